@@ -39,6 +39,7 @@
 #ifdef __FreeBSD__
 #include <pthread_np.h>
 #endif
+#include <sched.h>
 #include <semaphore.h>
 
 #include "os_thread.h"
@@ -400,6 +401,21 @@ os_thread_setaffinity_np(os_thread_t *thread, size_t set_size,
 		(cpu_set_t *)set);
 }
 
+/*
+ * os_thread_getcpu -- sched_getcpu abstraction layer
+ *
+ * Returns -1 if the CPU of the calling thread cannot be determined.
+ */
+int
+os_thread_getcpu(void)
+{
+#ifdef __linux__
+	return sched_getcpu();
+#else
+	return -1;
+#endif
+}
+
 /*
  * os_cpu_zero -- CP_ZERO abstraction layer
  */
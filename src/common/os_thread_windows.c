@@ -594,6 +594,16 @@ os_thread_setaffinity_np(os_thread_t *thread, size_t set_size,
 	return ret != 0 ? 0 : EINVAL;
 }
 
+/*
+ * os_thread_getcpu -- returns the number of the processor the calling thread
+ *	runs on, within its processor group
+ */
+int
+os_thread_getcpu(void)
+{
+	return (int)GetCurrentProcessorNumber();
+}
+
 /*
  * os_semaphore_init -- initializes a new semaphore instance
  */
@@ -305,6 +305,19 @@ static const char *str_2_pmempool_feature_map[] = {
 
 #define PMEMPOOL_FEATURE_2_STR_MAP_SIZE ARRAY_SIZE(str_2_pmempool_feature_map)
 
+/* features that are managed by the libraries themselves */
+static const features_t internal_feature_map[] = {
+	FEAT_INCOMPAT(OBJ_ULOG2),
+	FEAT_INCOMPAT(OBJ_LANES_EXT),
+};
+
+static const char *str_internal_feature_map[] = {
+	"OBJ_ULOG2",
+	"OBJ_LANES_EXT",
+};
+
+#define INTERNAL_FEATURE_MAP_SIZE ARRAY_SIZE(internal_feature_map)
+
 /*
  * util_str2feature -- convert string to feat_flags value
  */
@@ -366,5 +379,17 @@ util_feature2str(features_t features, features_t *found)
 			return str_2_pmempool_feature_map[i];
 		}
 	}
+
+	COMPILE_ERROR_ON(INTERNAL_FEATURE_MAP_SIZE !=
+			ARRAY_SIZE(str_internal_feature_map));
+
+	for (uint32_t i = 0; i < INTERNAL_FEATURE_MAP_SIZE; ++i) {
+		const features_t *record = &internal_feature_map[i];
+		if (util_feature_is_set(features, *record)) {
+			if (found)
+				memcpy(found, record, sizeof(features_t));
+			return str_internal_feature_map[i];
+		}
+	}
 	return NULL;
 }
@@ -2312,6 +2312,80 @@ util_header_create(struct pool_set *set, unsigned repidx, unsigned partidx,
 	return 0;
 }
 
+/*
+ * util_pool_feature_enable -- enables a feature in the headers of all the
+ *	parts of an open pool set
+ *
+ * The features of all the headers are verified to match when the pool set is
+ * opened, so once the feature is enabled in the first header of the master
+ * replica the function returns right away. The headers of remote replicas
+ * cannot be updated, and the ones of a pool set opened in copy-on-write mode
+ * are left alone, as nothing written to the pool reaches the files.
+ *
+ * Only the first part's header is still mapped after the pool set is opened
+ * (as a part of the pool), the headers of the remaining parts are mapped here.
+ */
+int
+util_pool_feature_enable(struct pool_set *set, features_t feature)
+{
+	LOG(3, "set %p feature {incompat %#x ro_compat %#x compat %#x}",
+		set, feature.incompat, feature.ro_compat, feature.compat);
+
+	if (set->cow)
+		return 0;
+
+	struct pool_hdr master;
+	memcpy(&master, REP(set, 0)->part[0].addr, sizeof(master));
+	util_convert2h_hdr_nocheck(&master);
+	if (util_feature_is_set(master.features, feature))
+		return 0;
+
+	for (unsigned r = 0; r < set->nreplicas; r++) {
+		if (set->replica[r]->remote) {
+			ERR("cannot update the header of remote replica #%u",
+				r);
+			errno = ENOTSUP;
+			return -1;
+		}
+	}
+
+	for (unsigned r = 0; r < set->nreplicas; r++) {
+		struct pool_replica *rep = set->replica[r];
+		for (unsigned p = 0; p < rep->nhdrs; p++) {
+			struct pool_set_part *part = &rep->part[p];
+			struct pool_hdr *hdrp = part->addr;
+			if (p != 0) {
+				if (util_map_hdr(part, MAP_SHARED, 0) != 0) {
+					LOG(2, "header mapping failed - "
+						"replica #%u part #%u", r, p);
+					return -1;
+				}
+				hdrp = part->hdr;
+			}
+
+			struct pool_hdr hdr;
+			memcpy(&hdr, hdrp, sizeof(hdr));
+			util_convert2h_hdr_nocheck(&hdr);
+
+			if (!util_feature_is_set(hdr.features, feature)) {
+				util_feature_enable(&hdr.features, feature);
+				util_convert2le_hdr(&hdr);
+				util_checksum(&hdr, sizeof(hdr), &hdr.checksum,
+					1, POOL_HDR_CSUM_END_OFF(&hdr));
+
+				memcpy(hdrp, &hdr, sizeof(hdr));
+				util_persist_auto(rep->is_pmem, hdrp,
+					sizeof(hdr));
+			}
+
+			if (p != 0)
+				util_unmap_hdr(part);
+		}
+	}
+
+	return 0;
+}
+
 /*
  * util_header_check -- (internal) validate header of a single pool set file
  */
@@ -3754,6 +3828,8 @@ util_pool_open_nocheck(struct pool_set *set, unsigned flags)
 	ASSERTne(set, NULL);
 	ASSERT(set->nreplicas > 0);
 
+	set->cow = cow;
+
 	if (flags & POOL_OPEN_CHECK_BAD_BLOCKS) {
 		/* check if any bad block recovery file exists */
 		if (badblocks_recovery_file_exists(set)) {
@@ -3909,6 +3985,8 @@ util_pool_open(struct pool_set **setp, const char *path, size_t minpartsize,
 
 	ASSERT(set->nreplicas > 0);
 
+	set->cow = cow;
+
 	uint32_t compat_features;
 
 	if (util_read_compat_features(set, &compat_features)) {
@@ -156,6 +156,7 @@ struct pool_set {
 	size_t poolsize;	/* the smallest replica size */
 	int has_bad_blocks;	/* pool set contains bad blocks */
 	int remote;		/* true if contains a remote replica */
+	int cow;		/* true if mapped in copy-on-write mode */
 	unsigned options;	/* enabled pool set options */
 
 	int directory_based;
@@ -380,6 +381,7 @@ int util_unmap_parts(struct pool_replica *rep, unsigned start_index,
 	unsigned end_index);
 int util_header_create(struct pool_set *set, unsigned repidx, unsigned partidx,
 	const struct pool_attr *attr, int overwrite);
+int util_pool_feature_enable(struct pool_set *set, features_t feature);
 
 int util_map_hdr(struct pool_set_part *part, int flags, int rdonly);
 void util_unmap_hdr(struct pool_set_part *part);
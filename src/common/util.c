@@ -128,19 +128,146 @@ util_is_zeroed(const void *addr, size_t len)
 }
 
 /*
- * util_checksum -- compute Fletcher64 checksum
+ * Fletcher64 is computed over little endian 32-bit words:
+ *	lo32 += w[i]; hi32 += lo32;
+ * For a block of n words it is equivalent to:
+ *	hi32 += n * lo32 + sum((n - i) * w[i]); lo32 += sum(w[i]);
+ * which lets the words of a block be summed independently of each other,
+ * both by the unrolled scalar loop and the vector one. The result is
+ * identical to the byte-serial definition of the checksum.
+ */
+
+/*
+ * util_checksum_seq_scalar -- (internal) sequential Fletcher64 checksum,
+ *	four words at a time
+ */
+static uint64_t
+util_checksum_seq_scalar(const void *addr, size_t len, uint64_t csum)
+{
+	const uint32_t *p32 = addr;
+	const uint32_t *p32end = (const uint32_t *)((const char *)addr + len);
+	uint32_t lo32 = (uint32_t)csum;
+	uint32_t hi32 = (uint32_t)(csum >> 32);
+
+	while (p32end - p32 >= 4) {
+		uint32_t w0 = le32toh(p32[0]);
+		uint32_t w1 = le32toh(p32[1]);
+		uint32_t w2 = le32toh(p32[2]);
+		uint32_t w3 = le32toh(p32[3]);
+
+		hi32 += 4 * lo32 + 4 * w0 + 3 * w1 + 2 * w2 + w3;
+		lo32 += w0 + w1 + w2 + w3;
+		p32 += 4;
+	}
+
+	while (p32 < p32end) {
+		lo32 += le32toh(*p32);
+		++p32;
+		hi32 += lo32;
+	}
+
+	return (uint64_t)hi32 << 32 | lo32;
+}
+
+#if (defined(__x86_64__) || defined(__amd64__)) && defined(__GNUC__)
+#include <immintrin.h>
+
+#define CHECKSUM_AVX2_WORDS 8 /* 32-bit words in a ymm register */
+#define CHECKSUM_AVX2_MIN 256 /* shorter buffers are not worth it */
+
+/*
+ * util_checksum_seq_avx2 -- (internal) sequential Fletcher64 checksum,
+ *	eight words at a time
  *
- * csump points to where the checksum lives, so that location
- * is treated as zeros while calculating the checksum. The
- * checksummed data is assumed to be in little endian order.
- * If insert is true, the calculated checksum is inserted into
- * the range at *csump.  Otherwise the calculated checksum is
- * checked against *csump and the result returned (true means
- * the range checksummed correctly).
+ * Each lane j accumulates the sum of its words (a[j]) and the sum of
+ * those partial sums after every block (b[j]), which is the sum of its
+ * words weighted by the number of remaining blocks. The lanes are merged
+ * once, at the end.
  */
-int
-util_checksum(void *addr, size_t len, uint64_t *csump,
-	int insert, size_t skip_off)
+__attribute__((target("avx2")))
+static uint64_t
+util_checksum_seq_avx2(const void *addr, size_t len, uint64_t csum)
+{
+	const __m256i *p = addr;
+	size_t nblocks = len / sizeof(__m256i);
+	uint32_t lo32 = (uint32_t)csum;
+	uint32_t hi32 = (uint32_t)(csum >> 32);
+
+	__m256i va = _mm256_setzero_si256();
+	__m256i vb = _mm256_setzero_si256();
+
+	for (size_t i = 0; i < nblocks; ++i) {
+		va = _mm256_add_epi32(va, _mm256_loadu_si256(p + i));
+		vb = _mm256_add_epi32(vb, va);
+	}
+
+	uint32_t a[CHECKSUM_AVX2_WORDS];
+	uint32_t b[CHECKSUM_AVX2_WORDS];
+	_mm256_storeu_si256((__m256i *)a, va);
+	_mm256_storeu_si256((__m256i *)b, vb);
+
+	hi32 += (uint32_t)(nblocks * CHECKSUM_AVX2_WORDS) * lo32;
+	for (unsigned j = 0; j < CHECKSUM_AVX2_WORDS; ++j) {
+		hi32 += CHECKSUM_AVX2_WORDS * b[j] - j * a[j];
+		lo32 += a[j];
+	}
+
+	size_t done = nblocks * sizeof(__m256i);
+
+	return util_checksum_seq_scalar((const char *)addr + done,
+			len - done, (uint64_t)hi32 << 32 | lo32);
+}
+
+/*
+ * util_checksum_seq_auto -- (internal) sequential Fletcher64 checksum,
+ *	vectorized for buffers long enough to amortize the setup
+ */
+static uint64_t
+util_checksum_seq_auto(const void *addr, size_t len, uint64_t csum)
+{
+	if (len < CHECKSUM_AVX2_MIN)
+		return util_checksum_seq_scalar(addr, len, csum);
+
+	return util_checksum_seq_avx2(addr, len, csum);
+}
+
+/* checksum implementation, picked in util_init */
+static uint64_t (*Checksum_seq)(const void *addr, size_t len,
+		uint64_t csum) = util_checksum_seq_scalar;
+
+/*
+ * util_checksum_init -- (internal) picks the fastest implementation
+ *	of the checksum supported by the cpu
+ */
+static void
+util_checksum_init(void)
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		Checksum_seq = util_checksum_seq_auto;
+}
+
+#define CHECKSUM_SEQ(addr, len, csum) Checksum_seq(addr, len, csum)
+#else
+static void
+util_checksum_init(void)
+{
+}
+
+#define CHECKSUM_SEQ(addr, len, csum)\
+	util_checksum_seq_scalar(addr, len, csum)
+#endif
+
+/*
+ * util_checksum_compute -- compute Fletcher64 checksum of the range, treating
+ *	the checksum at csump and everything past skip_off as zeros
+ *
+ * The zeroed areas are consumed in pairs of 32-bit words, just as the
+ * original byte-serial loop did.
+ */
+uint64_t
+util_checksum_compute(void *addr, size_t len, uint64_t *csump,
+	size_t skip_off)
 {
 	if (len % 4 != 0)
 		abort();
@@ -148,30 +275,60 @@ util_checksum(void *addr, size_t len, uint64_t *csump,
 	uint32_t *p32 = addr;
 	uint32_t *p32end = (uint32_t *)((char *)addr + len);
 	uint32_t *skip;
-	uint32_t lo32 = 0;
-	uint32_t hi32 = 0;
-	uint64_t csum;
+	uint32_t *c32 = (uint32_t *)csump;
+	uint64_t csum = 0;
 
 	if (skip_off)
 		skip = (uint32_t *)((char *)addr + skip_off);
 	else
-		skip = (uint32_t *)((char *)addr + len);
-
-	while (p32 < p32end)
-		if (p32 == (uint32_t *)csump || p32 >= skip) {
-			/* lo32 += 0; treat first 32-bits as zero */
-			p32++;
-			hi32 += lo32;
-			/* lo32 += 0; treat second 32-bits as zero */
-			p32++;
-			hi32 += lo32;
-		} else {
-			lo32 += le32toh(*p32);
-			++p32;
-			hi32 += lo32;
-		}
+		skip = p32end;
+
+	if (c32 >= p32 && c32 < skip &&
+	    ((uintptr_t)c32 - (uintptr_t)p32) % sizeof(*p32) == 0) {
+		csum = CHECKSUM_SEQ(p32, (size_t)(c32 - p32) * sizeof(*p32),
+			csum);
+		/* treat both 32-bit halves of the checksum as zero */
+		uint32_t lo32 = (uint32_t)csum;
+		uint32_t hi32 = (uint32_t)(csum >> 32) + 2 * lo32;
+		csum = (uint64_t)hi32 << 32 | lo32;
+		p32 = c32 + 2;
+	}
 
-	csum = (uint64_t)hi32 << 32 | lo32;
+	if (p32 < skip) {
+		csum = CHECKSUM_SEQ(p32, (size_t)(skip - p32) * sizeof(*p32),
+			csum);
+		p32 = skip;
+	}
+
+	if (p32 < p32end) {
+		/* the skipped tail is treated as zeros, two words at a time */
+		size_t nzeros = (size_t)(p32end - p32);
+		nzeros += nzeros % 2;
+		uint32_t lo32 = (uint32_t)csum;
+		uint32_t hi32 = (uint32_t)(csum >> 32) +
+			(uint32_t)nzeros * lo32;
+		csum = (uint64_t)hi32 << 32 | lo32;
+	}
+
+	return csum;
+}
+
+/*
+ * util_checksum -- compute Fletcher64 checksum
+ *
+ * csump points to where the checksum lives, so that location
+ * is treated as zeros while calculating the checksum. The
+ * checksummed data is assumed to be in little endian order.
+ * If insert is true, the calculated checksum is inserted into
+ * the range at *csump.  Otherwise the calculated checksum is
+ * checked against *csump and the result returned (true means
+ * the range checksummed correctly).
+ */
+int
+util_checksum(void *addr, size_t len, uint64_t *csump,
+	int insert, size_t skip_off)
+{
+	uint64_t csum = util_checksum_compute(addr, len, csump, skip_off);
 
 	if (insert) {
 		*csump = htole64(csum);
@@ -191,16 +348,8 @@ util_checksum_seq(const void *addr, size_t len, uint64_t csum)
 {
 	if (len % 4 != 0)
 		abort();
-	const uint32_t *p32 = addr;
-	const uint32_t *p32end = (const uint32_t *)((const char *)addr + len);
-	uint32_t lo32 = (uint32_t)csum;
-	uint32_t hi32 = (uint32_t)(csum >> 32);
-	while (p32 < p32end) {
-		lo32 += le32toh(*p32);
-		++p32;
-		hi32 += lo32;
-	}
-	return (uint64_t)hi32 << 32 | lo32;
+
+	return CHECKSUM_SEQ(addr, len, csum);
 }
 
 /*
@@ -305,6 +454,8 @@ util_init(void)
 	_On_valgrind = RUNNING_ON_VALGRIND;
 #endif
 
+	util_checksum_init();
+
 #if VG_PMEMCHECK_ENABLED
 	if (On_valgrind) {
 		char *pmreorder_env = getenv("PMREORDER_EMIT_LOG");
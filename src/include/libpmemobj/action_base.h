@@ -82,6 +82,8 @@ PMEMoid pmemobj_xreserve(PMEMobjpool *pop, struct pobj_action *act,
 	size_t size, uint64_t type_num, uint64_t flags);
 void pmemobj_set_value(PMEMobjpool *pop, struct pobj_action *act,
 	uint64_t *ptr, uint64_t value);
+int pmemobj_set_buf(PMEMobjpool *pop, struct pobj_action *act,
+	void *dest, const void *src, size_t size);
 void pmemobj_defer_free(PMEMobjpool *pop, PMEMoid oid, struct pobj_action *act);
 
 int pmemobj_publish(PMEMobjpool *pop, struct pobj_action *actv,
@@ -90,6 +92,21 @@ int pmemobj_tx_publish(struct pobj_action *actv, size_t actvcnt);
 
 void pmemobj_cancel(PMEMobjpool *pop, struct pobj_action *actv, size_t actvcnt);
 
+/* the maximum number of words updated by a single pmemobj_mwcas */
+#define POBJ_MWCAS_MAX_WORDS 4
+
+/* the bit of the words updated by pmemobj_mwcas reserved for the library */
+#define POBJ_MWCAS_RESERVED_BIT (1ULL << 63)
+
+struct pobj_mwcas {
+	uint64_t *ptr;
+	uint64_t old_value;
+	uint64_t new_value;
+};
+
+int pmemobj_mwcas(PMEMobjpool *pop, struct pobj_mwcas *words, size_t nwords);
+uint64_t pmemobj_mwcas_read(PMEMobjpool *pop, const uint64_t *ptr);
+
 #ifdef __cplusplus
 }
 #endif
@@ -71,8 +71,10 @@ typedef struct pmemobjpool PMEMobjpool;
 /*
  * allocation functions flags
  */
-#define POBJ_FLAG_ZERO		(((uint64_t)1) << 0)
-#define POBJ_FLAG_NO_FLUSH	(((uint64_t)1) << 1)
+#define POBJ_FLAG_ZERO			(((uint64_t)1) << 0)
+#define POBJ_FLAG_NO_FLUSH		(((uint64_t)1) << 1)
+#define POBJ_FLAG_NO_SNAPSHOT		(((uint64_t)1) << 2)
+#define POBJ_FLAG_ASSUME_INITIALIZED	(((uint64_t)1) << 3)
 
 #define POBJ_CLASS_ID(id)	(((uint64_t)(id)) << 48)
 
@@ -116,6 +118,20 @@ static const PMEMoid OID_NULL = { 0, 0 };
 ((lhs).off == (rhs).off &&\
 	(lhs).pool_uuid_lo == (rhs).pool_uuid_lo)
 
+/*
+ * Compact object handle
+ *
+ * Holds only the offset of the object, the pool is implied by the location
+ * of the handle itself, which must reside in the same pool as the object.
+ */
+typedef struct pmemcoid {
+	uint64_t off;
+} PMEMcoid;
+
+static const PMEMcoid COID_NULL = { 0 };
+#define COID_IS_NULL(o)	((o).off == 0)
+#define COID_EQUALS(lhs, rhs)	((lhs).off == (rhs).off)
+
 PMEMobjpool *pmemobj_pool_by_ptr(const void *addr);
 PMEMobjpool *pmemobj_pool_by_oid(PMEMoid oid);
 
@@ -187,6 +203,22 @@ void *pmemobj_volatile(PMEMobjpool *pop, struct pmemvlt *vlt,
  */
 PMEMoid pmemobj_oid(const void *addr);
 
+/*
+ * Returns the direct pointer of an object referenced by a compact handle.
+ */
+void *pmemobj_cdirect(const PMEMcoid *coid);
+
+/*
+ * Converts a compact handle to a regular object handle.
+ */
+PMEMoid pmemobj_coid_to_oid(const PMEMcoid *coid);
+
+/*
+ * Points the compact handle to the object. Does not make the handle
+ * persistent.
+ */
+int pmemobj_coid_from_oid(PMEMcoid *coid, PMEMoid oid);
+
 /*
  * Returns the number of usable bytes in the object. May be greater than
  * the requested size of the object because of internal alignment.
@@ -38,6 +38,7 @@
 #define LIBPMEMOBJ_CTL_H 1
 
 #include <stddef.h>
+#include <stdint.h>
 #include <sys/types.h>
 
 #include <libpmemobj/base.h>
@@ -166,6 +167,25 @@ struct pobj_alloc_class_desc {
 	unsigned class_id;
 };
 
+/*
+ * The number of buckets of the transaction latency histogram.
+ */
+#define POBJ_TX_LATENCY_BUCKETS 32
+
+/*
+ * Histogram of the latencies of the committed transactions, read from the
+ * stats.tx.latency entry point.
+ */
+struct pobj_tx_latency {
+	/*
+	 * The i-th bucket counts the transactions that took at least 2^i and
+	 * less than 2^(i+1) nanoseconds, from the beginning of the outermost
+	 * transaction until the end of its commit. The last bucket also counts
+	 * all the transactions that took longer.
+	 */
+	uint64_t count[POBJ_TX_LATENCY_BUCKETS];
+};
+
 #ifndef _WIN32
 /* EXPERIMENTAL */
 int pmemobj_ctl_get(PMEMobjpool *pop, const char *name, void *arg);
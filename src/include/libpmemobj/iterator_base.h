@@ -61,6 +61,21 @@ PMEMoid pmemobj_first(PMEMobjpool *pop);
  */
 PMEMoid pmemobj_next(PMEMoid oid);
 
+/*
+ * Matches objects of all type numbers in pmemobj_foreach_parallel.
+ */
+#define POBJ_ANY_TYPE_NUM (~0ULL)
+
+typedef int (*pmemobj_foreach_cb)(PMEMoid oid, void *arg);
+
+/*
+ * Calls cb for every object of the specified type number, concurrently from
+ * up to nthreads threads (the number of CPUs if 0). Iteration stops once cb
+ * returns a non-zero value, which is then returned.
+ */
+int pmemobj_foreach_parallel(PMEMobjpool *pop, uint64_t type_num,
+	pmemobj_foreach_cb cb, void *arg, unsigned nthreads);
+
 
 #ifdef __cplusplus
 }
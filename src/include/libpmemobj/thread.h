@@ -64,6 +64,11 @@ typedef union {
 	char padding[_POBJ_CL_SIZE];
 } PMEMcond;
 
+typedef union {
+	long long align;
+	char padding[_POBJ_CL_SIZE];
+} PMEMseqlock;
+
 void pmemobj_mutex_zero(PMEMobjpool *pop, PMEMmutex *mutexp);
 int pmemobj_mutex_lock(PMEMobjpool *pop, PMEMmutex *mutexp);
 int pmemobj_mutex_timedlock(PMEMobjpool *pop, PMEMmutex *__restrict mutexp,
@@ -93,6 +98,28 @@ int pmemobj_cond_timedwait(PMEMobjpool *pop, PMEMcond *__restrict condp,
 int pmemobj_cond_wait(PMEMobjpool *pop, PMEMcond *condp,
 	PMEMmutex *__restrict mutexp);
 
+void pmemobj_seqlock_zero(PMEMobjpool *pop, PMEMseqlock *seqlockp);
+int pmemobj_seqlock_wrlock(PMEMobjpool *pop, PMEMseqlock *seqlockp);
+int pmemobj_seqlock_unlock(PMEMobjpool *pop, PMEMseqlock *seqlockp);
+uint64_t pmemobj_seqlock_read_begin(PMEMobjpool *pop, PMEMseqlock *seqlockp);
+int pmemobj_seqlock_read_retry(PMEMobjpool *pop, PMEMseqlock *seqlockp,
+	uint64_t seq);
+
+/*
+ * Optimistic read section protected by a PMEMseqlock. The section is repeated
+ * until it executes without a concurrent writer, so it must not have any side
+ * effects other than copying out the protected data and must not leave the
+ * section with break, return or goto.
+ */
+#define POBJ_SEQLOCK_READ_BEGIN(pop, seqlockp) {\
+	uint64_t _pobj_seq;\
+	do {\
+		_pobj_seq = pmemobj_seqlock_read_begin((pop), (seqlockp));
+
+#define POBJ_SEQLOCK_READ_END(pop, seqlockp)\
+	} while (pmemobj_seqlock_read_retry((pop), (seqlockp), _pobj_seq));\
+}
+
 #ifdef __cplusplus
 }
 #endif
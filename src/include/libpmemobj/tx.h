@@ -166,6 +166,9 @@ pmemobj_tx_xadd_range_direct(&(p)->field, sizeof((p)->field), flags)
 
 #define TX_ZREALLOC(o, size)\
 ((__typeof__(o))pmemobj_tx_zrealloc((o).oid, size, TOID_TYPE_NUM_OF(o)))
+
+#define TX_COW(o)\
+((__typeof__(o))pmemobj_tx_cow(&(o).oid))
 #endif /* !defined(_MSC_VER) || defined(__cplusplus) */
 
 #define TX_STRDUP(s, type_num)\
@@ -72,6 +72,9 @@ enum pobj_tx_param {
 	TX_PARAM_MUTEX,	 /* PMEMmutex */
 	TX_PARAM_RWLOCK, /* PMEMrwlock */
 	TX_PARAM_CB,	 /* pmemobj_tx_callback cb, void *arg */
+	TX_PARAM_REDO,	 /* no arguments */
+	TX_PARAM_RELAXED_DURABILITY, /* no arguments */
+	TX_PARAM_SEQLOCK, /* PMEMseqlock */
 };
 
 #if !defined(_has_deprecated_with_message) && defined(__clang__)
@@ -108,8 +111,12 @@ typedef void (*pmemobj_tx_callback)(PMEMobjpool *pop, enum pobj_tx_stage stage,
 	POBJ_XALLOC_NO_FLUSH |\
 	POBJ_XALLOC_CLASS_MASK)
 
-#define POBJ_XADD_NO_FLUSH	POBJ_FLAG_NO_FLUSH
-#define POBJ_XADD_VALID_FLAGS	POBJ_XADD_NO_FLUSH
+#define POBJ_XADD_NO_FLUSH		POBJ_FLAG_NO_FLUSH
+#define POBJ_XADD_NO_SNAPSHOT		POBJ_FLAG_NO_SNAPSHOT
+#define POBJ_XADD_ASSUME_INITIALIZED	POBJ_FLAG_ASSUME_INITIALIZED
+#define POBJ_XADD_VALID_FLAGS	(POBJ_XADD_NO_FLUSH |\
+	POBJ_XADD_NO_SNAPSHOT |\
+	POBJ_XADD_ASSUME_INITIALIZED)
 
 /*
  * Starts a new transaction in the current thread.
@@ -203,6 +210,10 @@ int pmemobj_tx_add_range_direct(const void *ptr, size_t size);
  * Behaves exactly the same as pmemobj_tx_add_range when 'flags' equals 0.
  * 'Flags' is a bitmask of the following values:
  *  - POBJ_XADD_NO_FLUSH - skips flush on commit
+ *  - POBJ_XADD_NO_SNAPSHOT - skips snapshot, the contents of the range
+ *	are undefined after abort
+ *  - POBJ_XADD_ASSUME_INITIALIZED - skips the check for uninitialized data
+ *	under Valgrind
  */
 int pmemobj_tx_xadd_range(PMEMoid oid, uint64_t off, size_t size,
 		uint64_t flags);
@@ -211,9 +222,32 @@ int pmemobj_tx_xadd_range(PMEMoid oid, uint64_t off, size_t size,
  * Behaves exactly the same as pmemobj_tx_add_range_direct when 'flags' equals
  * 0. 'Flags' is a bitmask of the following values:
  *  - POBJ_XADD_NO_FLUSH - skips flush on commit
+ *  - POBJ_XADD_NO_SNAPSHOT - skips snapshot, the contents of the range
+ *	are undefined after abort
+ *  - POBJ_XADD_ASSUME_INITIALIZED - skips the check for uninitialized data
+ *	under Valgrind
  */
 int pmemobj_tx_xadd_range_direct(const void *ptr, size_t size, uint64_t flags);
 
+/*
+ * Returns the pointer through which the range should be accessed within
+ * the current transaction. In a redo-only transaction (TX_PARAM_REDO), this
+ * is the buffered copy of the range if it was added to the transaction.
+ * Otherwise, the pointer itself is returned.
+ */
+void *pmemobj_tx_access(void *ptr, size_t size);
+
+/*
+ * Takes a "snapshot" of the compact handle and points it to the object.
+ * The handle and the object have to belong to the pool of the transaction.
+ *
+ * If successful, returns zero.
+ * Otherwise, state changes to TX_STAGE_ONABORT and an error number is returned.
+ *
+ * This function must be called during TX_STAGE_WORK.
+ */
+int pmemobj_tx_coid_set(PMEMcoid *coid, PMEMoid oid);
+
 /*
  * Transactionally allocates a new object.
  *
@@ -298,6 +332,22 @@ PMEMoid pmemobj_tx_wcsdup(const wchar_t *s, uint64_t type_num);
  */
 int pmemobj_tx_free(PMEMoid oid);
 
+/*
+ * Transactionally replaces the object pointed to by the handle with a copy.
+ *
+ * Returns the copy of the object, which is modified instead of the object
+ * itself and does not have to be added to the transaction. On commit, the
+ * handle is pointed to the copy and the original object is freed. Other
+ * handles to the same object are registered by calling the function with
+ * each of them, they are all pointed to the same copy.
+ *
+ * If successful, returns the handle of the copy.
+ * Otherwise, state changes to TX_STAGE_ONABORT and an OID_NULL is returned.
+ *
+ * This function must be called during TX_STAGE_WORK.
+ */
+PMEMoid pmemobj_tx_cow(PMEMoid *oidp);
+
 #ifdef __cplusplus
 }
 #endif
@@ -49,6 +49,7 @@
 #include "container_ravl.h"
 #include "container_seglists.h"
 #include "alloc_class.h"
+#include "os.h"
 #include "os_thread.h"
 #include "set.h"
 
@@ -71,6 +72,26 @@ struct arena {
 	size_t nthreads;
 };
 
+/*
+ * Free huge chunks can be zeroed in the background, so that zeroed allocations
+ * don't have to memset the memory on the allocating thread. Such chunks are
+ * kept in a bucket separate from the default one, and are used by the regular
+ * allocations only once there's no other free memory left.
+ */
+struct heap_prezero {
+	struct bucket *bucket;
+	uint64_t nchunks; /* number of chunks in the prezero bucket */
+
+	/* protects the worker state below */
+	os_mutex_t lock;
+	os_cond_t cond;
+
+	size_t size; /* requested amount of zeroed free memory */
+	int running;
+	int stop;
+	os_thread_t worker;
+};
+
 struct heap_rt {
 	struct alloc_class_collection *alloc_classes;
 
@@ -92,6 +113,8 @@ struct heap_rt {
 	unsigned nzones;
 	unsigned zones_exhausted;
 	unsigned narenas;
+
+	struct heap_prezero prezero;
 };
 
 /*
@@ -338,6 +361,40 @@ heap_memblock_insert_block(const struct memory_block *m, void *b)
 	return bucket_insert_block(b, m);
 }
 
+/*
+ * heap_run_recycler -- (internal) returns the recycler that tracks the bitmap
+ *	mirror of the run, NULL if the run doesn't match any allocation class
+ */
+static struct recycler *
+heap_run_recycler(struct palloc_heap *heap, const struct memory_block *m)
+{
+	struct chunk_header *hdr = heap_get_chunk_hdr(heap, m);
+	struct chunk_run *run = heap_get_chunk_run(heap, m);
+
+	ASSERTeq(hdr->type, CHUNK_TYPE_RUN);
+
+	struct alloc_class *c = alloc_class_by_run(
+		heap->rt->alloc_classes,
+		run->hdr.block_size, hdr->flags, hdr->size_idx);
+
+	return c == NULL ? NULL : heap->rt->recyclers[c->id];
+}
+
+/*
+ * heap_run_iterate_free -- (internal) iterates over free blocks of a run,
+ *	must be called with the run lock held
+ */
+static int
+heap_run_iterate_free(struct palloc_heap *heap, const struct memory_block *m,
+	object_callback cb, void *arg)
+{
+	struct recycler *r = heap_run_recycler(heap, m);
+	if (r == NULL)
+		return m->m_ops->iterate_free(m, cb, arg);
+
+	return recycler_run_iterate_free(r, m, cb, arg);
+}
+
 /*
  * heap_run_create -- (internal) initializes a new run on an existing free chunk
  */
@@ -350,7 +407,15 @@ heap_run_create(struct palloc_heap *heap, struct bucket *b,
 		b->aclass->flags, b->aclass->unit_size,
 		b->aclass->run.alignment);
 
-	if (m->m_ops->iterate_free(m, heap_memblock_insert_block, b) != 0) {
+	os_mutex_t *lock = m->m_ops->get_lock(m);
+
+	util_mutex_lock(lock);
+
+	int ret = heap_run_iterate_free(heap, m, heap_memblock_insert_block, b);
+
+	util_mutex_unlock(lock);
+
+	if (ret != 0) {
 		b->c_ops->rm_all(b->container);
 		return -1;
 	}
@@ -372,7 +437,7 @@ heap_run_reuse(struct palloc_heap *heap, struct bucket *b,
 
 	util_mutex_lock(lock);
 
-	ret = m->m_ops->iterate_free(m, heap_memblock_insert_block, b);
+	ret = heap_run_iterate_free(heap, m, heap_memblock_insert_block, b);
 
 	util_mutex_unlock(lock);
 
@@ -455,8 +520,8 @@ heap_reclaim_run(struct palloc_heap *heap, struct memory_block *m)
 		heap->rt->alloc_classes,
 		run->hdr.block_size, hdr->flags, m->size_idx);
 
-	struct recycler_element e = recycler_element_new(heap, m);
 	if (c == NULL) {
+		struct recycler_element e = recycler_element_new(heap, m);
 		uint32_t size_idx = m->size_idx;
 		struct run_bitmap b;
 		m->m_ops->get_bitmap(m, &b);
@@ -466,10 +531,15 @@ heap_reclaim_run(struct palloc_heap *heap, struct memory_block *m)
 		return e.free_space == b.nbits;
 	}
 
-	if (e.free_space == c->run.nallocs)
+	struct recycler *r = heap->rt->recyclers[c->id];
+	struct recycler_element e = recycler_element_from_mirror(r, m);
+
+	if (e.free_space == c->run.nallocs) {
+		recycler_mirror_remove(r, m);
 		return 1;
+	}
 
-	if (recycler_put(heap->rt->recyclers[c->id], m, e) < 0)
+	if (recycler_put(r, m, e) < 0)
 		ERR("lost runtime tracking info of %u run due to OOM", c->id);
 
 	return 0;
@@ -600,6 +670,37 @@ heap_reclaim_garbage(struct palloc_heap *heap, struct bucket *bucket)
 	return ret;
 }
 
+/*
+ * heap_prezero_reclaim -- (internal) moves all of the zeroed chunks back into
+ *	the default bucket
+ */
+static int
+heap_prezero_reclaim(struct palloc_heap *heap, struct bucket *defb)
+{
+	struct heap_prezero *pz = &heap->rt->prezero;
+	struct bucket *zb = pz->bucket;
+	int ret = ENOMEM;
+
+	util_mutex_lock(&zb->lock);
+
+	struct memory_block m = MEMORY_BLOCK_NONE;
+	m.size_idx = 1;
+	while (zb->c_ops->get_rm_bestfit(zb->container, &m) == 0) {
+		util_fetch_and_sub64(&pz->nchunks, m.size_idx);
+
+		if (heap_free_chunk_reuse(heap, defb, &m) != 0)
+			LOG(2, "unable to track runtime chunk state");
+
+		m = MEMORY_BLOCK_NONE;
+		m.size_idx = 1;
+		ret = 0;
+	}
+
+	util_mutex_unlock(&zb->lock);
+
+	return ret;
+}
+
 /*
  * heap_ensure_huge_bucket_filled --
  *	(internal) refills the default bucket if needed
@@ -613,6 +714,9 @@ heap_ensure_huge_bucket_filled(struct palloc_heap *heap, struct bucket *bucket)
 	if (heap_populate_bucket(heap, bucket) == 0)
 		return 0;
 
+	if (heap_prezero_reclaim(heap, bucket) == 0)
+		return 0;
+
 	int extend;
 	if ((extend = heap_extend(heap, bucket, heap->growsize)) < 0)
 		return ENOMEM;
@@ -732,28 +836,37 @@ out:
 }
 
 /*
- * heap_memblock_on_free -- bookkeeping actions executed at every free of a
- *	block
+ * heap_memblock_on_alloc -- bookkeeping actions executed at every allocation
+ *	of a block, must be called with the run lock held
  */
 void
-heap_memblock_on_free(struct palloc_heap *heap, const struct memory_block *m)
+heap_memblock_on_alloc(struct palloc_heap *heap, const struct memory_block *m)
 {
 	if (m->type != MEMORY_BLOCK_RUN)
 		return;
 
-	struct chunk_header *hdr = heap_get_chunk_hdr(heap, m);
-	struct chunk_run *run = heap_get_chunk_run(heap, m);
+	struct recycler *r = heap_run_recycler(heap, m);
+	if (r == NULL)
+		return;
 
-	ASSERTeq(hdr->type, CHUNK_TYPE_RUN);
+	recycler_mark_allocated(r, m);
+}
 
-	struct alloc_class *c = alloc_class_by_run(
-		heap->rt->alloc_classes,
-		run->hdr.block_size, hdr->flags, hdr->size_idx);
+/*
+ * heap_memblock_on_free -- bookkeeping actions executed at every free of a
+ *	block
+ */
+void
+heap_memblock_on_free(struct palloc_heap *heap, const struct memory_block *m)
+{
+	if (m->type != MEMORY_BLOCK_RUN)
+		return;
 
-	if (c == NULL)
+	struct recycler *r = heap_run_recycler(heap, m);
+	if (r == NULL)
 		return;
 
-	recycler_inc_unaccounted(heap->rt->recyclers[c->id], m);
+	recycler_inc_unaccounted(r, m);
 }
 
 /*
@@ -823,6 +936,262 @@ heap_get_bestfit_block(struct palloc_heap *heap, struct bucket *b,
 	return 0;
 }
 
+/*
+ * The free block containers store the memory block structure at the beginning
+ * of each free block, which means that the first few bytes of any chunk that
+ * was at some point inserted into the prezero bucket might no longer be zero.
+ */
+#define HEAP_PREZERO_DIRTY_SIZE \
+(sizeof(struct allocation_header_legacy) + sizeof(struct memory_block))
+
+/*
+ * heap_get_zeroed_block -- extracts a memory block of equal size index from
+ *	the chunks that were zeroed in the background
+ */
+int
+heap_get_zeroed_block(struct palloc_heap *heap, struct memory_block *m)
+{
+	struct heap_prezero *pz = &heap->rt->prezero;
+	struct bucket *zb = pz->bucket;
+	uint32_t units = m->size_idx;
+
+	uint64_t nchunks;
+	util_atomic_load_explicit64(&pz->nchunks, &nchunks,
+		memory_order_acquire);
+	if (nchunks < units)
+		return ENOMEM;
+
+	util_mutex_lock(&zb->lock);
+
+	if (zb->c_ops->get_rm_bestfit(zb->container, m) != 0) {
+		util_mutex_unlock(&zb->lock);
+		return ENOMEM;
+	}
+
+	ASSERT(m->size_idx >= units);
+
+	if (units != m->size_idx)
+		heap_split_block(heap, zb, m, units);
+
+	util_fetch_and_sub64(&pz->nchunks, units);
+
+	util_mutex_unlock(&zb->lock);
+
+	for (uint32_t i = 0; i < m->size_idx; ++i) {
+		struct chunk *c = GET_CHUNK(heap->layout, m->zone_id,
+			m->chunk_id + i);
+		VALGRIND_DO_MAKE_MEM_UNDEFINED(c, HEAP_PREZERO_DIRTY_SIZE);
+		pmemops_memset(&heap->p_ops, c, 0, HEAP_PREZERO_DIRTY_SIZE,
+			PMEMOBJ_F_MEM_NODRAIN);
+	}
+	pmemops_drain(&heap->p_ops);
+
+	m->m_ops->ensure_header_type(m, zb->aclass->header_type);
+	m->header_type = zb->aclass->header_type;
+
+	/* let the worker know that the zeroed memory needs to be refilled */
+	util_mutex_lock(&pz->lock);
+	os_cond_signal(&pz->cond);
+	util_mutex_unlock(&pz->lock);
+
+	return 0;
+}
+
+/*
+ * The largest number of chunks that the prezero worker takes out of the
+ * default bucket at once. The zeroed chunks are coalesced with their
+ * neighbours in the prezero bucket, so this doesn't limit the size of the
+ * zeroed allocations, only the amount of memory that's unavailable
+ * to the allocator while it is being zeroed.
+ */
+#define HEAP_PREZERO_MAX_CHUNKS 16
+
+/* how long the worker waits before looking for free chunks again */
+#define HEAP_PREZERO_RETRY_SEC 1
+
+/*
+ * heap_prezero_chunks -- (internal) takes a free block out of the default
+ *	bucket, zeroes it and inserts it into the prezero bucket
+ */
+static int
+heap_prezero_chunks(struct palloc_heap *heap, uint32_t units)
+{
+	struct heap_prezero *pz = &heap->rt->prezero;
+
+	struct bucket *defb = heap_bucket_acquire_by_id(heap,
+		DEFAULT_ALLOC_CLASS_ID);
+
+	struct memory_block m = MEMORY_BLOCK_NONE;
+	m.size_idx = units;
+	int ret = defb->c_ops->get_rm_bestfit(defb->container, &m);
+	if (ret != 0) {
+		m = MEMORY_BLOCK_NONE;
+		m.size_idx = 1;
+		ret = defb->c_ops->get_rm_bestfit(defb->container, &m);
+	}
+
+	if (ret == 0 && m.size_idx > units)
+		heap_split_block(heap, defb, &m, units);
+
+	/*
+	 * The last free block is left to the allocator, otherwise the
+	 * worker would compete for memory with the application.
+	 */
+	if (ret == 0 && defb->c_ops->is_empty(defb->container)) {
+		bucket_insert_block(defb, &m);
+		ret = ENOMEM;
+	}
+
+	heap_bucket_release(heap, defb);
+
+	if (ret != 0)
+		return ret;
+
+	void *data = heap_get_chunk(heap, &m);
+	size_t size = (size_t)m.size_idx * CHUNKSIZE;
+
+	VALGRIND_DO_MAKE_MEM_UNDEFINED(data, size);
+	pmemops_memset(&heap->p_ops, data, 0, size,
+		PMEMOBJ_F_MEM_NONTEMPORAL);
+	VALGRIND_DO_MAKE_MEM_NOACCESS(data, size);
+
+	struct bucket *zb = pz->bucket;
+	util_mutex_lock(&zb->lock);
+
+	uint32_t nchunks = m.size_idx;
+	if (heap_free_chunk_reuse(heap, zb, &m) != 0)
+		LOG(2, "unable to track runtime chunk state");
+	else
+		util_fetch_and_add64(&pz->nchunks, nchunks);
+
+	util_mutex_unlock(&zb->lock);
+
+	return 0;
+}
+
+/*
+ * heap_prezero_worker -- (internal) keeps the requested amount of free
+ *	memory zeroed
+ */
+static void *
+heap_prezero_worker(void *arg)
+{
+	struct palloc_heap *heap = arg;
+	struct heap_prezero *pz = &heap->rt->prezero;
+
+	util_mutex_lock(&pz->lock);
+
+	while (!pz->stop) {
+		uint64_t nchunks;
+		util_atomic_load_explicit64(&pz->nchunks, &nchunks,
+			memory_order_acquire);
+
+		uint64_t target = pz->size / CHUNKSIZE;
+		if (nchunks >= target) {
+			os_cond_wait(&pz->cond, &pz->lock);
+			continue;
+		}
+
+		uint64_t units = target - nchunks;
+		if (units > HEAP_PREZERO_MAX_CHUNKS)
+			units = HEAP_PREZERO_MAX_CHUNKS;
+
+		util_mutex_unlock(&pz->lock);
+		int ret = heap_prezero_chunks(heap, (uint32_t)units);
+		util_mutex_lock(&pz->lock);
+
+		if (ret != 0 && !pz->stop) {
+			/* no free chunks right now, try again later */
+			struct timespec abs_timeout;
+			os_clock_gettime(CLOCK_REALTIME, &abs_timeout);
+			abs_timeout.tv_sec += HEAP_PREZERO_RETRY_SEC;
+			os_cond_timedwait(&pz->cond, &pz->lock, &abs_timeout);
+		}
+	}
+
+	util_mutex_unlock(&pz->lock);
+
+	return NULL;
+}
+
+/*
+ * heap_prezero_set_size -- changes the amount of free memory that is kept
+ *	zeroed in the background, starts the worker thread if needed
+ */
+int
+heap_prezero_set_size(struct palloc_heap *heap, size_t size)
+{
+	struct heap_prezero *pz = &heap->rt->prezero;
+	int ret = 0;
+
+	util_mutex_lock(&pz->lock);
+
+	if (size != 0 && !pz->running) {
+		ret = os_thread_create(&pz->worker, NULL,
+			heap_prezero_worker, heap);
+		if (ret != 0) {
+			errno = ret;
+			ERR("!failed to create the prezero worker");
+			ret = -1;
+			goto out;
+		}
+		pz->running = 1;
+	}
+
+	pz->size = size;
+	os_cond_signal(&pz->cond);
+
+out:
+	util_mutex_unlock(&pz->lock);
+
+	return ret;
+}
+
+/*
+ * heap_prezero_get_size -- returns the amount of free memory that is kept
+ *	zeroed in the background
+ */
+size_t
+heap_prezero_get_size(struct palloc_heap *heap)
+{
+	struct heap_prezero *pz = &heap->rt->prezero;
+
+	util_mutex_lock(&pz->lock);
+	size_t size = pz->size;
+	util_mutex_unlock(&pz->lock);
+
+	return size;
+}
+
+/*
+ * heap_prezero_get_zeroed -- returns the amount of free memory that is
+ *	currently zeroed and ready to be used by zeroed allocations
+ */
+size_t
+heap_prezero_get_zeroed(struct palloc_heap *heap)
+{
+	uint64_t nchunks;
+	util_atomic_load_explicit64(&heap->rt->prezero.nchunks, &nchunks,
+		memory_order_acquire);
+
+	return (size_t)nchunks * CHUNKSIZE;
+}
+
+/*
+ * heap_prezero_stop -- (internal) stops the prezero worker
+ */
+static void
+heap_prezero_stop(struct heap_prezero *pz)
+{
+	util_mutex_lock(&pz->lock);
+	pz->stop = 1;
+	os_cond_signal(&pz->cond);
+	util_mutex_unlock(&pz->lock);
+
+	if (pz->running)
+		os_thread_join(&pz->worker, NULL);
+}
+
 /*
  * heap_get_adjacent_free_block -- locates adjacent free memory block in heap
  */
@@ -1023,8 +1392,16 @@ heap_buckets_init(struct palloc_heap *heap)
 	if (h->default_bucket == NULL)
 		goto error_bucket_create;
 
+	h->prezero.bucket = bucket_new(container_new_ravl(heap),
+		alloc_class_by_id(h->alloc_classes, DEFAULT_ALLOC_CLASS_ID));
+
+	if (h->prezero.bucket == NULL)
+		goto error_prezero_bucket_create;
+
 	return 0;
 
+error_prezero_bucket_create:
+	bucket_delete(h->default_bucket);
 error_bucket_create:
 	for (unsigned i = 0; i < h->narenas; ++i)
 		heap_arena_destroy(&h->arenas[i]);
@@ -1158,6 +1535,15 @@ heap_boot(struct palloc_heap *heap, void *heap_start, uint64_t heap_size,
 
 	util_mutex_init(&h->arenas_lock);
 
+	h->prezero.bucket = NULL;
+	h->prezero.nchunks = 0;
+	h->prezero.size = 0;
+	h->prezero.running = 0;
+	h->prezero.stop = 0;
+	util_mutex_init(&h->prezero.lock);
+	if ((err = os_cond_init(&h->prezero.cond)) != 0)
+		goto error_prezero_cond_init;
+
 	os_tls_key_create(&h->thread_arena, heap_thread_arena_destructor);
 
 	heap->p_ops = *p_ops;
@@ -1181,6 +1567,12 @@ heap_boot(struct palloc_heap *heap, void *heap_start, uint64_t heap_size,
 
 	return 0;
 
+error_prezero_cond_init:
+	util_mutex_destroy(&h->prezero.lock);
+	util_mutex_destroy(&h->arenas_lock);
+	for (unsigned i = 0; i < h->nlocks; ++i)
+		util_mutex_destroy(&h->run_locks[i]);
+	Free(h->arenas);
 error_arenas_malloc:
 	alloc_class_collection_delete(h->alloc_classes);
 error_alloc_classes_new:
@@ -1256,9 +1648,15 @@ heap_cleanup(struct palloc_heap *heap)
 {
 	struct heap_rt *rt = heap->rt;
 
+	heap_prezero_stop(&rt->prezero);
+
 	alloc_class_collection_delete(rt->alloc_classes);
 
 	bucket_delete(rt->default_bucket);
+	if (rt->prezero.bucket != NULL)
+		bucket_delete(rt->prezero.bucket);
+	os_cond_destroy(&rt->prezero.cond);
+	util_mutex_destroy(&rt->prezero.lock);
 
 	for (unsigned i = 0; i < rt->narenas; ++i)
 		heap_arena_destroy(&rt->arenas[i]);
@@ -1457,17 +1855,15 @@ out:
 }
 
 /*
- * heap_zone_foreach_object -- (internal) iterates through objects in a zone
+ * heap_chunks_foreach_object -- (internal) iterates through objects in the
+ *	chunks of a zone, starting at the provided memory block and ending
+ *	before the chunk_end
  */
 static int
-heap_zone_foreach_object(struct palloc_heap *heap, object_callback cb,
-	void *arg, struct memory_block *m)
+heap_chunks_foreach_object(struct palloc_heap *heap, object_callback cb,
+	void *arg, struct memory_block *m, uint32_t chunk_end)
 {
-	struct zone *zone = ZID_TO_ZONE(heap->layout, m->zone_id);
-	if (zone->header.magic == 0)
-		return 0;
-
-	for (; m->chunk_id < zone->header.size_idx; ) {
+	for (; m->chunk_id < chunk_end; ) {
 		struct chunk_header *hdr = heap_get_chunk_hdr(heap, m);
 		memblock_rebuild_state(heap, m);
 		m->size_idx = hdr->size_idx;
@@ -1482,6 +1878,21 @@ heap_zone_foreach_object(struct palloc_heap *heap, object_callback cb,
 	return 0;
 }
 
+/*
+ * heap_zone_foreach_object -- (internal) iterates through objects in a zone
+ */
+static int
+heap_zone_foreach_object(struct palloc_heap *heap, object_callback cb,
+	void *arg, struct memory_block *m)
+{
+	struct zone *zone = ZID_TO_ZONE(heap->layout, m->zone_id);
+	if (zone->header.magic == 0)
+		return 0;
+
+	return heap_chunks_foreach_object(heap, cb, arg, m,
+		zone->header.size_idx);
+}
+
 /*
  * heap_foreach_object -- (internal) iterates through objects in the heap
  */
@@ -1497,6 +1908,178 @@ heap_foreach_object(struct palloc_heap *heap, object_callback cb, void *arg,
 	}
 }
 
+/*
+ * The minimum number of chunks that are handed out to a single worker of the
+ * parallel heap iteration at once. Units are always made out of whole memory
+ * blocks, so they might be larger than this.
+ */
+#define HEAP_FOREACH_UNIT_CHUNKS 16
+
+/* a contiguous range of chunks in a zone, iterated by a single worker */
+struct heap_foreach_unit {
+	uint32_t zone_id;
+	uint32_t chunk_start;
+	uint32_t chunk_end;
+};
+
+struct heap_foreach_parallel {
+	struct palloc_heap *heap;
+	object_callback cb;
+	void *arg;
+
+	VEC(, struct heap_foreach_unit) units;
+	uint64_t next_unit; /* index of the next unit to be taken */
+	int ret; /* first non-zero value returned by the callback */
+};
+
+/*
+ * heap_foreach_parallel_cb -- (internal) per-object callback of the parallel
+ *	heap iteration, stops the traversal once any of the workers is done
+ */
+static int
+heap_foreach_parallel_cb(const struct memory_block *m, void *arg)
+{
+	struct heap_foreach_parallel *p = arg;
+
+	int ret;
+	util_atomic_load_explicit32(&p->ret, &ret, memory_order_relaxed);
+	if (ret != 0)
+		return ret;
+
+	ret = p->cb(m, p->arg);
+	if (ret != 0)
+		util_bool_compare_and_swap32(&p->ret, 0, ret);
+
+	return ret;
+}
+
+/*
+ * heap_foreach_parallel_worker -- (internal) takes units of work until
+ *	there are none left or the iteration was stopped
+ */
+static void *
+heap_foreach_parallel_worker(void *arg)
+{
+	struct heap_foreach_parallel *p = arg;
+
+	uint64_t i;
+	while ((i = util_fetch_and_add64(&p->next_unit, 1)) <
+			VEC_SIZE(&p->units)) {
+		struct heap_foreach_unit *u = VEC_GET(&p->units, i);
+
+		struct memory_block m = MEMORY_BLOCK_NONE;
+		m.zone_id = u->zone_id;
+		m.chunk_id = u->chunk_start;
+
+		if (heap_chunks_foreach_object(p->heap,
+			heap_foreach_parallel_cb, p, &m, u->chunk_end) != 0)
+			break;
+	}
+
+	return NULL;
+}
+
+/*
+ * heap_foreach_parallel_units -- (internal) splits the heap into units of
+ *	work that consist of whole memory blocks
+ *
+ * This only hops through the chunk headers, without looking at the content
+ * of the runs, which is where most of the iteration time is spent.
+ */
+static int
+heap_foreach_parallel_units(struct palloc_heap *heap,
+	struct heap_foreach_parallel *p)
+{
+	struct memory_block m = MEMORY_BLOCK_NONE;
+	for (m.zone_id = 0; m.zone_id < heap->rt->nzones; ++m.zone_id) {
+		struct zone *zone = ZID_TO_ZONE(heap->layout, m.zone_id);
+		if (zone->header.magic == 0)
+			continue;
+
+		struct heap_foreach_unit u = {m.zone_id, 0, 0};
+		for (m.chunk_id = 0; m.chunk_id < zone->header.size_idx; ) {
+			struct chunk_header *hdr = heap_get_chunk_hdr(heap, &m);
+			m.chunk_id += hdr->size_idx;
+
+			if (m.chunk_id - u.chunk_start <
+					HEAP_FOREACH_UNIT_CHUNKS &&
+				m.chunk_id < zone->header.size_idx)
+				continue;
+
+			u.chunk_end = m.chunk_id;
+			if (VEC_PUSH_BACK(&p->units, u) != 0)
+				return -1;
+			u.chunk_start = m.chunk_id;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * heap_foreach_object_parallel -- iterates through objects in the heap using
+ *	the calling thread and up to nthreads - 1 additional worker threads
+ *
+ * The callback is invoked concurrently and in no particular order. Returns
+ * the first non-zero value returned by the callback, 0 if all objects were
+ * visited or -1 if the iteration could not be started.
+ */
+int
+heap_foreach_object_parallel(struct palloc_heap *heap, object_callback cb,
+	void *arg, unsigned nthreads)
+{
+	struct heap_foreach_parallel p;
+	p.heap = heap;
+	p.cb = cb;
+	p.arg = arg;
+	p.next_unit = 0;
+	p.ret = 0;
+	VEC_INIT(&p.units);
+
+	if (heap_foreach_parallel_units(heap, &p) != 0) {
+		ERR("!failed to allocate parallel iteration units");
+		VEC_DELETE(&p.units);
+		return -1;
+	}
+
+	if (nthreads == 0)
+		nthreads = heap_get_procs();
+	if (nthreads > VEC_SIZE(&p.units))
+		nthreads = (unsigned)VEC_SIZE(&p.units);
+
+	os_thread_t *threads = NULL;
+	unsigned nworkers = 0;
+	if (nthreads > 1) {
+		threads = Malloc(sizeof(*threads) * (nthreads - 1));
+		if (threads == NULL)
+			LOG(2, "!iterating the heap without worker threads");
+	}
+
+	/*
+	 * Failing to spawn a worker is not fatal - the units of work are
+	 * taken dynamically, so the remaining threads pick up the slack.
+	 */
+	for (unsigned i = 0; threads != NULL && i < nthreads - 1; ++i) {
+		errno = os_thread_create(&threads[nworkers], NULL,
+			heap_foreach_parallel_worker, &p);
+		if (errno != 0) {
+			LOG(2, "!failed to create a heap iteration worker");
+			break;
+		}
+		nworkers++;
+	}
+
+	heap_foreach_parallel_worker(&p);
+
+	for (unsigned i = 0; i < nworkers; ++i)
+		os_thread_join(&threads[i], NULL);
+
+	Free(threads);
+	VEC_DELETE(&p.units);
+
+	return p.ret;
+}
+
 #if VG_MEMCHECK_ENABLED
 
 /*
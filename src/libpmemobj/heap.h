@@ -86,12 +86,18 @@ heap_bucket_release(struct palloc_heap *heap, struct bucket *b);
 
 int heap_get_bestfit_block(struct palloc_heap *heap, struct bucket *b,
 	struct memory_block *m);
+int heap_get_zeroed_block(struct palloc_heap *heap, struct memory_block *m);
+int heap_prezero_set_size(struct palloc_heap *heap, size_t size);
+size_t heap_prezero_get_size(struct palloc_heap *heap);
+size_t heap_prezero_get_zeroed(struct palloc_heap *heap);
 struct memory_block
 heap_coalesce_huge(struct palloc_heap *heap, struct bucket *b,
 	const struct memory_block *m);
 os_mutex_t *heap_get_run_lock(struct palloc_heap *heap,
 		uint32_t chunk_id);
 
+void
+heap_memblock_on_alloc(struct palloc_heap *heap, const struct memory_block *m);
 void
 heap_memblock_on_free(struct palloc_heap *heap, const struct memory_block *m);
 int
@@ -100,6 +106,8 @@ heap_free_chunk_reuse(struct palloc_heap *heap,
 
 void heap_foreach_object(struct palloc_heap *heap, object_callback cb,
 	void *arg, struct memory_block start);
+int heap_foreach_object_parallel(struct palloc_heap *heap, object_callback cb,
+	void *arg, unsigned nthreads);
 
 struct alloc_class_collection *heap_alloc_classes(struct palloc_heap *heap);
 
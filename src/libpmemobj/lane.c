@@ -42,6 +42,8 @@
 #include <errno.h>
 #include <limits.h>
 #include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 #include "libpmemobj.h"
 #include "critnib.h"
@@ -52,8 +54,11 @@
 #include "os_thread.h"
 #include "valgrind_internal.h"
 #include "memops.h"
+#include "mmap.h"
 #include "palloc.h"
+#include "set.h"
 #include "tx.h"
+#include "vec.h"
 
 static os_tls_key_t Lane_info_key;
 
@@ -169,14 +174,73 @@ lane_info_cleanup(PMEMobjpool *pop)
 	}
 }
 
+/*
+ * lane_ext_layouts -- (internal) returns the first lane layout of an extension
+ */
+static struct lane_layout *
+lane_ext_layouts(struct lane_ext *ext)
+{
+	return (struct lane_layout *)ALIGN_UP((uintptr_t)(ext + 1),
+		CACHELINE_SIZE);
+}
+
 /*
  * lane_get_layout -- (internal) calculates the real pointer of the lane layout
  */
 static struct lane_layout *
 lane_get_layout(PMEMobjpool *pop, uint64_t lane_idx)
 {
-	return (void *)((char *)pop + pop->lanes_offset +
-		sizeof(struct lane_layout) * lane_idx);
+	if (likely(lane_idx < pop->nlanes))
+		return (void *)((char *)pop + pop->lanes_offset +
+			sizeof(struct lane_layout) * lane_idx);
+
+	lane_idx -= pop->nlanes;
+
+	uint64_t off = pop->lanes_ext_offset;
+	while (off != 0) {
+		struct lane_ext *ext = OBJ_OFF_TO_PTR(pop, off);
+		if (lane_idx < ext->nlanes)
+			return &lane_ext_layouts(ext)[lane_idx];
+
+		lane_idx -= ext->nlanes;
+		off = ext->next;
+	}
+
+	ASSERT(0);
+	return NULL;
+}
+
+/*
+ * lane_get_nlanes -- (internal) returns the number of lanes of the pool,
+ *	including the lanes of the extensions, or 0 if the list of the
+ *	extensions is corrupted
+ */
+static uint64_t
+lane_get_nlanes(PMEMobjpool *pop)
+{
+	uint64_t nlanes = pop->nlanes;
+
+	uint64_t off = pop->lanes_ext_offset;
+	while (off != 0) {
+		if (off < pop->heap_offset ||
+		    off + sizeof(struct lane_ext) > pop->set->poolsize) {
+			ERR("invalid lane extension offset 0x%" PRIx64, off);
+			return 0;
+		}
+
+		struct lane_ext *ext = OBJ_OFF_TO_PTR(pop, off);
+		if (ext->nlanes == 0 ||
+		    ext->nlanes > LANE_MAX_NLANES - nlanes) {
+			ERR("invalid number of lanes in extension 0x%" PRIx64
+				": %" PRIu64, off, ext->nlanes);
+			return 0;
+		}
+
+		nlanes += ext->nlanes;
+		off = ext->next;
+	}
+
+	return nlanes;
 }
 
 /*
@@ -191,7 +255,7 @@ lane_ulog_constructor(void *base, void *ptr, size_t usable_size, void *arg)
 	size_t capacity = ALIGN_DOWN(usable_size - sizeof(struct ulog),
 		CACHELINE_SIZE);
 
-	ulog_construct(OBJ_PTR_TO_OFF(base, ptr), capacity, 1, p_ops);
+	ulog_construct(OBJ_PTR_TO_OFF(base, ptr), capacity, 0, 1, p_ops);
 
 	return 0;
 }
@@ -231,6 +295,7 @@ lane_init(PMEMobjpool *pop, struct lane *lane, struct lane_layout *layout)
 	ASSERTne(lane, NULL);
 
 	lane->layout = layout;
+	mwcas_desc_init(&lane->mwcas);
 
 	lane->internal = operation_new((struct ulog *)&layout->internal,
 		LANE_REDO_INTERNAL_SIZE,
@@ -274,6 +339,47 @@ lane_destroy(PMEMobjpool *pop, struct lane *lane)
 	operation_delete(lane->external);
 }
 
+/*
+ * lane_alloc_chunks -- (internal) allocates the chunks of the runtime state
+ *	of the lanes that are missing for the given number of lanes
+ *
+ * The chunks are published by the caller, along with the number of lanes.
+ */
+static int
+lane_alloc_chunks(PMEMobjpool *pop, uint64_t nlanes)
+{
+	struct lane_descriptor *ld = &pop->lanes_desc;
+	uint64_t nchunks = (nlanes + LANE_CHUNK_NLANES - 1) / LANE_CHUNK_NLANES;
+
+	for (uint64_t i = 0; i < nchunks; ++i) {
+		if (ld->chunks[i] != NULL)
+			continue;
+
+		ld->chunks[i] = Zalloc(sizeof(struct lane_chunk));
+		if (ld->chunks[i] == NULL) {
+			ERR("!Zalloc of volatile lanes");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * lane_free_chunks -- (internal) frees the runtime state of the lanes
+ */
+static void
+lane_free_chunks(PMEMobjpool *pop)
+{
+	struct lane_descriptor *ld = &pop->lanes_desc;
+
+	for (unsigned i = 0; i < LANE_MAX_NCHUNKS; ++i)
+		Free(ld->chunks[i]);
+
+	Free(ld->chunks);
+	ld->chunks = NULL;
+}
+
 /*
  * lane_boot -- initializes all lanes
  */
@@ -282,8 +388,16 @@ lane_boot(PMEMobjpool *pop)
 {
 	int err = 0;
 
-	pop->lanes_desc.lane = Malloc(sizeof(struct lane) * pop->nlanes);
-	if (pop->lanes_desc.lane == NULL) {
+	uint64_t nlanes = lane_get_nlanes(pop);
+	if (nlanes == 0)
+		return EINVAL;
+
+	pop->lanes_desc.total_nlanes = (unsigned)nlanes;
+	pop->lanes_desc.extending = 0;
+
+	pop->lanes_desc.chunks =
+		Zalloc(sizeof(struct lane_chunk *) * LANE_MAX_NCHUNKS);
+	if (pop->lanes_desc.chunks == NULL) {
 		err = ENOMEM;
 		ERR("!Malloc of volatile lanes");
 		goto error_lanes_malloc;
@@ -291,22 +405,32 @@ lane_boot(PMEMobjpool *pop)
 
 	pop->lanes_desc.next_lane_idx = 0;
 
-	pop->lanes_desc.lane_locks =
-		Zalloc(sizeof(*pop->lanes_desc.lane_locks) * pop->nlanes);
-	if (pop->lanes_desc.lane_locks == NULL) {
-		ERR("!Malloc for lane locks");
-		goto error_locks_malloc;
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	pop->lanes_desc.ncpus = ncpus < 1 ? 1 : (unsigned)ncpus;
+	pop->lanes_desc.affinity = 0;
+
+	if (lane_alloc_chunks(pop, nlanes) != 0) {
+		err = ENOMEM;
+		goto error_chunks_malloc;
 	}
 
 	/* add lanes to pmemcheck ignored list */
 	VALGRIND_ADD_TO_GLOBAL_TX_IGNORE((char *)pop + pop->lanes_offset,
 		(sizeof(struct lane_layout) * pop->nlanes));
 
+	for (uint64_t off = pop->lanes_ext_offset; off != 0; ) {
+		struct lane_ext *ext = OBJ_OFF_TO_PTR(pop, off);
+		VALGRIND_ADD_TO_GLOBAL_TX_IGNORE(lane_ext_layouts(ext),
+			sizeof(struct lane_layout) * ext->nlanes);
+		off = ext->next;
+	}
+
 	uint64_t i;
-	for (i = 0; i < pop->nlanes; ++i) {
+	for (i = 0; i < nlanes; ++i) {
 		struct lane_layout *layout = lane_get_layout(pop, i);
 
-		if ((err = lane_init(pop, &pop->lanes_desc.lane[i], layout))) {
+		if ((err = lane_init(pop, lane_get(&pop->lanes_desc, i),
+				layout))) {
 			ERR("!lane_init");
 			goto error_lane_init;
 		}
@@ -316,16 +440,28 @@ lane_boot(PMEMobjpool *pop)
 
 error_lane_init:
 	for (; i >= 1; --i)
-		lane_destroy(pop, &pop->lanes_desc.lane[i - 1]);
-	Free(pop->lanes_desc.lane_locks);
-	pop->lanes_desc.lane_locks = NULL;
-error_locks_malloc:
-	Free(pop->lanes_desc.lane);
-	pop->lanes_desc.lane = NULL;
+		lane_destroy(pop, lane_get(&pop->lanes_desc, i - 1));
+error_chunks_malloc:
+	lane_free_chunks(pop);
 error_lanes_malloc:
 	return err;
 }
 
+/*
+ * lane_init_layout -- (internal) initializes ulogs of a single lane
+ */
+static void
+lane_init_layout(PMEMobjpool *pop, struct lane_layout *layout)
+{
+	ulog_construct(OBJ_PTR_TO_OFF(pop, &layout->internal),
+		LANE_REDO_INTERNAL_SIZE, 0, 0, &pop->p_ops);
+	ulog_construct(OBJ_PTR_TO_OFF(pop, &layout->external),
+		LANE_REDO_EXTERNAL_SIZE, 0, 0, &pop->p_ops);
+	/* undo logs are invalidated by bumping their generation */
+	ulog_construct(OBJ_PTR_TO_OFF(pop, &layout->undo),
+		LANE_UNDO_SIZE, 1, 0, &pop->p_ops);
+}
+
 /*
  * lane_init_data -- initalizes ulogs for all the lanes
  */
@@ -334,15 +470,9 @@ lane_init_data(PMEMobjpool *pop)
 {
 	struct lane_layout *layout;
 
-	for (uint64_t i = 0; i < pop->nlanes; ++i) {
-		layout = lane_get_layout(pop, i);
-		ulog_construct(OBJ_PTR_TO_OFF(pop, &layout->internal),
-			LANE_REDO_INTERNAL_SIZE, 0, &pop->p_ops);
-		ulog_construct(OBJ_PTR_TO_OFF(pop, &layout->external),
-			LANE_REDO_EXTERNAL_SIZE, 0, &pop->p_ops);
-		ulog_construct(OBJ_PTR_TO_OFF(pop, &layout->undo),
-			LANE_UNDO_SIZE, 0, &pop->p_ops);
-	}
+	for (uint64_t i = 0; i < pop->nlanes; ++i)
+		lane_init_layout(pop, lane_get_layout(pop, i));
+
 	layout = lane_get_layout(pop, 0);
 	pmemops_xpersist(&pop->p_ops, layout,
 		pop->nlanes * sizeof(struct lane_layout),
@@ -355,20 +485,219 @@ lane_init_data(PMEMobjpool *pop)
 void
 lane_cleanup(PMEMobjpool *pop)
 {
-	for (uint64_t i = 0; i < pop->nlanes; ++i)
-		lane_destroy(pop, &pop->lanes_desc.lane[i]);
+	for (uint64_t i = 0; i < pop->lanes_desc.total_nlanes; ++i)
+		lane_destroy(pop, lane_get(&pop->lanes_desc, i));
 
-	Free(pop->lanes_desc.lane);
-	pop->lanes_desc.lane = NULL;
-	Free(pop->lanes_desc.lane_locks);
-	pop->lanes_desc.lane_locks = NULL;
+	lane_free_chunks(pop);
 
 	lane_info_cleanup(pop);
 }
 
+/*
+ * lane_undo_recover -- (internal) recovers the undo log of a single lane
+ *
+ * The log is rolled back unless it belongs to a relaxed transaction from an
+ * epoch that was already made durable, such a log is just discarded.
+ */
+static int
+lane_undo_recover(PMEMobjpool *pop, uint64_t idx)
+{
+	struct lane_layout *layout = lane_get_layout(pop, idx);
+	struct ulog *undo = (struct ulog *)&layout->undo;
+
+	struct operation_context *ctx = operation_new(
+		undo,
+		LANE_UNDO_SIZE,
+		lane_undo_extend, (ulog_free_fn)pfree, &pop->p_ops,
+		LOG_TYPE_UNDO);
+	if (ctx == NULL) {
+		LOG(2, "undo recovery failed %" PRIu64, idx);
+		return ENOMEM;
+	}
+	/*
+	 * Pools created before the undo logs had generation numbers rely on
+	 * the logs being zeroed after use.
+	 */
+	int legacy = undo->gen_num == 0;
+
+	operation_resume(ctx);
+	if (undo->epoch == 0 || undo->epoch > pop->tx_epoch_durable)
+		operation_process(ctx);
+
+	/*
+	 * Before such a log switches to generations, the entries left behind
+	 * by it have to be erased once, so that they are not mistaken for
+	 * entries of a later generation.
+	 */
+	if (legacy)
+		ulog_clobber_stale(undo, &pop->p_ops);
+
+	operation_finish(ctx);
+	operation_delete(ctx);
+
+	if (undo->gen_num == 0)
+		ulog_inc_gen_num(undo, &pop->p_ops);
+
+	if (undo->epoch != 0) {
+		ulog_epoch_set(undo, 0, &pop->p_ops);
+		pmemops_drain(&pop->p_ops);
+	}
+
+	return 0;
+}
+
+struct lane_epoch {
+	uint64_t epoch;
+	uint64_t lane;
+};
+
+/*
+ * lane_epoch_cmp -- (internal) orders the lanes by descending epochs
+ */
+static int
+lane_epoch_cmp(const void *lhs, const void *rhs)
+{
+	const struct lane_epoch *l = lhs;
+	const struct lane_epoch *r = rhs;
+
+	if (l->epoch > r->epoch)
+		return -1;
+	if (l->epoch < r->epoch)
+		return 1;
+	return 0;
+}
+
+/*
+ * Number of threads used to recover the lanes of the pools being opened,
+ * 0 means as many as there are online CPUs.
+ */
+static int Lane_recovery_threads;
+
+struct lane_recovery {
+	PMEMobjpool *pop;
+	int (*recover)(PMEMobjpool *pop, uint64_t idx);
+
+	VEC(, uint64_t) lanes; /* lanes with logs that need recovery */
+	uint64_t next; /* index of the next lane to be taken */
+	int err; /* first error returned by the recovery of a lane */
+};
+
+/*
+ * lane_redo_recover -- (internal) recovers the redo logs of a single lane,
+ *	internal first
+ */
+static int
+lane_redo_recover(PMEMobjpool *pop, uint64_t idx)
+{
+	struct lane_layout *layout = lane_get_layout(pop, idx);
+
+	ulog_recover((struct ulog *)&layout->internal,
+		OBJ_OFF_IS_VALID_FROM_CTX, &pop->p_ops);
+	ulog_recover((struct ulog *)&layout->external,
+		OBJ_OFF_IS_VALID_FROM_CTX, &pop->p_ops);
+
+	return 0;
+}
+
+/*
+ * lane_recovery_worker -- (internal) takes lanes to recover until there are
+ *	none left or the recovery of any of them has failed
+ */
+static void *
+lane_recovery_worker(void *arg)
+{
+	struct lane_recovery *r = arg;
+
+	uint64_t i;
+	while ((i = util_fetch_and_add64(&r->next, 1)) <
+			VEC_SIZE(&r->lanes)) {
+		int err;
+		util_atomic_load_explicit32(&r->err, &err,
+			memory_order_relaxed);
+		if (err != 0)
+			break;
+
+		err = r->recover(r->pop, VEC_ARR(&r->lanes)[i]);
+		if (err != 0)
+			util_bool_compare_and_swap32(&r->err, 0, err);
+	}
+
+	return NULL;
+}
+
+/*
+ * lane_recovery_run -- (internal) recovers the collected lanes using the
+ *	calling thread and the additional worker threads
+ *
+ * The logs of different lanes never overlap: the heap metadata modified by
+ * a redo log is protected by locks held until the log is cleared, and the
+ * data snapshotted by the undo logs of the unfinished transactions is
+ * protected by the locks of the application.
+ */
+static int
+lane_recovery_run(struct lane_recovery *r)
+{
+	unsigned nthreads = Lane_recovery_threads > 0 ?
+		(unsigned)Lane_recovery_threads : r->pop->lanes_desc.ncpus;
+	if (nthreads > VEC_SIZE(&r->lanes))
+		nthreads = (unsigned)VEC_SIZE(&r->lanes);
+
+	os_thread_t *threads = NULL;
+	unsigned nworkers = 0;
+	if (nthreads > 1) {
+		threads = Malloc(sizeof(*threads) * (nthreads - 1));
+		if (threads == NULL)
+			LOG(2, "!recovering the lanes without worker threads");
+	}
+
+	/* the calling thread can recover all of the lanes on its own */
+	for (unsigned i = 0; threads != NULL && i < nthreads - 1; ++i) {
+		errno = os_thread_create(&threads[nworkers], NULL,
+			lane_recovery_worker, r);
+		if (errno != 0) {
+			LOG(2, "!failed to create a lane recovery worker");
+			break;
+		}
+		nworkers++;
+	}
+
+	lane_recovery_worker(r);
+
+	for (unsigned i = 0; i < nworkers; ++i)
+		os_thread_join(&threads[i], NULL);
+
+	Free(threads);
+
+	return r->err;
+}
+
+/*
+ * lane_redo_recovery_needed -- (internal) checks if any of the redo logs of
+ *	the lane needs to be processed
+ */
+static int
+lane_redo_recovery_needed(struct lane_layout *layout)
+{
+	return ulog_recovery_needed((struct ulog *)&layout->internal, 0) ||
+		ulog_recovery_needed((struct ulog *)&layout->external, 0);
+}
+
+/*
+ * lane_undo_recovery_needed -- (internal) checks if the undo log of the lane
+ *	has any entries or has to be brought up to date
+ */
+static int
+lane_undo_recovery_needed(struct ulog *undo)
+{
+	return undo->gen_num == 0 || ulog_recovery_needed(undo, 0);
+}
+
 /*
  * lane_recover_and_section_boot -- performs initialization and recovery of all
  * lanes
+ *
+ * Each phase of the recovery processes the lanes in parallel. The time spent
+ * in each of the phases is recorded in the statistics of the pool.
  */
 int
 lane_recover_and_section_boot(PMEMobjpool *pop)
@@ -379,50 +708,121 @@ lane_recover_and_section_boot(PMEMobjpool *pop)
 
 	int err = 0;
 	uint64_t i; /* lane index */
+	uint64_t nlanes = 0;
+	uint64_t recovered = 0; /* lanes with recovered redo logs */
 	struct lane_layout *layout;
+	uint64_t *time = pop->stats->transient->recovery_time;
+	uint64_t start = stats_now();
+
+	struct lane_recovery r;
+	r.pop = pop;
+	r.err = 0;
+	VEC_INIT(&r.lanes);
 
 	/*
 	 * First we need to recover the internal/external redo logs so that the
 	 * allocator state is consistent before we boot it.
+	 *
+	 * A redo log might link a new extension of the lane area, so the number
+	 * of lanes is evaluated again until no more lanes show up.
 	 */
-	for (i = 0; i < pop->nlanes; ++i) {
-		layout = lane_get_layout(pop, i);
+	r.recover = lane_redo_recover;
+	while (recovered < (nlanes = lane_get_nlanes(pop))) {
+		VEC_CLEAR(&r.lanes);
+		r.next = 0;
+
+		for (i = recovered; i < nlanes; ++i) {
+			layout = lane_get_layout(pop, i);
+			if (!lane_redo_recovery_needed(layout))
+				continue;
+
+			if (VEC_PUSH_BACK(&r.lanes, i) != 0) {
+				err = ENOMEM;
+				goto out;
+			}
+		}
 
-		ulog_recover((struct ulog *)&layout->internal,
-			OBJ_OFF_IS_VALID_FROM_CTX, &pop->p_ops);
-		ulog_recover((struct ulog *)&layout->external,
-			OBJ_OFF_IS_VALID_FROM_CTX, &pop->p_ops);
+		if ((err = lane_recovery_run(&r)) != 0)
+			goto out;
+		recovered = nlanes;
 	}
 
+	if (nlanes == 0) {
+		err = EINVAL;
+		goto out;
+	}
+
+	uint64_t now = stats_now();
+	time[STATS_RECOVERY_REDO] = now - start;
+	start = now;
+
 	if ((err = pmalloc_boot(pop)) != 0)
-		return err;
+		goto out;
+
+	now = stats_now();
+	time[STATS_RECOVERY_HEAP_BOOT] = now - start;
+	start = now;
 
 	/*
 	 * Undo logs must be processed after the heap is initialized since
 	 * a undo recovery might require deallocation of the next ulogs.
+	 *
+	 * The logs of committed relaxed transactions are recovered last, in
+	 * the reverse order of their epochs, because the data they snapshotted
+	 * might have been modified again by the transactions that followed.
 	 */
-	for (i = 0; i < pop->nlanes; ++i) {
+	VEC(, struct lane_epoch) relaxed = VEC_INITIALIZER;
+
+	VEC_CLEAR(&r.lanes);
+	r.next = 0;
+	r.recover = lane_undo_recover;
+	for (i = 0; i < nlanes; ++i) {
 		layout = lane_get_layout(pop, i);
 
 		struct ulog *undo = (struct ulog *)&layout->undo;
+		if (undo->epoch != 0) {
+			struct lane_epoch e = {undo->epoch, i};
+			if (VEC_PUSH_BACK(&relaxed, e) != 0) {
+				err = ENOMEM;
+				goto out_relaxed;
+			}
+			continue;
+		}
 
-		struct operation_context *ctx = operation_new(
-			undo,
-			LANE_UNDO_SIZE,
-			lane_undo_extend, (ulog_free_fn)pfree, &pop->p_ops,
-			LOG_TYPE_UNDO);
-		if (ctx == NULL) {
-			LOG(2, "undo recovery failed %" PRIu64 " %d",
-				i, err);
-			return err;
+		if (!lane_undo_recovery_needed(undo))
+			continue;
+
+		if (VEC_PUSH_BACK(&r.lanes, i) != 0) {
+			err = ENOMEM;
+			goto out_relaxed;
 		}
-		operation_resume(ctx);
-		operation_process(ctx);
-		operation_finish(ctx);
-		operation_delete(ctx);
 	}
 
-	return 0;
+	if ((err = lane_recovery_run(&r)) != 0)
+		goto out_relaxed;
+
+	qsort(VEC_ARR(&relaxed), VEC_SIZE(&relaxed), sizeof(struct lane_epoch),
+		lane_epoch_cmp);
+
+	struct lane_epoch *e;
+	VEC_FOREACH_BY_PTR(e, &relaxed) {
+		if ((err = lane_undo_recover(pop, e->lane)) != 0)
+			goto out_relaxed;
+	}
+
+	time[STATS_RECOVERY_UNDO] = stats_now() - start;
+
+	LOG(3, "lanes recovered in %" PRIu64 " ns (redo), %" PRIu64
+		" ns (heap boot), %" PRIu64 " ns (undo)",
+		time[STATS_RECOVERY_REDO], time[STATS_RECOVERY_HEAP_BOOT],
+		time[STATS_RECOVERY_UNDO]);
+
+out_relaxed:
+	VEC_DELETE(&relaxed);
+out:
+	VEC_DELETE(&r.lanes);
+
+	return err;
 }
 
 /*
@@ -444,7 +844,11 @@ lane_check(PMEMobjpool *pop)
 	uint64_t j; /* lane index */
 	struct lane_layout *layout;
 
-	for (j = 0; j < pop->nlanes; ++j) {
+	uint64_t nlanes = lane_get_nlanes(pop);
+	if (nlanes == 0)
+		return EINVAL;
+
+	for (j = 0; j < nlanes; ++j) {
 		layout = lane_get_layout(pop, j);
 		if (ulog_check((struct ulog *)&layout->internal,
 		    OBJ_OFF_IS_VALID_FROM_CTX, &pop->p_ops) != 0) {
@@ -461,14 +865,18 @@ lane_check(PMEMobjpool *pop)
  * get_lane -- (internal) get free lane index
  */
 static inline void
-get_lane(uint64_t *locks, struct lane_info *info, uint64_t nlocks)
+get_lane(PMEMobjpool *pop, struct lane_info *info)
 {
+	struct lane_descriptor *ld = &pop->lanes_desc;
+	uint64_t nlocks = ld->runtime_nlanes;
+
 	info->lane_idx = info->primary;
 	while (1) {
 		do {
 			info->lane_idx %= nlocks;
 			if (likely(util_bool_compare_and_swap64(
-					&locks[info->lane_idx], 0, 1))) {
+					lane_get_lock(ld, info->lane_idx),
+					0, 1))) {
 				if (info->lane_idx == info->primary) {
 					info->primary_attempts =
 						LANE_PRIMARY_ATTEMPTS;
@@ -480,9 +888,10 @@ get_lane(uint64_t *locks, struct lane_info *info, uint64_t nlocks)
 				return;
 			}
 
-			if (info->lane_idx == info->primary &&
-					info->primary_attempts > 0) {
-				info->primary_attempts--;
+			if (info->lane_idx == info->primary) {
+				STATS_INC(pop->stats, transient, lane_busy, 1);
+				if (info->primary_attempts > 0)
+					info->primary_attempts--;
 			}
 
 			++info->lane_idx;
@@ -492,6 +901,80 @@ get_lane(uint64_t *locks, struct lane_info *info, uint64_t nlocks)
 	}
 }
 
+/*
+ * lane_try_acquire -- (internal) tries to take the lane with the given index
+ */
+static inline int
+lane_try_acquire(struct lane_descriptor *ld, struct lane_info *info,
+	uint64_t idx)
+{
+	if (!util_bool_compare_and_swap64(lane_get_lock(ld, idx), 0, 1))
+		return 0;
+
+	info->lane_idx = info->primary = idx;
+
+	return 1;
+}
+
+/*
+ * get_lane_affine -- (internal) get free lane index from the partition of the
+ *	CPU the thread runs on
+ *
+ * The lanes are split into contiguous partitions, one per CPU, so that the
+ * lanes used on a CPU stay in its caches, and since the CPUs of a NUMA node
+ * are usually numbered consecutively, the neighboring partitions are most
+ * likely local to the same node. A lane of another partition is taken,
+ * nearest ones first, only when all the local lanes are busy.
+ *
+ * Returns -1 if the CPU of the thread is unknown.
+ */
+static inline int
+get_lane_affine(PMEMobjpool *pop, struct lane_info *info)
+{
+	struct lane_descriptor *ld = &pop->lanes_desc;
+	uint64_t nlocks = ld->runtime_nlanes;
+	uint64_t ncpus = pop->lanes_desc.ncpus;
+
+	while (1) {
+		int cpu = os_thread_getcpu();
+		if (unlikely(cpu < 0))
+			return -1;
+
+		uint64_t part = (uint64_t)cpu % ncpus;
+		uint64_t begin = part * nlocks / ncpus;
+		uint64_t end = (part + 1) * nlocks / ncpus;
+		if (end == begin) /* more CPUs than lanes */
+			end = begin + 1;
+
+		/* the lane used last time is the most likely to be cached */
+		uint64_t size = end - begin;
+		uint64_t first = info->primary >= begin &&
+			info->primary < end ? info->primary - begin : 0;
+
+		for (uint64_t i = 0; i < size; ++i) {
+			if (lane_try_acquire(ld, info,
+					begin + (first + i) % size))
+				return 0;
+
+			if (i == 0)
+				STATS_INC(pop->stats, transient, lane_busy, 1);
+		}
+
+		for (uint64_t i = 0; i < begin || end + i < nlocks; ++i) {
+			if ((end + i < nlocks &&
+				lane_try_acquire(ld, info, end + i)) ||
+			    (i < begin &&
+				lane_try_acquire(ld, info, begin - i - 1))) {
+				STATS_INC(pop->stats, transient, lane_stolen,
+					1);
+				return 0;
+			}
+		}
+
+		sched_yield();
+	}
+}
+
 /*
  * get_lane_info_record -- (internal) get lane record attached to memory pool
  *	or first free
@@ -538,7 +1021,8 @@ get_lane_info_record(PMEMobjpool *pop)
 }
 
 /*
- * lane_hold -- grabs a per-thread lane in a round-robin fashion
+ * lane_hold -- grabs a per-thread lane in a round-robin fashion, or from the
+ *	lanes of the current CPU in the affinity mode
  */
 unsigned
 lane_hold(PMEMobjpool *pop, struct lane **lanep)
@@ -561,13 +1045,14 @@ lane_hold(PMEMobjpool *pop, struct lane **lanep)
 			&pop->lanes_desc.next_lane_idx, LANE_JUMP);
 	} /* handles wraparound */
 
-	uint64_t *llocks = pop->lanes_desc.lane_locks;
 	/* grab next free lane from lanes available at runtime */
 	if (!lane->nest_count++) {
-		get_lane(llocks, lane, pop->lanes_desc.runtime_nlanes);
+		if (!pop->lanes_desc.affinity ||
+				get_lane_affine(pop, lane) != 0)
+			get_lane(pop, lane);
 	}
 
-	struct lane *l = &pop->lanes_desc.lane[lane->lane_idx];
+	struct lane *l = lane_get(&pop->lanes_desc, lane->lane_idx);
 
 	/* reinitialize lane's content only if in outermost hold */
 	if (lanep && lane->nest_count == 1) {
@@ -608,6 +1093,18 @@ lane_detach(PMEMobjpool *pop)
 	return (unsigned)lane->lane_idx;
 }
 
+/*
+ * lane_release_detached -- releases a lane detached from its thread
+ */
+void
+lane_release_detached(PMEMobjpool *pop, unsigned lane)
+{
+	if (unlikely(!util_bool_compare_and_swap64(
+			lane_get_lock(&pop->lanes_desc, lane), 1, 0))) {
+		FATAL("util_bool_compare_and_swap64");
+	}
+}
+
 /*
  * lane_release -- drops the per-thread lane
  */
@@ -628,9 +1125,322 @@ lane_release(PMEMobjpool *pop)
 		FATAL("lane_release");
 	} else if (--(lane->nest_count) == 0) {
 		if (unlikely(!util_bool_compare_and_swap64(
-				&pop->lanes_desc.lane_locks[lane->lane_idx],
-				1, 0))) {
+				lane_get_lock(&pop->lanes_desc,
+					lane->lane_idx), 1, 0))) {
 			FATAL("util_bool_compare_and_swap64");
 		}
 	}
 }
+
+/*
+ * lane_ext_constructor -- (internal) constructor of an extension of the lane
+ *	area
+ */
+static int
+lane_ext_constructor(void *base, void *ptr, size_t usable_size, void *arg)
+{
+	PMEMobjpool *pop = base;
+	struct lane_ext *ext = ptr;
+	uint64_t nlanes = *(uint64_t *)arg;
+
+	ext->next = 0;
+	ext->nlanes = nlanes;
+	pmemops_persist(&pop->p_ops, ext, sizeof(*ext));
+
+	struct lane_layout *layouts = lane_ext_layouts(ext);
+	for (uint64_t i = 0; i < nlanes; ++i)
+		lane_init_layout(pop, &layouts[i]);
+
+	pmemops_persist(&pop->p_ops, layouts,
+		nlanes * sizeof(struct lane_layout));
+
+	return 0;
+}
+
+/*
+ * lane_extend -- (internal) adds new lanes to the pool
+ *
+ * The lanes are allocated from the heap and linked at the end of the list of
+ * the extensions of the lane area, and they can be used right away. The
+ * versions of the library that don't know the extensions would not recover
+ * their logs, which is why the pool gets an incompat feature first.
+ */
+static int
+lane_extend(PMEMobjpool *pop, unsigned nlanes)
+{
+	struct lane_descriptor *ld = &pop->lanes_desc;
+
+	if (!util_bool_compare_and_swap32(&ld->extending, 0, 1)) {
+		ERR("the lanes are already being extended");
+		errno = EBUSY;
+		return -1;
+	}
+
+	int ret = -1;
+	unsigned total = ld->total_nlanes;
+
+	if (nlanes == 0 || nlanes > LANE_MAX_NLANES - total) {
+		ERR("invalid number of new lanes %u, the pool has %u lanes "
+			"out of %u", nlanes, total, LANE_MAX_NLANES);
+		errno = EINVAL;
+		goto out;
+	}
+
+	/* the pool header is made inaccessible once the pool is opened */
+	RANGE_RW(pop->addr, sizeof(struct pool_hdr), pop->is_dev_dax);
+	int feat_err = util_pool_feature_enable(pop->set,
+		(features_t)FEAT_INCOMPAT(OBJ_LANES_EXT));
+	RANGE_NONE(pop->addr, sizeof(struct pool_hdr), pop->is_dev_dax);
+	if (feat_err != 0) {
+		ERR("!cannot mark the pool as having extended lanes");
+		goto out;
+	}
+
+	if (lane_alloc_chunks(pop, total + nlanes) != 0) {
+		errno = ENOMEM;
+		goto out;
+	}
+
+	uint64_t *dest = &pop->lanes_ext_offset;
+	while (*dest != 0)
+		dest = &((struct lane_ext *)OBJ_OFF_TO_PTR(pop, *dest))->next;
+
+	uint64_t n = nlanes;
+	size_t size = sizeof(struct lane_ext) + CACHELINE_SIZE +
+		n * sizeof(struct lane_layout);
+	if (pmalloc_construct(pop, dest, size, lane_ext_constructor, &n,
+			0, OBJ_INTERNAL_OBJECT_MASK, 0) != 0) {
+		ERR("!cannot allocate %u new lanes", nlanes);
+		goto out;
+	}
+
+	struct lane_layout *layouts =
+		lane_ext_layouts(OBJ_OFF_TO_PTR(pop, *dest));
+	VALGRIND_ADD_TO_GLOBAL_TX_IGNORE(layouts,
+		sizeof(struct lane_layout) * nlanes);
+
+	/* on failure, the new lanes are used once the pool is reopened */
+	for (unsigned i = 0; i < nlanes; ++i) {
+		if (lane_init(pop, lane_get(ld, total + i), &layouts[i]) != 0) {
+			while (i-- > 0)
+				lane_destroy(pop, lane_get(ld, total + i));
+			ERR("!lane_init");
+			goto out;
+		}
+	}
+
+	util_atomic_store_explicit32(&ld->total_nlanes, total + nlanes,
+		memory_order_release);
+	ret = 0;
+
+out:
+	util_atomic_store_explicit32(&ld->extending, 0, memory_order_release);
+
+	return ret;
+}
+
+/*
+ * CTL_READ_HANDLER(count) -- returns the number of lanes available at runtime
+ */
+static int
+CTL_READ_HANDLER(count)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	int *arg_out = arg;
+	*arg_out = (int)pop->lanes_desc.runtime_nlanes;
+
+	return 0;
+}
+
+/*
+ * CTL_WRITE_HANDLER(count) -- changes the number of lanes available at
+ *	runtime
+ */
+static int
+CTL_WRITE_HANDLER(count)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	int arg_in = *(int *)arg;
+
+	if (pop->has_remote_replicas) {
+		ERR("the number of lanes of a pool with remote replicas "
+			"cannot be changed");
+		errno = ENOTSUP;
+		return -1;
+	}
+
+	unsigned total;
+	util_atomic_load_explicit32(&pop->lanes_desc.total_nlanes, &total,
+		memory_order_acquire);
+	if (arg_in <= 0 || (unsigned)arg_in > total) {
+		ERR("invalid number of lanes %d, the pool has %u lanes",
+			arg_in, total);
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (tx_epoch_resize(pop, (unsigned)arg_in) != 0)
+		return -1;
+
+	util_atomic_store_explicit32(&pop->lanes_desc.runtime_nlanes,
+		(unsigned)arg_in, memory_order_release);
+
+	return 0;
+}
+
+static const struct ctl_argument CTL_ARG(count) = CTL_ARG_INT;
+
+/*
+ * CTL_READ_HANDLER(total) -- returns the number of lanes in the pool
+ */
+static int
+CTL_READ_HANDLER(total)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	int *arg_out = arg;
+	unsigned total;
+	util_atomic_load_explicit32(&pop->lanes_desc.total_nlanes, &total,
+		memory_order_acquire);
+	*arg_out = (int)total;
+
+	return 0;
+}
+
+/*
+ * CTL_RUNNABLE_HANDLER(extend) -- adds the given number of lanes to the pool
+ */
+static int
+CTL_RUNNABLE_HANDLER(extend)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	int arg_in = *(int *)arg;
+
+	if (pop->has_remote_replicas) {
+		ERR("the lanes of a pool with remote replicas cannot be "
+			"extended");
+		errno = ENOTSUP;
+		return -1;
+	}
+
+	if (arg_in <= 0) {
+		ERR("invalid number of new lanes %d", arg_in);
+		errno = EINVAL;
+		return -1;
+	}
+
+	return lane_extend(pop, (unsigned)arg_in);
+}
+
+/*
+ * CTL_READ_HANDLER(affinity) -- returns whether the lanes are assigned to
+ *	the CPUs
+ */
+static int
+CTL_READ_HANDLER(affinity)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	int *arg_out = arg;
+	*arg_out = pop->lanes_desc.affinity;
+
+	return 0;
+}
+
+/*
+ * CTL_WRITE_HANDLER(affinity) -- enables or disables the assignment of the
+ *	lanes to the CPUs
+ */
+static int
+CTL_WRITE_HANDLER(affinity)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	int arg_in = *(int *)arg;
+	pop->lanes_desc.affinity = arg_in > 0;
+
+	return 0;
+}
+
+static const struct ctl_argument CTL_ARG(affinity) = CTL_ARG_BOOLEAN;
+
+static const struct ctl_node CTL_NODE(lane)[] = {
+	CTL_LEAF_RW(affinity),
+	CTL_LEAF_RW(count),
+	CTL_LEAF_RO(total),
+	CTL_LEAF_RUNNABLE(extend),
+
+	CTL_NODE_END
+};
+
+/*
+ * lane_ctl_register -- registers ctl nodes for lanes
+ */
+void
+lane_ctl_register(PMEMobjpool *pop)
+{
+	CTL_REGISTER_MODULE(pop->ctl, lane);
+}
+
+/*
+ * CTL_READ_HANDLER(threads) -- returns the number of threads used to recover
+ *	the lanes
+ */
+static int
+CTL_READ_HANDLER(threads)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	int *arg_out = arg;
+
+	*arg_out = Lane_recovery_threads;
+
+	return 0;
+}
+
+/*
+ * CTL_WRITE_HANDLER(threads) -- sets the number of threads used to recover
+ *	the lanes, 0 for as many as there are online CPUs
+ */
+static int
+CTL_WRITE_HANDLER(threads)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	int arg_in = *(int *)arg;
+
+	if (arg_in < 0) {
+		ERR("number of recovery threads cannot be negative");
+		errno = EINVAL;
+		return -1;
+	}
+
+	Lane_recovery_threads = arg_in;
+
+	return 0;
+}
+
+static const struct ctl_argument CTL_ARG(threads) = CTL_ARG_INT;
+
+static const struct ctl_node CTL_NODE(recovery)[] = {
+	CTL_LEAF_RW(threads),
+
+	CTL_NODE_END
+};
+
+/*
+ * lane_global_ctl_register -- registers global ctl nodes for the recovery of
+ *	lanes
+ */
+void
+lane_global_ctl_register(void)
+{
+	CTL_REGISTER_MODULE(NULL, recovery);
+}
@@ -38,6 +38,7 @@
 #define LIBPMEMOBJ_LANE_H 1
 
 #include <stdint.h>
+#include "mwcas.h"
 #include "ulog.h"
 #include "libpmemobj.h"
 
@@ -61,6 +62,20 @@ extern "C" {
 
 #define RLANE_DEFAULT 0
 
+/*
+ * Maximum number of lanes, including the ones added in the extensions of
+ * the lane area.
+ */
+#define LANE_MAX_NLANES 16384
+
+/*
+ * The lane locks and the runtime state of the lanes are allocated in chunks,
+ * only for the lanes the pool has. The chunks never move, so that the lanes
+ * can be added to the pool in use.
+ */
+#define LANE_CHUNK_NLANES 256
+#define LANE_MAX_NCHUNKS (LANE_MAX_NLANES / LANE_CHUNK_NLANES)
+
 #define LANE_TOTAL_SIZE 3072 /* 3 * 1024 (sum of 3 old lane sections) */
 /*
  * We have 3 kilobytes to distribute.
@@ -100,11 +115,28 @@ struct lane_layout {
 	struct ULOG(LANE_UNDO_SIZE) undo;
 };
 
+/*
+ * Extension of the lane area, allocated from the heap. The extensions form
+ * a list that starts at 'lanes_ext_offset' of the pool, their lanes follow
+ * the lanes of the pool descriptor. The lane layouts of an extension start
+ * at the first cache line boundary after its header.
+ */
+struct lane_ext {
+	uint64_t next; /* offset of the next extension */
+	uint64_t nlanes; /* number of lanes in this extension */
+};
+
 struct lane {
 	struct lane_layout *layout; /* pointer to persistent layout */
 	struct operation_context *internal; /* context for internal ulog */
 	struct operation_context *external; /* context for external ulog */
 	struct operation_context *undo; /* context for undo ulog */
+	struct mwcas_desc mwcas; /* the multi-word CAS performed in the lane */
+};
+
+struct lane_chunk {
+	uint64_t locks[LANE_CHUNK_NLANES];
+	struct lane lanes[LANE_CHUNK_NLANES];
 };
 
 struct lane_descriptor {
@@ -114,11 +146,39 @@ struct lane_descriptor {
 	 * other resources e.g. available RNIC's submission queue sizes.
 	 */
 	unsigned runtime_nlanes;
+	unsigned total_nlanes; /* including the lanes of the extensions */
+	unsigned extending; /* lanes are being added to the pool */
 	unsigned next_lane_idx;
-	uint64_t *lane_locks;
-	struct lane *lane;
+	struct lane_chunk **chunks; /* LANE_MAX_NCHUNKS entries */
+
+	/*
+	 * In the affinity mode the lanes are split into 'ncpus' partitions
+	 * and threads take the lanes from the partition of the CPU they run on.
+	 */
+	int affinity;
+	unsigned ncpus;
 };
 
+/*
+ * lane_get -- returns the runtime state of the lane with the given index
+ */
+static inline struct lane *
+lane_get(struct lane_descriptor *ld, uint64_t idx)
+{
+	return &ld->chunks[idx / LANE_CHUNK_NLANES]->
+		lanes[idx % LANE_CHUNK_NLANES];
+}
+
+/*
+ * lane_get_lock -- returns the lock of the lane with the given index
+ */
+static inline uint64_t *
+lane_get_lock(struct lane_descriptor *ld, uint64_t idx)
+{
+	return &ld->chunks[idx / LANE_CHUNK_NLANES]->
+		locks[idx % LANE_CHUNK_NLANES];
+}
+
 typedef int (*section_layout_op)(PMEMobjpool *pop, void *data, unsigned length);
 typedef void *(*section_constr)(PMEMobjpool *pop, void *data);
 typedef void (*section_destr)(PMEMobjpool *pop, void *rt);
@@ -158,12 +218,15 @@ void lane_cleanup(PMEMobjpool *pop);
 int lane_recover_and_section_boot(PMEMobjpool *pop);
 int lane_section_cleanup(PMEMobjpool *pop);
 int lane_check(PMEMobjpool *pop);
+void lane_ctl_register(PMEMobjpool *pop);
+void lane_global_ctl_register(void);
 
 unsigned lane_hold(PMEMobjpool *pop, struct lane **lane);
 void lane_release(PMEMobjpool *pop);
 
 void lane_attach(PMEMobjpool *pop, unsigned lane);
 unsigned lane_detach(PMEMobjpool *pop);
+void lane_release_detached(PMEMobjpool *pop, unsigned lane);
 
 #ifdef __cplusplus
 }
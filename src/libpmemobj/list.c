@@ -40,6 +40,7 @@
 #include "os_thread.h"
 #include "out.h"
 #include "sync.h"
+#include "tx.h"
 #include "valgrind_internal.h"
 #include "memops.h"
 
@@ -492,6 +493,8 @@ list_insert_new(PMEMobjpool *pop,
 	int r = pmemobj_mutex_assert_locked(pop, &user_head->lock);
 	ASSERTeq(r, 0);
 #endif
+	tx_epoch_sync_all(pop);
+
 	struct lane *lane;
 	lane_hold(pop, &lane);
 
@@ -621,6 +624,8 @@ list_insert(PMEMobjpool *pop,
 	LOG(3, NULL);
 	ASSERTne(head, NULL);
 
+	tx_epoch_sync_all(pop);
+
 	struct lane *lane;
 	lane_hold(pop, &lane);
 
@@ -701,6 +706,8 @@ list_remove_free(PMEMobjpool *pop, size_t pe_offset,
 	ASSERTeq(r, 0);
 #endif
 
+	tx_epoch_sync_all(pop);
+
 	struct lane *lane;
 	lane_hold(pop, &lane);
 	struct operation_context *ctx = lane->external;
@@ -784,6 +791,8 @@ list_remove(PMEMobjpool *pop,
 
 	int ret;
 
+	tx_epoch_sync_all(pop);
+
 	struct lane *lane;
 	lane_hold(pop, &lane);
 
@@ -855,6 +864,8 @@ list_move(PMEMobjpool *pop,
 
 	int ret;
 
+	tx_epoch_sync_all(pop);
+
 	struct lane *lane;
 	lane_hold(pop, &lane);
 
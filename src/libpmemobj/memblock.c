@@ -221,6 +221,12 @@ memblock_header_compact_write(const struct memory_block *m,
 	padded.hdr.size = size | ((uint64_t)flags << ALLOC_HDR_SIZE_SHIFT);
 	padded.hdr.extra = extra;
 
+	/*
+	 * The padding ends up in the user data, which might have been zeroed
+	 * ahead of time.
+	 */
+	memset(padded.padding, 0, sizeof(padded.padding));
+
 	struct allocation_header_compact *hdrp = m->m_ops->get_real_data(m);
 
 	VALGRIND_DO_MAKE_MEM_UNDEFINED(hdrp, sizeof(*hdrp));
@@ -906,6 +912,34 @@ block_get_flags(const struct memory_block *m)
 	return memblock_header_ops[m->header_type].get_flags(m);
 }
 
+/*
+ * Number of bitmap values that are checked at once when looking for free units.
+ * Fully allocated parts of the bitmap are skipped in 256 bit steps, which is
+ * a loop that compilers can easily vectorize.
+ */
+#define RUN_BITMAP_SCAN_VALUES 4
+
+/*
+ * run_bitmap_skip_full -- (internal) returns the index of the first group of
+ *	values, starting from the given one, that has at least one clear bit
+ */
+static unsigned
+run_bitmap_skip_full(const struct run_bitmap *b, unsigned i)
+{
+	while (i + RUN_BITMAP_SCAN_VALUES <= b->nvalues) {
+		uint64_t full = UINT64_MAX;
+		for (unsigned j = 0; j < RUN_BITMAP_SCAN_VALUES; ++j)
+			full &= b->values[i + j];
+
+		if (full != UINT64_MAX)
+			break;
+
+		i += RUN_BITMAP_SCAN_VALUES;
+	}
+
+	return i;
+}
+
 /*
  * heap_run_process_bitmap_value -- (internal) looks for unset bits in the
  * value, creates a valid memory block out of them and inserts that
@@ -970,20 +1004,25 @@ run_process_bitmap_value(const struct memory_block *m,
 }
 
 /*
- * run_iterate_free -- iterates over free blocks in a run
+ * memblock_run_bitmap_iterate_free -- iterates over free blocks of a run
+ *	described by the given bitmap, which doesn't have to reside in the pool
  */
-static int
-run_iterate_free(const struct memory_block *m, object_callback cb, void *arg)
+int
+memblock_run_bitmap_iterate_free(const struct memory_block *m,
+	const struct run_bitmap *b, object_callback cb, void *arg)
 {
 	int ret = 0;
 	uint32_t block_off = 0;
 
-	struct run_bitmap b;
-	run_get_bitmap(m, &b);
-
 	struct memory_block nm = *m;
-	for (unsigned i = 0; i < b.nvalues; ++i) {
-		uint64_t v = b.values[i];
+	for (unsigned i = 0; i < b->nvalues; ++i) {
+		if (i % RUN_BITMAP_SCAN_VALUES == 0) {
+			i = run_bitmap_skip_full(b, i);
+			if (i == b->nvalues)
+				break;
+		}
+
+		uint64_t v = b->values[i];
 		ASSERT((uint64_t)RUN_BITS_PER_VALUE * (uint64_t)i
 			<= UINT32_MAX);
 		block_off = RUN_BITS_PER_VALUE * i;
@@ -995,6 +1034,18 @@ run_iterate_free(const struct memory_block *m, object_callback cb, void *arg)
 	return 0;
 }
 
+/*
+ * run_iterate_free -- iterates over free blocks in a run
+ */
+static int
+run_iterate_free(const struct memory_block *m, object_callback cb, void *arg)
+{
+	struct run_bitmap b;
+	run_get_bitmap(m, &b);
+
+	return memblock_run_bitmap_iterate_free(m, &b, cb, arg);
+}
+
 /*
  * run_iterate_used -- iterates over used blocks in a run
  */
@@ -1178,16 +1229,22 @@ huge_reinit_chunk(const struct memory_block *m)
 }
 
 /*
- * run_calc_free -- calculates the number of free units in a run
+ * memblock_run_bitmap_calc_free -- calculates the number of free units and
+ *	the largest free block in the given run bitmap, which doesn't have to
+ *	reside in the pool
  */
-static void
-run_calc_free(const struct memory_block *m,
+void
+memblock_run_bitmap_calc_free(const struct run_bitmap *b,
 	uint32_t *free_space, uint32_t *max_free_block)
 {
-	struct run_bitmap b;
-	run_get_bitmap(m, &b);
-	for (unsigned i = 0; i < b.nvalues; ++i) {
-		uint64_t value = ~b.values[i];
+	for (unsigned i = 0; i < b->nvalues; ++i) {
+		if (i % RUN_BITMAP_SCAN_VALUES == 0) {
+			i = run_bitmap_skip_full(b, i);
+			if (i == b->nvalues)
+				break;
+		}
+
+		uint64_t value = ~b->values[i];
 		if (value == 0)
 			continue;
 
@@ -1227,6 +1284,19 @@ run_calc_free(const struct memory_block *m,
 	}
 }
 
+/*
+ * run_calc_free -- calculates the number of free units in a run
+ */
+static void
+run_calc_free(const struct memory_block *m,
+	uint32_t *free_space, uint32_t *max_free_block)
+{
+	struct run_bitmap b;
+	run_get_bitmap(m, &b);
+
+	memblock_run_bitmap_calc_free(&b, free_space, max_free_block);
+}
+
 static const struct memory_block_ops mb_ops[MAX_MEMORY_BLOCK] = {
 	[MEMORY_BLOCK_HUGE] = {
 		.block_size = huge_block_size,
@@ -313,6 +313,10 @@ struct memory_block memblock_run_init(struct palloc_heap *heap,
 void memblock_run_bitmap(uint32_t *size_idx, uint16_t flags,
 	uint64_t unit_size, uint64_t alignment, void *content,
 	struct run_bitmap *b);
+void memblock_run_bitmap_calc_free(const struct run_bitmap *b,
+	uint32_t *free_space, uint32_t *max_free_block);
+int memblock_run_bitmap_iterate_free(const struct memory_block *m,
+	const struct run_bitmap *b, object_callback cb, void *arg);
 
 #ifdef __cplusplus
 }
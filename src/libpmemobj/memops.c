@@ -58,6 +58,12 @@ struct operation_log {
 	struct ulog *ulog; /* DRAM allocated log of modifications */
 };
 
+/*
+ * Number of the recent operations that the count of the kept ulog extensions
+ * is based on, it's also the scale of the fixed-point count.
+ */
+#define OP_KEEP_SCALE 16
+
 /*
  * operation_context -- context of an ongoing palloc operation
  */
@@ -77,20 +83,56 @@ struct operation_context {
 	size_t total_logged; /* total amount of buffer stores in the logs */
 
 	struct ulog *ulog; /* pointer to the persistent ulog log */
+	uint64_t gen_num; /* generation of the ulog the operation started in */
 	size_t ulog_base_nbytes; /* available bytes in initial ulog log */
 	size_t ulog_capacity; /* sum of capacity, incl all next ulog logs */
 
 	struct ulog_next next; /* vector of 'next' fields of persistent ulog */
+	size_t next_keep; /* extensions to keep, scaled by OP_KEEP_SCALE */
+	uint64_t nextended; /* number of the extensions allocated so far */
+	struct ulog_entries sorted; /* scratch space for sorting redo entries */
 
 	int in_progress; /* operation sanity check */
 
 	struct operation_log pshadow_ops; /* shadow copy of persistent ulog */
 	struct operation_log transient_ops; /* log of transient changes */
+	size_t pshadow_last; /* offset of the last persistent entry */
+	size_t pshadow_last_end; /* end of the ulog with the last entry */
 
 	/* collection used to look for potential merge candidates */
 	VECQ(, struct ulog_entry_val *) merge_entries;
 };
 
+/*
+ * operation_log_resize -- (internal) reallocates the ulog of the operation log
+ *	to the given capacity, keeping its current contents
+ *
+ * The ulog is cacheline aligned, just like its persistent counterpart, so that
+ * the buffer entries can be created directly in it.
+ */
+static int
+operation_log_resize(struct operation_log *log, size_t capacity)
+{
+	struct ulog *ulog = util_aligned_malloc(CACHELINE_SIZE,
+		SIZEOF_ULOG(capacity));
+	if (ulog == NULL) {
+		ERR("!util_aligned_malloc");
+		return -1;
+	}
+
+	if (log->ulog != NULL) {
+		memcpy(ulog, log->ulog, SIZEOF_ULOG(log->capacity));
+		util_aligned_free(log->ulog);
+	} else {
+		memset(ulog, 0, SIZEOF_ULOG(capacity));
+	}
+
+	log->ulog = ulog;
+	log->capacity = capacity;
+
+	return 0;
+}
+
 /*
  * operation_log_transient_init -- (internal) initialize operation log
  *	containing transient memory resident changes
@@ -98,20 +140,14 @@ struct operation_context {
 static int
 operation_log_transient_init(struct operation_log *log)
 {
-	log->capacity = ULOG_BASE_SIZE;
 	log->offset = 0;
+	log->ulog = NULL;
 
-	struct ulog *src = Zalloc(sizeof(struct ulog) +
-		ULOG_BASE_SIZE);
-	if (src == NULL) {
-		ERR("!Zalloc");
+	if (operation_log_resize(log, ULOG_BASE_SIZE) != 0)
 		return -1;
-	}
 
 	/* initialize underlying redo log structure */
-	src->capacity = ULOG_BASE_SIZE;
-
-	log->ulog = src;
+	log->ulog->capacity = ULOG_BASE_SIZE;
 
 	return 0;
 }
@@ -124,21 +160,16 @@ static int
 operation_log_persistent_init(struct operation_log *log,
 	size_t ulog_base_nbytes)
 {
-	log->capacity = ULOG_BASE_SIZE;
 	log->offset = 0;
+	log->ulog = NULL;
 
-	struct ulog *src = Zalloc(sizeof(struct ulog) +
-		ULOG_BASE_SIZE);
-	if (src == NULL) {
-		ERR("!Zalloc");
+	if (operation_log_resize(log, ULOG_BASE_SIZE) != 0)
 		return -1;
-	}
 
 	/* initialize underlying redo log structure */
-	src->capacity = ulog_base_nbytes;
-	memset(src->unused, 0, sizeof(src->unused));
-
-	log->ulog = src;
+	log->ulog->capacity = ulog_base_nbytes;
+	log->ulog->epoch = 0;
+	memset(log->ulog->unused, 0, sizeof(log->ulog->unused));
 
 	return 0;
 }
@@ -165,6 +196,14 @@ operation_transient_memcpy(void *base, void *dest, const void *src, size_t len,
 	return memcpy(dest, src, len);
 }
 
+/*
+ * operation_transient_drain -- transient drain wrapper
+ */
+static void
+operation_transient_drain(void *base)
+{
+}
+
 /*
  * operation_new -- creates new operation context
  */
@@ -187,7 +226,10 @@ operation_new(struct ulog *ulog, size_t ulog_base_nbytes,
 	ctx->ulog_free = ulog_free;
 	ctx->in_progress = 0;
 	VEC_INIT(&ctx->next);
+	VEC_INIT(&ctx->sorted);
 	ulog_rebuild_next_vec(ulog, &ctx->next, p_ops);
+	/* the extensions left by the previous runs are assumed to be needed */
+	ctx->next_keep = VEC_SIZE(&ctx->next) * OP_KEEP_SCALE;
 	ctx->p_ops = p_ops;
 	ctx->type = type;
 
@@ -202,6 +244,7 @@ operation_new(struct ulog *ulog, size_t ulog_base_nbytes,
 	ctx->s_ops.base = p_ops->base;
 	ctx->s_ops.flush = operation_transient_clean;
 	ctx->s_ops.memcpy = operation_transient_memcpy;
+	ctx->s_ops.drain = operation_transient_drain;
 
 	VECQ_INIT(&ctx->merge_entries);
 
@@ -228,8 +271,9 @@ operation_delete(struct operation_context *ctx)
 {
 	VECQ_DELETE(&ctx->merge_entries);
 	VEC_DELETE(&ctx->next);
-	Free(ctx->pshadow_ops.ulog);
-	Free(ctx->transient_ops.ulog);
+	VEC_DELETE(&ctx->sorted);
+	util_aligned_free(ctx->pshadow_ops.ulog);
+	util_aligned_free(ctx->transient_ops.ulog);
 	Free(ctx);
 }
 
@@ -288,6 +332,62 @@ operation_try_merge_entry(struct operation_context *ctx,
 	return ret;
 }
 
+/*
+ * operation_log_end -- (internal) returns the offset of the end of the
+ *	persistent ulog that contains the given offset of the log, or 0 if the
+ *	offset is past the reserved capacity
+ */
+static size_t
+operation_log_end(struct operation_context *ctx, size_t offset)
+{
+	size_t end = ctx->ulog_base_nbytes;
+	struct ulog *ulog = ctx->ulog;
+
+	while (end <= offset) {
+		ulog = ulog_next(ulog, ctx->p_ops);
+		if (ulog == NULL)
+			return 0;
+
+		end += ulog->capacity;
+	}
+
+	return end;
+}
+
+/*
+ * operation_try_append_entry -- (internal) tries to append a set of the given
+ *	value to the last entry in the persistent log
+ *
+ * Sets of consecutive words are stored in a single entry, which takes up
+ * only 8 bytes per word instead of 16. This is the case for all the ranges
+ * of the redo logged transactions. The entries cannot cross the boundaries of
+ * the persistent ulogs, so a run ends with the ulog it has started in.
+ */
+static int
+operation_try_append_entry(struct operation_context *ctx,
+	void *ptr, uint64_t value)
+{
+	struct operation_log *oplog = &ctx->pshadow_ops;
+	if (oplog->offset == 0 || ctx->pshadow_last_end <= ctx->pshadow_last)
+		return 0;
+
+	if (!ulog_entry_val_append(oplog->ulog, ctx->pshadow_last, ptr, value,
+	    ctx->pshadow_last_end - ctx->pshadow_last, &ctx->s_ops))
+		return 0;
+
+	struct ulog_entry_base *e = (struct ulog_entry_base *)
+		(oplog->ulog->data + ctx->pshadow_last);
+	oplog->offset = ctx->pshadow_last + ulog_entry_size(e);
+
+	/*
+	 * The entries tracked for merging could now be overridden by the
+	 * appended value, which would make merging them incorrect.
+	 */
+	VECQ_CLEAR(&ctx->merge_entries);
+
+	return 1;
+}
+
 /*
  * operation_merge_entry_add -- adds a new entry to the merge collection,
  *	keeps capacity at OP_MERGE_SEARCH. Removes old entries in FIFO fashion.
@@ -322,18 +422,14 @@ operation_add_typed_entry(struct operation_context *ctx,
 	 * Always make sure to have one extra spare cacheline so that the
 	 * ulog log entry creation has enough room for zeroing.
 	 */
-	if (oplog->offset + CACHELINE_SIZE == oplog->capacity) {
-		size_t ncapacity = oplog->capacity + ULOG_BASE_SIZE;
-		struct ulog *ulog = Realloc(oplog->ulog,
-			SIZEOF_ULOG(ncapacity));
-		if (ulog == NULL)
+	if (oplog->offset + CACHELINE_SIZE >= oplog->capacity) {
+		if (operation_log_resize(oplog,
+		    oplog->capacity + ULOG_BASE_SIZE) != 0)
 			return -1;
-		oplog->capacity += ULOG_BASE_SIZE;
-		oplog->ulog = ulog;
 
 		/*
-		 * Realloc invalidated the ulog entries that are inside of this
-		 * vector, need to clear it to avoid use after free.
+		 * Reallocation invalidated the ulog entries that are inside of
+		 * this vector, need to clear it to avoid use after free.
 		 */
 		VECQ_CLEAR(&ctx->merge_entries);
 	}
@@ -342,12 +438,20 @@ operation_add_typed_entry(struct operation_context *ctx,
 		operation_try_merge_entry(ctx, ptr, value, type) != 0)
 		return 0;
 
+	if (log_type == LOG_PERSISTENT && type == ULOG_OPERATION_SET &&
+		operation_try_append_entry(ctx, ptr, value) != 0)
+		return 0;
+
 	struct ulog_entry_val *entry = ulog_entry_val_create(
 		oplog->ulog, oplog->offset, ptr, value, type,
 		log_type == LOG_TRANSIENT ? &ctx->t_ops : &ctx->s_ops);
 
-	if (log_type == LOG_PERSISTENT)
+	if (log_type == LOG_PERSISTENT) {
 		operation_merge_entry_add(ctx, entry);
+		ctx->pshadow_last = oplog->offset;
+		ctx->pshadow_last_end = type == ULOG_OPERATION_SET ?
+			operation_log_end(ctx, oplog->offset) : 0;
+	}
 
 	oplog->offset += ulog_entry_size(&entry->base);
 
@@ -372,6 +476,110 @@ operation_add_entry(struct operation_context *ctx, void *ptr, uint64_t value,
 		from_pool ? LOG_PERSISTENT : LOG_TRANSIENT);
 }
 
+/*
+ * operation_log_pad -- (internal) pads the shadow copy of the persistent log
+ *	to a cacheline boundary by repeating the modification of its last word
+ *
+ * Applying the same value entry twice in a row has no additional effect.
+ * The value entries are 16 bytes long, so the copies never cross the
+ * boundaries of the persistent ulogs.
+ */
+static void
+operation_log_pad(struct operation_context *ctx)
+{
+	struct operation_log *oplog = &ctx->pshadow_ops;
+	ASSERTeq(oplog->offset % sizeof(struct ulog_entry_val), 0);
+
+	if (oplog->offset % CACHELINE_SIZE == 0)
+		return;
+
+	struct ulog_entry_base *e = (struct ulog_entry_base *)
+		(oplog->ulog->data + ctx->pshadow_last);
+	ulog_operation_type type = ulog_entry_type(e);
+	uint64_t *ptr = (uint64_t *)((uintptr_t)ctx->p_ops->base +
+		ulog_entry_offset(e));
+	uint64_t value;
+
+	if (type == ULOG_OPERATION_SET_RUN) {
+		struct ulog_entry_vals *evs = (struct ulog_entry_vals *)e;
+		ptr += evs->nvalues - 1;
+		value = evs->values[evs->nvalues - 1];
+		type = ULOG_OPERATION_SET;
+	} else {
+		value = ((struct ulog_entry_val *)e)->value;
+	}
+
+	while (oplog->offset % CACHELINE_SIZE != 0) {
+		ulog_entry_val_create(oplog->ulog, oplog->offset, ptr, value,
+			type, &ctx->s_ops);
+		oplog->offset += sizeof(struct ulog_entry_val);
+	}
+}
+
+/*
+ * operation_add_buffer_redo -- (internal) adds a buffer operation to the
+ *	shadow copy of the persistent redo log
+ *
+ * The buffer entries are cacheline aligned, and the ones that don't fit in
+ * the remaining space of a persistent ulog are split in two. The capacity
+ * of the persistent log has to be reserved up front.
+ */
+static int
+operation_add_buffer_redo(struct operation_context *ctx,
+	void *dest, const void *src, size_t size, ulog_operation_type type)
+{
+	struct operation_log *oplog = &ctx->pshadow_ops;
+
+	/* a set entry only stores the value the range is filled with */
+	int fill = type == ULOG_OPERATION_BUF_SET;
+
+	/* room for the padding, and a spare cacheline for zeroing */
+	if (oplog->offset + 2 * CACHELINE_SIZE >= oplog->capacity &&
+	    operation_log_resize(oplog,
+	    oplog->capacity + ULOG_BASE_SIZE) != 0)
+		return -1;
+
+	operation_log_pad(ctx);
+
+	do {
+		size_t end = operation_log_end(ctx, oplog->offset);
+		ASSERTne(end, 0);
+
+		size_t real_size = (fill ? sizeof(uint8_t) : size) +
+			sizeof(struct ulog_entry_buf);
+		size_t curr_size = MIN(real_size, end - oplog->offset);
+		size_t data_size = fill ? size :
+			curr_size - sizeof(struct ulog_entry_buf);
+		size_t entry_size = ALIGN_UP(curr_size, CACHELINE_SIZE);
+
+		size_t nbytes = oplog->offset + entry_size + CACHELINE_SIZE;
+		if (nbytes >= oplog->capacity &&
+		    operation_log_resize(oplog,
+		    ALIGN_UP(nbytes + 1, (size_t)ULOG_BASE_SIZE)) != 0)
+			return -1;
+
+		ulog_entry_buf_create(oplog->ulog, oplog->offset,
+			ctx->gen_num, dest, src, data_size, type, &ctx->s_ops);
+
+		ctx->pshadow_last = oplog->offset;
+		oplog->offset += entry_size;
+
+		dest = (char *)dest + data_size;
+		src = (const char *)src + data_size;
+		size -= data_size;
+	} while (size != 0);
+
+	/* terminate the log, there might be leftovers of the previous one */
+	memset(oplog->ulog->data + oplog->offset, 0,
+		sizeof(struct ulog_entry_base));
+
+	/* the entries that precede the buffer must not change anymore */
+	ctx->pshadow_last_end = 0;
+	VECQ_CLEAR(&ctx->merge_entries);
+
+	return 0;
+}
+
 /*
  * operation_add_buffer -- adds a buffer operation to the log
  */
@@ -379,7 +587,13 @@ int
 operation_add_buffer(struct operation_context *ctx,
 	void *dest, void *src, size_t size, ulog_operation_type type)
 {
-	size_t real_size = size + sizeof(struct ulog_entry_buf);
+	if (ctx->type == LOG_TYPE_REDO)
+		return operation_add_buffer_redo(ctx, dest, src, size, type);
+
+	/* a set entry only stores the value the range is filled with */
+	int fill = type == ULOG_OPERATION_BUF_SET;
+	size_t real_size = (fill ? sizeof(uint8_t) : size) +
+		sizeof(struct ulog_entry_buf);
 
 	/* if there's no space left in the log, reserve some more */
 	if (ctx->ulog_curr_capacity == 0) {
@@ -394,11 +608,12 @@ operation_add_buffer(struct operation_context *ctx,
 	}
 
 	size_t curr_size = MIN(real_size, ctx->ulog_curr_capacity);
-	size_t data_size = curr_size - sizeof(struct ulog_entry_buf);
+	size_t data_size = fill ? size :
+		curr_size - sizeof(struct ulog_entry_buf);
 
 	/* create a persistent log entry */
 	struct ulog_entry_buf *e = ulog_entry_buf_create(ctx->ulog_curr,
-		ctx->ulog_curr_offset,
+		ctx->ulog_curr_offset, ctx->gen_num,
 		dest, src, data_size,
 		type, ctx->p_ops);
 	size_t entry_size = ALIGN_UP(curr_size, CACHELINE_SIZE);
@@ -431,8 +646,8 @@ operation_process_persistent_redo(struct operation_context *ctx)
 		ctx->pshadow_ops.offset, ctx->ulog_base_nbytes,
 		&ctx->next, ctx->p_ops);
 
-	ulog_process(ctx->pshadow_ops.ulog, OBJ_OFF_IS_VALID_FROM_CTX,
-		ctx->p_ops);
+	ulog_process_coalesced(ctx->pshadow_ops.ulog, &ctx->sorted,
+		OBJ_OFF_IS_VALID_FROM_CTX, ctx->p_ops);
 
 	ulog_clobber(ctx->ulog, &ctx->next, ctx->p_ops);
 }
@@ -445,24 +660,51 @@ operation_process_persistent_undo(struct operation_context *ctx)
 {
 	ASSERTeq(ctx->pshadow_ops.capacity % CACHELINE_SIZE, 0);
 
+	if (ctx->total_logged == 0)
+		return;
+
 	ulog_process(ctx->ulog, OBJ_OFF_IS_VALID_FROM_CTX, ctx->p_ops);
+
+	/* the rolled back data must be durable before the log is discarded */
+	pmemops_drain(ctx->p_ops);
 }
 
 /*
  * operation_reserve -- (internal) reserves new capacity in persistent ulog log
+ *
+ * The shadow copy of a redo log is grown to fit the reserved capacity as well,
+ * so that the entries which fit in the persistent log can always be added.
  */
 int
 operation_reserve(struct operation_context *ctx, size_t new_capacity)
 {
+	if (ctx->type == LOG_TYPE_REDO) {
+		struct operation_log *oplog = &ctx->pshadow_ops;
+
+		/* room for the padding, and a spare cacheline for zeroing */
+		size_t shadow_capacity = ALIGN_UP(new_capacity +
+			2 * CACHELINE_SIZE + 1, (size_t)ULOG_BASE_SIZE);
+		if (shadow_capacity > oplog->capacity) {
+			if (operation_log_resize(oplog, shadow_capacity) != 0)
+				return -1;
+
+			/* the tracked entries were in the previous copy */
+			VECQ_CLEAR(&ctx->merge_entries);
+		}
+	}
+
 	if (new_capacity > ctx->ulog_capacity) {
 		if (ctx->extend == NULL) {
 			ERR("no extend function present");
 			return -1;
 		}
 
-		if (ulog_reserve(ctx->ulog,
+		size_t nnext = VEC_SIZE(&ctx->next);
+		int ret = ulog_reserve(ctx->ulog,
 		    ctx->ulog_base_nbytes, &new_capacity, ctx->extend,
-		    &ctx->next, ctx->p_ops) != 0)
+		    &ctx->next, ctx->p_ops);
+		ctx->nextended += VEC_SIZE(&ctx->next) - nnext;
+		if (ret != 0)
 			return -1;
 		ctx->ulog_capacity = new_capacity;
 	}
@@ -486,12 +728,15 @@ operation_init(struct operation_context *ctx)
 		plog->capacity);
 	tlog->offset = 0;
 	plog->offset = 0;
+	ctx->pshadow_last = 0;
+	ctx->pshadow_last_end = 0;
 	VECQ_REINIT(&ctx->merge_entries);
 
 	ctx->ulog_curr_offset = 0;
 	ctx->ulog_curr_capacity = 0;
 	ctx->ulog_curr = NULL;
 	ctx->total_logged = 0;
+	ctx->gen_num = ctx->ulog->gen_num;
 }
 
 /*
@@ -564,6 +809,95 @@ operation_process(struct operation_context *ctx)
 		ulog_process(ctx->transient_ops.ulog, NULL, &ctx->t_ops);
 }
 
+/*
+ * operation_logs_used -- (internal) returns the number of the ulog extensions
+ *	used by the current operation
+ */
+static size_t
+operation_logs_used(struct operation_context *ctx)
+{
+	size_t used = 0;
+	struct ulog *ulog = ctx->ulog;
+
+	if (ctx->type == LOG_TYPE_UNDO) {
+		if (ctx->ulog_curr == NULL)
+			return 0;
+
+		while (ulog != ctx->ulog_curr) {
+			ulog = ulog_next(ulog, ctx->p_ops);
+			ASSERTne(ulog, NULL);
+			used++;
+		}
+
+		return used;
+	}
+
+	size_t nbytes = ctx->pshadow_ops.offset;
+	size_t capacity = ctx->ulog_base_nbytes;
+	while (capacity < nbytes &&
+	    (ulog = ulog_next(ulog, ctx->p_ops)) != NULL) {
+		capacity += ulog->capacity;
+		used++;
+	}
+
+	return used;
+}
+
+/*
+ * operation_logs_account -- (internal) updates the number of the ulog
+ *	extensions to keep with the ones used by the current operation
+ *
+ * The count follows the peak use and then slowly decays, so that the
+ * extensions needed by a recurring large operation are not freed by the
+ * smaller ones that happen in between.
+ */
+static void
+operation_logs_account(struct operation_context *ctx)
+{
+	size_t used = operation_logs_used(ctx) * OP_KEEP_SCALE;
+	size_t decayed = ctx->next_keep * (OP_KEEP_SCALE - 1) / OP_KEEP_SCALE;
+
+	ctx->next_keep = MAX(used, decayed);
+}
+
+/*
+ * operation_nextended -- returns the number of the ulog extensions allocated
+ *	by the context since it was created
+ */
+uint64_t
+operation_nextended(struct operation_context *ctx)
+{
+	return ctx->nextended;
+}
+
+/*
+ * operation_free_logs -- frees the ulog extensions that were not in use
+ *	recently, the remaining ones are reused by the next operations
+ *
+ * This might allocate memory, and so it cannot be called while holding any
+ * of the heap locks.
+ */
+void
+operation_free_logs(struct operation_context *ctx)
+{
+	ASSERTeq(ctx->in_progress, 0);
+
+	if (ctx->ulog_free == NULL)
+		return;
+
+	size_t nkeep = (ctx->next_keep + OP_KEEP_SCALE - 1) / OP_KEEP_SCALE;
+	if (VEC_SIZE(&ctx->next) <= nkeep)
+		return;
+
+	ulog_free_next(ctx->ulog, nkeep, ctx->ulog_free, ctx->p_ops);
+
+	/* freeing has shrunk the ulog */
+	ctx->ulog_capacity = ulog_capacity(ctx->ulog,
+		ctx->ulog_base_nbytes, ctx->p_ops);
+	VEC_CLEAR(&ctx->next);
+	ulog_rebuild_next_vec(ctx->ulog, &ctx->next, ctx->p_ops);
+}
+
 /*
  * operation_finish -- finalizes the operation
  */
@@ -575,14 +909,15 @@ operation_finish(struct operation_context *ctx)
 
 	if (ctx->type == LOG_TYPE_REDO && ctx->pshadow_ops.offset != 0) {
 		operation_process(ctx);
+		operation_logs_account(ctx);
 	} else if (ctx->type == LOG_TYPE_UNDO && ctx->total_logged != 0) {
-		ulog_clobber_data(ctx->ulog,
-			ctx->total_logged, ctx->ulog_base_nbytes,
-			&ctx->next, ctx->ulog_free, ctx->p_ops);
-		/* clobbering might have shrunk the ulog */
-		ctx->ulog_capacity = ulog_capacity(ctx->ulog,
-			ctx->ulog_base_nbytes, ctx->p_ops);
-		VEC_CLEAR(&ctx->next);
-		ulog_rebuild_next_vec(ctx->ulog, &ctx->next, ctx->p_ops);
+		/*
+		 * Instead of zeroing out the entries, the log moves on to the
+		 * next generation, which makes all of them invalid at once.
+		 */
+		if (ctx->ulog->gen_num == ctx->gen_num)
+			ulog_inc_gen_num(ctx->ulog, ctx->p_ops);
+		operation_logs_account(ctx);
+		operation_free_logs(ctx);
 	}
 }
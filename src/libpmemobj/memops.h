@@ -63,6 +63,20 @@ enum log_type {
 	MAX_LOG_TYPE,
 };
 
+/*
+ * Upper bound of the space taken up in a redo log by a buffer entry of the
+ * given size, including the padding that aligns it to a cacheline.
+ */
+#define OPERATION_REDO_BUFFER_SIZE(size)\
+	(ALIGN_UP(sizeof(struct ulog_entry_buf) + (size), CACHELINE_SIZE) +\
+	CACHELINE_SIZE - sizeof(struct ulog_entry_val))
+
+/*
+ * Upper bound of the space lost to a buffer entry that reaches the end of
+ * a redo ulog and has to be split in two.
+ */
+#define OPERATION_REDO_BUFFER_SPLIT_SIZE CACHELINE_SIZE
+
 struct operation_context;
 
 struct operation_context *
@@ -89,6 +103,8 @@ int operation_reserve(struct operation_context *ctx, size_t new_capacity);
 void operation_process(struct operation_context *ctx);
 void operation_finish(struct operation_context *ctx);
 void operation_cancel(struct operation_context *ctx);
+void operation_free_logs(struct operation_context *ctx);
+uint64_t operation_nextended(struct operation_context *ctx);
 
 #ifdef __cplusplus
 }
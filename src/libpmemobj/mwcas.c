@@ -0,0 +1,382 @@
+/*
+ * Copyright 2019, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * mwcas.c -- persistent multi-word compare-and-swap
+ *
+ * An operation takes ownership of the words it updates, in the order of
+ * their addresses, by replacing the expected values with a marker that
+ * refers to the descriptor of the operation in the lane it holds. Before any
+ * of the markers is installed, the undo log of the lane records the marker
+ * along with the expected value of each word, and the recovery of the lane
+ * restores only the words that still hold the marker, which are the ones
+ * the operation managed to take before a crash. Once the operation owns all
+ * the words, the new values are published through the redo log of the lane
+ * along with the invalidation of the undo log, which makes the operation
+ * durable in a single atomic step. A failed operation releases the words it
+ * owns the same way, only with their expected values.
+ *
+ * Readers that encounter a marker resolve the logical value of the word from
+ * the descriptor instead of waiting for the operation. Other operations wait
+ * until the word is released by its owner, they never modify the words of
+ * an operation whose undo log is still valid. Since the ownership is always
+ * taken in the order of the addresses, the operations cannot deadlock.
+ */
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lane.h"
+#include "mwcas.h"
+#include "obj.h"
+#include "out.h"
+#include "palloc.h"
+#include "pmemops.h"
+#include "tx.h"
+#include "util.h"
+#include "valgrind_internal.h"
+
+/* the bits of the marker that store the index of the lane */
+#define MWCAS_LANE_BITS 16
+#define MWCAS_LANE_MASK ((1ULL << MWCAS_LANE_BITS) - 1)
+
+/* the sequence numbers wrap around in the remaining bits */
+#define MWCAS_SEQ_MASK (~POBJ_MWCAS_RESERVED_BIT >> MWCAS_LANE_BITS)
+
+#define MWCAS_MARKER(lane_idx, seq)\
+	(POBJ_MWCAS_RESERVED_BIT | ((seq) << MWCAS_LANE_BITS) | (lane_idx))
+#define MWCAS_MARKER_LANE(marker) ((marker) & MWCAS_LANE_MASK)
+#define MWCAS_MARKER_SEQ(marker)\
+	(((marker) & ~POBJ_MWCAS_RESERVED_BIT) >> MWCAS_LANE_BITS)
+
+/*
+ * mwcas_desc_init -- initializes the descriptor of a lane
+ */
+void
+mwcas_desc_init(struct mwcas_desc *desc)
+{
+	desc->seq = 0;
+	desc->status = MWCAS_UNDECIDED;
+	desc->nwords = 0;
+}
+
+/*
+ * mwcas_load -- (internal) atomically loads a word
+ */
+static inline uint64_t
+mwcas_load(const uint64_t *ptr)
+{
+	uint64_t value;
+	util_atomic_load_explicit64(ptr, &value, memory_order_acquire);
+
+	return value;
+}
+
+/*
+ * mwcas_resolve -- (internal) reads the status of the operation that owns
+ *	the word and the expected value of the word, returns 0 if the operation
+ *	no longer owns the word
+ *
+ * The descriptor can be reused by the lane at any point, and so its
+ * contents are only valid if the marker is still in place after reading
+ * them.
+ */
+static int
+mwcas_resolve(PMEMobjpool *pop, const uint64_t *ptr, uint64_t marker,
+	uint64_t *value, uint64_t *status)
+{
+	uint64_t lane_idx = MWCAS_MARKER_LANE(marker);
+	ASSERT(lane_idx < pop->lanes_desc.total_nlanes);
+
+	struct mwcas_desc *desc = &lane_get(&pop->lanes_desc, lane_idx)->mwcas;
+
+	if (mwcas_load(&desc->seq) != MWCAS_MARKER_SEQ(marker))
+		return 0;
+
+	*status = mwcas_load(&desc->status);
+	uint64_t nwords = mwcas_load(&desc->nwords);
+
+	int found = 0;
+	for (uint64_t i = 0; i < nwords && i < POBJ_MWCAS_MAX_WORDS; ++i) {
+		struct pobj_mwcas *w = &desc->words[i];
+
+		uint64_t *wptr;
+		util_atomic_load_explicit64(&w->ptr, &wptr,
+			memory_order_acquire);
+		if (wptr != ptr)
+			continue;
+
+		*value = mwcas_load(&w->old_value);
+		found = 1;
+		break;
+	}
+
+	return found && mwcas_load(ptr) == marker;
+}
+
+/*
+ * mwcas_wait -- (internal) waits until the word is no longer owned by the
+ *	operation of the marker
+ *
+ * The owner releases the words in the same atomic step that invalidates its
+ * undo log, regardless of the outcome of the operation.
+ */
+static void
+mwcas_wait(const uint64_t *ptr, uint64_t marker)
+{
+	while (mwcas_load(ptr) == marker)
+		sched_yield();
+}
+
+/*
+ * mwcas_acquire -- (internal) takes the ownership of the word if it has the
+ *	expected value, returns 0 otherwise
+ */
+static int
+mwcas_acquire(struct pobj_mwcas *w, uint64_t marker)
+{
+	for (;;) {
+		uint64_t value = mwcas_load(w->ptr);
+
+		if (value & POBJ_MWCAS_RESERVED_BIT) {
+			mwcas_wait(w->ptr, value);
+			continue;
+		}
+
+		if (value != w->old_value)
+			return 0;
+
+		if (util_bool_compare_and_swap64(w->ptr, value, marker))
+			return 1;
+	}
+}
+
+/*
+ * mwcas_word_compare -- (internal) compares the words by their address
+ */
+static int
+mwcas_word_compare(const void *lhs, const void *rhs)
+{
+	const struct pobj_mwcas *l = lhs;
+	const struct pobj_mwcas *r = rhs;
+
+	if (l->ptr < r->ptr)
+		return -1;
+	if (l->ptr > r->ptr)
+		return 1;
+
+	return 0;
+}
+
+/*
+ * mwcas_words_check -- (internal) validates the words of an operation
+ */
+static int
+mwcas_words_check(PMEMobjpool *pop, const struct pobj_mwcas *words,
+	size_t nwords)
+{
+	for (size_t i = 0; i < nwords; ++i) {
+		const struct pobj_mwcas *w = &words[i];
+
+		if (!OBJ_PTR_FROM_POOL(pop, w->ptr) ||
+		    !OBJ_PTR_FROM_POOL(pop, w->ptr + 1)) {
+			ERR("word outside of pool");
+			return -1;
+		}
+
+		if ((uintptr_t)w->ptr % sizeof(uint64_t) != 0) {
+			ERR("unaligned word");
+			return -1;
+		}
+
+		if ((w->old_value | w->new_value) & POBJ_MWCAS_RESERVED_BIT) {
+			ERR("value with the reserved bit set");
+			return -1;
+		}
+
+		if (i != 0 && w->ptr == words[i - 1].ptr) {
+			ERR("duplicated word");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * mwcas_publish -- (internal) durably releases the words owned by the
+ *	operation and invalidates its undo log
+ *
+ * The words are set to their new values if the operation has succeeded, or
+ * back to their expected values otherwise.
+ */
+static void
+mwcas_publish(PMEMobjpool *pop, struct lane *lane,
+	struct pobj_mwcas *words, size_t nwords, int succeeded)
+{
+	struct pobj_action actv[POBJ_MWCAS_MAX_WORDS + 1];
+
+	for (size_t i = 0; i < nwords; ++i)
+		palloc_set_value(&pop->heap, &actv[i], words[i].ptr,
+			succeeded ? words[i].new_value : words[i].old_value);
+
+	struct ulog *undo = (struct ulog *)&lane->layout->undo;
+	palloc_set_value(&pop->heap, &actv[nwords],
+		&undo->gen_num, undo->gen_num + 1);
+
+	operation_start(lane->external);
+	palloc_publish(&pop->heap, actv, nwords + 1, lane->external);
+}
+
+/*
+ * pmemobj_mwcas -- atomically and durably sets the words to their new values
+ *	if all of them have the expected values
+ */
+int
+pmemobj_mwcas(PMEMobjpool *pop, struct pobj_mwcas *words, size_t nwords)
+{
+	LOG(3, "pop %p words %p nwords %zu", pop, words, nwords);
+
+	if (nwords == 0 || nwords > POBJ_MWCAS_MAX_WORDS) {
+		ERR("invalid number of words %zu", nwords);
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (pmemobj_tx_stage() != TX_STAGE_NONE) {
+		ERR("multi-word compare-and-swap inside of a transaction");
+		errno = EINVAL;
+		return -1;
+	}
+
+	struct pobj_mwcas sorted[POBJ_MWCAS_MAX_WORDS];
+	memcpy(sorted, words, nwords * sizeof(*words));
+	qsort(sorted, nwords, sizeof(*sorted), mwcas_word_compare);
+
+	if (mwcas_words_check(pop, sorted, nwords) != 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	PMEMOBJ_API_START();
+
+	/* must not be overtaken by the relaxed transactions */
+	tx_epoch_sync_all(pop);
+
+	struct lane *lane;
+	uint64_t lane_idx = lane_hold(pop, &lane);
+	struct mwcas_desc *desc = &lane->mwcas;
+
+	/* the descriptor is filled in before it's referenced by any marker */
+	uint64_t seq = (desc->seq + 1) & MWCAS_SEQ_MASK;
+	util_atomic_store_explicit64(&desc->status, MWCAS_UNDECIDED,
+		memory_order_relaxed);
+	util_atomic_store_explicit64(&desc->nwords, nwords,
+		memory_order_relaxed);
+	for (size_t i = 0; i < nwords; ++i) {
+		struct pobj_mwcas *w = &desc->words[i];
+		util_atomic_store_explicit64(&w->ptr, sorted[i].ptr,
+			memory_order_relaxed);
+		util_atomic_store_explicit64(&w->old_value,
+			sorted[i].old_value, memory_order_relaxed);
+		util_atomic_store_explicit64(&w->new_value,
+			sorted[i].new_value, memory_order_relaxed);
+	}
+	util_atomic_store_explicit64(&desc->seq, seq, memory_order_release);
+
+	COMPILE_ERROR_ON(LANE_MAX_NLANES > MWCAS_LANE_MASK + 1);
+	uint64_t marker = MWCAS_MARKER(lane_idx, seq);
+
+	int ret = 0;
+	operation_start(lane->undo);
+	for (size_t i = 0; i < nwords; ++i) {
+		struct ulog_entry_cas restore = {marker, sorted[i].old_value};
+		if (operation_add_buffer(lane->undo, sorted[i].ptr,
+		    &restore, sizeof(restore),
+		    ULOG_OPERATION_BUF_CAS) != 0) {
+			ERR("out of memory");
+			errno = ENOMEM;
+			ret = -1;
+			goto out;
+		}
+	}
+
+	size_t owned;
+	for (owned = 0; owned < nwords; ++owned) {
+		if (!mwcas_acquire(&sorted[owned], marker))
+			break;
+	}
+
+	int succeeded = owned == nwords;
+	util_atomic_store_explicit64(&desc->status,
+		succeeded ? MWCAS_SUCCEEDED : MWCAS_FAILED,
+		memory_order_release);
+	mwcas_publish(pop, lane, sorted, owned, succeeded);
+	if (!succeeded)
+		ret = 1;
+
+out:
+	operation_finish(lane->undo);
+	lane_release(pop);
+
+	PMEMOBJ_API_END();
+	return ret;
+}
+
+/*
+ * pmemobj_mwcas_read -- reads a word updated by pmemobj_mwcas
+ *
+ * A word owned by an operation that is yet to succeed still logically holds
+ * the expected value. The new values of a successful operation are only
+ * returned once they are durable.
+ */
+uint64_t
+pmemobj_mwcas_read(PMEMobjpool *pop, const uint64_t *ptr)
+{
+	LOG(15, "pop %p ptr %p", pop, ptr);
+
+	for (;;) {
+		uint64_t value = mwcas_load(ptr);
+		if (!(value & POBJ_MWCAS_RESERVED_BIT))
+			return value;
+
+		uint64_t expected;
+		uint64_t status;
+		if (mwcas_resolve(pop, ptr, value, &expected, &status) &&
+		    status != MWCAS_SUCCEEDED)
+			return expected;
+
+		sched_yield();
+	}
+}
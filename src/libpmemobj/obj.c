@@ -93,6 +93,25 @@ static struct critnib *pools_tree; /* tree used for searching by address */
 
 int _pobj_cache_invalidate;
 
+#define POOL_CACHE_SIZE 8
+
+/*
+ * Per-thread cache of recently used pools, ordered from the most to the least
+ * recently used one. It sits behind the single-entry cache of pmemobj_direct
+ * so that threads working with several pools at once don't have to go
+ * through the global index on every switch between them.
+ */
+struct pool_cache {
+	int invalidate;
+	unsigned nentries;
+	struct pool_cache_entry {
+		uint64_t uuid_lo;
+		PMEMobjpool *pop;
+	} entries[POOL_CACHE_SIZE];
+};
+
+static __thread struct pool_cache Pool_cache;
+
 #ifndef _WIN32
 
 __thread struct _pobj_pcache _pobj_cached_pool;
@@ -189,6 +208,8 @@ obj_ctl_init_and_load(PMEMobjpool *pop)
 
 	if (pop) {
 		tx_ctl_register(pop);
+		sync_ctl_register(pop);
+		lane_ctl_register(pop);
 		pmalloc_ctl_register(pop);
 		stats_ctl_register(pop);
 		debug_ctl_register(pop);
@@ -272,6 +293,101 @@ pmemobj_oid(const void *addr)
 	return oid;
 }
 
+/*
+ * obj_pool_by_coid -- (internal) returns the pool containing the compact
+ *	handle
+ *
+ * The per-thread pool cache of pmemobj_direct is consulted first, compact
+ * handles are usually dereferenced alongside regular ones from the same pool.
+ */
+static PMEMobjpool *
+obj_pool_by_coid(const PMEMcoid *coid)
+{
+#ifndef _WIN32
+	struct _pobj_pcache *cache = &_pobj_cached_pool;
+	if (cache->pop != NULL &&
+			cache->invalidate == _pobj_cache_invalidate &&
+			OBJ_PTR_FROM_POOL(cache->pop, coid))
+		return cache->pop;
+
+	PMEMobjpool *pop = pmemobj_pool_by_ptr(coid);
+	if (pop != NULL) {
+		cache->invalidate = _pobj_cache_invalidate;
+		cache->pop = pop;
+		cache->uuid_lo = pop->uuid_lo;
+	}
+
+	return pop;
+#else
+	return pmemobj_pool_by_ptr(coid);
+#endif
+}
+
+/*
+ * pmemobj_cdirect -- returns the direct pointer of an object referenced by
+ *	a compact handle
+ */
+void *
+pmemobj_cdirect(const PMEMcoid *coid)
+{
+	if (coid->off == 0)
+		return NULL;
+
+	PMEMobjpool *pop = obj_pool_by_coid(coid);
+	if (pop == NULL)
+		return NULL;
+
+	return (char *)pop + coid->off;
+}
+
+/*
+ * pmemobj_coid_to_oid -- converts a compact handle to a regular one
+ */
+PMEMoid
+pmemobj_coid_to_oid(const PMEMcoid *coid)
+{
+	if (coid->off == 0)
+		return OID_NULL;
+
+	PMEMobjpool *pop = obj_pool_by_coid(coid);
+	if (pop == NULL)
+		return OID_NULL;
+
+	PMEMoid oid = {pop->uuid_lo, coid->off};
+	return oid;
+}
+
+/*
+ * pmemobj_coid_from_oid -- points the compact handle to the object
+ *
+ * The handle must reside in the same pool as the object it references.
+ */
+int
+pmemobj_coid_from_oid(PMEMcoid *coid, PMEMoid oid)
+{
+	if (OID_IS_NULL(oid)) {
+		coid->off = 0;
+		return 0;
+	}
+
+	PMEMobjpool *pop = obj_pool_by_coid(coid);
+	if (pop == NULL) {
+		ERR("compact handle outside of pool");
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (oid.pool_uuid_lo != pop->uuid_lo) {
+		ERR("object from a different pool than the compact handle");
+		errno = EINVAL;
+		return -1;
+	}
+
+	coid->off = oid.off;
+
+	return 0;
+}
+
 /*
  * User may decide to map all pools with MAP_PRIVATE flag using
  * PMEMOBJ_COW environment variable.
@@ -316,6 +432,7 @@ obj_init(void)
 	 * subsequent call to this function for individual pools.
 	 */
 	ctl_global_register();
+	lane_global_ctl_register();
 
 	if (obj_ctl_init_and_load(NULL))
 		FATAL("error: %s", pmemobj_errormsg());
@@ -871,6 +988,11 @@ obj_runtime_init_common(PMEMobjpool *pop)
 		return errno;
 	}
 
+	if ((errno = tx_epoch_boot(pop)) != 0) {
+		ERR("!tx_epoch_boot");
+		return errno;
+	}
+
 	pop->conversion_flags = 0;
 	pmemops_persist(&pop->p_ops,
 		&pop->conversion_flags, sizeof(pop->conversion_flags));
@@ -954,10 +1076,17 @@ obj_descr_create(PMEMobjpool *pop, const char *layout, size_t poolsize)
 
 	/*
 	 * It's safe to use PMEMOBJ_F_RELAXED flag because the reserved
-	 * area must be entirely zeroed.
+	 * area must be entirely zeroed. The durable epoch and the lane
+	 * extensions, which directly precede it, start from zero as well.
 	 */
-	pmemops_memset(p_ops, pop->pmem_reserved, 0,
-		sizeof(pop->pmem_reserved), PMEMOBJ_F_RELAXED);
+	COMPILE_ERROR_ON(offsetof(struct pmemobjpool, pmem_reserved) !=
+		offsetof(struct pmemobjpool, tx_epoch_durable) +
+		sizeof(pop->tx_epoch_durable) +
+		sizeof(pop->lanes_ext_offset));
+	pmemops_memset(p_ops, &pop->tx_epoch_durable, 0,
+		sizeof(pop->tx_epoch_durable) +
+		sizeof(pop->lanes_ext_offset) + sizeof(pop->pmem_reserved),
+		PMEMOBJ_F_RELAXED);
 
 	return 0;
 }
@@ -1226,6 +1355,10 @@ obj_runtime_init(PMEMobjpool *pop, int rdonly, int boot, unsigned nlanes)
 	if (pop->tx_params == NULL)
 		goto err_tx_params;
 
+	pop->sync_params = sync_params_new();
+	if (pop->sync_params == NULL)
+		goto err_sync_params;
+
 	pop->stats = stats_new(pop);
 	if (pop->stats == NULL)
 		goto err_stat;
@@ -1236,9 +1369,12 @@ obj_runtime_init(PMEMobjpool *pop, int rdonly, int boot, unsigned nlanes)
 		sizeof(pop->rwlock_head));
 	VALGRIND_REMOVE_PMEM_MAPPING(&pop->cond_head,
 		sizeof(pop->cond_head));
+	VALGRIND_REMOVE_PMEM_MAPPING(&pop->seqlock_head,
+		sizeof(pop->seqlock_head));
 	pop->mutex_head = NULL;
 	pop->rwlock_head = NULL;
 	pop->cond_head = NULL;
+	pop->seqlock_head = NULL;
 
 	if (boot) {
 		if ((errno = obj_runtime_init_common(pop)) != 0)
@@ -1291,6 +1427,8 @@ err_critnib_insert:
 err_boot:
 	stats_delete(pop, pop->stats);
 err_stat:
+	sync_params_delete(pop->sync_params);
+err_sync_params:
 	tx_params_delete(pop->tx_params);
 err_tx_params:
 
@@ -1931,6 +2069,18 @@ obj_pool_lock_cleanup(PMEMobjpool *pop)
 		c->PMEMcond_bsd_cond_p = NULL;
 	}
 	pop->cond_head = NULL;
+
+	PMEMseqlock_internal *nexts;
+	for (PMEMseqlock_internal *l = pop->seqlock_head; l != NULL;
+			l = nexts) {
+		nexts = l->PMEMseqlock_next;
+		LOG(4, "seqlock %p *mutex %p", &l->PMEMseqlock_lock,
+			l->PMEMseqlock_bsd_mutex_p);
+		os_mutex_destroy(&l->PMEMseqlock_lock);
+		l->PMEMseqlock_next = NULL;
+		l->PMEMseqlock_bsd_mutex_p = NULL;
+	}
+	pop->seqlock_head = NULL;
 }
 /*
  * obj_pool_cleanup -- (internal) cleanup the pool and unmap
@@ -1940,11 +2090,15 @@ obj_pool_cleanup(PMEMobjpool *pop)
 {
 	LOG(3, "pop %p", pop);
 
+	tx_epoch_stop(pop);
+	tx_postcommit_stop(pop);
+
 	stats_delete(pop, pop->stats);
 	tx_params_delete(pop->tx_params);
 	ctl_delete(pop->ctl);
 
 	obj_pool_lock_cleanup(pop);
+	sync_params_delete(pop->sync_params);
 
 	lane_section_cleanup(pop);
 	lane_cleanup(pop);
@@ -2029,6 +2183,7 @@ pmemobj_checkU(const char *path, const char *layout)
 	} else {
 		stats_delete(pop, pop->stats);
 		tx_params_delete(pop->tx_params);
+		sync_params_delete(pop->sync_params);
 		ctl_delete(pop->ctl);
 
 		/* unmap all the replicas */
@@ -2085,6 +2240,53 @@ pmemobj_checkW(const wchar_t *path, const wchar_t *layout)
 }
 #endif
 
+/*
+ * obj_pool_by_uuid -- (internal) returns the pool handle with the given uuid,
+ *	consulting the per-thread pool cache first
+ */
+static PMEMobjpool *
+obj_pool_by_uuid(uint64_t uuid_lo)
+{
+	struct pool_cache *c = &Pool_cache;
+	struct pool_cache_entry e;
+
+	if (c->invalidate != _pobj_cache_invalidate) {
+		c->invalidate = _pobj_cache_invalidate;
+		c->nentries = 0;
+	}
+
+	for (unsigned i = 0; i < c->nentries; ++i) {
+		if (c->entries[i].uuid_lo != uuid_lo)
+			continue;
+
+		e = c->entries[i];
+		memmove(&c->entries[1], &c->entries[0],
+			i * sizeof(c->entries[0]));
+		c->entries[0] = e;
+
+		STATS_INC(e.pop->stats, transient, pool_cache_hits, 1);
+
+		return e.pop;
+	}
+
+	e.pop = critnib_get(pools_ht, uuid_lo);
+	if (e.pop == NULL)
+		return NULL;
+
+	STATS_INC(e.pop->stats, transient, pool_cache_misses, 1);
+
+	/* the least recently used entry is evicted when the cache is full */
+	if (c->nentries < POOL_CACHE_SIZE)
+		c->nentries++;
+
+	memmove(&c->entries[1], &c->entries[0],
+		(c->nentries - 1) * sizeof(c->entries[0]));
+	e.uuid_lo = uuid_lo;
+	c->entries[0] = e;
+
+	return e.pop;
+}
+
 /*
  * pmemobj_pool_by_oid -- returns the pool handle associated with the oid
  */
@@ -2097,7 +2299,7 @@ pmemobj_pool_by_oid(PMEMoid oid)
 	if (pools_ht == NULL)
 		return NULL;
 
-	return critnib_get(pools_ht, oid.pool_uuid_lo);
+	return obj_pool_by_uuid(oid.pool_uuid_lo);
 }
 
 /*
@@ -2131,7 +2333,6 @@ pmemobj_pool_by_ptr(const void *addr)
 
 /* arguments for constructor_alloc */
 struct constr_args {
-	int zero_init;
 	pmemobj_constr constructor;
 	void *arg;
 };
@@ -2144,16 +2345,12 @@ constructor_alloc(void *ctx, void *ptr, size_t usable_size, void *arg)
 {
 	PMEMobjpool *pop = ctx;
 	LOG(3, "pop %p ptr %p arg %p", pop, ptr, arg);
-	struct pmem_ops *p_ops = &pop->p_ops;
 
 	ASSERTne(ptr, NULL);
 	ASSERTne(arg, NULL);
 
 	struct constr_args *carg = arg;
 
-	if (carg->zero_init)
-		pmemops_memset(p_ops, ptr, 0, usable_size, 0);
-
 	int ret = 0;
 	if (carg->constructor)
 		ret = carg->constructor(pop, ptr, carg->arg);
@@ -2177,10 +2374,15 @@ obj_alloc_construct(PMEMobjpool *pop, PMEMoid *oidp, size_t size,
 
 	struct constr_args carg;
 
-	carg.zero_init = flags & POBJ_FLAG_ZERO;
 	carg.constructor = constructor;
 	carg.arg = arg;
 
+	/*
+	 * The operation is durable right away, it must not overtake the relaxed
+	 * transactions that might have modified the destination.
+	 */
+	tx_epoch_sync_all(pop);
+
 	struct operation_context *ctx = pmalloc_operation_hold(pop);
 
 	if (oidp)
@@ -2189,8 +2391,7 @@ obj_alloc_construct(PMEMobjpool *pop, PMEMoid *oidp, size_t size,
 
 	int ret = palloc_operation(&pop->heap, 0,
 			oidp != NULL ? &oidp->off : NULL, size,
-			constructor_alloc, &carg, type_num, 0,
-			CLASS_ID_FROM_FLAG(flags),
+			constructor_alloc, &carg, type_num, 0, flags,
 			ctx);
 
 	pmalloc_operation_release(pop);
@@ -2310,6 +2511,8 @@ obj_free(PMEMobjpool *pop, PMEMoid *oidp)
 {
 	ASSERTne(oidp, NULL);
 
+	tx_epoch_sync_all(pop);
+
 	struct operation_context *ctx = pmalloc_operation_hold(pop);
 
 	operation_add_entry(ctx, &oidp->pool_uuid_lo, 0, ULOG_OPERATION_SET);
@@ -2387,6 +2590,8 @@ obj_realloc_common(PMEMobjpool *pop,
 	carg.arg = NULL;
 	carg.zero_init = zero_init;
 
+	tx_epoch_sync_all(pop);
+
 	struct operation_context *ctx = pmalloc_operation_hold(pop);
 
 	int ret = palloc_operation(&pop->heap, oidp->off, &oidp->off,
@@ -2823,6 +3028,8 @@ obj_alloc_root(PMEMobjpool *pop, size_t size,
 	carg.zero_init = 1;
 	carg.arg = arg;
 
+	tx_epoch_sync_all(pop);
+
 	struct operation_context *ctx = pmalloc_operation_hold(pop);
 
 	operation_add_entry(ctx, &pop->root_size, size, ULOG_OPERATION_SET);
@@ -2963,6 +3170,61 @@ pmemobj_next(PMEMoid oid)
 	return ret;
 }
 
+struct obj_foreach_arg {
+	PMEMobjpool *pop;
+	uint64_t type_num;
+	pmemobj_foreach_cb cb;
+	void *arg;
+};
+
+/*
+ * obj_foreach_parallel_cb -- (internal) filters out internal objects and
+ *	objects of other types before calling the user callback
+ */
+static int
+obj_foreach_parallel_cb(uint64_t off, uint64_t extra, uint16_t flags,
+	void *arg)
+{
+	struct obj_foreach_arg *fa = arg;
+
+	if (flags & OBJ_INTERNAL_OBJECT_MASK)
+		return 0;
+
+	if (fa->type_num != POBJ_ANY_TYPE_NUM && fa->type_num != extra)
+		return 0;
+
+	PMEMoid oid = {fa->pop->uuid_lo, off};
+
+	return fa->cb(oid, fa->arg);
+}
+
+/*
+ * pmemobj_foreach_parallel -- calls cb for every object of the specified
+ *	type using up to nthreads threads
+ */
+int
+pmemobj_foreach_parallel(PMEMobjpool *pop, uint64_t type_num,
+	pmemobj_foreach_cb cb, void *arg, unsigned nthreads)
+{
+	LOG(3, "pop %p type_num %" PRIu64 " cb %p arg %p nthreads %u",
+		pop, type_num, cb, arg, nthreads);
+
+	if (cb == NULL) {
+		ERR("invalid callback");
+		errno = EINVAL;
+		return -1;
+	}
+
+	PMEMOBJ_API_START();
+
+	struct obj_foreach_arg fa = {pop, type_num, cb, arg};
+	int ret = palloc_foreach_parallel(&pop->heap,
+		obj_foreach_parallel_cb, &fa, nthreads);
+
+	PMEMOBJ_API_END();
+	return ret;
+}
+
 /*
  * pmemobj_reserve -- reserves a single object
  */
@@ -3013,12 +3275,11 @@ pmemobj_xreserve(PMEMobjpool *pop, struct pobj_action *act,
 	PMEMOBJ_API_START();
 	struct constr_args carg;
 
-	carg.zero_init = flags & POBJ_FLAG_ZERO;
 	carg.constructor = NULL;
 	carg.arg = NULL;
 
 	if (palloc_reserve(&pop->heap, size, constructor_alloc, &carg,
-		type_num, 0, CLASS_ID_FROM_FLAG(flags), act) != 0) {
+		type_num, 0, flags, act) != 0) {
 		PMEMOBJ_API_END();
 		return oid;
 	}
@@ -3040,6 +3301,30 @@ pmemobj_set_value(PMEMobjpool *pop, struct pobj_action *act,
 	palloc_set_value(&pop->heap, act, ptr, value);
 }
 
+/*
+ * pmemobj_set_buf -- creates an action to set a buffer
+ */
+int
+pmemobj_set_buf(PMEMobjpool *pop, struct pobj_action *act,
+	void *dest, const void *src, size_t size)
+{
+	LOG(3, "pop %p act %p dest %p src %p size %zu",
+		pop, act, dest, src, size);
+
+	if (size == 0 || !OBJ_PTR_FROM_POOL(pop, dest) ||
+	    !OBJ_PTR_FROM_POOL(pop, (char *)dest + size - 1)) {
+		ERR("buffer outside of pool");
+		errno = EINVAL;
+		return -1;
+	}
+
+	PMEMOBJ_API_START();
+	int ret = palloc_set_buf(&pop->heap, act, dest, src, size);
+	PMEMOBJ_API_END();
+
+	return ret;
+}
+
 /*
  * pmemobj_defer_free -- creates a deferred free action
  */
@@ -3057,11 +3342,29 @@ int
 pmemobj_publish(PMEMobjpool *pop, struct pobj_action *actv, size_t actvcnt)
 {
 	PMEMOBJ_API_START();
+
+	tx_epoch_sync_all(pop);
+
 	struct operation_context *ctx = pmalloc_operation_hold(pop);
 
 	size_t entries_size = actvcnt * sizeof(struct ulog_entry_val);
 
+	/*
+	 * The buffers can take up any amount of space, the log is extended
+	 * up front to fit them, including the entries split at the end
+	 * of each of the ulogs.
+	 */
+	size_t buffers_size = palloc_buffers_log_size(actv, actvcnt);
+	if (buffers_size != 0) {
+		entries_size += buffers_size;
+		size_t nsplits = entries_size / (LANE_REDO_EXTERNAL_SIZE -
+			OPERATION_REDO_BUFFER_SPLIT_SIZE) + 1;
+		entries_size += nsplits * OPERATION_REDO_BUFFER_SPLIT_SIZE;
+	}
+
 	if (operation_reserve(ctx, entries_size) != 0) {
+		operation_cancel(ctx);
+		pmalloc_operation_release(pop);
 		PMEMOBJ_API_END();
 		return -1;
 	}
@@ -3145,7 +3448,6 @@ pmemobj_list_insert_new(PMEMobjpool *pop, size_t pe_offset, void *head,
 
 	carg.constructor = constructor;
 	carg.arg = arg;
-	carg.zero_init = 0;
 
 	PMEMoid retoid = OID_NULL;
 	list_insert_new_user(pop, pe_offset, head, dest, before, size, type_num,
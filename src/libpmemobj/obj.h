@@ -64,7 +64,7 @@ extern "C" {
 #define OBJ_FORMAT_MAJOR 5
 
 #define OBJ_FORMAT_FEAT_DEFAULT \
-	{0x0000, POOL_FEAT_INCOMPAT_DEFAULT, 0x0000}
+	{0x0000, POOL_FEAT_INCOMPAT_DEFAULT | POOL_FEAT_OBJ_ULOG2, 0x0000}
 
 #define OBJ_FORMAT_FEAT_CHECK \
 	{0x0000, POOL_FEAT_INCOMPAT_VALID, 0x0000}
@@ -151,7 +151,10 @@ struct pmemobjpool {
 
 	struct stats_persistent stats_persistent;
 
-	char pmem_reserved[496]; /* must be zeroed */
+	uint64_t tx_epoch_durable; /* last durable relaxed transaction epoch */
+	uint64_t lanes_ext_offset; /* first extension of the lane area */
+
+	char pmem_reserved[480]; /* must be zeroed */
 
 	/* some run-time state, allocated out of memory pool... */
 	void *addr;		/* mapped region */
@@ -195,6 +198,7 @@ struct pmemobjpool {
 	int tx_debug_skip_expensive_checks;
 
 	struct tx_parameters *tx_params;
+	struct sync_parameters *sync_params;
 
 	/*
 	 * Locks are dynamically allocated on FreeBSD. Keep track so
@@ -203,10 +207,11 @@ struct pmemobjpool {
 	PMEMmutex_internal *mutex_head;
 	PMEMrwlock_internal *rwlock_head;
 	PMEMcond_internal *cond_head;
+	PMEMseqlock_internal *seqlock_head;
 
 	/* padding to align size of this structure to page boundary */
 	/* sizeof(unused2) == 8192 - offsetof(struct pmemobjpool, unused2) */
-	char unused2[992];
+	char unused2[968];
 };
 
 /*
@@ -216,9 +221,6 @@ struct pmemobjpool {
  */
 #define OBJ_INTERNAL_OBJECT_MASK ((1ULL) << 15)
 
-#define CLASS_ID_FROM_FLAG(flag)\
-((uint16_t)((flag) >> 48))
-
 /*
  * pmemobj_get_uuid_lo -- (internal) evaluates XOR sum of least significant
  * 8 bytes with most significant 8 bytes.
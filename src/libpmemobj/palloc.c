@@ -92,6 +92,8 @@ struct pobj_action_internal {
 		struct {
 			uint64_t *ptr;
 			uint64_t value;
+			void *buf; /* copy of the buffer, NULL for a value */
+			size_t size;
 		};
 
 		/* padding, not used */
@@ -111,9 +113,59 @@ palloc_set_value(struct palloc_heap *heap, struct pobj_action *act,
 	struct pobj_action_internal *actp = (struct pobj_action_internal *)act;
 	actp->ptr = ptr;
 	actp->value = value;
+	actp->buf = NULL;
+	actp->size = 0;
 	actp->lock = NULL;
 }
 
+/*
+ * palloc_set_buf -- creates a new memory action that sets a buffer
+ *
+ * The data is copied, so that the source buffer can be reused as soon as this
+ * function returns.
+ */
+int
+palloc_set_buf(struct palloc_heap *heap, struct pobj_action *act,
+	void *dest, const void *src, size_t size)
+{
+	struct pobj_action_internal *actp = (struct pobj_action_internal *)act;
+
+	actp->buf = Malloc(size);
+	if (actp->buf == NULL) {
+		ERR("!Malloc");
+		return -1;
+	}
+	memcpy(actp->buf, src, size);
+
+	act->type = POBJ_ACTION_TYPE_MEM;
+	actp->ptr = dest;
+	actp->value = 0;
+	actp->size = size;
+	actp->lock = NULL;
+
+	return 0;
+}
+
+/*
+ * palloc_buffers_log_size -- returns the upper bound of the redo log space
+ *	taken up by the buffers of the given actions, on top of the space
+ *	of a single value entry per action
+ */
+size_t
+palloc_buffers_log_size(struct pobj_action *actv, size_t actvcnt)
+{
+	size_t size = 0;
+
+	struct pobj_action_internal *act;
+	for (size_t i = 0; i < actvcnt; ++i) {
+		act = (struct pobj_action_internal *)&actv[i];
+		if (act->type == POBJ_ACTION_TYPE_MEM && act->buf != NULL)
+			size += OPERATION_REDO_BUFFER_SIZE(act->size);
+	}
+
+	return size;
+}
+
 /*
  * alloc_prep_block -- (internal) prepares a memory block for allocation
  *
@@ -124,12 +176,15 @@ palloc_set_value(struct palloc_heap *heap, struct pobj_action *act,
  * Because the memory block at this stage is only reserved in transient state
  * there's no need to worry about fail-safety of this method because in case
  * of a crash the memory will be back in the free blocks collection.
+ *
+ * If requested, the user data is zeroed before the constructor is called,
+ * unless the block is known to be zeroed already.
  */
 static int
 alloc_prep_block(struct palloc_heap *heap, const struct memory_block *m,
 	palloc_constr constructor, void *arg,
-	uint64_t extra_field, uint16_t object_flags,
-	uint64_t *offset_value)
+	uint64_t extra_field, uint16_t object_flags, uint64_t flags,
+	int zeroed, uint64_t *offset_value)
 {
 	void *uptr = m->m_ops->get_user_data(m);
 	size_t usize = m->m_ops->get_user_size(m);
@@ -148,6 +203,19 @@ alloc_prep_block(struct palloc_heap *heap, const struct memory_block *m,
 		pmemops_memset(&heap->p_ops, uptr, heap->alloc_pattern,
 			usize, 0);
 		VALGRIND_DO_MAKE_MEM_UNDEFINED(uptr, usize);
+		zeroed = 0;
+	}
+
+	if (flags & POBJ_FLAG_ZERO) {
+		if (zeroed) {
+			VALGRIND_DO_MAKE_MEM_DEFINED(uptr, usize);
+		} else {
+			VALGRIND_ADD_TO_TX(uptr, usize);
+			pmemops_memset(&heap->p_ops, uptr, 0, usize,
+				(flags & POBJ_FLAG_NO_FLUSH) ?
+				PMEMOBJ_F_MEM_NOFLUSH : 0);
+			VALGRIND_REMOVE_FROM_TX(uptr, usize);
+		}
 	}
 
 	int ret;
@@ -193,7 +261,7 @@ alloc_prep_block(struct palloc_heap *heap, const struct memory_block *m,
 static int
 palloc_reservation_create(struct palloc_heap *heap, size_t size,
 	palloc_constr constructor, void *arg,
-	uint64_t extra_field, uint16_t object_flags, uint16_t class_id,
+	uint64_t extra_field, uint16_t object_flags, uint64_t flags,
 	struct pobj_action_internal *out)
 {
 	int err = 0;
@@ -201,6 +269,7 @@ palloc_reservation_create(struct palloc_heap *heap, size_t size,
 	struct memory_block *new_block = &out->m;
 	out->type = POBJ_ACTION_TYPE_HEAP;
 
+	uint16_t class_id = CLASS_ID_FROM_FLAG(flags);
 	ASSERT(class_id < UINT8_MAX);
 	struct alloc_class *c = class_id == 0 ?
 		heap_get_best_class(heap, size) :
@@ -234,12 +303,24 @@ palloc_reservation_create(struct palloc_heap *heap, size_t size,
 
 	struct bucket *b = heap_bucket_acquire(heap, c);
 
-	err = heap_get_bestfit_block(heap, b, new_block);
-	if (err != 0)
-		goto out;
+	/*
+	 * Zeroed huge allocations are first satisfied from the chunks that
+	 * were already zeroed in the background, if there are any.
+	 */
+	int zeroed = (flags & POBJ_FLAG_ZERO) && c->type == CLASS_HUGE &&
+		heap_get_zeroed_block(heap, new_block) == 0;
+
+	if (zeroed) {
+		STATS_INC(heap->stats, transient, heap_prezero_hits, 1);
+	} else {
+		err = heap_get_bestfit_block(heap, b, new_block);
+		if (err != 0)
+			goto out;
+	}
 
 	if (alloc_prep_block(heap, new_block, constructor, arg,
-		extra_field, object_flags, &out->offset) != 0) {
+		extra_field, object_flags, flags, zeroed,
+		&out->offset) != 0) {
 		/*
 		 * Constructor returned non-zero value which means
 		 * the memory block reservation has to be rolled back.
@@ -361,6 +442,7 @@ palloc_heap_action_on_process(struct palloc_heap *heap,
 	if (act->new_state == MEMBLOCK_ALLOCATED) {
 		STATS_INC(heap->stats, persistent, heap_curr_allocated,
 			act->m.m_ops->get_real_size(&act->m));
+		heap_memblock_on_alloc(heap, &act->m);
 		if (act->resvp)
 			util_fetch_and_sub64(act->resvp, 1);
 	} else if (act->new_state == MEMBLOCK_FREE) {
@@ -412,7 +494,29 @@ palloc_mem_action_exec(struct palloc_heap *heap,
 	const struct pobj_action_internal *act,
 	struct operation_context *ctx)
 {
-	operation_add_entry(ctx, act->ptr, act->value, ULOG_OPERATION_SET);
+	if (act->buf != NULL) {
+		/*
+		 * The log space of the buffers is reserved before the actions
+		 * are executed, see palloc_buffers_log_size.
+		 */
+		int ret = operation_add_buffer(ctx, act->ptr, act->buf,
+			act->size, ULOG_OPERATION_BUF_CPY);
+		if (ret != 0)
+			FATAL("buffer action without reserved log space");
+	} else {
+		operation_add_entry(ctx, act->ptr, act->value,
+			ULOG_OPERATION_SET);
+	}
+}
+
+/*
+ * palloc_mem_action_release -- frees the copy of the data of a buffer action
+ */
+static void
+palloc_mem_action_release(struct palloc_heap *heap,
+	struct pobj_action_internal *act)
+{
+	Free(act->buf);
 }
 
 static const struct {
@@ -452,9 +556,9 @@ static const struct {
 	},
 	[POBJ_ACTION_TYPE_MEM] = {
 		.exec = palloc_mem_action_exec,
-		.on_cancel = palloc_mem_action_noop,
+		.on_cancel = palloc_mem_action_release,
 		.on_process = palloc_mem_action_noop,
-		.on_unlock = palloc_mem_action_noop,
+		.on_unlock = palloc_mem_action_release,
 	}
 };
 
@@ -524,7 +628,8 @@ palloc_exec_actions(struct palloc_heap *heap,
 
 		action_funcs[act->type].on_process(heap, act);
 
-		if (i == 0 || act->lock != actv[i - 1].lock) {
+		/* the lock is released after its last action is processed */
+		if (i == actvcnt - 1 || act->lock != actv[i + 1].lock) {
 			if (act->lock)
 				util_mutex_unlock(act->lock);
 		}
@@ -543,14 +648,14 @@ palloc_exec_actions(struct palloc_heap *heap,
 int
 palloc_reserve(struct palloc_heap *heap, size_t size,
 	palloc_constr constructor, void *arg,
-	uint64_t extra_field, uint16_t object_flags, uint16_t class_id,
+	uint64_t extra_field, uint16_t object_flags, uint64_t flags,
 	struct pobj_action *act)
 {
 	COMPILE_ERROR_ON(sizeof(struct pobj_action) !=
 		sizeof(struct pobj_action_internal));
 
 	return palloc_reservation_create(heap, size, constructor, arg,
-		extra_field, object_flags, class_id,
+		extra_field, object_flags, flags,
 		(struct pobj_action_internal *)act);
 }
 
@@ -654,7 +759,7 @@ int
 palloc_operation(struct palloc_heap *heap,
 	uint64_t off, uint64_t *dest_off, size_t size,
 	palloc_constr constructor, void *arg,
-	uint64_t extra_field, uint16_t object_flags, uint16_t class_id,
+	uint64_t extra_field, uint16_t object_flags, uint64_t flags,
 	struct operation_context *ctx)
 {
 	size_t user_size = 0;
@@ -684,7 +789,7 @@ palloc_operation(struct palloc_heap *heap,
 	if (size != 0) {
 		alloc = &ops[nops++];
 		if (palloc_reservation_create(heap, size, constructor, arg,
-			extra_field, object_flags, class_id, alloc) != 0) {
+			extra_field, object_flags, flags, alloc) != 0) {
 			operation_cancel(ctx);
 			return -1;
 		}
@@ -812,6 +917,41 @@ palloc_next(struct palloc_heap *heap, uint64_t off)
 	return HEAP_PTR_TO_OFF(heap, uptr);
 }
 
+struct palloc_foreach_arg {
+	struct palloc_heap *heap;
+	palloc_foreach_cb cb;
+	void *arg;
+};
+
+/*
+ * palloc_foreach_parallel_cb -- (internal) translates a memory block into
+ *	an object offset for the user callback
+ */
+static int
+palloc_foreach_parallel_cb(const struct memory_block *m, void *arg)
+{
+	struct palloc_foreach_arg *fa = arg;
+
+	void *uptr = m->m_ops->get_user_data(m);
+
+	return fa->cb(HEAP_PTR_TO_OFF(fa->heap, uptr),
+		m->m_ops->get_extra(m), m->m_ops->get_flags(m), fa->arg);
+}
+
+/*
+ * palloc_foreach_parallel -- concurrently calls cb for every object in the
+ *	heap, using up to nthreads threads
+ */
+int
+palloc_foreach_parallel(struct palloc_heap *heap, palloc_foreach_cb cb,
+	void *arg, unsigned nthreads)
+{
+	struct palloc_foreach_arg fa = {heap, cb, arg};
+
+	return heap_foreach_object_parallel(heap, palloc_foreach_parallel_cb,
+		&fa, nthreads);
+}
+
 /*
  * palloc_boot -- initializes allocator section
  */
@@ -52,6 +52,10 @@ extern "C" {
 
 #define PALLOC_CTL_DEBUG_NO_PATTERN (-1)
 
+/* extracts the allocation class id from the POBJ_X* allocation flags */
+#define CLASS_ID_FROM_FLAG(flag)\
+((uint16_t)((flag) >> 48))
+
 struct palloc_heap {
 	struct pmem_ops p_ops;
 	struct heap_layout *layout;
@@ -74,13 +78,13 @@ typedef int (*palloc_constr)(void *base, void *ptr,
 
 int palloc_operation(struct palloc_heap *heap, uint64_t off, uint64_t *dest_off,
 	size_t size, palloc_constr constructor, void *arg,
-	uint64_t extra_field, uint16_t object_flags, uint16_t class_id,
+	uint64_t extra_field, uint16_t object_flags, uint64_t flags,
 	struct operation_context *ctx);
 
 int
 palloc_reserve(struct palloc_heap *heap, size_t size,
 	palloc_constr constructor, void *arg,
-	uint64_t extra_field, uint16_t object_flags, uint16_t class_id,
+	uint64_t extra_field, uint16_t object_flags, uint64_t flags,
 	struct pobj_action *act);
 
 void
@@ -100,9 +104,21 @@ void
 palloc_set_value(struct palloc_heap *heap, struct pobj_action *act,
 	uint64_t *ptr, uint64_t value);
 
+int
+palloc_set_buf(struct palloc_heap *heap, struct pobj_action *act,
+	void *dest, const void *src, size_t size);
+
+size_t palloc_buffers_log_size(struct pobj_action *actv, size_t actvcnt);
+
 uint64_t palloc_first(struct palloc_heap *heap);
 uint64_t palloc_next(struct palloc_heap *heap, uint64_t off);
 
+typedef int (*palloc_foreach_cb)(uint64_t off, uint64_t extra,
+	uint16_t flags, void *arg);
+
+int palloc_foreach_parallel(struct palloc_heap *heap, palloc_foreach_cb cb,
+	void *arg, unsigned nthreads);
+
 size_t palloc_usable_size(struct palloc_heap *heap, uint64_t off);
 uint64_t palloc_extra(struct palloc_heap *heap, uint64_t off);
 uint16_t palloc_flags(struct palloc_heap *heap, uint64_t off);
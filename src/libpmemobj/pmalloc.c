@@ -144,13 +144,13 @@ pmalloc(PMEMobjpool *pop, uint64_t *off, size_t size,
 int
 pmalloc_construct(PMEMobjpool *pop, uint64_t *off, size_t size,
 	palloc_constr constructor, void *arg,
-	uint64_t extra_field, uint16_t object_flags, uint16_t class_id)
+	uint64_t extra_field, uint16_t object_flags, uint64_t flags)
 {
 	struct operation_context *ctx =
 		pmalloc_operation_hold_type(pop, OPERATION_INTERNAL, 1);
 
 	int ret = palloc_operation(&pop->heap, 0, off, size, constructor, arg,
-			extra_field, object_flags, class_id, ctx);
+			extra_field, object_flags, flags, ctx);
 
 	pmalloc_operation_release(pop);
 
@@ -520,6 +520,61 @@ CTL_WRITE_HANDLER(granularity)(void *ctx,
 
 static const struct ctl_argument CTL_ARG(granularity) = CTL_ARG_LONG_LONG;
 
+/*
+ * CTL_READ_HANDLER(prezero) -- reads the amount of free memory that is
+ * zeroed in the background
+ */
+static int
+CTL_READ_HANDLER(prezero)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	ssize_t *arg_out = arg;
+
+	*arg_out = (ssize_t)heap_prezero_get_size(&pop->heap);
+
+	return 0;
+}
+
+/*
+ * CTL_WRITE_HANDLER(prezero) -- changes the amount of free memory that is
+ * zeroed in the background
+ */
+static int
+CTL_WRITE_HANDLER(prezero)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	ssize_t arg_in = *(ssize_t *)arg;
+	if (arg_in < 0) {
+		ERR("incorrect prezero size, must be 0 or larger");
+		return -1;
+	}
+
+	return heap_prezero_set_size(&pop->heap, (size_t)arg_in);
+}
+
+static const struct ctl_argument CTL_ARG(prezero) = CTL_ARG_LONG_LONG;
+
+/*
+ * CTL_READ_HANDLER(prezeroed) -- reads the amount of free memory that is
+ * already zeroed
+ */
+static int
+CTL_READ_HANDLER(prezeroed)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	uint64_t *arg_out = arg;
+
+	*arg_out = heap_prezero_get_zeroed(&pop->heap);
+
+	return 0;
+}
+
 /*
  * CTL_READ_HANDLER(narenas) -- reads a number of the arenas
  */
@@ -554,6 +609,8 @@ CTL_READ_HANDLER(arena_id)(void *ctx,
 static const struct ctl_node CTL_NODE(size)[] = {
 	CTL_LEAF_RW(granularity),
 	CTL_LEAF_RUNNABLE(extend),
+	CTL_LEAF_RW(prezero),
+	CTL_LEAF_RO(prezeroed),
 
 	CTL_NODE_END
 };
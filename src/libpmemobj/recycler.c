@@ -41,10 +41,30 @@
 #include "util.h"
 #include "sys_util.h"
 #include "ravl.h"
+#include "critnib.h"
 #include "valgrind_internal.h"
 
 #define THRESHOLD_MUL 4
 
+/*
+ * Transient copy of the bitmap of a run that is either stored in the recycler
+ * or used by a bucket. Allocations and frees update the copy along with the
+ * persistent bitmap, which means that the scores of the runs can be
+ * recalculated and the buckets can be filled without reading the persistent
+ * bitmaps again. The mirror lives until the run is turned back into a free
+ * chunk. Protected by the run lock.
+ */
+struct recycler_mirror {
+	uint64_t key;
+	uint32_t free_space; /* number of clear bits in the bitmap */
+	unsigned nvalues;
+	unsigned nbits;
+	uint64_t values[];
+};
+
+#define RECYCLER_MIRROR_KEY(zone_id, chunk_id)\
+(((uint64_t)(zone_id) << 32) | (uint64_t)(chunk_id))
+
 /*
  * recycler_element_cmp -- compares two recycler elements
  */
@@ -94,6 +114,9 @@ struct recycler {
 	VEC(, struct recycler_element) recalc;
 	VEC(, struct memory_block_reserved *) pending;
 
+	/* bitmap mirrors of the runs in the recycler, by zone and chunk id */
+	struct critnib *mirrors;
+
 	os_mutex_t lock;
 };
 
@@ -112,6 +135,10 @@ recycler_new(struct palloc_heap *heap, size_t nallocs)
 	if (r->runs == NULL)
 		goto error_alloc_tree;
 
+	r->mirrors = critnib_new();
+	if (r->mirrors == NULL)
+		goto error_alloc_mirrors;
+
 	r->heap = heap;
 	r->nallocs = nallocs;
 	r->recalc_threshold = nallocs * THRESHOLD_MUL;
@@ -125,6 +152,8 @@ recycler_new(struct palloc_heap *heap, size_t nallocs)
 
 	return r;
 
+error_alloc_mirrors:
+	ravl_delete(r->runs);
 error_alloc_tree:
 	Free(r);
 error_alloc_recycler:
@@ -137,6 +166,11 @@ error_alloc_recycler:
 void
 recycler_delete(struct recycler *r)
 {
+	struct recycler_mirror *mirror;
+	while ((mirror = critnib_find_le(r->mirrors, UINT64_MAX)) != NULL)
+		Free(critnib_remove(r->mirrors, mirror->key));
+	critnib_delete(r->mirrors);
+
 	VEC_DELETE(&r->recalc);
 
 	struct memory_block_reserved *mr;
@@ -180,6 +214,111 @@ recycler_element_new(struct palloc_heap *heap, const struct memory_block *m)
 	return e;
 }
 
+/*
+ * recycler_mirror_acquire -- (internal) returns the bitmap mirror of the run,
+ *	creating it from the persistent bitmap if necessary, must be called with
+ *	the run lock held
+ */
+static struct recycler_mirror *
+recycler_mirror_acquire(struct recycler *r, const struct memory_block *m)
+{
+	uint64_t key = RECYCLER_MIRROR_KEY(m->zone_id, m->chunk_id);
+
+	struct recycler_mirror *mirror = critnib_get(r->mirrors, key);
+	if (mirror != NULL)
+		return mirror;
+
+	struct run_bitmap b;
+	m->m_ops->get_bitmap(m, &b);
+
+	size_t size = sizeof(*b.values) * b.nvalues;
+	mirror = Malloc(sizeof(*mirror) + size);
+	if (mirror == NULL)
+		return NULL;
+
+	mirror->key = key;
+	mirror->nvalues = b.nvalues;
+	mirror->nbits = b.nbits;
+	memcpy(mirror->values, b.values, size);
+
+	/* the bits past the end of the run are always set */
+	uint32_t used = 0;
+	for (unsigned i = 0; i < b.nvalues; ++i)
+		used += util_popcount64(b.values[i]);
+	mirror->free_space = RUN_BITS_PER_VALUE * b.nvalues - used;
+
+	if (critnib_insert(r->mirrors, key, mirror) != 0) {
+		Free(mirror);
+		return NULL;
+	}
+
+	return mirror;
+}
+
+/*
+ * recycler_mirror_bitmap -- (internal) describes the mirror as a run bitmap
+ */
+static void
+recycler_mirror_bitmap(struct recycler_mirror *mirror, struct run_bitmap *b)
+{
+	b->nvalues = mirror->nvalues;
+	b->nbits = mirror->nbits;
+	b->size = sizeof(*mirror->values) * mirror->nvalues;
+	b->values = mirror->values;
+}
+
+/*
+ * recycler_mirror_remove -- removes the bitmap mirror of the run, must be
+ *	called once the run stops being one
+ */
+void
+recycler_mirror_remove(struct recycler *r, const struct memory_block *m)
+{
+	os_mutex_t *lock = m->m_ops->get_lock(m);
+	util_mutex_lock(lock);
+
+	Free(critnib_remove(r->mirrors,
+		RECYCLER_MIRROR_KEY(m->zone_id, m->chunk_id)));
+
+	util_mutex_unlock(lock);
+}
+
+/*
+ * recycler_element_from_mirror -- calculates the recycler element of a run
+ *	using its bitmap mirror, the mirror is created if necessary
+ */
+struct recycler_element
+recycler_element_from_mirror(struct recycler *r, const struct memory_block *m)
+{
+	os_mutex_t *lock = m->m_ops->get_lock(m);
+	util_mutex_lock(lock);
+
+	struct recycler_element e = {
+		.free_space = 0,
+		.max_free_block = 0,
+		.chunk_id = m->chunk_id,
+		.zone_id = m->zone_id,
+	};
+
+	struct recycler_mirror *mirror = recycler_mirror_acquire(r, m);
+	if (mirror != NULL) {
+		/* a full run has nothing to offer, skip the scan */
+		if (mirror->free_space != 0) {
+			struct run_bitmap b;
+			recycler_mirror_bitmap(mirror, &b);
+			memblock_run_bitmap_calc_free(&b,
+				&e.free_space, &e.max_free_block);
+			ASSERTeq(e.free_space, mirror->free_space);
+		}
+	} else {
+		m->m_ops->calc_free(m, &e.free_space, &e.max_free_block);
+	}
+
+	util_mutex_unlock(lock);
+
+	return e;
+}
+
 /*
  * recycler_put -- inserts new run into the recycler
  */
@@ -189,12 +328,20 @@ recycler_put(struct recycler *r, const struct memory_block *m,
 {
 	int ret = 0;
 
+	os_mutex_t *lock = m->m_ops->get_lock(m);
+	util_mutex_lock(lock);
+	recycler_mirror_acquire(r, m);
+	util_mutex_unlock(lock);
+
 	util_mutex_lock(&r->lock);
 
 	ret = ravl_emplace_copy(r->runs, &element);
 
 	util_mutex_unlock(&r->lock);
 
+	if (ret != 0)
+		recycler_mirror_remove(r, m);
+
 	return ret;
 }
 
@@ -211,11 +358,12 @@ recycler_pending_check(struct recycler *r)
 	VEC_FOREACH_BY_POS(pos, &r->pending) {
 		mr = VEC_ARR(&r->pending)[pos];
 		if (mr->nresv == 0) {
-			struct recycler_element e = recycler_element_new(
-				r->heap, &mr->m);
+			struct recycler_element e =
+				recycler_element_from_mirror(r, &mr->m);
 			if (ravl_emplace_copy(r->runs, &e) != 0) {
 				ERR("unable to track run %u due to OOM",
 					mr->m.chunk_id);
+				recycler_mirror_remove(r, &mr->m);
 			}
 			Free(mr);
 			VEC_ERASE_BY_POS(&r->pending, pos);
@@ -318,7 +466,8 @@ recycler_recalc(struct recycler *r, int force)
 		nm.zone_id = ne->zone_id;
 		memblock_rebuild_state(r->heap, &nm);
 
-		struct recycler_element e = recycler_element_new(r->heap, &nm);
+		struct recycler_element e =
+			recycler_element_from_mirror(r, &nm);
 
 		ASSERT(e.free_space >= existing_free_space);
 		uint64_t free_space_diff = e.free_space - existing_free_space;
@@ -338,6 +487,7 @@ recycler_recalc(struct recycler *r, int force)
 		ravl_remove(r->runs, n);
 
 		if (e.free_space == r->nallocs) {
+			recycler_mirror_remove(r, &nm);
 			memblock_rebuild_state(r->heap, &nm);
 			if (VEC_PUSH_BACK(&runs, nm) != 0)
 				ASSERT(0); /* XXX: fix after refactoring */
@@ -348,7 +498,12 @@ recycler_recalc(struct recycler *r, int force)
 
 	struct recycler_element *e;
 	VEC_FOREACH_BY_PTR(e, &r->recalc) {
-		ravl_emplace_copy(r->runs, e);
+		if (ravl_emplace_copy(r->runs, e) != 0) {
+			nm.chunk_id = e->chunk_id;
+			nm.zone_id = e->zone_id;
+			memblock_rebuild_state(r->heap, &nm);
+			recycler_mirror_remove(r, &nm);
+		}
 	}
 
 	VEC_CLEAR(&r->recalc);
@@ -360,13 +515,87 @@ recycler_recalc(struct recycler *r, int force)
 	return runs;
 }
 
+/*
+ * recycler_run_iterate_free -- iterates over free blocks of a run using its
+ *	bitmap mirror, the mirror is created if necessary, must be called with
+ *	the run lock held
+ */
+int
+recycler_run_iterate_free(struct recycler *r, const struct memory_block *m,
+	object_callback cb, void *arg)
+{
+	struct recycler_mirror *mirror = recycler_mirror_acquire(r, m);
+	if (mirror == NULL)
+		return m->m_ops->iterate_free(m, cb, arg);
+
+#ifdef DEBUG
+	struct run_bitmap pb;
+	m->m_ops->get_bitmap(m, &pb);
+	ASSERTeq(pb.nvalues, mirror->nvalues);
+	ASSERTeq(memcmp(pb.values, mirror->values,
+		sizeof(*pb.values) * pb.nvalues), 0);
+#endif
+
+	if (mirror->free_space == 0)
+		return 0;
+
+	struct run_bitmap b;
+	recycler_mirror_bitmap(mirror, &b);
+
+	return memblock_run_bitmap_iterate_free(m, &b, cb, arg);
+}
+
+/*
+ * recycler_mark_allocated -- sets the allocated units in the bitmap mirror of
+ *	the run, must be called with the run lock held
+ */
+void
+recycler_mark_allocated(struct recycler *r, const struct memory_block *m)
+{
+	struct recycler_mirror *mirror = critnib_get(r->mirrors,
+		RECYCLER_MIRROR_KEY(m->zone_id, m->chunk_id));
+	if (mirror == NULL)
+		return;
+
+	ASSERT(m->size_idx <= RUN_BITS_PER_VALUE);
+
+	uint64_t bmask = m->size_idx == RUN_BITS_PER_VALUE ?
+		UINT64_MAX : ((1ULL << m->size_idx) - 1ULL) <<
+			(m->block_off % RUN_BITS_PER_VALUE);
+
+	unsigned v = m->block_off / RUN_BITS_PER_VALUE;
+	ASSERT(v < mirror->nvalues);
+	ASSERTeq(mirror->values[v] & bmask, 0);
+	mirror->values[v] |= bmask;
+
+	ASSERT(mirror->free_space >= m->size_idx);
+	mirror->free_space -= m->size_idx;
+}
+
 /*
  * recycler_inc_unaccounted -- increases the number of unaccounted units in the
- *	recycler
+ *	recycler and clears the freed units in the bitmap mirror of the run,
+ *	must be called with the run lock held
  */
 void
 recycler_inc_unaccounted(struct recycler *r, const struct memory_block *m)
 {
+	struct recycler_mirror *mirror = critnib_get(r->mirrors,
+		RECYCLER_MIRROR_KEY(m->zone_id, m->chunk_id));
+	if (mirror != NULL) {
+		ASSERT(m->size_idx <= RUN_BITS_PER_VALUE);
+
+		uint64_t bmask = m->size_idx == RUN_BITS_PER_VALUE ?
+			UINT64_MAX : ((1ULL << m->size_idx) - 1ULL) <<
+				(m->block_off % RUN_BITS_PER_VALUE);
+
+		unsigned v = m->block_off / RUN_BITS_PER_VALUE;
+		ASSERT(v < mirror->nvalues);
+		ASSERTeq(mirror->values[v] & bmask, bmask);
+		mirror->values[v] &= ~bmask;
+		mirror->free_space += m->size_idx;
+	}
+
 	util_fetch_and_add64(&r->unaccounted_total, m->size_idx);
 	util_fetch_and_add64(&r->unaccounted_units[m->chunk_id],
 		m->size_idx);
@@ -63,6 +63,8 @@ struct recycler *recycler_new(struct palloc_heap *layout,
 void recycler_delete(struct recycler *r);
 struct recycler_element recycler_element_new(struct palloc_heap *heap,
 	const struct memory_block *m);
+struct recycler_element recycler_element_from_mirror(struct recycler *r,
+	const struct memory_block *m);
 
 int recycler_put(struct recycler *r, const struct memory_block *m,
 	struct recycler_element element);
@@ -78,6 +80,12 @@ struct empty_runs recycler_recalc(struct recycler *r, int force);
 void recycler_inc_unaccounted(struct recycler *r,
 	const struct memory_block *m);
 
+int recycler_run_iterate_free(struct recycler *r,
+	const struct memory_block *m, object_callback cb, void *arg);
+void recycler_mark_allocated(struct recycler *r,
+	const struct memory_block *m);
+void recycler_mirror_remove(struct recycler *r, const struct memory_block *m);
+
 #ifdef __cplusplus
 }
 #endif
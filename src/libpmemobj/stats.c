@@ -35,12 +35,115 @@
  */
 
 #include "obj.h"
+#include "os.h"
 #include "stats.h"
 
 STATS_CTL_HANDLER(persistent, curr_allocated, heap_curr_allocated);
+STATS_CTL_HANDLER(transient, prezero_hits, heap_prezero_hits);
 
 static const struct ctl_node CTL_NODE(heap)[] = {
 	STATS_CTL_LEAF(persistent, curr_allocated),
+	STATS_CTL_LEAF(transient, prezero_hits),
+
+	CTL_NODE_END
+};
+
+STATS_CTL_HANDLER(transient, hits, pool_cache_hits);
+STATS_CTL_HANDLER(transient, misses, pool_cache_misses);
+
+static const struct ctl_node CTL_NODE(pool_cache)[] = {
+	STATS_CTL_LEAF(transient, hits),
+	STATS_CTL_LEAF(transient, misses),
+
+	CTL_NODE_END
+};
+
+STATS_CTL_HANDLER(transient, committed, tx_committed);
+STATS_CTL_HANDLER(transient, aborted, tx_aborted);
+STATS_CTL_HANDLER(transient, ranges, tx_ranges);
+STATS_CTL_HANDLER(transient, snapshot_bytes, tx_snapshot_bytes);
+STATS_CTL_HANDLER(transient, undo_extensions, tx_undo_extensions);
+STATS_CTL_HANDLER(transient, redo_extensions, tx_redo_extensions);
+
+STATS_CTL_HANDLER(transient, work, tx_time[STATS_TX_WORK]);
+STATS_CTL_HANDLER(transient, pre_commit, tx_time[STATS_TX_PRE_COMMIT]);
+STATS_CTL_HANDLER(transient, drain, tx_time[STATS_TX_DRAIN]);
+STATS_CTL_HANDLER(transient, publish, tx_time[STATS_TX_PUBLISH]);
+STATS_CTL_HANDLER(transient, post_commit, tx_time[STATS_TX_POST_COMMIT]);
+
+static const struct ctl_node CTL_NODE(time)[] = {
+	STATS_CTL_LEAF(transient, work),
+	STATS_CTL_LEAF(transient, pre_commit),
+	STATS_CTL_LEAF(transient, drain),
+	STATS_CTL_LEAF(transient, publish),
+	STATS_CTL_LEAF(transient, post_commit),
+
+	CTL_NODE_END
+};
+
+/*
+ * CTL_READ_HANDLER(latency) -- returns the histogram of the latencies of the
+ *	committed transactions
+ */
+static int
+CTL_READ_HANDLER(latency)(void *ctx,
+	enum ctl_query_source source, void *arg,
+	struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	struct pobj_tx_latency *arg_out = arg;
+	uint64_t *latency = pop->stats->transient->tx_latency;
+
+	for (unsigned i = 0; i < POBJ_TX_LATENCY_BUCKETS; ++i)
+		util_atomic_load_explicit64(&latency[i], &arg_out->count[i],
+			memory_order_acquire);
+
+	return 0;
+}
+
+static const struct ctl_node CTL_NODE(tx)[] = {
+	STATS_CTL_LEAF(transient, committed),
+	STATS_CTL_LEAF(transient, aborted),
+	STATS_CTL_LEAF(transient, ranges),
+	STATS_CTL_LEAF(transient, snapshot_bytes),
+	STATS_CTL_LEAF(transient, undo_extensions),
+	STATS_CTL_LEAF(transient, redo_extensions),
+	CTL_CHILD(time),
+	CTL_LEAF_RO(latency),
+
+	CTL_NODE_END
+};
+
+STATS_CTL_HANDLER(transient, contended, mutex_contended);
+STATS_CTL_HANDLER(transient, parked, mutex_parked);
+
+static const struct ctl_node CTL_NODE(mutex)[] = {
+	STATS_CTL_LEAF(transient, contended),
+	STATS_CTL_LEAF(transient, parked),
+
+	CTL_NODE_END
+};
+
+STATS_CTL_HANDLER(transient, busy, lane_busy);
+STATS_CTL_HANDLER(transient, stolen, lane_stolen);
+
+static const struct ctl_node CTL_NODE(lane)[] = {
+	STATS_CTL_LEAF(transient, busy),
+	STATS_CTL_LEAF(transient, stolen),
+
+	CTL_NODE_END
+};
+
+STATS_CTL_HANDLER(transient, redo, recovery_time[STATS_RECOVERY_REDO]);
+STATS_CTL_HANDLER(transient, heap_boot,
+	recovery_time[STATS_RECOVERY_HEAP_BOOT]);
+STATS_CTL_HANDLER(transient, undo, recovery_time[STATS_RECOVERY_UNDO]);
+
+static const struct ctl_node CTL_NODE(recovery)[] = {
+	STATS_CTL_LEAF(transient, redo),
+	STATS_CTL_LEAF(transient, heap_boot),
+	STATS_CTL_LEAF(transient, undo),
 
 	CTL_NODE_END
 };
@@ -83,11 +186,28 @@ static const struct ctl_argument CTL_ARG(enabled) = CTL_ARG_BOOLEAN;
 
 static const struct ctl_node CTL_NODE(stats)[] = {
 	CTL_CHILD(heap),
+	CTL_CHILD(pool_cache),
+	CTL_CHILD(tx),
+	CTL_CHILD(mutex),
+	CTL_CHILD(lane),
+	CTL_CHILD(recovery),
 	CTL_LEAF_RW(enabled),
 
 	CTL_NODE_END
 };
 
+/*
+ * stats_now -- returns the monotonic time in nanoseconds
+ */
+uint64_t
+stats_now(void)
+{
+	struct timespec ts;
+	os_clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
 /*
  * stats_new -- allocates and initializes statistics instance
  */
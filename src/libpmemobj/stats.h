@@ -38,13 +38,53 @@
 #define LIBPMEMOBJ_STATS_H 1
 
 #include "ctl.h"
+#include "libpmemobj.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+enum stats_tx_stage {
+	STATS_TX_WORK,
+	STATS_TX_PRE_COMMIT,
+	STATS_TX_DRAIN,
+	STATS_TX_PUBLISH,
+	STATS_TX_POST_COMMIT,
+
+	MAX_STATS_TX_STAGE
+};
+
+enum stats_recovery_phase {
+	STATS_RECOVERY_REDO,
+	STATS_RECOVERY_HEAP_BOOT,
+	STATS_RECOVERY_UNDO,
+
+	MAX_STATS_RECOVERY_PHASE
+};
+
 struct stats_transient {
-	int unused;
+	uint64_t heap_prezero_hits;
+
+	uint64_t pool_cache_hits;
+	uint64_t pool_cache_misses;
+
+	uint64_t tx_committed;
+	uint64_t tx_aborted;
+	uint64_t tx_ranges;
+	uint64_t tx_snapshot_bytes;
+	uint64_t tx_undo_extensions;
+	uint64_t tx_redo_extensions;
+	uint64_t tx_time[MAX_STATS_TX_STAGE]; /* in nanoseconds */
+	uint64_t tx_latency[POBJ_TX_LATENCY_BUCKETS];
+
+	uint64_t mutex_contended;
+	uint64_t mutex_parked;
+
+	uint64_t lane_busy;
+	uint64_t lane_stolen;
+
+	/* set on open, even if the statistics are disabled */
+	uint64_t recovery_time[MAX_STATS_RECOVERY_PHASE]; /* in nanoseconds */
 };
 
 struct stats_persistent {
@@ -91,6 +131,8 @@ static int CTL_READ_HANDLER(type##_##name)(void *ctx,\
 
 void stats_ctl_register(PMEMobjpool *pop);
 
+uint64_t stats_now(void);
+
 struct stats *stats_new(PMEMobjpool *pop);
 void stats_delete(PMEMobjpool *pop, struct stats *stats);
 
@@ -58,6 +58,25 @@
 #define RECORD_LOCK(init, type, p)
 #endif
 
+/* tail of a queue lock which is held and has no waiters */
+#define SYNC_QUEUE_HELD 1ULL
+
+enum sync_waiter_state {
+	SYNC_WAITING,
+	SYNC_PARKED,
+	SYNC_GRANTED,
+};
+
+/*
+ * Waiter of a queue lock, lives on the stack of the waiting thread only until
+ * the lock is handed to it.
+ */
+struct sync_waiter {
+	uint64_t next; /* waiter queued behind this one */
+	uint64_t state;
+	os_semaphore_t sem; /* initialized only once the waiter parks */
+};
+
 /*
  * _get_value -- (internal) atomically initialize and return a value.
  *	Returns -1 on error, 0 if the caller is not the value
@@ -96,8 +115,35 @@ _get_value(uint64_t pop_runid, volatile uint64_t *runid, void *value, void *arg,
 	return initializer;
 }
 
+/*
+ * mutex_init -- (internal) initializes a mutex as either a queue lock or
+ *	an os mutex, depending on the configuration of the pool
+ */
+static int
+mutex_init(void *value, void *arg)
+{
+	PMEMmutex_internal *imp = value;
+	PMEMobjpool *pop = arg;
+	struct sync_parameters *sp = pop->sync_params;
+
+	if (sp->adaptive) {
+		sp->queued = 1;
+		imp->pmemmutex.adaptive = 1;
+		imp->PMEMmutex_tail = 0;
+		imp->PMEMmutex_queue_next = 0;
+
+		return 0;
+	}
+
+	imp->pmemmutex.adaptive = 0;
+
+	return os_mutex_init(&imp->PMEMmutex_lock);
+}
+
 /*
  * get_mutex -- (internal) atomically initialize, record and return a mutex
+ *
+ * For queue locks the returned os mutex must not be used.
  */
 static inline os_mutex_t *
 get_mutex(PMEMobjpool *pop, PMEMmutex_internal *imp)
@@ -117,17 +163,286 @@ get_mutex(PMEMobjpool *pop, PMEMmutex_internal *imp)
 
 	VALGRIND_REMOVE_PMEM_MAPPING(imp, _POBJ_CL_SIZE);
 
-	int initializer = _get_value(pop->run_id, runid, &imp->PMEMmutex_lock,
-		NULL, (void *)os_mutex_init);
+	int initializer = _get_value(pop->run_id, runid, imp, pop, mutex_init);
 	if (initializer == -1) {
 		return NULL;
 	}
 
-	RECORD_LOCK(initializer, mutex, imp);
+	RECORD_LOCK(initializer && !imp->pmemmutex.adaptive, mutex, imp);
 
 	return &imp->PMEMmutex_lock;
 }
 
+/*
+ * queue_trylock -- (internal) acquires an uncontended queue lock
+ */
+static inline int
+queue_trylock(PMEMmutex_internal *imp)
+{
+	if (util_bool_compare_and_swap64(&imp->PMEMmutex_tail, 0,
+			SYNC_QUEUE_HELD))
+		return 0;
+
+	return EBUSY;
+}
+
+/*
+ * queue_wait -- (internal) waits until the lock is handed to the waiter,
+ *	polling it for a while before the thread is put to sleep
+ */
+static void
+queue_wait(PMEMobjpool *pop, struct sync_waiter *w)
+{
+	uint64_t state;
+	for (unsigned i = 0; i < pop->sync_params->spin; ++i) {
+		util_atomic_load_explicit64(&w->state, &state,
+			memory_order_acquire);
+		if (state == SYNC_GRANTED)
+			return;
+	}
+
+	if (os_semaphore_init(&w->sem, 0) != 0) {
+		/* the thread cannot be put to sleep, keep polling */
+		do {
+			util_atomic_load_explicit64(&w->state, &state,
+				memory_order_acquire);
+		} while (state != SYNC_GRANTED);
+
+		return;
+	}
+
+	if (util_bool_compare_and_swap64(&w->state, SYNC_WAITING,
+			SYNC_PARKED)) {
+		STATS_INC(pop->stats, transient, mutex_parked, 1);
+
+		/*
+		 * The semaphore is posted exactly once, after the lock is
+		 * handed over, so it cannot be destroyed before that.
+		 */
+		while (os_semaphore_wait(&w->sem) != 0)
+			;
+	}
+
+	os_semaphore_destroy(&w->sem);
+}
+
+/*
+ * queue_grant -- (internal) hands the lock over to the waiter, which cannot
+ *	be accessed afterwards unless it was already asleep
+ */
+static void
+queue_grant(struct sync_waiter *w)
+{
+	uint64_t state;
+	do {
+		util_atomic_load_explicit64(&w->state, &state,
+			memory_order_acquire);
+	} while (!util_bool_compare_and_swap64(&w->state, state,
+			SYNC_GRANTED));
+
+	if (state == SYNC_PARKED)
+		os_semaphore_post(&w->sem);
+}
+
+/*
+ * queue_lock -- (internal) acquires a queue lock
+ *
+ * This is the variant of the MCS lock in which the lock itself stands in for
+ * the queue node of its holder, so that the waiters can be allocated on the
+ * stack and the lock can be released without the holder's node. The tail
+ * points to the last waiter, or is SYNC_QUEUE_HELD if there are none, and
+ * the holder finds the waiter to hand the lock over to in the 'next' field.
+ */
+static int
+queue_lock(PMEMobjpool *pop, PMEMmutex_internal *imp)
+{
+	if (likely(queue_trylock(imp) == 0))
+		return 0;
+
+	STATS_INC(pop->stats, transient, mutex_contended, 1);
+
+	struct sync_waiter w;
+	w.next = 0;
+	w.state = SYNC_WAITING;
+	uint64_t self = (uint64_t)(uintptr_t)&w;
+
+	uint64_t prev;
+	while (1) {
+		util_atomic_load_explicit64(&imp->PMEMmutex_tail, &prev,
+			memory_order_acquire);
+		if (prev == 0) {
+			if (queue_trylock(imp) == 0)
+				return 0;
+		} else if (util_bool_compare_and_swap64(&imp->PMEMmutex_tail,
+				prev, self)) {
+			break;
+		}
+	}
+
+	uint64_t *link = prev == SYNC_QUEUE_HELD ?
+		&imp->PMEMmutex_queue_next :
+		&((struct sync_waiter *)(uintptr_t)prev)->next;
+	util_atomic_store_explicit64(link, self, memory_order_release);
+
+	queue_wait(pop, &w);
+
+	/* the lock is held, the waiter has to be replaced by the lock itself */
+	uint64_t next;
+	util_atomic_load_explicit64(&w.next, &next, memory_order_acquire);
+	if (next == 0) {
+		util_atomic_store_explicit64(&imp->PMEMmutex_queue_next, 0,
+			memory_order_release);
+		if (util_bool_compare_and_swap64(&imp->PMEMmutex_tail, self,
+				SYNC_QUEUE_HELD))
+			return 0;
+
+		/* another thread got queued, but did not link itself yet */
+		do {
+			util_atomic_load_explicit64(&w.next, &next,
+				memory_order_acquire);
+		} while (next == 0);
+	}
+
+	util_atomic_store_explicit64(&imp->PMEMmutex_queue_next, next,
+		memory_order_release);
+
+	return 0;
+}
+
+/*
+ * queue_release -- (internal) releases a queue lock, or hands it over to the
+ *	first waiter
+ *
+ * Returns 1 if the threads sleeping in queue_timedlock have to be woken up.
+ */
+static int
+queue_release(PMEMobjpool *pop, PMEMmutex_internal *imp)
+{
+	uint64_t next;
+	util_atomic_load_explicit64(&imp->PMEMmutex_queue_next, &next,
+		memory_order_acquire);
+	if (next == 0) {
+		if (util_bool_compare_and_swap64(&imp->PMEMmutex_tail,
+				SYNC_QUEUE_HELD, 0)) {
+			uint64_t ntimed;
+			util_atomic_load_explicit64(&pop->sync_params->ntimed,
+				&ntimed, memory_order_acquire);
+
+			return ntimed != 0;
+		}
+
+		/* a waiter got queued, but did not link itself yet */
+		do {
+			util_atomic_load_explicit64(
+				&imp->PMEMmutex_queue_next, &next,
+				memory_order_acquire);
+		} while (next == 0);
+	}
+
+	queue_grant((struct sync_waiter *)(uintptr_t)next);
+
+	return 0;
+}
+
+/*
+ * queue_unlock -- (internal) unlocks a queue lock
+ */
+static int
+queue_unlock(PMEMobjpool *pop, PMEMmutex_internal *imp)
+{
+	struct sync_parameters *sp = pop->sync_params;
+
+	if (queue_release(pop, imp)) {
+		util_mutex_lock(&sp->cond_lock);
+		os_cond_broadcast(&sp->timed);
+		util_mutex_unlock(&sp->cond_lock);
+	}
+
+	return 0;
+}
+
+/*
+ * queue_timedlock -- (internal) acquires a queue lock, unless it's not
+ *	released before the timeout
+ *
+ * Queued waiters cannot leave the queue, so instead the thread sleeps until
+ * the lock is released without anyone waiting in the queue.
+ */
+static int
+queue_timedlock(PMEMobjpool *pop, PMEMmutex_internal *imp,
+	const struct timespec *abs_timeout)
+{
+	if (likely(queue_trylock(imp) == 0))
+		return 0;
+
+	STATS_INC(pop->stats, transient, mutex_contended, 1);
+
+	struct sync_parameters *sp = pop->sync_params;
+	int ret = 0;
+
+	util_mutex_lock(&sp->cond_lock);
+	util_fetch_and_add64(&sp->ntimed, 1);
+	while (queue_trylock(imp) != 0) {
+		ret = os_cond_timedwait(&sp->timed, &sp->cond_lock,
+			abs_timeout);
+		if (ret != 0) {
+			if (queue_trylock(imp) == 0)
+				ret = 0;
+			break;
+		}
+	}
+	util_fetch_and_sub64(&sp->ntimed, 1);
+	util_mutex_unlock(&sp->cond_lock);
+
+	return ret;
+}
+
+/*
+ * queue_cond_wait -- (internal) waits on a condition variable with a queue
+ *	lock held
+ *
+ * Condition variables can be used only with os mutexes, so the waits and
+ * the wake-ups are serialized on the mutex of the pool instead.
+ */
+static int
+queue_cond_wait(PMEMobjpool *pop, os_cond_t *cond, PMEMmutex_internal *imp,
+	const struct timespec *abs_timeout)
+{
+	struct sync_parameters *sp = pop->sync_params;
+
+	util_mutex_lock(&sp->cond_lock);
+	if (queue_release(pop, imp))
+		os_cond_broadcast(&sp->timed);
+
+	int ret = abs_timeout == NULL ?
+		os_cond_wait(cond, &sp->cond_lock) :
+		os_cond_timedwait(cond, &sp->cond_lock, abs_timeout);
+
+	util_mutex_unlock(&sp->cond_lock);
+	queue_lock(pop, imp);
+
+	return ret;
+}
+
+/*
+ * cond_wake -- (internal) wakes up the threads waiting on a condition
+ *	variable, which might be waiting with a queue lock held
+ */
+static int
+cond_wake(PMEMobjpool *pop, os_cond_t *cond, int (*wake)(os_cond_t *))
+{
+	struct sync_parameters *sp = pop->sync_params;
+
+	if (likely(!sp->queued))
+		return wake(cond);
+
+	util_mutex_lock(&sp->cond_lock);
+	int ret = wake(cond);
+	util_mutex_unlock(&sp->cond_lock);
+
+	return ret;
+}
+
 /*
  * get_rwlock -- (internal) atomically initialize, record and return a rwlock
  */
@@ -195,6 +510,56 @@ get_cond(PMEMobjpool *pop, PMEMcond_internal *icp)
 	return &icp->PMEMcond_cond;
 }
 
+/*
+ * seqlock_init -- (internal) initializes the writer mutex of a seqlock and
+ *	resets the sequence, which might have been left odd by a writer that
+ *	did not unlock it before the pool was closed
+ */
+static int
+seqlock_init(void *value, void *arg)
+{
+	PMEMseqlock_internal *isp = value;
+
+	isp->pmemseqlock.seq = 0;
+
+	return os_mutex_init(&isp->PMEMseqlock_lock);
+}
+
+/*
+ * get_seqlock -- (internal) atomically initialize, record and return the
+ *	writer mutex of a seqlock
+ */
+static inline os_mutex_t *
+get_seqlock(PMEMobjpool *pop, PMEMseqlock_internal *isp)
+{
+	if (likely(isp->pmemseqlock.runid == pop->run_id))
+		return &isp->PMEMseqlock_lock;
+
+	volatile uint64_t *runid = &isp->pmemseqlock.runid;
+
+	LOG(5, "PMEMseqlock %p pop->run_id %"\
+		PRIu64 " pmemseqlock.runid %" PRIu64,
+		isp, pop->run_id, *runid);
+
+	ASSERTeq((uintptr_t)runid % util_alignof(uint64_t), 0);
+
+	COMPILE_ERROR_ON(sizeof(PMEMseqlock) != sizeof(PMEMseqlock_internal));
+	COMPILE_ERROR_ON(util_alignof(PMEMseqlock)
+		!= util_alignof(os_mutex_t));
+
+	VALGRIND_REMOVE_PMEM_MAPPING(isp, _POBJ_CL_SIZE);
+
+	int initializer = _get_value(pop->run_id, runid, isp, NULL,
+		seqlock_init);
+	if (initializer == -1) {
+		return NULL;
+	}
+
+	RECORD_LOCK(initializer, seqlock, isp);
+
+	return &isp->PMEMseqlock_lock;
+}
+
 /*
  * pmemobj_mutex_zero -- zero-initialize a pmem resident mutex
  *
@@ -232,8 +597,19 @@ pmemobj_mutex_lock(PMEMobjpool *pop, PMEMmutex *mutexp)
 	if (mutex == NULL)
 		return EINVAL;
 
+	if (mutexip->pmemmutex.adaptive)
+		return queue_lock(pop, mutexip);
+
 	ASSERTeq((uintptr_t)mutex % util_alignof(os_mutex_t), 0);
 
+	if (unlikely(pop->stats->enabled)) {
+		int ret = os_mutex_trylock(mutex);
+		if (ret != EBUSY)
+			return ret;
+
+		STATS_INC(pop->stats, transient, mutex_contended, 1);
+	}
+
 	return os_mutex_lock(mutex);
 }
 
@@ -254,6 +630,9 @@ pmemobj_mutex_assert_locked(PMEMobjpool *pop, PMEMmutex *mutexp)
 	if (mutex == NULL)
 		return EINVAL;
 
+	if (mutexip->pmemmutex.adaptive)
+		return mutexip->PMEMmutex_tail != 0 ? 0 : ENODEV;
+
 	ASSERTeq((uintptr_t)mutex % util_alignof(os_mutex_t), 0);
 
 	int ret = os_mutex_trylock(mutex);
@@ -289,6 +668,9 @@ pmemobj_mutex_timedlock(PMEMobjpool *pop, PMEMmutex *__restrict mutexp,
 	if (mutex == NULL)
 		return EINVAL;
 
+	if (mutexip->pmemmutex.adaptive)
+		return queue_timedlock(pop, mutexip, abs_timeout);
+
 	ASSERTeq((uintptr_t)mutex % util_alignof(os_mutex_t), 0);
 
 	return os_mutex_timedlock(mutex, abs_timeout);
@@ -312,6 +694,9 @@ pmemobj_mutex_trylock(PMEMobjpool *pop, PMEMmutex *mutexp)
 	if (mutex == NULL)
 		return EINVAL;
 
+	if (mutexip->pmemmutex.adaptive)
+		return queue_trylock(mutexip);
+
 	ASSERTeq((uintptr_t)mutex % util_alignof(os_mutex_t), 0);
 
 	return os_mutex_trylock(mutex);
@@ -333,6 +718,9 @@ pmemobj_mutex_unlock(PMEMobjpool *pop, PMEMmutex *mutexp)
 	if (mutex == NULL)
 		return EINVAL;
 
+	if (mutexip->pmemmutex.adaptive)
+		return queue_unlock(pop, mutexip);
+
 	ASSERTeq((uintptr_t)mutex % util_alignof(os_mutex_t), 0);
 
 	return os_mutex_unlock(mutex);
@@ -557,7 +945,7 @@ pmemobj_cond_broadcast(PMEMobjpool *pop, PMEMcond *condp)
 
 	ASSERTeq((uintptr_t)cond % util_alignof(os_cond_t), 0);
 
-	return os_cond_broadcast(cond);
+	return cond_wake(pop, cond, os_cond_broadcast);
 }
 
 /*
@@ -580,7 +968,7 @@ pmemobj_cond_signal(PMEMobjpool *pop, PMEMcond *condp)
 
 	ASSERTeq((uintptr_t)cond % util_alignof(os_cond_t), 0);
 
-	return os_cond_signal(cond);
+	return cond_wake(pop, cond, os_cond_signal);
 }
 
 /*
@@ -607,6 +995,9 @@ pmemobj_cond_timedwait(PMEMobjpool *pop, PMEMcond *__restrict condp,
 	if ((cond == NULL) || (mutex == NULL))
 		return EINVAL;
 
+	if (mutexip->pmemmutex.adaptive)
+		return queue_cond_wait(pop, cond, mutexip, abs_timeout);
+
 	ASSERTeq((uintptr_t)mutex % util_alignof(os_mutex_t), 0);
 	ASSERTeq((uintptr_t)cond % util_alignof(os_cond_t), 0);
 
@@ -635,12 +1026,167 @@ pmemobj_cond_wait(PMEMobjpool *pop, PMEMcond *condp,
 	if ((cond == NULL) || (mutex == NULL))
 		return EINVAL;
 
+	if (mutexip->pmemmutex.adaptive)
+		return queue_cond_wait(pop, cond, mutexip, NULL);
+
 	ASSERTeq((uintptr_t)mutex % util_alignof(os_mutex_t), 0);
 	ASSERTeq((uintptr_t)cond % util_alignof(os_cond_t), 0);
 
 	return os_cond_wait(cond, mutex);
 }
 
+/*
+ * pmemobj_seqlock_zero -- zero-initialize a pmem resident seqlock
+ *
+ * This function is not MT safe.
+ */
+void
+pmemobj_seqlock_zero(PMEMobjpool *pop, PMEMseqlock *seqlockp)
+{
+	LOG(3, "pop %p seqlock %p", pop, seqlockp);
+
+	ASSERTeq(pop, pmemobj_pool_by_ptr(seqlockp));
+
+	PMEMseqlock_internal *seqlockip = (PMEMseqlock_internal *)seqlockp;
+	seqlockip->pmemseqlock.runid = 0;
+	pmemops_persist(&pop->p_ops, &seqlockip->pmemseqlock.runid,
+				sizeof(seqlockip->pmemseqlock.runid));
+}
+
+/*
+ * pmemobj_seqlock_wrlock -- lock a pmem resident seqlock for writing
+ *
+ * Writers are serialized on the embedded mutex. Once the mutex is held, the
+ * sequence is made odd, which forces all the concurrent readers to retry.
+ */
+int
+pmemobj_seqlock_wrlock(PMEMobjpool *pop, PMEMseqlock *seqlockp)
+{
+	LOG(3, "pop %p seqlock %p", pop, seqlockp);
+
+	ASSERTeq(pop, pmemobj_pool_by_ptr(seqlockp));
+
+	PMEMseqlock_internal *seqlockip = (PMEMseqlock_internal *)seqlockp;
+	os_mutex_t *mutex = get_seqlock(pop, seqlockip);
+	if (mutex == NULL)
+		return EINVAL;
+
+	ASSERTeq((uintptr_t)mutex % util_alignof(os_mutex_t), 0);
+
+	int ret = os_mutex_lock(mutex);
+	if (ret)
+		return ret;
+
+	uint64_t seq = seqlockip->pmemseqlock.seq;
+	ASSERTeq(seq % 2, 0);
+
+	util_atomic_store_explicit64(&seqlockip->pmemseqlock.seq, seq + 1,
+		memory_order_relaxed);
+	/* the protected data cannot be modified before the sequence */
+	util_synchronize();
+
+	return 0;
+}
+
+/*
+ * pmemobj_seqlock_unlock -- unlock a pmem resident seqlock
+ */
+int
+pmemobj_seqlock_unlock(PMEMobjpool *pop, PMEMseqlock *seqlockp)
+{
+	LOG(3, "pop %p seqlock %p", pop, seqlockp);
+
+	ASSERTeq(pop, pmemobj_pool_by_ptr(seqlockp));
+
+	PMEMseqlock_internal *seqlockip = (PMEMseqlock_internal *)seqlockp;
+	os_mutex_t *mutex = get_seqlock(pop, seqlockip);
+	if (mutex == NULL)
+		return EINVAL;
+
+	ASSERTeq((uintptr_t)mutex % util_alignof(os_mutex_t), 0);
+
+	uint64_t seq = seqlockip->pmemseqlock.seq;
+	ASSERTeq(seq % 2, 1);
+
+	util_atomic_store_explicit64(&seqlockip->pmemseqlock.seq, seq + 1,
+		memory_order_release);
+
+	return os_mutex_unlock(mutex);
+}
+
+/*
+ * pmemobj_seqlock_read_begin -- start an optimistic read of the data
+ *	protected by a pmem resident seqlock
+ *
+ * Returns the sequence that has to be validated with
+ * pmemobj_seqlock_read_retry once the data is read. The seqlock is not
+ * modified, nor initialized, by the readers - a seqlock which was not yet
+ * used by a writer in this run of the pool is read as if its sequence was 0.
+ * If there's a writer in progress, the reader waits on the writer mutex.
+ */
+uint64_t
+pmemobj_seqlock_read_begin(PMEMobjpool *pop, PMEMseqlock *seqlockp)
+{
+	LOG(15, "pop %p seqlock %p", pop, seqlockp);
+
+	PMEMseqlock_internal *seqlockip = (PMEMseqlock_internal *)seqlockp;
+
+	uint64_t runid;
+	uint64_t seq;
+	while (1) {
+		util_atomic_load_explicit64(&seqlockip->pmemseqlock.runid,
+			&runid, memory_order_acquire);
+		if (runid != pop->run_id)
+			return 0;
+
+		util_atomic_load_explicit64(&seqlockip->pmemseqlock.seq,
+			&seq, memory_order_acquire);
+		if (likely(seq % 2 == 0))
+			return seq;
+
+		/* wait for the writer instead of spinning */
+		util_mutex_lock(&seqlockip->PMEMseqlock_lock);
+		util_mutex_unlock(&seqlockip->PMEMseqlock_lock);
+	}
+}
+
+/*
+ * pmemobj_seqlock_read_retry -- validate an optimistic read of the data
+ *	protected by a pmem resident seqlock
+ *
+ * Returns a non-zero value if a writer could have modified the data since
+ * the matching pmemobj_seqlock_read_begin, in which case the data has to be
+ * read again.
+ */
+int
+pmemobj_seqlock_read_retry(PMEMobjpool *pop, PMEMseqlock *seqlockp,
+	uint64_t seq)
+{
+	LOG(15, "pop %p seqlock %p seq %" PRIu64, pop, seqlockp, seq);
+
+	PMEMseqlock_internal *seqlockip = (PMEMseqlock_internal *)seqlockp;
+
+	/* the protected data has to be read before the sequence */
+	util_synchronize();
+
+	uint64_t runid;
+	util_atomic_load_explicit64(&seqlockip->pmemseqlock.runid,
+		&runid, memory_order_acquire);
+
+	/*
+	 * Writers initialize the seqlock before they modify anything, so as
+	 * long as it is not initialized the data is unchanged.
+	 */
+	if (runid != pop->run_id)
+		return seq != 0;
+
+	uint64_t cur;
+	util_atomic_load_explicit64(&seqlockip->pmemseqlock.seq,
+		&cur, memory_order_relaxed);
+
+	return cur != seq;
+}
+
 /*
  * pmemobj_volatile -- atomically initialize, record and return a
  *	generic value
@@ -669,3 +1215,137 @@ pmemobj_volatile(PMEMobjpool *pop, struct pmemvlt *vlt,
 
 	return ptr;
 }
+
+/*
+ * sync_params_new -- creates the synchronization parameters of a pool
+ */
+struct sync_parameters *
+sync_params_new(void)
+{
+	struct sync_parameters *sp = Malloc(sizeof(*sp));
+	if (sp == NULL)
+		return NULL;
+
+	sp->adaptive = 0;
+	sp->queued = 0;
+	sp->spin = SYNC_DEFAULT_MUTEX_SPIN;
+	sp->ntimed = 0;
+
+	util_mutex_init(&sp->cond_lock);
+	if ((errno = os_cond_init(&sp->timed)) != 0) {
+		util_mutex_destroy(&sp->cond_lock);
+		Free(sp);
+		return NULL;
+	}
+
+	return sp;
+}
+
+/*
+ * sync_params_delete -- deletes the synchronization parameters of a pool
+ */
+void
+sync_params_delete(struct sync_parameters *sp)
+{
+	ASSERTeq(sp->ntimed, 0);
+
+	os_cond_destroy(&sp->timed);
+	util_mutex_destroy(&sp->cond_lock);
+	Free(sp);
+}
+
+/*
+ * CTL_READ_HANDLER(adaptive) -- returns whether the newly initialized
+ *	mutexes are queue locks
+ */
+static int
+CTL_READ_HANDLER(adaptive)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	int *arg_out = arg;
+	*arg_out = pop->sync_params->adaptive;
+
+	return 0;
+}
+
+/*
+ * CTL_WRITE_HANDLER(adaptive) -- selects the implementation of the mutexes
+ *	which are initialized from now on
+ */
+static int
+CTL_WRITE_HANDLER(adaptive)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	int arg_in = *(int *)arg;
+	pop->sync_params->adaptive = arg_in > 0;
+
+	return 0;
+}
+
+static const struct ctl_argument CTL_ARG(adaptive) = CTL_ARG_BOOLEAN;
+
+/*
+ * CTL_READ_HANDLER(spin) -- returns the number of times the waiters of
+ *	a queue lock poll it before they are put to sleep
+ */
+static int
+CTL_READ_HANDLER(spin)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	int *arg_out = arg;
+	*arg_out = (int)pop->sync_params->spin;
+
+	return 0;
+}
+
+/*
+ * CTL_WRITE_HANDLER(spin) -- sets the number of times the waiters of
+ *	a queue lock poll it before they are put to sleep
+ */
+static int
+CTL_WRITE_HANDLER(spin)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	int arg_in = *(int *)arg;
+	if (arg_in < 0) {
+		ERR("invalid mutex spin count %d", arg_in);
+		errno = EINVAL;
+		return -1;
+	}
+
+	pop->sync_params->spin = (unsigned)arg_in;
+
+	return 0;
+}
+
+static const struct ctl_argument CTL_ARG(spin) = CTL_ARG_INT;
+
+static const struct ctl_node CTL_NODE(mutex)[] = {
+	CTL_LEAF_RW(adaptive),
+	CTL_LEAF_RW(spin),
+
+	CTL_NODE_END
+};
+
+static const struct ctl_node CTL_NODE(sync)[] = {
+	CTL_CHILD(mutex),
+
+	CTL_NODE_END
+};
+
+/*
+ * sync_ctl_register -- registers ctl nodes for "sync" module
+ */
+void
+sync_ctl_register(PMEMobjpool *pop)
+{
+	CTL_REGISTER_MODULE(pop->ctl, sync);
+}
@@ -48,6 +48,23 @@
 extern "C" {
 #endif
 
+#define SYNC_DEFAULT_MUTEX_SPIN 100 /* lock polls before a waiter parks */
+
+struct sync_parameters {
+	int adaptive; /* mutexes initialized from now on are queue locks */
+	int queued; /* at least one queue lock was initialized in this run */
+	unsigned spin;
+
+	os_mutex_t cond_lock; /* protects waits on queue locks */
+	os_cond_t timed; /* signaled when a queue lock is released */
+	uint64_t ntimed; /* number of threads waiting on 'timed' */
+};
+
+struct sync_parameters *sync_params_new(void);
+void sync_params_delete(struct sync_parameters *sync_params);
+
+void sync_ctl_register(PMEMobjpool *pop);
+
 /*
  * internal definitions of PMEM-locks
  */
@@ -61,12 +78,19 @@ typedef union padded_pmemmutex {
 				void *bsd_mutex_p;
 				union padded_pmemmutex *next;
 			} bsd_u;
+			struct {
+				uint64_t tail; /* last waiter or held flag */
+				uint64_t next; /* holder's successor */
+			} queue_u;
 		} mutex_u;
+		uint64_t adaptive; /* the mutex is a queue lock in this run */
 	} pmemmutex;
 } PMEMmutex_internal;
 #define PMEMmutex_lock pmemmutex.mutex_u.mutex
 #define PMEMmutex_bsd_mutex_p pmemmutex.mutex_u.bsd_u.bsd_mutex_p
 #define PMEMmutex_next pmemmutex.mutex_u.bsd_u.next
+#define PMEMmutex_tail pmemmutex.mutex_u.queue_u.tail
+#define PMEMmutex_queue_next pmemmutex.mutex_u.queue_u.next
 
 typedef union padded_pmemrwlock {
 	char padding[_POBJ_CL_SIZE];
@@ -102,6 +126,24 @@ typedef union padded_pmemcond {
 #define PMEMcond_bsd_cond_p pmemcond.cond_u.bsd_u.bsd_cond_p
 #define PMEMcond_next pmemcond.cond_u.bsd_u.next
 
+typedef union padded_pmemseqlock {
+	char padding[_POBJ_CL_SIZE];
+	struct {
+		uint64_t runid;
+		uint64_t seq; /* odd while a writer holds the lock */
+		union {
+			os_mutex_t mutex;
+			struct {
+				void *bsd_mutex_p;
+				union padded_pmemseqlock *next;
+			} bsd_u;
+		} mutex_u;
+	} pmemseqlock;
+} PMEMseqlock_internal;
+#define PMEMseqlock_lock pmemseqlock.mutex_u.mutex
+#define PMEMseqlock_bsd_mutex_p pmemseqlock.mutex_u.bsd_u.bsd_mutex_p
+#define PMEMseqlock_next pmemseqlock.mutex_u.bsd_u.next
+
 /*
  * pmemobj_mutex_lock_nofail -- pmemobj_mutex_lock variant that never
  * fails from caller perspective. If pmemobj_mutex_lock failed, this function
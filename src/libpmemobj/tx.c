@@ -43,14 +43,100 @@
 #include "out.h"
 #include "pmalloc.h"
 #include "tx.h"
+#include "tx_ranges.h"
 #include "valgrind_internal.h"
 #include "memops.h"
+#include "os.h"
+#include "os_thread.h"
+#include "sys_util.h"
+#include "vecq.h"
 
 struct tx_data {
 	SLIST_ENTRY(tx_data) tx_entry;
 	jmp_buf env;
 };
 
+/*
+ * Queue of lanes detached from committed transactions. The lanes are released
+ * by the post commit workers once their undo logs are clobbered.
+ */
+struct tx_postcommit {
+	os_mutex_t lock;
+	os_cond_t cond; /* signaled on a new task or when stopping */
+	os_cond_t idle; /* signaled when a worker exits */
+	VECQ(, unsigned) tasks;
+	unsigned depth; /* 0 if the queue is disabled */
+	unsigned nworkers;
+	int stop;
+};
+
+/*
+ * State of the group commit. Transactions reaching the pre-commit phase
+ * within a short window form a group, whose ranges are flushed by one of them
+ * (the leader) and made durable with a single drain.
+ */
+struct tx_group_commit {
+	os_mutex_t lock;
+	os_cond_t full; /* signaled when the pending group is full */
+	os_cond_t done; /* signaled when a group becomes durable */
+	VEC(tx_group, struct tx_ranges *) pending; /* group being collected */
+	struct tx_group flushing; /* group being flushed by the leader */
+	uint64_t gen; /* generation of the pending group */
+	uint64_t durable; /* generation of the last durable group */
+	int leader; /* set if there's a leader collecting or flushing a group */
+	unsigned batch; /* max transactions in a group, <= 1 disables */
+	unsigned window; /* time in microseconds the leader waits for a group */
+};
+
+/* lane of a committed relaxed transaction */
+struct tx_epoch_lane {
+	uint64_t epoch;
+	unsigned lane_idx;
+};
+
+/*
+ * State of the relaxed durability transactions. A committed relaxed
+ * transaction keeps its lane, with the undo log tagged by the epoch of the
+ * commit, until all the epochs up to its own are made durable.
+ */
+struct tx_epoch {
+	os_mutex_t lock;
+	os_cond_t cond; /* signaled on a new pending lane or a finished sync */
+	os_cond_t wake; /* wakes up the workers, signaled when stopping */
+	VEC(tx_epoch_lanes, struct tx_epoch_lane) pending; /* committed lanes */
+	struct tx_epoch_lanes batch; /* lanes being made durable */
+	uint64_t last; /* last assigned epoch */
+	uint64_t durable; /* last durable epoch */
+	size_t max_pending; /* limit of lanes held by pending epochs */
+	unsigned interval; /* time in milliseconds between syncs of workers */
+	unsigned nworkers;
+	int syncing;
+	int stop;
+};
+
+/*
+ * tx_cow -- the copy of an object created by pmemobj_tx_cow
+ */
+struct tx_cow {
+	uint64_t old_off;
+	uint64_t new_off;
+};
+
+/*
+ * tx_stats -- statistics of the current transaction of a thread, added to the
+ *	statistics of the pool once the transaction is over
+ */
+struct tx_stats {
+	int enabled; /* collected for the current transaction */
+	uint64_t begin; /* start of the outermost transaction, in nanoseconds */
+	uint64_t mark; /* start of the current stage, in nanoseconds */
+	uint64_t time[MAX_STATS_TX_STAGE];
+	uint64_t nranges;
+	uint64_t nbytes;
+	uint64_t undo_nextended; /* extensions of the lane logs at the start */
+	uint64_t redo_nextended;
+};
+
 struct tx {
 	PMEMobjpool *pop;
 	enum pobj_tx_stage stage;
@@ -59,14 +145,27 @@ struct tx {
 	SLIST_HEAD(txl, tx_lock_data) tx_locks;
 	SLIST_HEAD(txd, tx_data) tx_entries;
 
-	struct ravl *ranges;
+	struct tx_ranges ranges;
+
+	/* write set of a redo-only transaction, NULL for undo transactions */
+	struct ravl *redo_set;
+	size_t redo_nwords; /* number of 8-byte words in the write set */
+	size_t redo_nranges; /* number of ranges in the write set */
+	size_t redo_nbytes; /* log space of the published buffers */
+
+	int relaxed; /* commit doesn't wait for durability */
 
 	VEC(, struct pobj_action) actions;
 
+	/* copy-on-write copies of the objects updated in the transaction */
+	VEC(, struct tx_cow) cows;
+
 	pmemobj_tx_callback stage_callback;
 	void *stage_callback_arg;
 
 	int first_snapshot;
+
+	struct tx_stats stats;
 };
 
 /*
@@ -81,10 +180,103 @@ get_tx()
 	return &tx;
 }
 
+/*
+ * tx_stats_start -- (internal) starts collecting the statistics of the
+ *	outermost transaction, if they are enabled in the pool
+ */
+static void
+tx_stats_start(struct tx *tx)
+{
+	struct tx_stats *st = &tx->stats;
+
+	st->enabled = tx->pop->stats->enabled;
+	if (!st->enabled)
+		return;
+
+	st->begin = stats_now();
+	st->mark = st->begin;
+	memset(st->time, 0, sizeof(st->time));
+	st->nranges = 0;
+	st->nbytes = 0;
+	st->undo_nextended = operation_nextended(tx->lane->undo);
+	st->redo_nextended = operation_nextended(tx->lane->external);
+}
+
+/*
+ * tx_stats_stage -- (internal) accounts the time since the end of the previous
+ *	stage to the given stage of the transaction
+ */
+static inline void
+tx_stats_stage(struct tx *tx, enum stats_tx_stage stage)
+{
+	struct tx_stats *st = &tx->stats;
+	if (!st->enabled)
+		return;
+
+	uint64_t now = stats_now();
+	st->time[stage] += now - st->mark;
+	st->mark = now;
+}
+
+/*
+ * tx_stats_logs -- (internal) adds the log extensions allocated on
+ *	behalf of the transaction to the statistics of the pool, while the lane
+ *	is still held
+ */
+static void
+tx_stats_logs(struct tx *tx)
+{
+	struct tx_stats *st = &tx->stats;
+	if (!st->enabled)
+		return;
+
+	struct stats *stats = tx->pop->stats;
+
+	STATS_INC(stats, transient, tx_undo_extensions,
+		operation_nextended(tx->lane->undo) - st->undo_nextended);
+	STATS_INC(stats, transient, tx_redo_extensions,
+		operation_nextended(tx->lane->external) - st->redo_nextended);
+}
+
+/*
+ * tx_stats_end -- (internal) adds the statistics of the finished outermost
+ *	transaction to the statistics of the pool
+ */
+static void
+tx_stats_end(struct tx *tx, int committed)
+{
+	struct tx_stats *st = &tx->stats;
+	if (!st->enabled)
+		return;
+
+	struct stats *stats = tx->pop->stats;
+
+	STATS_INC(stats, transient, tx_ranges, st->nranges);
+	STATS_INC(stats, transient, tx_snapshot_bytes, st->nbytes);
+
+	if (!committed) {
+		STATS_INC(stats, transient, tx_aborted, 1);
+		return;
+	}
+
+	STATS_INC(stats, transient, tx_committed, 1);
+
+	for (int i = 0; i < MAX_STATS_TX_STAGE; ++i)
+		STATS_INC(stats, transient, tx_time[i], st->time[i]);
+
+	uint64_t latency = stats_now() - st->begin;
+	unsigned bucket = latency == 0 ? 0 : util_mssb_index64(latency);
+	if (bucket >= POBJ_TX_LATENCY_BUCKETS)
+		bucket = POBJ_TX_LATENCY_BUCKETS - 1;
+
+	STATS_INC(stats, transient, tx_latency[bucket], 1);
+}
+
 struct tx_lock_data {
 	union {
 		PMEMmutex *mutex;
 		PMEMrwlock *rwlock;
+		PMEMseqlock *seqlock;
 	} lock;
 	enum pobj_tx_param lock_type;
 	SLIST_ENTRY(tx_lock_data) tx_lock;
@@ -102,20 +294,26 @@ struct tx_alloc_args {
 #define ALLOC_ARGS(flags)\
 (struct tx_alloc_args){flags, NULL, 0}
 
-struct tx_range_def {
+/*
+ * Range modified by a redo-only transaction. The new contents are kept in
+ * DRAM until commit, when they are written out through the redo log.
+ * Both the offset and the size are aligned to 8 bytes and the ranges in the
+ * write set never overlap nor are adjacent to each other.
+ */
+struct tx_redo_range {
 	uint64_t offset;
 	uint64_t size;
-	uint64_t flags;
+	uint8_t *data;
 };
 
 /*
- * tx_range_def_cmp -- compares two snapshot ranges
+ * tx_redo_range_cmp -- compares two write set ranges
  */
 static int
-tx_range_def_cmp(const void *lhs, const void *rhs)
+tx_redo_range_cmp(const void *lhs, const void *rhs)
 {
-	const struct tx_range_def *l = lhs;
-	const struct tx_range_def *r = rhs;
+	const struct tx_redo_range *l = lhs;
+	const struct tx_redo_range *r = rhs;
 
 	if (l->offset > r->offset)
 		return 1;
@@ -138,7 +336,89 @@ tx_params_new(void)
 
 	tx_params->cache_size = TX_DEFAULT_RANGE_CACHE_SIZE;
 
+	struct tx_postcommit *pc = Malloc(sizeof(*pc));
+	if (pc == NULL)
+		goto error_postcommit_alloc;
+
+	util_mutex_init(&pc->lock);
+	if ((errno = os_cond_init(&pc->cond)) != 0)
+		goto error_cond_init;
+	if ((errno = os_cond_init(&pc->idle)) != 0)
+		goto error_idle_init;
+	VECQ_INIT(&pc->tasks);
+	pc->depth = 0;
+	pc->nworkers = 0;
+	pc->stop = 0;
+
+	tx_params->postcommit = pc;
+
+	struct tx_group_commit *gc = Malloc(sizeof(*gc));
+	if (gc == NULL)
+		goto error_group_commit_alloc;
+
+	util_mutex_init(&gc->lock);
+	if ((errno = os_cond_init(&gc->full)) != 0)
+		goto error_full_init;
+	if ((errno = os_cond_init(&gc->done)) != 0)
+		goto error_done_init;
+	VEC_INIT(&gc->pending);
+	VEC_INIT(&gc->flushing);
+	gc->gen = 1;
+	gc->durable = 0;
+	gc->leader = 0;
+	gc->batch = 0;
+	gc->window = TX_DEFAULT_GROUP_COMMIT_WINDOW;
+
+	tx_params->group_commit = gc;
+
+	struct tx_epoch *ep = Malloc(sizeof(*ep));
+	if (ep == NULL)
+		goto error_epoch_alloc;
+
+	util_mutex_init(&ep->lock);
+	if ((errno = os_cond_init(&ep->cond)) != 0)
+		goto error_epoch_cond_init;
+	if ((errno = os_cond_init(&ep->wake)) != 0)
+		goto error_wake_init;
+	VEC_INIT(&ep->pending);
+	VEC_INIT(&ep->batch);
+	ep->last = 0;
+	ep->durable = 0;
+	ep->max_pending = 0;
+	ep->interval = TX_DEFAULT_EPOCH_INTERVAL;
+	ep->nworkers = 0;
+	ep->syncing = 0;
+	ep->stop = 0;
+
+	tx_params->epoch = ep;
+
 	return tx_params;
+
+error_wake_init:
+	os_cond_destroy(&ep->cond);
+error_epoch_cond_init:
+	util_mutex_destroy(&ep->lock);
+	Free(ep);
+error_epoch_alloc:
+	VEC_DELETE(&gc->flushing);
+	VEC_DELETE(&gc->pending);
+	os_cond_destroy(&gc->done);
+error_done_init:
+	os_cond_destroy(&gc->full);
+error_full_init:
+	util_mutex_destroy(&gc->lock);
+	Free(gc);
+error_group_commit_alloc:
+	VECQ_DELETE(&pc->tasks);
+	os_cond_destroy(&pc->idle);
+error_idle_init:
+	os_cond_destroy(&pc->cond);
+error_cond_init:
+	util_mutex_destroy(&pc->lock);
+	Free(pc);
+error_postcommit_alloc:
+	Free(tx_params);
+	return NULL;
 }
 
 /*
@@ -147,6 +427,41 @@ tx_params_new(void)
 void
 tx_params_delete(struct tx_parameters *tx_params)
 {
+	struct tx_epoch *ep = tx_params->epoch;
+
+	ASSERTeq(ep->nworkers, 0);
+	ASSERTeq(VEC_SIZE(&ep->pending), 0);
+
+	VEC_DELETE(&ep->batch);
+	VEC_DELETE(&ep->pending);
+	os_cond_destroy(&ep->wake);
+	os_cond_destroy(&ep->cond);
+	util_mutex_destroy(&ep->lock);
+	Free(ep);
+
+	struct tx_group_commit *gc = tx_params->group_commit;
+
+	ASSERTeq(gc->leader, 0);
+	ASSERTeq(VEC_SIZE(&gc->pending), 0);
+
+	VEC_DELETE(&gc->flushing);
+	VEC_DELETE(&gc->pending);
+	os_cond_destroy(&gc->done);
+	os_cond_destroy(&gc->full);
+	util_mutex_destroy(&gc->lock);
+	Free(gc);
+
+	struct tx_postcommit *pc = tx_params->postcommit;
+
+	ASSERTeq(pc->nworkers, 0);
+	ASSERTeq(VECQ_SIZE(&pc->tasks), 0);
+
+	VECQ_DELETE(&pc->tasks);
+	os_cond_destroy(&pc->idle);
+	os_cond_destroy(&pc->cond);
+	util_mutex_destroy(&pc->lock);
+	Free(pc);
+
 	Free(tx_params);
 }
 
@@ -187,15 +502,46 @@ obj_tx_abort_null(int errnum)
 		FATAL("%s called in invalid stage %d", __func__, (tx)->stage);\
 } while (0)
 
+/*
+ * Upper bound of the space taken up by a write set range in addition to its
+ * data, the ranges are logged as cacheline aligned buffer entries.
+ */
+#define TX_REDO_RANGE_OVERHEAD OPERATION_REDO_BUFFER_SIZE(CACHELINE_SIZE)
+
+/*
+ * tx_log_reserve -- (internal) reserves space in the external redo log for
+ *	all the actions and the write set of the transaction, plus the given
+ *	number of new entries and words in new write set ranges
+ *
+ * Every range of the write set is logged as a single buffer entry, unless
+ * it's split at the end of one of the ulogs in the chain. Each of them is at
+ * least LANE_REDO_EXTERNAL_SIZE bytes long.
+ */
+static int
+tx_log_reserve(struct tx *tx, size_t nentries, size_t nwords, size_t nranges)
+{
+	size_t entries_size =
+		(VEC_SIZE(&tx->actions) + nentries) *
+			sizeof(struct ulog_entry_val) +
+		(tx->redo_nwords + nwords) * sizeof(uint64_t) +
+		(tx->redo_nranges + nranges) * TX_REDO_RANGE_OVERHEAD +
+		tx->redo_nbytes;
+
+	size_t split_size = OPERATION_REDO_BUFFER_SPLIT_SIZE;
+	size_t nsplits = entries_size /
+		(LANE_REDO_EXTERNAL_SIZE - split_size) + 1;
+	entries_size += nsplits * split_size;
+
+	return operation_reserve(tx->lane->external, entries_size);
+}
+
 /*
  * tx_action_add -- (internal) reserve space and add a new tx action
  */
 static struct pobj_action *
 tx_action_add(struct tx *tx)
 {
-	size_t entries_size = (VEC_SIZE(&tx->actions) + 1) *
-		sizeof(struct ulog_entry_val);
-	if (operation_reserve(tx->lane->external, entries_size) != 0)
+	if (tx_log_reserve(tx, 1, 0, 0) != 0)
 		return NULL;
 
 	VEC_INC_BACK(&tx->actions);
@@ -212,6 +558,225 @@ tx_action_remove(struct tx *tx)
 	VEC_POP_BACK(&tx->actions);
 }
 
+/*
+ * tx_redo_range_free -- (internal) frees the buffered contents of a range
+ */
+static void
+tx_redo_range_free(void *data, void *ctx)
+{
+	struct tx_redo_range *r = data;
+	Free(r->data);
+}
+
+/*
+ * tx_redo_clear -- (internal) discards the write set of the transaction
+ */
+static void
+tx_redo_clear(struct tx *tx)
+{
+	if (tx->redo_set == NULL)
+		return;
+
+	ravl_delete_cb(tx->redo_set, tx_redo_range_free, NULL);
+	tx->redo_set = NULL;
+	tx->redo_nwords = 0;
+	tx->redo_nranges = 0;
+}
+
+/*
+ * tx_redo_insert -- (internal) inserts a copy of the buffered contents of
+ *	a range into the write set
+ */
+static int
+tx_redo_insert(struct tx *tx, uint64_t offset, uint64_t size,
+	const uint8_t *src)
+{
+	struct tx_redo_range r = {offset, size, Malloc(size)};
+	if (r.data == NULL) {
+		ERR("!Malloc");
+		return -1;
+	}
+
+	memcpy(r.data, src, size);
+
+	if (ravl_emplace_copy(tx->redo_set, &r) != 0) {
+		Free(r.data);
+		return -1;
+	}
+
+	tx->redo_nwords += size / sizeof(uint64_t);
+	tx->redo_nranges++;
+
+	return 0;
+}
+
+/*
+ * tx_redo_add -- (internal) adds a range to the write set of the transaction,
+ *	merging it with the overlapping and adjacent ranges
+ */
+static int
+tx_redo_add(struct tx *tx, const struct tx_range_def *args)
+{
+	uint64_t begin = ALIGN_DOWN(args->offset, sizeof(uint64_t));
+	uint64_t end = ALIGN_UP(args->offset + args->size, sizeof(uint64_t));
+	if (begin == end)
+		return 0;
+
+	struct tx_redo_range search = {end, 0, NULL};
+	struct ravl_node *n = ravl_find(tx->redo_set, &search,
+		RAVL_PREDICATE_LESS_EQUAL);
+	struct tx_redo_range *f = n ? ravl_data(n) : NULL;
+
+	/* the common case of a range that is already in the write set */
+	if (f != NULL && f->offset <= begin && f->offset + f->size >= end)
+		return 0;
+
+	/* find the boundaries of the merged range */
+	uint64_t mbegin = begin;
+	uint64_t mend = end;
+	uint64_t merged = 0;
+	while (f != NULL && f->offset + f->size >= mbegin) {
+		mbegin = MIN(mbegin, f->offset);
+		mend = MAX(mend, f->offset + f->size);
+		merged += f->size;
+
+		search.offset = f->offset;
+		n = ravl_find(tx->redo_set, &search, RAVL_PREDICATE_LESS);
+		f = n ? ravl_data(n) : NULL;
+	}
+
+	size_t nwords = (mend - mbegin - merged) / sizeof(uint64_t);
+	if (tx_log_reserve(tx, 0, nwords, 1) != 0)
+		return -1;
+
+	uint8_t *data = Malloc(mend - mbegin);
+	if (data == NULL) {
+		ERR("!Malloc");
+		return -1;
+	}
+
+	/* the parts not yet in the write set are read from the pool */
+	memcpy(data, (char *)tx->pop + mbegin, mend - mbegin);
+
+	search.offset = end;
+	while ((n = ravl_find(tx->redo_set, &search,
+			RAVL_PREDICATE_LESS_EQUAL)) != NULL) {
+		f = ravl_data(n);
+		if (f->offset + f->size < mbegin)
+			break;
+
+		memcpy(data + (f->offset - mbegin), f->data, f->size);
+		tx->redo_nwords -= f->size / sizeof(uint64_t);
+		tx->redo_nranges--;
+		Free(f->data);
+		ravl_remove(tx->redo_set, n);
+	}
+
+	struct tx_redo_range r = {mbegin, mend - mbegin, data};
+	if (ravl_emplace_copy(tx->redo_set, &r) != 0) {
+		Free(data);
+		return -1;
+	}
+
+	tx->redo_nwords += r.size / sizeof(uint64_t);
+	tx->redo_nranges++;
+
+	if (tx->stats.enabled)
+		tx->stats.nbytes += mend - mbegin - merged;
+
+	return 0;
+}
+
+/*
+ * tx_redo_remove -- (internal) removes a range from the write set of the
+ *	transaction, the ranges that cross its boundaries are trimmed
+ */
+static int
+tx_redo_remove(struct tx *tx, uint64_t offset, uint64_t size)
+{
+	uint64_t begin = ALIGN_UP(offset, sizeof(uint64_t));
+	uint64_t end = ALIGN_DOWN(offset + size, sizeof(uint64_t));
+
+	int ret = 0;
+	struct tx_redo_range search = {end, 0, NULL};
+	struct ravl_node *n;
+	while (begin < end && (n = ravl_find(tx->redo_set, &search,
+			RAVL_PREDICATE_LESS)) != NULL) {
+		struct tx_redo_range f = *(struct tx_redo_range *)ravl_data(n);
+		uint64_t fend = f.offset + f.size;
+		if (fend <= begin)
+			break;
+
+		ravl_remove(tx->redo_set, n);
+		tx->redo_nwords -= f.size / sizeof(uint64_t);
+		tx->redo_nranges--;
+
+		if (f.offset < begin && tx_redo_insert(tx, f.offset,
+				begin - f.offset, f.data) != 0)
+			ret = -1;
+
+		if (fend > end && tx_redo_insert(tx, end, fend - end,
+				f.data + (end - f.offset)) != 0)
+			ret = -1;
+
+		Free(f.data);
+	}
+
+	return ret;
+}
+
+/*
+ * tx_redo_ptr -- (internal) returns the buffered contents of the range if
+ *	it's entirely contained in the write set, the range itself otherwise
+ */
+static void *
+tx_redo_ptr(struct tx *tx, void *ptr, size_t size)
+{
+	if (tx->redo_set == NULL || !OBJ_PTR_FROM_POOL(tx->pop, ptr))
+		return ptr;
+
+	uint64_t offset = (uint64_t)((char *)ptr - (char *)tx->pop);
+
+	struct tx_redo_range search = {offset, 0, NULL};
+	struct ravl_node *n = ravl_find(tx->redo_set, &search,
+		RAVL_PREDICATE_LESS_EQUAL);
+	if (n == NULL)
+		return ptr;
+
+	struct tx_redo_range *f = ravl_data(n);
+	if (offset + size > f->offset + f->size)
+		return ptr;
+
+	return f->data + (offset - f->offset);
+}
+
+/*
+ * tx_redo_log -- (internal) adds the write set of the transaction to the
+ *	external redo log, one buffer entry per range
+ */
+static int
+tx_redo_log(struct tx *tx)
+{
+	struct operation_context *ctx = tx->lane->external;
+
+	struct tx_redo_range search = {0, 0, NULL};
+	enum ravl_predicate p = RAVL_PREDICATE_GREATER_EQUAL;
+	struct ravl_node *n;
+	while ((n = ravl_find(tx->redo_set, &search, p)) != NULL) {
+		struct tx_redo_range *f = ravl_data(n);
+
+		if (operation_add_buffer(ctx,
+				OBJ_OFF_TO_PTR(tx->pop, f->offset), f->data,
+				f->size, ULOG_OPERATION_BUF_CPY) != 0)
+			return -1;
+
+		search.offset = f->offset;
+		p = RAVL_PREDICATE_GREATER;
+	}
+
+	return 0;
+}
+
 /*
  * constructor_tx_alloc -- (internal) constructor for normal alloc
  */
@@ -228,9 +793,6 @@ constructor_tx_alloc(void *ctx, void *ptr, size_t usable_size, void *arg)
 	/* do not report changes to the new object */
 	VALGRIND_ADD_TO_TX(ptr, usable_size);
 
-	if (args->flags & POBJ_FLAG_ZERO)
-		memset(ptr, 0, usable_size);
-
 	if (args->copy_ptr && args->copy_size != 0) {
 		memcpy(ptr, args->copy_ptr, args->copy_size);
 	}
@@ -309,6 +871,7 @@ tx_restore_range(PMEMobjpool *pop, struct tx *tx, struct ulog_entry_buf *range)
 	COMPILE_ERROR_ON(sizeof(PMEMmutex) != _POBJ_CL_SIZE);
 	COMPILE_ERROR_ON(sizeof(PMEMrwlock) != _POBJ_CL_SIZE);
 	COMPILE_ERROR_ON(sizeof(PMEMcond) != _POBJ_CL_SIZE);
+	COMPILE_ERROR_ON(sizeof(PMEMseqlock) != _POBJ_CL_SIZE);
 
 	struct txr tx_ranges;
 	SLIST_INIT(&tx_ranges);
@@ -349,7 +912,11 @@ tx_restore_range(PMEMobjpool *pop, struct tx *tx, struct ulog_entry_buf *range)
 				(char *)txr->begin - (char *)dst_ptr];
 		ASSERT((char *)txr->end >= (char *)txr->begin);
 		size_t size = (size_t)((char *)txr->end - (char *)txr->begin);
-		pmemops_memcpy(&pop->p_ops, txr->begin, src, size, 0);
+		if (ulog_entry_type(&range->base) == ULOG_OPERATION_BUF_SET)
+			pmemops_memset(&pop->p_ops, txr->begin, range->data[0],
+				size, 0);
+		else
+			pmemops_memcpy(&pop->p_ops, txr->begin, src, size, 0);
 		Free(txr);
 	}
 }
@@ -365,6 +932,7 @@ tx_undo_entry_apply(struct ulog_entry_base *e, void *arg,
 
 	switch (ulog_entry_type(e)) {
 		case ULOG_OPERATION_BUF_CPY:
+		case ULOG_OPERATION_BUF_SET:
 			eb = (struct ulog_entry_buf *)e;
 
 			tx_restore_range(p_ops->base, get_tx(), eb);
@@ -372,7 +940,7 @@ tx_undo_entry_apply(struct ulog_entry_base *e, void *arg,
 		case ULOG_OPERATION_AND:
 		case ULOG_OPERATION_OR:
 		case ULOG_OPERATION_SET:
-		case ULOG_OPERATION_BUF_SET:
+		case ULOG_OPERATION_SET_RUN:
 		default:
 			ASSERT(0);
 	}
@@ -397,31 +965,131 @@ tx_abort_set(PMEMobjpool *pop, struct lane *lane)
  * tx_flush_range -- (internal) flush one range
  */
 static void
-tx_flush_range(void *data, void *ctx)
+tx_flush_range(const struct tx_range_def *range, void *ctx)
 {
 	PMEMobjpool *pop = ctx;
-	struct tx_range_def *range = data;
 	if (!(range->flags & POBJ_FLAG_NO_FLUSH)) {
 		pmemops_xflush(&pop->p_ops, OBJ_OFF_TO_PTR(pop, range->offset),
 				range->size, PMEMOBJ_F_RELAXED);
 	}
+}
+
+/*
+ * tx_untrack_range -- (internal) stop tracking one range
+ */
+static void
+tx_untrack_range(const struct tx_range_def *range, void *ctx)
+{
+	PMEMobjpool *pop = ctx;
 	VALGRIND_REMOVE_FROM_TX(OBJ_OFF_TO_PTR(pop, range->offset),
 		range->size);
 }
 
+/*
+ * tx_commit_range -- (internal) flush one range and stop tracking it
+ */
+static void
+tx_commit_range(const struct tx_range_def *range, void *ctx)
+{
+	tx_flush_range(range, ctx);
+	tx_untrack_range(range, ctx);
+}
+
 /*
  * tx_clean_range -- (internal) clean one range
  */
 static void
-tx_clean_range(void *data, void *ctx)
+tx_clean_range(const struct tx_range_def *range, void *ctx)
 {
 	PMEMobjpool *pop = ctx;
-	struct tx_range_def *range = data;
 	VALGRIND_REMOVE_FROM_TX(OBJ_OFF_TO_PTR(pop, range->offset),
 		range->size);
 	VALGRIND_SET_CLEAN(OBJ_OFF_TO_PTR(pop, range->offset), range->size);
 }
 
+/*
+ * tx_group_lead -- (internal) collects the pending group of transactions,
+ *	flushes all their ranges and makes them durable with a single drain
+ *
+ * Called and returns with the group commit lock held.
+ */
+static void
+tx_group_lead(PMEMobjpool *pop, struct tx_group_commit *gc)
+{
+	struct timespec deadline;
+	os_clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_nsec += (long)gc->window * 1000;
+	deadline.tv_sec += deadline.tv_nsec / 1000000000;
+	deadline.tv_nsec %= 1000000000;
+
+	while (VEC_SIZE(&gc->pending) < gc->batch) {
+		if (os_cond_timedwait(&gc->full, &gc->lock, &deadline) != 0)
+			break;
+	}
+
+	struct tx_group group = gc->flushing;
+	gc->flushing = gc->pending;
+	gc->pending = group;
+	uint64_t gen = gc->gen++;
+
+	util_mutex_unlock(&gc->lock);
+
+	/*
+	 * The stores of all the transactions in the group happened before
+	 * they were added to the group under the lock, so flushing their
+	 * ranges here and draining once makes all of them durable.
+	 */
+	struct tx_ranges *ranges;
+	VEC_FOREACH(ranges, &gc->flushing)
+		tx_ranges_foreach(ranges, tx_flush_range, pop);
+
+	pmemops_drain(&pop->p_ops);
+
+	VEC_CLEAR(&gc->flushing);
+
+	util_mutex_lock(&gc->lock);
+
+	gc->durable = gen;
+	gc->leader = 0;
+	os_cond_broadcast(&gc->done);
+}
+
+/*
+ * tx_group_commit -- (internal) joins the pending group of transactions and
+ *	waits until the group is durable, leading it if there's no leader
+ */
+static void
+tx_group_commit(PMEMobjpool *pop, struct tx_group_commit *gc,
+	struct tx_ranges *ranges)
+{
+	util_mutex_lock(&gc->lock);
+
+	if (VEC_PUSH_BACK(&gc->pending, ranges) != 0) {
+		util_mutex_unlock(&gc->lock);
+
+		/* not enough memory to join the group, commit alone */
+		tx_ranges_foreach(ranges, tx_flush_range, pop);
+		pmemops_drain(&pop->p_ops);
+		return;
+	}
+
+	uint64_t gen = gc->gen;
+
+	if (VEC_SIZE(&gc->pending) >= gc->batch)
+		os_cond_signal(&gc->full);
+
+	while (gc->durable < gen) {
+		if (gc->leader) {
+			os_cond_wait(&gc->done, &gc->lock);
+		} else {
+			gc->leader = 1;
+			tx_group_lead(pop, gc);
+		}
+	}
+
+	util_mutex_unlock(&gc->lock);
+}
+
 /*
  * tx_pre_commit -- (internal) do pre-commit operations
  */
@@ -430,11 +1098,27 @@ tx_pre_commit(struct tx *tx)
 {
 	LOG(5, NULL);
 
-	/* Flush all regions and destroy the whole tree. */
-	ravl_delete_cb(tx->ranges, tx_flush_range, tx->pop);
-	tx->ranges = NULL;
-}
+	PMEMobjpool *pop = tx->pop;
+	struct tx_group_commit *gc = pop->tx_params->group_commit;
+
+	unsigned batch;
+	util_atomic_load_explicit32(&gc->batch, &batch,
+		memory_order_relaxed);
+
+	if (batch > 1) {
+		/* the ranges are flushed and drained by the group leader */
+		tx_stats_stage(tx, STATS_TX_PRE_COMMIT);
+		tx_group_commit(pop, gc, &tx->ranges);
+		tx_ranges_clear(&tx->ranges, tx_untrack_range, pop);
+	} else {
+		/* Flush all regions and clear the whole set. */
+		tx_ranges_clear(&tx->ranges, tx_commit_range, pop);
+		tx_stats_stage(tx, STATS_TX_PRE_COMMIT);
+		pmemops_drain(&pop->p_ops);
+	}
 
+	tx_stats_stage(tx, STATS_TX_DRAIN);
+}
 
 /*
  * tx_abort -- (internal) abort all allocated objects
@@ -448,11 +1132,12 @@ tx_abort(PMEMobjpool *pop, struct lane *lane)
 
 	tx_abort_set(pop, lane);
 
-	ravl_delete_cb(tx->ranges, tx_clean_range, pop);
+	tx_redo_clear(tx);
+	tx_ranges_clear(&tx->ranges, tx_clean_range, pop);
 	palloc_cancel(&pop->heap,
 		VEC_ARR(&tx->actions), VEC_SIZE(&tx->actions));
 	VEC_CLEAR(&tx->actions);
-	tx->ranges = NULL;
+	VEC_CLEAR(&tx->cows);
 }
 
 /*
@@ -505,6 +1190,15 @@ add_to_tx_and_lock(struct tx *tx, enum pobj_tx_param type, void *lock)
 				ERR("!pmemobj_rwlock_wrlock");
 			}
 			break;
+		case TX_PARAM_SEQLOCK:
+			txl->lock.seqlock = lock;
+			retval = pmemobj_seqlock_wrlock(tx->pop,
+				txl->lock.seqlock);
+			if (retval) {
+				errno = retval;
+				ERR("!pmemobj_seqlock_wrlock");
+			}
+			break;
 		default:
 			ERR("Unrecognized lock type");
 			ASSERT(0);
@@ -537,6 +1231,10 @@ release_and_free_tx_locks(struct tx *tx)
 				pmemobj_rwlock_unlock(tx->pop,
 					tx_lock->lock.rwlock);
 				break;
+			case TX_PARAM_SEQLOCK:
+				pmemobj_seqlock_unlock(tx->pop,
+					tx_lock->lock.seqlock);
+				break;
 			default:
 				ERR("Unrecognized lock type");
 				ASSERT(0);
@@ -547,8 +1245,8 @@ release_and_free_tx_locks(struct tx *tx)
 }
 
 /*
- * tx_lane_ranges_insert_def -- (internal) allocates and inserts a new range
- *	definition into the ranges tree
+ * tx_lane_ranges_insert_def -- (internal) inserts a new range definition
+ *	into the ranges set
  */
 static int
 tx_lane_ranges_insert_def(PMEMobjpool *pop, struct tx *tx,
@@ -557,12 +1255,8 @@ tx_lane_ranges_insert_def(PMEMobjpool *pop, struct tx *tx,
 	LOG(3, "rdef->offset %"PRIu64" rdef->size %"PRIu64,
 		rdef->offset, rdef->size);
 
-	int ret = ravl_emplace_copy(tx->ranges, rdef);
-	if (ret == EEXIST)
-		FATAL("invalid state of ranges tree");
-
-	return ret;
-}
+	return tx_ranges_add(&tx->ranges, rdef, NULL, NULL);
+}
 
 /*
  * tx_alloc_common -- (internal) common function for alloc and zalloc
@@ -584,8 +1278,9 @@ tx_alloc_common(struct tx *tx, size_t size, type_num_t type_num,
 	if (action == NULL)
 		return obj_tx_abort_null(ENOMEM);
 
+	/* the object is flushed on commit along with the rest of the ranges */
 	if (palloc_reserve(&pop->heap, size, constructor, &args, type_num, 0,
-		CLASS_ID_FROM_FLAG(args.flags), action) != 0)
+		args.flags | POBJ_FLAG_NO_FLUSH, action) != 0)
 		goto err_oom;
 
 	/* allocate object to undo log */
@@ -594,7 +1289,9 @@ tx_alloc_common(struct tx *tx, size_t size, type_num_t type_num,
 	retoid.pool_uuid_lo = pop->uuid_lo;
 	size = palloc_usable_size(&pop->heap, retoid.off);
 
-	const struct tx_range_def r = {retoid.off, size, args.flags};
+	/* new objects are kept separate so that they can be freed */
+	const struct tx_range_def r = {retoid.off, size,
+		(args.flags & POBJ_XALLOC_NO_FLUSH) | TX_RANGE_NO_MERGE};
 	if (tx_lane_ranges_insert_def(pop, tx, &r) != 0)
 		goto err_oom;
 
@@ -659,6 +1356,30 @@ tx_realloc_common(struct tx *tx, PMEMoid oid, size_t size, uint64_t type_num,
 	return new_obj;
 }
 
+/*
+ * tx_redo_begin -- (internal) turns the transaction into a redo-only one
+ */
+static int
+tx_redo_begin(struct tx *tx, struct tx_data *txd)
+{
+	if (tx->redo_set != NULL)
+		return 0;
+
+	if (SLIST_NEXT(txd, tx_entry) != NULL) {
+		ERR("redo-only transaction nested in an undo transaction");
+		return EINVAL;
+	}
+
+	tx->redo_set = ravl_new_sized(tx_redo_range_cmp,
+		sizeof(struct tx_redo_range));
+	if (tx->redo_set == NULL) {
+		ERR("!ravl_new_sized");
+		return ENOMEM;
+	}
+
+	return 0;
+}
+
 /*
  * pmemobj_tx_begin -- initializes new transaction
  */
@@ -685,15 +1406,22 @@ pmemobj_tx_begin(PMEMobjpool *pop, jmp_buf env, ...)
 		operation_start(tx->lane->undo);
 
 		VEC_INIT(&tx->actions);
+		VEC_INIT(&tx->cows);
 		SLIST_INIT(&tx->tx_entries);
 		SLIST_INIT(&tx->tx_locks);
 
-		tx->ranges = ravl_new_sized(tx_range_def_cmp,
-			sizeof(struct tx_range_def));
+		tx_ranges_init(&tx->ranges);
 
 		tx->pop = pop;
 
+		tx->redo_set = NULL;
+		tx->redo_nwords = 0;
+		tx->redo_nranges = 0;
+		tx->redo_nbytes = 0;
+		tx->relaxed = 0;
 		tx->first_snapshot = 1;
+
+		tx_stats_start(tx);
 	} else {
 		FATAL("Invalid stage %d to begin new transaction", tx->stage);
 	}
@@ -738,6 +1466,21 @@ pmemobj_tx_begin(PMEMobjpool *pop, jmp_buf env, ...)
 
 			tx->stage_callback = cb;
 			tx->stage_callback_arg = arg;
+		} else if (param_type == TX_PARAM_REDO) {
+			err = tx_redo_begin(tx, txd);
+			if (err) {
+				va_end(argp);
+				goto err_abort;
+			}
+		} else if (param_type == TX_PARAM_RELAXED_DURABILITY) {
+			if (SLIST_NEXT(txd, tx_entry) != NULL && !tx->relaxed) {
+				ERR("relaxed durability transaction nested in "
+					"a durable transaction");
+				err = EINVAL;
+				va_end(argp);
+				goto err_abort;
+			}
+			tx->relaxed = 1;
 		} else {
 			err = add_to_tx_and_lock(tx, param_type,
 				va_arg(argp, void *));
@@ -826,6 +1569,9 @@ obj_tx_abort(int errnum, int user)
 		/* process the undo log */
 		tx_abort(tx->pop, tx->lane);
 
+		tx_stats_logs(tx);
+		tx_stats_end(tx, 0);
+
 		lane_release(tx->pop);
 		tx->lane = NULL;
 	}
@@ -866,12 +1612,391 @@ pmemobj_tx_errno(void)
 	return get_tx()->last_errnum;
 }
 
+/*
+ * tx_lane_finish -- (internal) clobbers the undo log of the lane of
+ *	a committed transaction and frees the log extensions it no longer needs
+ */
+static void
+tx_lane_finish(struct lane *lane)
+{
+	operation_finish(lane->undo);
+	operation_free_logs(lane->external);
+}
+
+/*
+ * tx_postcommit_cleanup -- (internal) clobbers the undo log of a lane detached
+ *	by a committed transaction and releases the lane
+ */
+static void
+tx_postcommit_cleanup(PMEMobjpool *pop, unsigned lane_idx)
+{
+	struct lane *lane = lane_get(&pop->lanes_desc, lane_idx);
+
+	lane_attach(pop, lane_idx);
+
+	tx_lane_finish(lane);
+
+	lane_release(pop);
+}
+
+/*
+ * tx_postcommit_enqueue -- (internal) hands the lane of the committed
+ *	transaction off to the post commit workers, returns 0 on success
+ */
+static int
+tx_postcommit_enqueue(PMEMobjpool *pop)
+{
+	struct tx_postcommit *pc = pop->tx_params->postcommit;
+	int ret = -1;
+
+	if (pc->depth == 0)
+		return ret;
+
+	util_mutex_lock(&pc->lock);
+
+	if (pc->nworkers != 0 && !pc->stop &&
+			VECQ_SIZE(&pc->tasks) < pc->depth) {
+		unsigned lane_idx = lane_detach(pop);
+		ret = VECQ_ENQUEUE(&pc->tasks, lane_idx);
+		if (ret == 0)
+			os_cond_signal(&pc->cond);
+		else
+			lane_attach(pop, lane_idx);
+	}
+
+	util_mutex_unlock(&pc->lock);
+
+	return ret;
+}
+
+/*
+ * tx_post_commit -- (internal) performs the cleanup of the committed
+ *	transaction and releases its lane, either directly or in the background
+ */
 static void
 tx_post_commit(struct tx *tx)
 {
-	operation_finish(tx->lane->undo);
+	PMEMobjpool *pop = tx->pop;
+
+	VEC_CLEAR(&tx->actions);
+	VEC_CLEAR(&tx->cows);
+
+	if (tx_postcommit_enqueue(pop) != 0) {
+		tx_lane_finish(tx->lane);
+		lane_release(pop);
+	}
+
+	tx->lane = NULL;
+}
+
+/*
+ * tx_postcommit_stop -- stops all the post commit workers of the pool,
+ *	the tasks that are still queued are processed before the workers exit
+ */
+void
+tx_postcommit_stop(PMEMobjpool *pop)
+{
+	struct tx_postcommit *pc = pop->tx_params->postcommit;
+
+	util_mutex_lock(&pc->lock);
+
+	pc->stop = 1;
+	os_cond_broadcast(&pc->cond);
+	while (pc->nworkers != 0)
+		os_cond_wait(&pc->idle, &pc->lock);
+	pc->stop = 0;
+
+	util_mutex_unlock(&pc->lock);
+}
+
+/*
+ * tx_epoch_boot -- initializes the relaxed durability epochs after the pool
+ *	recovery, which leaves no pending epochs behind
+ */
+int
+tx_epoch_boot(PMEMobjpool *pop)
+{
+	struct tx_epoch *ep = pop->tx_params->epoch;
+
+	ep->last = pop->tx_epoch_durable;
+	ep->durable = pop->tx_epoch_durable;
+
+	/*
+	 * Every pending epoch holds a lane, the limit leaves the other half
+	 * of them for the transactions in progress.
+	 */
+	size_t nlanes = pop->lanes_desc.runtime_nlanes;
+	ep->max_pending = nlanes / 2;
+
+	if (VEC_RESERVE(&ep->pending, nlanes) != 0 ||
+	    VEC_RESERVE(&ep->batch, nlanes) != 0)
+		return ENOMEM;
+
+	return 0;
+}
+
+/*
+ * tx_epoch_resize -- adjusts the relaxed durability epochs to the new number
+ *	of lanes available at runtime
+ *
+ * The lanes above the new limit can still be held by the transactions in
+ * progress, so the capacity of the queues is never reduced.
+ */
+int
+tx_epoch_resize(PMEMobjpool *pop, unsigned nlanes)
+{
+	struct tx_epoch *ep = pop->tx_params->epoch;
+	int ret = 0;
+
+	util_mutex_lock(&ep->lock);
+
+	/* the batch is used without the lock while syncing */
+	while (ep->syncing)
+		os_cond_wait(&ep->cond, &ep->lock);
+
+	if (nlanes > ep->pending.capacity &&
+	    (VEC_RESERVE(&ep->pending, nlanes) != 0 ||
+	    VEC_RESERVE(&ep->batch, nlanes) != 0)) {
+		errno = ENOMEM;
+		ret = -1;
+	} else {
+		ep->max_pending = nlanes / 2;
+	}
+
+	util_mutex_unlock(&ep->lock);
+
+	return ret;
+}
+
+/*
+ * tx_epoch_lane_cmp -- (internal) orders the pending lanes by their epochs
+ */
+static int
+tx_epoch_lane_cmp(const void *lhs, const void *rhs)
+{
+	const struct tx_epoch_lane *l = lhs;
+	const struct tx_epoch_lane *r = rhs;
+
+	if (l->epoch < r->epoch)
+		return -1;
+	if (l->epoch > r->epoch)
+		return 1;
+	return 0;
+}
+
+/*
+ * tx_epoch_collect -- (internal) moves the pending lanes of the consecutive
+ *	epochs that follow the last durable one to the batch, returns their
+ *	number
+ *
+ * The epochs are assigned before the lanes are queued, so the queue might
+ * miss a lane of an epoch that precedes the ones already in it.
+ */
+static size_t
+tx_epoch_collect(struct tx_epoch *ep)
+{
+	struct tx_epoch_lane *lanes = VEC_ARR(&ep->pending);
+	size_t nlanes = VEC_SIZE(&ep->pending);
+
+	qsort(lanes, nlanes, sizeof(*lanes), tx_epoch_lane_cmp);
+
+	size_t n = 0;
+	while (n < nlanes && lanes[n].epoch == ep->durable + n + 1) {
+		VEC_PUSH_BACK(&ep->batch, lanes[n]);
+		n++;
+	}
+
+	memmove(lanes, lanes + n, (nlanes - n) * sizeof(*lanes));
+	ep->pending.size -= n;
+
+	return n;
+}
+
+/*
+ * tx_epoch_persist -- (internal) makes the epochs of the collected lanes
+ *	durable and releases the lanes
+ *
+ * The data of the transactions is already durable, only their undo logs are
+ * left intact. Once the durable epoch is persisted the logs are no longer
+ * rolled back by the recovery.
+ */
+static void
+tx_epoch_persist(PMEMobjpool *pop, struct tx_epoch *ep)
+{
+	uint64_t durable = VEC_BACK(&ep->batch).epoch;
+
+	pop->tx_epoch_durable = durable;
+	pmemops_persist(&pop->p_ops, &pop->tx_epoch_durable,
+		sizeof(pop->tx_epoch_durable));
+
+	struct tx_epoch_lane *l;
+	VEC_FOREACH_BY_PTR(l, &ep->batch) {
+		struct lane *lane = lane_get(&pop->lanes_desc, l->lane_idx);
+		tx_lane_finish(lane);
+	}
+
+	/*
+	 * The tags can be removed only once the logs are clobbered, otherwise
+	 * the logs of durable transactions would be rolled back.
+	 */
+	VEC_FOREACH_BY_PTR(l, &ep->batch) {
+		struct lane *lane = lane_get(&pop->lanes_desc, l->lane_idx);
+		ulog_epoch_set((struct ulog *)&lane->layout->undo, 0,
+			&pop->p_ops);
+	}
+	pmemops_drain(&pop->p_ops);
+
+	VEC_FOREACH_BY_PTR(l, &ep->batch)
+		lane_release_detached(pop, l->lane_idx);
+
+	VEC_CLEAR(&ep->batch);
+}
+
+/*
+ * tx_epoch_advance -- (internal) makes the consecutive pending epochs
+ *	durable, returns 0 if there were none
+ *
+ * Called and returns with the epoch lock held.
+ */
+static int
+tx_epoch_advance(PMEMobjpool *pop, struct tx_epoch *ep)
+{
+	if (ep->syncing || tx_epoch_collect(ep) == 0)
+		return 0;
+
+	ep->syncing = 1;
+	util_mutex_unlock(&ep->lock);
+
+	tx_epoch_persist(pop, ep);
+
+	util_mutex_lock(&ep->lock);
+	util_atomic_store_explicit64(&ep->durable, pop->tx_epoch_durable,
+		memory_order_release);
+	ep->syncing = 0;
+	os_cond_broadcast(&ep->cond);
+
+	return 1;
+}
+
+/*
+ * tx_epoch_sync -- (internal) waits until all the epochs up to the given one
+ *	are durable
+ */
+static void
+tx_epoch_sync(PMEMobjpool *pop, uint64_t epoch)
+{
+	struct tx_epoch *ep = pop->tx_params->epoch;
+
+	util_mutex_lock(&ep->lock);
+	while (ep->durable < epoch) {
+		if (!tx_epoch_advance(pop, ep))
+			os_cond_wait(&ep->cond, &ep->lock);
+	}
+	util_mutex_unlock(&ep->lock);
+}
+
+/*
+ * tx_epoch_sync_all -- waits until all the committed relaxed
+ *	transactions are durable
+ */
+void
+tx_epoch_sync_all(PMEMobjpool *pop)
+{
+	struct tx_epoch *ep = pop->tx_params->epoch;
+
+	uint64_t last;
+	util_atomic_load_explicit64(&ep->last, &last, memory_order_acquire);
+	uint64_t durable;
+	util_atomic_load_explicit64(&ep->durable, &durable,
+		memory_order_acquire);
+
+	if (durable < last)
+		tx_epoch_sync(pop, last);
+}
+
+/*
+ * tx_epoch_can_commit -- (internal) checks whether the transaction can be
+ *	committed without waiting for durability
+ *
+ * Allocations and frees are published by the redo log, which is durable
+ * right away, so only transactions that merely snapshot and modify
+ * existing data qualify.
+ */
+static int
+tx_epoch_can_commit(struct tx *tx)
+{
+	if (!tx->relaxed || tx->redo_set != NULL)
+		return 0;
+
+	/* the first snapshot adds an action that invalidates the undo log */
+	size_t nactions = tx->first_snapshot ? 0 : 1;
+
+	return VEC_SIZE(&tx->actions) == nactions;
+}
+
+/*
+ * tx_epoch_commit -- (internal) commits a relaxed transaction
+ *
+ * The data is flushed and the undo log is tagged with a new epoch, which
+ * takes a single drain. The lane is then held, with the log intact, until
+ * the epoch becomes durable.
+ */
+static void
+tx_epoch_commit(struct tx *tx)
+{
+	PMEMobjpool *pop = tx->pop;
+	struct tx_epoch *ep = pop->tx_params->epoch;
+
+	tx_ranges_clear(&tx->ranges, tx_commit_range, pop);
 
+	/* the undo log is invalidated once the epoch is durable instead */
 	VEC_CLEAR(&tx->actions);
+
+	struct tx_epoch_lane l;
+	l.epoch = util_fetch_and_add64(&ep->last, 1) + 1;
+
+	ulog_epoch_set((struct ulog *)&tx->lane->layout->undo, l.epoch,
+		&pop->p_ops);
+	pmemops_drain(&pop->p_ops);
+
+	l.lane_idx = lane_detach(pop);
+	tx->lane = NULL;
+
+	util_mutex_lock(&ep->lock);
+
+	/* the capacity covers all the lanes, this never fails */
+	int ret = VEC_PUSH_BACK(&ep->pending, l);
+	ASSERTeq(ret, 0);
+	os_cond_broadcast(&ep->cond);
+
+	int full = VEC_SIZE(&ep->pending) > ep->max_pending;
+
+	util_mutex_unlock(&ep->lock);
+
+	if (full)
+		tx_epoch_sync(pop, l.epoch);
+}
+
+/*
+ * tx_epoch_stop -- stops all the epoch workers of the pool and makes all the
+ *	committed relaxed transactions durable
+ */
+void
+tx_epoch_stop(PMEMobjpool *pop)
+{
+	struct tx_epoch *ep = pop->tx_params->epoch;
+
+	util_mutex_lock(&ep->lock);
+
+	ep->stop = 1;
+	os_cond_broadcast(&ep->wake);
+	while (ep->nworkers != 0)
+		os_cond_wait(&ep->cond, &ep->lock);
+	ep->stop = 0;
+
+	util_mutex_unlock(&ep->lock);
+
+	tx_epoch_sync_all(pop);
 }
 
 /*
@@ -900,20 +2025,45 @@ pmemobj_tx_commit(void)
 
 		PMEMobjpool *pop = tx->pop;
 
-		/* pre-commit phase */
-		tx_pre_commit(tx);
+		tx_stats_stage(tx, STATS_TX_WORK);
 
-		pmemops_drain(&pop->p_ops);
+		if (tx_epoch_can_commit(tx)) {
+			tx_stats_logs(tx);
+			tx_epoch_commit(tx);
+			tx_stats_stage(tx, STATS_TX_PRE_COMMIT);
+		} else {
+			/*
+			 * A durable commit must not overtake the relaxed
+			 * transactions it might depend on.
+			 */
+			tx_epoch_sync_all(pop);
+
+			operation_start(tx->lane->external);
+
+			if (tx->redo_set != NULL) {
+				if (tx_redo_log(tx) != 0) {
+					operation_cancel(tx->lane->external);
+					ERR("out of memory");
+					obj_tx_abort(ENOMEM, 0);
+					PMEMOBJ_API_END();
+					return;
+				}
+				tx_redo_clear(tx);
+			}
 
-		operation_start(tx->lane->external);
-		palloc_publish(&pop->heap, VEC_ARR(&tx->actions),
-			VEC_SIZE(&tx->actions), tx->lane->external);
+			/* pre-commit phase */
+			tx_pre_commit(tx);
 
-		tx_post_commit(tx);
+			palloc_publish(&pop->heap, VEC_ARR(&tx->actions),
+				VEC_SIZE(&tx->actions), tx->lane->external);
+			tx_stats_stage(tx, STATS_TX_PUBLISH);
+			tx_stats_logs(tx);
 
-		lane_release(pop);
+			tx_post_commit(tx);
+			tx_stats_stage(tx, STATS_TX_POST_COMMIT);
+		}
 
-		tx->lane = NULL;
+		tx_stats_end(tx, 1);
 	}
 
 	tx->stage = TX_STAGE_ONCOMMIT;
@@ -960,6 +2110,7 @@ pmemobj_tx_end(void)
 		tx->pop = NULL;
 		tx->stage = TX_STAGE_NONE;
 		VEC_DELETE(&tx->actions);
+		VEC_DELETE(&tx->cows);
 
 		if (tx->stage_callback) {
 			pmemobj_tx_callback cb = tx->stage_callback;
@@ -1045,17 +2196,88 @@ vg_verify_initialized(PMEMobjpool *pop, const struct tx_range_def *def)
 #endif
 }
 
+/*
+ * Shortest run of zeroed cachelines that is logged as a set entry, a shorter
+ * one would not make up for the split of the surrounding buffer entry.
+ */
+#define TX_ZERO_RUN_MIN (4 * CACHELINE_SIZE)
+
+/*
+ * tx_undo_log_range -- (internal) logs the old contents of the range in the
+ *	undo log, runs of zeroed cachelines are logged as set entries, which
+ *	only take up a single cacheline in the log
+ */
+static int
+tx_undo_log_range(struct tx *tx, void *ptr, size_t size)
+{
+	struct operation_context *ctx = tx->lane->undo;
+	char *begin = ptr;
+
+	if (size < TX_ZERO_RUN_MIN)
+		return operation_add_buffer(ctx, begin, begin, size,
+			ULOG_OPERATION_BUF_CPY);
+
+	size_t logged = 0; /* length of the already logged part of the range */
+	size_t off = 0;
+	while (off + CACHELINE_SIZE <= size) {
+		size_t zrun = 0;
+		while (off + zrun + CACHELINE_SIZE <= size &&
+		    util_is_zeroed(begin + off + zrun, CACHELINE_SIZE))
+			zrun += CACHELINE_SIZE;
+
+		if (zrun < TX_ZERO_RUN_MIN) {
+			off += zrun + CACHELINE_SIZE;
+			continue;
+		}
+
+		if (off != logged && operation_add_buffer(ctx,
+		    begin + logged, begin + logged, off - logged,
+		    ULOG_OPERATION_BUF_CPY) != 0)
+			return -1;
+
+		if (operation_add_buffer(ctx, begin + off, begin + off, zrun,
+		    ULOG_OPERATION_BUF_SET) != 0)
+			return -1;
+
+		off += zrun;
+		logged = off;
+	}
+
+	if (logged == size)
+		return 0;
+
+	return operation_add_buffer(ctx, begin + logged, begin + logged,
+		size - logged, ULOG_OPERATION_BUF_CPY);
+}
+
 /*
  * pmemobj_tx_add_snapshot -- (internal) creates a variably sized snapshot
  */
 static int
-pmemobj_tx_add_snapshot(struct tx *tx, struct tx_range_def *snapshot)
+pmemobj_tx_add_snapshot(const struct tx_range_def *snapshot, void *arg)
 {
-	vg_verify_initialized(tx->pop, snapshot);
+	struct tx *tx = arg;
+
+	void *ptr = OBJ_OFF_TO_PTR(tx->pop, snapshot->offset);
+
+	/*
+	 * The range is only flushed on commit, its old contents are not
+	 * restored on abort.
+	 */
+	if (snapshot->flags & POBJ_XADD_NO_SNAPSHOT) {
+		VALGRIND_ADD_TO_TX(ptr, snapshot->size);
+		return 0;
+	}
+
+	if (!(snapshot->flags & POBJ_XADD_ASSUME_INITIALIZED))
+		vg_verify_initialized(tx->pop, snapshot);
+
+	if (tx->stats.enabled)
+		tx->stats.nbytes += snapshot->size;
 
 	/*
 	 * If we are creating the first snapshot, setup a redo log action to
-	 * clear the first entry so that the undo log becomes
+	 * bump the generation of the undo log so that it becomes
 	 * invalid once the redo log is processed.
 	 */
 	if (tx->first_snapshot) {
@@ -1063,11 +2285,9 @@ pmemobj_tx_add_snapshot(struct tx *tx, struct tx_range_def *snapshot)
 		if (action == NULL)
 			return -1;
 
-		/* first entry of the first ulog */
-		struct ulog_entry_base *e =
-			(struct ulog_entry_base *)tx->lane->layout->undo.data;
+		struct ulog *undo = (struct ulog *)&tx->lane->layout->undo;
 		palloc_set_value(&tx->pop->heap, action,
-			&e->offset, 0);
+			&undo->gen_num, undo->gen_num + 1);
 
 		tx->first_snapshot = 0;
 	}
@@ -1076,11 +2296,14 @@ pmemobj_tx_add_snapshot(struct tx *tx, struct tx_range_def *snapshot)
 	 * Depending on the size of the block, either allocate an
 	 * entire new object or use cache.
 	 */
-	void *ptr = OBJ_OFF_TO_PTR(tx->pop, snapshot->offset);
 	VALGRIND_ADD_TO_TX(ptr, snapshot->size);
 
-	return operation_add_buffer(tx->lane->undo, ptr, ptr, snapshot->size,
-		ULOG_OPERATION_BUF_CPY);
+	/* the contents of uninitialized memory must not be inspected */
+	if (snapshot->flags & POBJ_XADD_ASSUME_INITIALIZED)
+		return operation_add_buffer(tx->lane->undo, ptr, ptr,
+			snapshot->size, ULOG_OPERATION_BUF_CPY);
+
+	return tx_undo_log_range(tx, ptr, snapshot->size);
 }
 
 /*
@@ -1104,138 +2327,21 @@ pmemobj_tx_add_common(struct tx *tx, struct tx_range_def *args)
 		return obj_tx_abort_err(EINVAL);
 	}
 
-	int ret = 0;
+	if (tx->stats.enabled)
+		tx->stats.nranges++;
 
-	/*
-	 * Search existing ranges backwards starting from the end of the
-	 * snapshot.
-	 */
-	struct tx_range_def r = *args;
-	struct tx_range_def search = {0, 0, 0};
-	/*
-	 * If the range is directly adjacent to an existing one,
-	 * they can be merged, so search for less or equal elements.
-	 */
-	enum ravl_predicate p = RAVL_PREDICATE_LESS_EQUAL;
-	struct ravl_node *nprev = NULL;
-	while (r.size != 0) {
-		search.offset = r.offset + r.size;
-		struct ravl_node *n = ravl_find(tx->ranges, &search, p);
-		/*
-		 * We have to skip searching for LESS_EQUAL because
-		 * the snapshot we would find is the one that was just
-		 * created.
-		 */
-		p = RAVL_PREDICATE_LESS;
-
-		struct tx_range_def *f = n ? ravl_data(n) : NULL;
-
-		size_t fend = f == NULL ? 0: f->offset + f->size;
-		size_t rend = r.offset + r.size;
-		if (fend == 0 || fend < r.offset) {
-			/*
-			 * If found no range or the found range is not
-			 * overlapping or adjacent on the left side, we can just
-			 * create the entire r.offset + r.size snapshot.
-			 *
-			 * Snapshot:
-			 *	--+-
-			 * Existing ranges:
-			 *	---- (no ranges)
-			 * or	+--- (no overlap)
-			 * or	---+ (adjacent on on right side)
-			 */
-			if (nprev != NULL) {
-				/*
-				 * But, if we have an existing adjacent snapshot
-				 * on the right side, we can just extend it to
-				 * include the desired range.
-				 */
-				struct tx_range_def *fprev = ravl_data(nprev);
-				ASSERTeq(rend, fprev->offset);
-				fprev->offset -= r.size;
-				fprev->size += r.size;
-			} else {
-				/*
-				 * If we don't have anything adjacent, create
-				 * a new range in the tree.
-				 */
-				ret = tx_lane_ranges_insert_def(tx->pop,
-					tx, &r);
-				if (ret != 0)
-					break;
-			}
-			ret = pmemobj_tx_add_snapshot(tx, &r);
-			break;
-		} else if (fend <= rend) {
-			/*
-			 * If found range has its end inside of the desired
-			 * snapshot range, we can extend the found range by the
-			 * size leftover on the left side.
-			 *
-			 * Snapshot:
-			 *	--+++--
-			 * Existing ranges:
-			 *	+++---- (overlap on left)
-			 * or	---+--- (found snapshot is inside)
-			 * or	---+-++ (inside, and adjacent on the rigt)
-			 * or	+++++-- (desired snapshot is inside)
-			 *
-			 */
-			struct tx_range_def snapshot = *args;
-			snapshot.offset = fend;
-			/* the side not yet covered by an existing snapshot */
-			snapshot.size = rend - fend;
-
-			/* the number of bytes intersecting in both ranges */
-			size_t intersection = fend - MAX(f->offset, r.offset);
-			r.size -= intersection + snapshot.size;
-			f->size += snapshot.size;
-
-			if (snapshot.size != 0) {
-				ret = pmemobj_tx_add_snapshot(tx, &snapshot);
-				if (ret != 0)
-					break;
-			}
-
-			/*
-			 * If there's a snapshot adjacent on right side, merge
-			 * the two ranges together.
-			 */
-			if (nprev != NULL) {
-				struct tx_range_def *fprev = ravl_data(nprev);
-				ASSERTeq(rend, fprev->offset);
-				f->size += fprev->size;
-				ravl_remove(tx->ranges, nprev);
-			}
-		} else if (fend >= r.offset) {
-			/*
-			 * If found range has its end extending beyond the
-			 * desired snapshot.
-			 *
-			 * Snapshot:
-			 *	--+++--
-			 * Existing ranges:
-			 *	-----++ (adjacent on the right)
-			 * or	----++- (overlapping on the right)
-			 * or	----+++ (overlapping and adjacent on the right)
-			 * or	--+++++ (desired snapshot is inside)
-			 *
-			 * Notice that we cannot create a snapshot based solely
-			 * on this information without risking overwritting an
-			 * existing one. We have to continue iterating, but we
-			 * keep the information about adjacent snapshots in the
-			 * nprev variable.
-			 */
-			size_t overlap = rend - MAX(f->offset, r.offset);
-			r.size -= overlap;
-		} else {
-			ASSERT(0);
+	if (tx->redo_set != NULL) {
+		if (tx_redo_add(tx, args) != 0) {
+			ERR("out of memory");
+			return obj_tx_abort_err(ENOMEM);
 		}
-
-		nprev = n;
+		return 0;
 	}
 
+	/* only the parts of the range not yet in the transaction are logged */
+	int ret = tx_ranges_add(&tx->ranges, args,
+		pmemobj_tx_add_snapshot, tx);
+
 	if (ret != 0) {
 		ERR("out of memory");
 		return obj_tx_abort_err(ENOMEM);
@@ -1321,6 +2427,70 @@ pmemobj_tx_xadd_range_direct(const void *ptr, size_t size, uint64_t flags)
 	return ret;
 }
 
+/*
+ * pmemobj_tx_access -- returns the pointer through which the range should
+ *	be accessed within the current transaction
+ */
+void *
+pmemobj_tx_access(void *ptr, size_t size)
+{
+	LOG(15, NULL);
+
+	struct tx *tx = get_tx();
+	if (tx->stage != TX_STAGE_WORK)
+		return ptr;
+
+	return tx_redo_ptr(tx, ptr, size);
+}
+
+/*
+ * pmemobj_tx_coid_set -- snapshots the compact handle and points it
+ *	to the object
+ */
+int
+pmemobj_tx_coid_set(PMEMcoid *coid, PMEMoid oid)
+{
+	LOG(3, NULL);
+
+	PMEMOBJ_API_START();
+	struct tx *tx = get_tx();
+
+	ASSERT_IN_TX(tx);
+	ASSERT_TX_STAGE_WORK(tx);
+
+	PMEMobjpool *pop = tx->pop;
+	int ret;
+
+	if (!OBJ_PTR_FROM_POOL(pop, coid)) {
+		ERR("compact handle outside of pool");
+		ret = obj_tx_abort_err(EINVAL);
+		PMEMOBJ_API_END();
+		return ret;
+	}
+
+	if (!OID_IS_NULL(oid) && oid.pool_uuid_lo != pop->uuid_lo) {
+		ERR("invalid pool uuid");
+		ret = obj_tx_abort_err(EINVAL);
+		PMEMOBJ_API_END();
+		return ret;
+	}
+
+	struct tx_range_def args = {
+		.offset = (uint64_t)((char *)coid - (char *)pop),
+		.size = sizeof(*coid),
+		.flags = 0,
+	};
+
+	ret = pmemobj_tx_add_common(tx, &args);
+	if (ret == 0) {
+		PMEMcoid *dest = tx_redo_ptr(tx, coid, sizeof(*coid));
+		dest->off = oid.off;
+	}
+
+	PMEMOBJ_API_END();
+	return ret;
+}
+
 /*
  * pmemobj_tx_add_range -- adds persistent memory range into the transaction
  */
@@ -1638,23 +2808,27 @@ pmemobj_tx_free(PMEMoid oid)
 
 	struct pobj_action *action;
 
-	struct tx_range_def range = {oid.off, 0, 0};
-	struct ravl_node *n = ravl_find(tx->ranges, &range,
-		RAVL_PREDICATE_EQUAL);
+	struct tx_range_def *r = tx_ranges_get(&tx->ranges, oid.off);
 
 	/*
 	 * If attempting to free an object allocated within the same
 	 * transaction, simply cancel the alloc and remove it from the actions.
 	 */
-	if (n != NULL) {
+	if (r != NULL) {
 		VEC_FOREACH_BY_PTR(action, &tx->actions) {
 			if (action->type == POBJ_ACTION_TYPE_HEAP &&
 			    action->heap.offset == oid.off) {
-				struct tx_range_def *r = ravl_data(n);
 				void *ptr = OBJ_OFF_TO_PTR(pop, r->offset);
+				if (tx->redo_set != NULL && tx_redo_remove(tx,
+						r->offset, r->size) != 0) {
+					ERR("out of memory");
+					int ret = obj_tx_abort_err(ENOMEM);
+					PMEMOBJ_API_END();
+					return ret;
+				}
 				VALGRIND_SET_CLEAN(ptr, r->size);
 				VALGRIND_REMOVE_FROM_TX(ptr, r->size);
-				ravl_remove(tx->ranges, n);
+				tx_ranges_remove(&tx->ranges, oid.off);
 				palloc_cancel(&pop->heap, action, 1);
 				VEC_ERASE_BY_PTR(&tx->actions, action);
 				PMEMOBJ_API_END();
@@ -1676,6 +2850,102 @@ pmemobj_tx_free(PMEMoid oid)
 	return 0;
 }
 
+/*
+ * tx_cow_copy -- (internal) returns the copy of the object made in
+ *	the transaction, creates it if there is none yet
+ */
+static PMEMoid
+tx_cow_copy(struct tx *tx, PMEMoid oid)
+{
+	PMEMobjpool *pop = tx->pop;
+
+	/* objects allocated in the transaction are not logged anyway */
+	struct tx_range_def *r = tx_ranges_get(&tx->ranges, oid.off);
+	if (r != NULL && (r->flags & TX_RANGE_NO_MERGE))
+		return oid;
+
+	struct tx_cow *cow;
+	VEC_FOREACH_BY_PTR(cow, &tx->cows) {
+		if (cow->old_off == oid.off) {
+			PMEMoid copy = {pop->uuid_lo, cow->new_off};
+			return copy;
+		}
+	}
+
+	void *ptr = OBJ_OFF_TO_PTR(pop, oid.off);
+	size_t size = palloc_usable_size(&pop->heap, oid.off);
+	type_num_t type_num = (type_num_t)palloc_extra(&pop->heap, oid.off);
+
+	PMEMoid copy = tx_alloc_common(tx, size, type_num,
+		constructor_tx_alloc, COPY_ARGS(0, ptr, size));
+	if (OBJ_OID_IS_NULL(copy))
+		return copy;
+
+	if (pmemobj_tx_free(oid) != 0)
+		return OID_NULL;
+
+	struct tx_cow c = {oid.off, copy.off};
+	if (VEC_PUSH_BACK(&tx->cows, c) != 0) {
+		ERR("out of memory");
+		return obj_tx_abort_null(ENOMEM);
+	}
+
+	return copy;
+}
+
+/*
+ * pmemobj_tx_cow -- returns a copy of the object to be modified instead of
+ *	the object itself, the handle is pointed to the copy on commit
+ */
+PMEMoid
+pmemobj_tx_cow(PMEMoid *oidp)
+{
+	LOG(3, NULL);
+	struct tx *tx = get_tx();
+
+	ASSERT_IN_TX(tx);
+	ASSERT_TX_STAGE_WORK(tx);
+
+	PMEMobjpool *pop = tx->pop;
+
+	if (!OBJ_PTR_FROM_POOL(pop, oidp)) {
+		ERR("object handle outside of pool");
+		return obj_tx_abort_null(EINVAL);
+	}
+
+	PMEMoid oid = *oidp;
+	if (OBJ_OID_IS_NULL(oid)) {
+		ERR("cannot copy a null object");
+		return obj_tx_abort_null(EINVAL);
+	}
+
+	if (pop->uuid_lo != oid.pool_uuid_lo) {
+		ERR("invalid pool uuid");
+		return obj_tx_abort_null(EINVAL);
+	}
+	ASSERT(OBJ_OID_IS_VALID(pop, oid));
+
+	PMEMOBJ_API_START();
+
+	PMEMoid copy = tx_cow_copy(tx, oid);
+	if (OBJ_OID_IS_NULL(copy) || copy.off == oid.off) {
+		PMEMOBJ_API_END();
+		return copy;
+	}
+
+	/* the handle is switched to the copy along with the allocations */
+	struct pobj_action *action = tx_action_add(tx);
+	if (action == NULL) {
+		PMEMOBJ_API_END();
+		return obj_tx_abort_null(ENOMEM);
+	}
+
+	palloc_set_value(&pop->heap, action, &oidp->off, copy.off);
+
+	PMEMOBJ_API_END();
+	return copy;
+}
+
 /*
  * pmemobj_tx_publish -- publishes actions inside of a transaction
  */
@@ -1686,10 +2956,11 @@ pmemobj_tx_publish(struct pobj_action *actv, size_t actvcnt)
 	ASSERT_TX_STAGE_WORK(tx);
 	PMEMOBJ_API_START();
 
-	size_t entries_size = (VEC_SIZE(&tx->actions) + actvcnt) *
-		sizeof(struct ulog_entry_val);
+	size_t redo_nbytes = tx->redo_nbytes;
+	tx->redo_nbytes += palloc_buffers_log_size(actv, actvcnt);
 
-	if (operation_reserve(tx->lane->external, entries_size) != 0) {
+	if (tx_log_reserve(tx, actvcnt, 0, 0) != 0) {
+		tx->redo_nbytes = redo_nbytes;
 		PMEMOBJ_API_END();
 		return -1;
 	}
@@ -1820,12 +3091,21 @@ static const struct ctl_node CTL_NODE(debug)[] = {
 };
 
 /*
- * CTL_WRITE_HANDLER(queue_depth) -- returns the depth of the post commit queue
+ * CTL_READ_HANDLER(queue_depth) -- returns the depth of the post commit queue
  */
 static int
 CTL_READ_HANDLER(queue_depth)(void *ctx, enum ctl_query_source source,
 	void *arg, struct ctl_indexes *indexes)
 {
+	PMEMobjpool *pop = ctx;
+	struct tx_postcommit *pc = pop->tx_params->postcommit;
+
+	int *arg_out = arg;
+
+	util_mutex_lock(&pc->lock);
+	*arg_out = (int)pc->depth;
+	util_mutex_unlock(&pc->lock);
+
 	return 0;
 }
 
@@ -1836,18 +3116,78 @@ static int
 CTL_WRITE_HANDLER(queue_depth)(void *ctx, enum ctl_query_source source,
 	void *arg, struct ctl_indexes *indexes)
 {
-	return 0;
+	PMEMobjpool *pop = ctx;
+	struct tx_postcommit *pc = pop->tx_params->postcommit;
+
+	int arg_in = *(int *)arg;
+
+	if (arg_in < 0) {
+		ERR("invalid post commit queue depth %d", arg_in);
+		errno = EINVAL;
+		return -1;
+	}
+
+	int ret = 0;
+
+	util_mutex_lock(&pc->lock);
+	if (pc->nworkers != 0) {
+		ERR("post commit queue depth cannot be changed while "
+			"workers are running");
+		errno = EBUSY;
+		ret = -1;
+	} else {
+		pc->depth = (unsigned)arg_in;
+	}
+	util_mutex_unlock(&pc->lock);
+
+	return ret;
 }
 
 static const struct ctl_argument CTL_ARG(queue_depth) = CTL_ARG_INT;
 
 /*
  * CTL_READ_HANDLER(worker) -- launches the post commit worker thread function
+ *
+ * The calling thread processes the post commit tasks until the workers are
+ * stopped.
  */
 static int
 CTL_READ_HANDLER(worker)(void *ctx, enum ctl_query_source source,
 	void *arg, struct ctl_indexes *indexes)
 {
+	PMEMobjpool *pop = ctx;
+	struct tx_postcommit *pc = pop->tx_params->postcommit;
+
+	util_mutex_lock(&pc->lock);
+
+	if (pc->depth == 0) {
+		util_mutex_unlock(&pc->lock);
+		ERR("post commit queue is disabled");
+		errno = EINVAL;
+		return -1;
+	}
+
+	pc->nworkers++;
+
+	for (;;) {
+		while (VECQ_SIZE(&pc->tasks) == 0 && !pc->stop)
+			os_cond_wait(&pc->cond, &pc->lock);
+
+		if (VECQ_SIZE(&pc->tasks) == 0)
+			break;
+
+		unsigned lane_idx = VECQ_DEQUEUE(&pc->tasks);
+
+		util_mutex_unlock(&pc->lock);
+		tx_postcommit_cleanup(pop, lane_idx);
+		util_mutex_lock(&pc->lock);
+	}
+
+	pc->nworkers--;
+	os_cond_broadcast(&pc->idle);
+
+	util_mutex_unlock(&pc->lock);
+
 	return 0;
 }
 
@@ -1858,6 +3198,10 @@ static int
 CTL_READ_HANDLER(stop)(void *ctx, enum ctl_query_source source,
 	void *arg, struct ctl_indexes *indexes)
 {
+	PMEMobjpool *pop = ctx;
+
+	tx_postcommit_stop(pop);
+
 	return 0;
 }
 
@@ -1869,10 +3213,278 @@ static const struct ctl_node CTL_NODE(post_commit)[] = {
 	CTL_NODE_END
 };
 
+/*
+ * CTL_READ_HANDLER(batch) -- returns the max number of transactions in a group
+ */
+static int
+CTL_READ_HANDLER(batch)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+	struct tx_group_commit *gc = pop->tx_params->group_commit;
+
+	int *arg_out = arg;
+
+	util_mutex_lock(&gc->lock);
+	*arg_out = (int)gc->batch;
+	util_mutex_unlock(&gc->lock);
+
+	return 0;
+}
+
+/*
+ * CTL_WRITE_HANDLER(batch) -- sets the max number of transactions in a group
+ */
+static int
+CTL_WRITE_HANDLER(batch)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+	struct tx_group_commit *gc = pop->tx_params->group_commit;
+
+	int arg_in = *(int *)arg;
+
+	if (arg_in < 0) {
+		ERR("invalid group commit size %d", arg_in);
+		errno = EINVAL;
+		return -1;
+	}
+
+	util_mutex_lock(&gc->lock);
+	util_atomic_store_explicit32(&gc->batch, (unsigned)arg_in,
+		memory_order_relaxed);
+	/* the leader might be waiting for a group that is now big enough */
+	os_cond_signal(&gc->full);
+	util_mutex_unlock(&gc->lock);
+
+	return 0;
+}
+
+static const struct ctl_argument CTL_ARG(batch) = CTL_ARG_INT;
+
+/*
+ * CTL_READ_HANDLER(window) -- returns the time in microseconds the leader
+ *	waits for a group to fill up
+ */
+static int
+CTL_READ_HANDLER(window)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+	struct tx_group_commit *gc = pop->tx_params->group_commit;
+
+	int *arg_out = arg;
+
+	util_mutex_lock(&gc->lock);
+	*arg_out = (int)gc->window;
+	util_mutex_unlock(&gc->lock);
+
+	return 0;
+}
+
+/*
+ * CTL_WRITE_HANDLER(window) -- sets the time in microseconds the leader
+ *	waits for a group to fill up
+ */
+static int
+CTL_WRITE_HANDLER(window)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+	struct tx_group_commit *gc = pop->tx_params->group_commit;
+
+	int arg_in = *(int *)arg;
+
+	if (arg_in < 0 || arg_in >= 1000000) {
+		ERR("invalid group commit window %d", arg_in);
+		errno = EINVAL;
+		return -1;
+	}
+
+	util_mutex_lock(&gc->lock);
+	gc->window = (unsigned)arg_in;
+	util_mutex_unlock(&gc->lock);
+
+	return 0;
+}
+
+static const struct ctl_argument CTL_ARG(window) = CTL_ARG_INT;
+
+static const struct ctl_node CTL_NODE(group_commit)[] = {
+	CTL_LEAF_RW(batch),
+	CTL_LEAF_RW(window),
+
+	CTL_NODE_END
+};
+
+/*
+ * CTL_READ_HANDLER(durable) -- returns the last durable epoch
+ */
+static int
+CTL_READ_HANDLER(durable)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+	struct tx_epoch *ep = pop->tx_params->epoch;
+
+	uint64_t *arg_out = arg;
+	util_atomic_load_explicit64(&ep->durable, arg_out,
+		memory_order_acquire);
+
+	return 0;
+}
+
+/*
+ * CTL_READ_HANDLER(last) -- returns the epoch of the last committed relaxed
+ *	transaction
+ */
+static int
+CTL_READ_HANDLER(last)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+	struct tx_epoch *ep = pop->tx_params->epoch;
+
+	uint64_t *arg_out = arg;
+	util_atomic_load_explicit64(&ep->last, arg_out, memory_order_acquire);
+
+	return 0;
+}
+
+/*
+ * CTL_RUNNABLE_HANDLER(sync) -- makes all the committed relaxed transactions
+ *	durable
+ */
+static int
+CTL_RUNNABLE_HANDLER(sync)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	tx_epoch_sync_all(pop);
+
+	return 0;
+}
+
+/*
+ * CTL_READ_HANDLER(interval) -- returns the time in milliseconds between
+ *	the syncs of the epoch workers
+ */
+static int
+CTL_READ_HANDLER(interval)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+	struct tx_epoch *ep = pop->tx_params->epoch;
+
+	int *arg_out = arg;
+
+	util_mutex_lock(&ep->lock);
+	*arg_out = (int)ep->interval;
+	util_mutex_unlock(&ep->lock);
+
+	return 0;
+}
+
+/*
+ * CTL_WRITE_HANDLER(interval) -- sets the time in milliseconds between
+ *	the syncs of the epoch workers
+ */
+static int
+CTL_WRITE_HANDLER(interval)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+	struct tx_epoch *ep = pop->tx_params->epoch;
+
+	int arg_in = *(int *)arg;
+
+	if (arg_in <= 0 || arg_in >= 1000000) {
+		ERR("invalid epoch interval %d", arg_in);
+		errno = EINVAL;
+		return -1;
+	}
+
+	util_mutex_lock(&ep->lock);
+	ep->interval = (unsigned)arg_in;
+	util_mutex_unlock(&ep->lock);
+
+	return 0;
+}
+
+static const struct ctl_argument CTL_ARG(interval) = CTL_ARG_INT;
+
+/*
+ * CTL_RUNNABLE_HANDLER(worker) -- launches the epoch worker thread function
+ *
+ * The calling thread periodically makes the committed relaxed transactions
+ * durable until the workers are stopped.
+ */
+static int
+CTL_RUNNABLE_HANDLER(worker)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+	struct tx_epoch *ep = pop->tx_params->epoch;
+
+	util_mutex_lock(&ep->lock);
+
+	ep->nworkers++;
+
+	while (!ep->stop) {
+		struct timespec deadline;
+		os_clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += ep->interval / 1000;
+		deadline.tv_nsec += (long)(ep->interval % 1000) * 1000000;
+		deadline.tv_sec += deadline.tv_nsec / 1000000000;
+		deadline.tv_nsec %= 1000000000;
+
+		while (!ep->stop && os_cond_timedwait(&ep->wake, &ep->lock,
+				&deadline) == 0)
+			;
+
+		tx_epoch_advance(pop, ep);
+	}
+
+	ep->nworkers--;
+	os_cond_broadcast(&ep->cond);
+
+	util_mutex_unlock(&ep->lock);
+
+	return 0;
+}
+
+/*
+ * CTL_RUNNABLE_HANDLER(stop) -- stops all epoch workers
+ */
+static int
+CTL_RUNNABLE_HANDLER(stop)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	tx_epoch_stop(pop);
+
+	return 0;
+}
+
+static const struct ctl_node CTL_NODE(epoch)[] = {
+	CTL_LEAF_RO(durable),
+	CTL_LEAF_RO(last),
+	CTL_LEAF_RUNNABLE(sync),
+	CTL_LEAF_RW(interval),
+	CTL_LEAF_RUNNABLE(worker),
+	CTL_LEAF_RUNNABLE(stop),
+
+	CTL_NODE_END
+};
+
 static const struct ctl_node CTL_NODE(tx)[] = {
 	CTL_CHILD(debug),
 	CTL_CHILD(cache),
 	CTL_CHILD(post_commit),
+	CTL_CHILD(group_commit),
+	CTL_CHILD(epoch),
 
 	CTL_NODE_END
 };
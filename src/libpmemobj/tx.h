@@ -47,14 +47,23 @@ extern "C" {
 
 #define TX_DEFAULT_RANGE_CACHE_SIZE (1 << 15)
 #define TX_DEFAULT_RANGE_CACHE_THRESHOLD (1 << 12)
+#define TX_DEFAULT_GROUP_COMMIT_WINDOW 50 /* microseconds */
+#define TX_DEFAULT_EPOCH_INTERVAL 10 /* milliseconds */
 
 #define TX_RANGE_MASK (8ULL - 1)
 #define TX_RANGE_MASK_LEGACY (32ULL - 1)
 
 #define TX_ALIGN_SIZE(s, amask) (((s) + (amask)) & ~(amask))
 
+struct tx_postcommit;
+struct tx_group_commit;
+struct tx_epoch;
+
 struct tx_parameters {
 	size_t cache_size;
+	struct tx_postcommit *postcommit; /* queue of post commit tasks */
+	struct tx_group_commit *group_commit; /* shared pre-commit drain */
+	struct tx_epoch *epoch; /* relaxed durability epochs */
 };
 
 /*
@@ -68,6 +77,13 @@ void tx_ctl_register(PMEMobjpool *pop);
 struct tx_parameters *tx_params_new(void);
 void tx_params_delete(struct tx_parameters *tx_params);
 
+void tx_postcommit_stop(PMEMobjpool *pop);
+
+int tx_epoch_boot(PMEMobjpool *pop);
+int tx_epoch_resize(PMEMobjpool *pop, unsigned nlanes);
+void tx_epoch_stop(PMEMobjpool *pop);
+void tx_epoch_sync_all(PMEMobjpool *pop);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,413 @@
+/*
+ * Copyright 2019, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * tx_ranges.c -- implementation of the set of transaction ranges
+ */
+
+#include <string.h>
+
+#include "alloc.h"
+#include "out.h"
+#include "tx_ranges.h"
+
+#define RANGE_END(def) ((def)->offset + (def)->size)
+
+/* position of a range in the set */
+struct tx_ranges_pos {
+	size_t leaf;
+	unsigned pos;
+};
+
+/*
+ * tx_ranges_init -- initializes an empty set of ranges
+ */
+void
+tx_ranges_init(struct tx_ranges *r)
+{
+	r->first.nranges = 0;
+	r->first_leaves[0] = &r->first;
+	r->leaves = r->first_leaves;
+	r->nleaves = 1;
+	r->capacity = 1;
+	r->hint_leaf = 0;
+	r->hint_pos = 0;
+}
+
+/*
+ * tx_ranges_at -- (internal) returns the range at the given position
+ */
+static inline struct tx_range_def *
+tx_ranges_at(struct tx_ranges *r, struct tx_ranges_pos p)
+{
+	return &r->leaves[p.leaf]->ranges[p.pos];
+}
+
+/*
+ * tx_ranges_find_le -- (internal) finds the last range that starts at or
+ *	before the given offset, returns 0 if there's no such range
+ *
+ * All the leaves, except for the first one in an empty set, are never empty.
+ */
+static int
+tx_ranges_find_le(struct tx_ranges *r, uint64_t offset,
+	struct tx_ranges_pos *p)
+{
+	size_t llo = 0;
+	size_t lhi = r->nleaves;
+	while (lhi - llo > 1) {
+		size_t mid = llo + (lhi - llo) / 2;
+		if (r->leaves[mid]->ranges[0].offset <= offset)
+			llo = mid;
+		else
+			lhi = mid;
+	}
+
+	struct tx_ranges_leaf *l = r->leaves[llo];
+	unsigned lo = 0;
+	unsigned hi = l->nranges;
+	while (lo < hi) {
+		unsigned mid = lo + (hi - lo) / 2;
+		if (l->ranges[mid].offset <= offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == 0)
+		return 0;
+
+	p->leaf = llo;
+	p->pos = lo - 1;
+
+	return 1;
+}
+
+/*
+ * tx_ranges_next -- (internal) moves the position to the next range,
+ *	returns 0 if there's no such range
+ */
+static int
+tx_ranges_next(struct tx_ranges *r, struct tx_ranges_pos *p)
+{
+	if (p->pos + 1 < r->leaves[p->leaf]->nranges) {
+		p->pos++;
+		return 1;
+	}
+
+	if (p->leaf + 1 < r->nleaves) {
+		p->leaf++;
+		p->pos = 0;
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * tx_ranges_split -- (internal) moves the ranges of a full leaf starting
+ *	from the given position to a new leaf inserted right after it
+ */
+static int
+tx_ranges_split(struct tx_ranges *r, size_t leaf, unsigned pos)
+{
+	if (r->nleaves == r->capacity) {
+		size_t ncapacity = r->capacity * 2;
+		struct tx_ranges_leaf **leaves;
+		if (r->leaves == r->first_leaves) {
+			leaves = Malloc(ncapacity * sizeof(*leaves));
+			if (leaves != NULL)
+				memcpy(leaves, r->leaves,
+					r->nleaves * sizeof(*leaves));
+		} else {
+			leaves = Realloc(r->leaves,
+				ncapacity * sizeof(*leaves));
+		}
+		if (leaves == NULL) {
+			ERR("!Malloc");
+			return -1;
+		}
+
+		r->leaves = leaves;
+		r->capacity = ncapacity;
+	}
+
+	struct tx_ranges_leaf *nl = Malloc(sizeof(*nl));
+	if (nl == NULL) {
+		ERR("!Malloc");
+		return -1;
+	}
+
+	struct tx_ranges_leaf *l = r->leaves[leaf];
+	nl->nranges = l->nranges - pos;
+	memcpy(nl->ranges, &l->ranges[pos],
+		nl->nranges * sizeof(struct tx_range_def));
+	l->nranges = pos;
+
+	memmove(&r->leaves[leaf + 2], &r->leaves[leaf + 1],
+		(r->nleaves - leaf - 1) * sizeof(*r->leaves));
+	r->leaves[leaf + 1] = nl;
+	r->nleaves++;
+
+	return 0;
+}
+
+/*
+ * tx_ranges_insert_at -- (internal) inserts a new range at the given
+ *	position, splitting the leaf if it's full
+ */
+static int
+tx_ranges_insert_at(struct tx_ranges *r, struct tx_ranges_pos p,
+	const struct tx_range_def *def)
+{
+	struct tx_ranges_leaf *l = r->leaves[p.leaf];
+
+	if (l->nranges == TX_RANGES_LEAF_SIZE) {
+		/*
+		 * Ranges are usually added in an ascending order, so the last
+		 * leaf is split at the insertion point to keep it full.
+		 */
+		int append = p.leaf == r->nleaves - 1 && p.pos == l->nranges;
+		if (tx_ranges_split(r, p.leaf,
+				append ? p.pos : TX_RANGES_LEAF_SIZE / 2) != 0)
+			return -1;
+
+		if (p.pos >= l->nranges) {
+			p.pos -= l->nranges;
+			p.leaf++;
+			l = r->leaves[p.leaf];
+		}
+	}
+
+	memmove(&l->ranges[p.pos + 1], &l->ranges[p.pos],
+		(l->nranges - p.pos) * sizeof(*def));
+	l->ranges[p.pos] = *def;
+	l->nranges++;
+
+	r->hint_leaf = p.leaf;
+	r->hint_pos = p.pos;
+
+	return 0;
+}
+
+/*
+ * tx_ranges_remove_at -- (internal) removes the range at the given position,
+ *	along with its leaf if it becomes empty
+ */
+static void
+tx_ranges_remove_at(struct tx_ranges *r, struct tx_ranges_pos p)
+{
+	struct tx_ranges_leaf *l = r->leaves[p.leaf];
+
+	l->nranges--;
+	memmove(&l->ranges[p.pos], &l->ranges[p.pos + 1],
+		(l->nranges - p.pos) * sizeof(struct tx_range_def));
+
+	if (l->nranges != 0 || r->nleaves == 1)
+		return;
+
+	if (p.leaf == 0) {
+		/* the first leaf is embedded, move the next one in its place */
+		struct tx_ranges_leaf *next = r->leaves[1];
+		memcpy(l, next, sizeof(*l));
+		Free(next);
+		p.leaf = 1;
+	} else {
+		Free(l);
+	}
+
+	memmove(&r->leaves[p.leaf], &r->leaves[p.leaf + 1],
+		(r->nleaves - p.leaf - 1) * sizeof(*r->leaves));
+	r->nleaves--;
+}
+
+/*
+ * tx_ranges_mergeable -- (internal) checks whether the right range directly
+ *	follows the left one and both can be merged together
+ */
+static inline int
+tx_ranges_mergeable(const struct tx_range_def *lhs,
+	const struct tx_range_def *rhs)
+{
+	return RANGE_END(lhs) == rhs->offset && lhs->flags == rhs->flags &&
+		!(lhs->flags & TX_RANGE_NO_MERGE);
+}
+
+/*
+ * tx_ranges_add -- adds the parts of the range that are not yet in the set,
+ *	merging them with the adjacent ranges that have the same flags
+ *
+ * The callback, if present, is called for each of the parts before it's
+ * added to the set. If it fails, its return value is returned.
+ */
+int
+tx_ranges_add(struct tx_ranges *r, const struct tx_range_def *def,
+	tx_ranges_add_cb cb, void *arg)
+{
+	uint64_t end = RANGE_END(def);
+
+	/* the common case of a range that is already in the set */
+	if (r->hint_leaf < r->nleaves &&
+	    r->hint_pos < r->leaves[r->hint_leaf]->nranges) {
+		struct tx_range_def *h =
+			&r->leaves[r->hint_leaf]->ranges[r->hint_pos];
+		if (h->offset <= def->offset && RANGE_END(h) >= end)
+			return 0;
+	}
+
+	uint64_t cur = def->offset;
+	while (cur < end) {
+		struct tx_ranges_pos prev = {0, 0};
+		struct tx_ranges_pos next = {0, 0};
+		struct tx_range_def *p = NULL;
+		struct tx_range_def *n = NULL;
+
+		if (tx_ranges_find_le(r, cur, &prev)) {
+			p = tx_ranges_at(r, prev);
+			if (RANGE_END(p) > cur) {
+				/* skip the part that is already in the set */
+				r->hint_leaf = prev.leaf;
+				r->hint_pos = prev.pos;
+				cur = RANGE_END(p);
+				continue;
+			}
+
+			next = prev;
+			if (tx_ranges_next(r, &next))
+				n = tx_ranges_at(r, next);
+		} else if (r->leaves[0]->nranges != 0) {
+			n = tx_ranges_at(r, next);
+		}
+
+		struct tx_range_def gap = {cur, 0, def->flags};
+		gap.size = (n != NULL && n->offset < end ? n->offset : end) -
+			cur;
+
+		if (cb != NULL) {
+			int ret = cb(&gap, arg);
+			if (ret != 0)
+				return ret;
+		}
+
+		if (p != NULL && tx_ranges_mergeable(p, &gap)) {
+			p->size += gap.size;
+			r->hint_leaf = prev.leaf;
+			r->hint_pos = prev.pos;
+
+			if (n != NULL && tx_ranges_mergeable(p, n)) {
+				p->size += n->size;
+				tx_ranges_remove_at(r, next);
+			}
+		} else if (n != NULL && tx_ranges_mergeable(&gap, n)) {
+			n->offset = gap.offset;
+			n->size += gap.size;
+			r->hint_leaf = next.leaf;
+			r->hint_pos = next.pos;
+		} else {
+			struct tx_ranges_pos pos = {prev.leaf, 0};
+			if (p != NULL)
+				pos.pos = prev.pos + 1;
+
+			if (tx_ranges_insert_at(r, pos, &gap) != 0)
+				return -1;
+		}
+
+		cur += gap.size;
+	}
+
+	return 0;
+}
+
+/*
+ * tx_ranges_get -- returns the range that starts at the given offset
+ */
+struct tx_range_def *
+tx_ranges_get(struct tx_ranges *r, uint64_t offset)
+{
+	struct tx_ranges_pos p;
+	if (!tx_ranges_find_le(r, offset, &p))
+		return NULL;
+
+	struct tx_range_def *f = tx_ranges_at(r, p);
+
+	return f->offset == offset ? f : NULL;
+}
+
+/*
+ * tx_ranges_remove -- removes the range that starts at the given offset
+ */
+void
+tx_ranges_remove(struct tx_ranges *r, uint64_t offset)
+{
+	struct tx_ranges_pos p;
+	if (tx_ranges_find_le(r, offset, &p) &&
+	    tx_ranges_at(r, p)->offset == offset)
+		tx_ranges_remove_at(r, p);
+}
+
+/*
+ * tx_ranges_foreach -- calls the callback for all the ranges in an ascending
+ *	order
+ */
+void
+tx_ranges_foreach(struct tx_ranges *r, tx_ranges_cb cb, void *arg)
+{
+	for (size_t i = 0; i < r->nleaves; ++i) {
+		struct tx_ranges_leaf *l = r->leaves[i];
+		for (unsigned j = 0; j < l->nranges; ++j)
+			cb(&l->ranges[j], arg);
+	}
+}
+
+/*
+ * tx_ranges_clear -- calls the callback, if present, for all the ranges in
+ *	an ascending order and removes them from the set
+ */
+void
+tx_ranges_clear(struct tx_ranges *r, tx_ranges_cb cb, void *arg)
+{
+	for (size_t i = 0; i < r->nleaves; ++i) {
+		struct tx_ranges_leaf *l = r->leaves[i];
+		if (cb != NULL) {
+			for (unsigned j = 0; j < l->nranges; ++j)
+				cb(&l->ranges[j], arg);
+		}
+
+		if (l != &r->first)
+			Free(l);
+	}
+
+	if (r->leaves != r->first_leaves)
+		Free(r->leaves);
+
+	tx_ranges_init(r);
+}
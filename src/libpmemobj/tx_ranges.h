@@ -0,0 +1,98 @@
+/*
+ * Copyright 2019, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * tx_ranges.h -- internal definitions for the set of transaction ranges
+ */
+
+#ifndef LIBPMEMOBJ_TX_RANGES_H
+#define LIBPMEMOBJ_TX_RANGES_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* number of ranges in a single leaf of the set */
+#define TX_RANGES_LEAF_SIZE 64
+
+/* ranges with this flag are never merged with their neighbours */
+#define TX_RANGE_NO_MERGE (((uint64_t)1) << 63)
+
+struct tx_range_def {
+	uint64_t offset;
+	uint64_t size;
+	uint64_t flags;
+};
+
+struct tx_ranges_leaf {
+	unsigned nranges;
+	struct tx_range_def ranges[TX_RANGES_LEAF_SIZE];
+};
+
+/*
+ * Set of disjoint ranges, sorted by their offsets. It's a two-level B+-tree:
+ * a sorted array of leaves, each holding a sorted array of ranges. As long
+ * as all the ranges fit in the first leaf, which is embedded in the
+ * structure, the set is just a flat sorted array and no memory is allocated.
+ */
+struct tx_ranges {
+	struct tx_ranges_leaf **leaves; /* sorted by the first range offset */
+	size_t nleaves;
+	size_t capacity;
+
+	/* leaf and position of the recently used range */
+	size_t hint_leaf;
+	unsigned hint_pos;
+
+	struct tx_ranges_leaf *first_leaves[1];
+	struct tx_ranges_leaf first;
+};
+
+typedef int (*tx_ranges_add_cb)(const struct tx_range_def *def, void *arg);
+typedef void (*tx_ranges_cb)(const struct tx_range_def *def, void *arg);
+
+void tx_ranges_init(struct tx_ranges *r);
+int tx_ranges_add(struct tx_ranges *r, const struct tx_range_def *def,
+	tx_ranges_add_cb cb, void *arg);
+struct tx_range_def *tx_ranges_get(struct tx_ranges *r, uint64_t offset);
+void tx_ranges_remove(struct tx_ranges *r, uint64_t offset);
+void tx_ranges_foreach(struct tx_ranges *r, tx_ranges_cb cb, void *arg);
+void tx_ranges_clear(struct tx_ranges *r, tx_ranges_cb cb, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
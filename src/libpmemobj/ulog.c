@@ -35,6 +35,7 @@
  */
 
 #include <inttypes.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "libpmemobj.h"
@@ -103,6 +104,7 @@ ulog_entry_offset(const struct ulog_entry_base *entry)
 size_t
 ulog_entry_size(const struct ulog_entry_base *entry)
 {
+	struct ulog_entry_vals *evs;
 	struct ulog_entry_buf *eb;
 
 	switch (ulog_entry_type(entry)) {
@@ -110,7 +112,12 @@ ulog_entry_size(const struct ulog_entry_base *entry)
 		case ULOG_OPERATION_OR:
 		case ULOG_OPERATION_SET:
 			return sizeof(struct ulog_entry_val);
+		case ULOG_OPERATION_SET_RUN:
+			evs = (struct ulog_entry_vals *)entry;
+			return ULOG_ENTRY_VALS_SIZE(evs->nvalues);
 		case ULOG_OPERATION_BUF_SET:
+		case ULOG_OPERATION_BUF_CAS:
+			return CACHELINE_SIZE;
 		case ULOG_OPERATION_BUF_CPY:
 			eb = (struct ulog_entry_buf *)entry;
 			return CACHELINE_ALIGN(
@@ -122,29 +129,76 @@ ulog_entry_size(const struct ulog_entry_base *entry)
 	return 0;
 }
 
+/*
+ * ulog_entry_buf_checksum -- (internal) calculates the checksum of a buffer
+ *	entry that belongs to the given generation of a ulog
+ */
+static uint64_t
+ulog_entry_buf_checksum(uint64_t csum, uint64_t gen_num)
+{
+	if (gen_num == 0)
+		return csum;
+
+	return util_checksum_seq(&gen_num, sizeof(gen_num), csum);
+}
+
 /*
  * ulog_entry_valid -- (internal) checks if a ulog entry is valid
  * Returns 1 if the range is valid, otherwise 0 is returned.
+ *
+ * A ulog with a nonzero generation number is never zeroed, the entries left
+ * behind by its previous generations are told apart by their checksum, which
+ * covers the generation number. Only buffer entries carry a checksum, so such
+ * a log cannot contain value entries.
  */
 static int
-ulog_entry_valid(const struct ulog_entry_base *entry)
+ulog_entry_valid(struct ulog *ulog, const struct ulog_entry_base *entry,
+	size_t max_size)
 {
 	if (entry->offset == 0)
 		return 0;
 
 	size_t size;
+	struct ulog_entry_vals *evs;
 	struct ulog_entry_buf *b;
+	ulog_operation_type t = ulog_entry_type(entry);
 
-	switch (ulog_entry_type(entry)) {
+	switch (t) {
+		case ULOG_OPERATION_AND:
+		case ULOG_OPERATION_OR:
+		case ULOG_OPERATION_SET:
+			return ulog->gen_num == 0;
+		case ULOG_OPERATION_SET_RUN:
+			evs = (struct ulog_entry_vals *)entry;
+			return ulog->gen_num == 0 && max_size >= sizeof(*evs) &&
+				evs->nvalues <= (max_size - sizeof(*evs)) /
+					sizeof(uint64_t) &&
+				ULOG_ENTRY_VALS_SIZE(evs->nvalues) <= max_size;
 		case ULOG_OPERATION_BUF_CPY:
 		case ULOG_OPERATION_BUF_SET:
-			size = ulog_entry_size(entry);
+		case ULOG_OPERATION_BUF_CAS:
 			b = (struct ulog_entry_buf *)entry;
-			if (!util_checksum(b, size, &b->checksum, 0, 0))
+			if (max_size < sizeof(*b))
+				return 0;
+			if (t == ULOG_OPERATION_BUF_CPY &&
+			    b->size > max_size - sizeof(*b))
+				return 0;
+			if (t == ULOG_OPERATION_BUF_CAS &&
+			    b->size != sizeof(struct ulog_entry_cas))
+				return 0;
+
+			size = ulog_entry_size(entry);
+			if (size > max_size)
+				return 0;
+
+			uint64_t csum = util_checksum_compute(b, size,
+				&b->checksum, 0);
+			csum = ulog_entry_buf_checksum(csum, ulog->gen_num);
+			if (b->checksum != htole64(csum))
 				return 0;
 			break;
 		default:
-			break;
+			return 0;
 	}
 
 	return 1;
@@ -154,8 +208,8 @@ ulog_entry_valid(const struct ulog_entry_base *entry)
  * ulog_construct -- initializes the ulog structure
  */
 void
-ulog_construct(uint64_t offset, size_t capacity, int flush,
-	const struct pmem_ops *p_ops)
+ulog_construct(uint64_t offset, size_t capacity, uint64_t gen_num,
+	int flush, const struct pmem_ops *p_ops)
 {
 	struct ulog *ulog = ulog_by_offset(offset, p_ops);
 	ASSERTne(ulog, NULL);
@@ -165,6 +219,8 @@ ulog_construct(uint64_t offset, size_t capacity, int flush,
 	ulog->capacity = capacity;
 	ulog->checksum = 0;
 	ulog->next = 0;
+	ulog->epoch = 0;
+	ulog->gen_num = gen_num;
 	memset(ulog->unused, 0, sizeof(ulog->unused));
 
 	if (flush) {
@@ -198,7 +254,7 @@ ulog_foreach_entry(struct ulog *ulog,
 	for (struct ulog *r = ulog; r != NULL; r = ulog_next(r, ops)) {
 		for (size_t offset = 0; offset < r->capacity; ) {
 			e = (struct ulog_entry_base *)(r->data + offset);
-			if (!ulog_entry_valid(e))
+			if (!ulog_entry_valid(ulog, e, r->capacity - offset))
 				return ret;
 
 			if ((ret = cb(e, arg, ops)) != 0)
@@ -393,11 +449,94 @@ ulog_entry_val_create(struct ulog *ulog, size_t offset, uint64_t *dest,
 	return e;
 }
 
+/*
+ * ulog_entry_val_append -- appends a value to the entry at the given offset
+ *	of the ulog, if the entry sets the word that directly precedes dest
+ *
+ * A single value entry is converted into a run of values. The entry cannot
+ * grow past max_size bytes. Returns 1 if the value was appended, 0 otherwise.
+ * Just like ulog_entry_val_create, this function requires at least
+ * a cacheline of space to be available past the end of the entry.
+ */
+int
+ulog_entry_val_append(struct ulog *ulog, size_t offset, uint64_t *dest,
+	uint64_t value, size_t max_size, const struct pmem_ops *p_ops)
+{
+	struct ulog_entry_base *e =
+		(struct ulog_entry_base *)(ulog->data + offset);
+	uint64_t dest_off = (uint64_t)(dest) - (uint64_t)p_ops->base;
+
+	struct ulog_entry_val *ev;
+	struct ulog_entry_vals *evs;
+
+	struct {
+		struct ulog_entry_vals vs;
+		uint64_t values[2];
+		struct ulog_entry_base zeroes;
+	} run;
+	COMPILE_ERROR_ON(sizeof(run) != ULOG_ENTRY_VALS_SIZE(2) +
+		sizeof(struct ulog_entry_base));
+
+	/*
+	 * The next value is stored either in the padding of the run or
+	 * in a new pair of words, the second of which becomes the padding.
+	 */
+	struct {
+		uint64_t value;
+		uint64_t padding;
+		struct ulog_entry_base zeroes;
+	} next;
+	COMPILE_ERROR_ON(sizeof(next) != 3 * sizeof(uint64_t));
+
+	switch (ulog_entry_type(e)) {
+		case ULOG_OPERATION_SET:
+			if (ulog_entry_offset(e) + sizeof(uint64_t) != dest_off ||
+			    ULOG_ENTRY_VALS_SIZE(2) > max_size)
+				return 0;
+
+			ev = (struct ulog_entry_val *)e;
+			run.vs.base.offset = ulog_entry_offset(e) |
+				ULOG_OPERATION(ULOG_OPERATION_SET_RUN);
+			run.vs.nvalues = 2;
+			run.values[0] = ev->value;
+			run.values[1] = value;
+			run.zeroes.offset = 0;
+
+			pmemops_memcpy(p_ops, e, &run, sizeof(run),
+				PMEMOBJ_F_MEM_NOFLUSH | PMEMOBJ_F_RELAXED);
+
+			return 1;
+		case ULOG_OPERATION_SET_RUN:
+			evs = (struct ulog_entry_vals *)e;
+			if (ulog_entry_offset(e) +
+			    evs->nvalues * sizeof(uint64_t) != dest_off ||
+			    ULOG_ENTRY_VALS_SIZE(evs->nvalues + 1) > max_size)
+				return 0;
+
+			next.value = value;
+			next.padding = 0;
+			next.zeroes.offset = 0;
+
+			pmemops_memcpy(p_ops, &evs->values[evs->nvalues],
+				&next, sizeof(next),
+				PMEMOBJ_F_MEM_NOFLUSH | PMEMOBJ_F_RELAXED);
+			evs->nvalues++;
+
+			return 1;
+		default:
+			return 0;
+	}
+}
+
 /*
  * ulog_entry_buf_create -- atomically creates a buffer entry in the log
+ *
+ * The entry is valid only as long as the generation number of the first
+ * ulog in the chain is equal to gen_num.
  */
 struct ulog_entry_buf *
-ulog_entry_buf_create(struct ulog *ulog, size_t offset, uint64_t *dest,
+ulog_entry_buf_create(struct ulog *ulog, size_t offset, uint64_t gen_num,
+	uint64_t *dest,
 	const void *src, uint64_t size,
 	ulog_operation_type type, const struct pmem_ops *p_ops)
 {
@@ -417,6 +556,9 @@ ulog_entry_buf_create(struct ulog *ulog, size_t offset, uint64_t *dest,
 	 *	remainder of the data, and copy the entire cacheline.
 	 *
 	 * This is done so that we avoid a cache-miss on misaligned writes.
+	 *
+	 * A set entry only logs the first byte of the source buffer, the one
+	 * the whole destination is filled with.
 	 */
 
 	struct ulog_entry_buf *b = alloca(CACHELINE_SIZE);
@@ -425,12 +567,15 @@ ulog_entry_buf_create(struct ulog *ulog, size_t offset, uint64_t *dest,
 	b->size = size;
 	b->checksum = 0;
 
+	size_t data_size = type == ULOG_OPERATION_BUF_SET ?
+		sizeof(uint8_t) : size;
+
 	size_t bdatasize = CACHELINE_SIZE - sizeof(struct ulog_entry_buf);
-	size_t ncopy = MIN(size, bdatasize);
+	size_t ncopy = MIN(data_size, bdatasize);
 	memcpy(b->data, src, ncopy);
 	memset(b->data + ncopy, 0, bdatasize - ncopy);
 
-	size_t remaining_size = ncopy > size ? 0 : size - ncopy;
+	size_t remaining_size = ncopy > data_size ? 0 : data_size - ncopy;
 
 	char *srcof = (char *)src + ncopy;
 	size_t rcopy = ALIGN_DOWN(remaining_size, CACHELINE_SIZE);
@@ -468,6 +613,7 @@ ulog_entry_buf_create(struct ulog *ulog, size_t offset, uint64_t *dest,
 	if (lcopy != 0)
 		b->checksum = util_checksum_seq(last_cacheline,
 			CACHELINE_SIZE, b->checksum);
+	b->checksum = ulog_entry_buf_checksum(b->checksum, gen_num);
 
 	ASSERT(IS_CACHELINE_ALIGNED(e));
 
@@ -478,11 +624,31 @@ ulog_entry_buf_create(struct ulog *ulog, size_t offset, uint64_t *dest,
 
 	pmemops_drain(p_ops);
 
-	ASSERT(ulog_entry_valid(&e->base));
-
 	return e;
 }
 
+/*
+ * ulog_entry_val_store -- (internal) applies a single value modification to
+ *	its destination, without flushing it
+ */
+static void
+ulog_entry_val_store(ulog_operation_type type, uint64_t value, uint64_t *dst)
+{
+	switch (type) {
+		case ULOG_OPERATION_AND:
+			*dst &= value;
+		break;
+		case ULOG_OPERATION_OR:
+			*dst |= value;
+		break;
+		case ULOG_OPERATION_SET:
+			*dst = value;
+		break;
+		default:
+			ASSERT(0);
+	}
+}
+
 /*
  * ulog_entry_apply -- applies modifications of a single ulog entry
  */
@@ -497,34 +663,31 @@ ulog_entry_apply(const struct ulog_entry_base *e, int persist,
 	uint64_t *dst = (uint64_t *)((uintptr_t)p_ops->base + offset);
 
 	struct ulog_entry_val *ev;
+	struct ulog_entry_vals *evs;
 	struct ulog_entry_buf *eb;
+	struct ulog_entry_cas *ec;
 
 	flush_fn f = persist ? p_ops->persist : p_ops->flush;
 
 	switch (t) {
 		case ULOG_OPERATION_AND:
-			ev = (struct ulog_entry_val *)e;
-
-			VALGRIND_ADD_TO_TX(dst, dst_size);
-			*dst &= ev->value;
-			f(p_ops->base, dst, sizeof(uint64_t),
-				PMEMOBJ_F_RELAXED);
-		break;
 		case ULOG_OPERATION_OR:
+		case ULOG_OPERATION_SET:
 			ev = (struct ulog_entry_val *)e;
 
 			VALGRIND_ADD_TO_TX(dst, dst_size);
-			*dst |= ev->value;
+			ulog_entry_val_store(t, ev->value, dst);
 			f(p_ops->base, dst, sizeof(uint64_t),
 				PMEMOBJ_F_RELAXED);
 		break;
-		case ULOG_OPERATION_SET:
-			ev = (struct ulog_entry_val *)e;
+		case ULOG_OPERATION_SET_RUN:
+			evs = (struct ulog_entry_vals *)e;
 
+			dst_size = evs->nvalues * sizeof(uint64_t);
 			VALGRIND_ADD_TO_TX(dst, dst_size);
-			*dst = ev->value;
-			f(p_ops->base, dst, sizeof(uint64_t),
-				PMEMOBJ_F_RELAXED);
+			for (uint64_t i = 0; i < evs->nvalues; ++i)
+				dst[i] = evs->values[i];
+			f(p_ops->base, dst, dst_size, PMEMOBJ_F_RELAXED);
 		break;
 		case ULOG_OPERATION_BUF_SET:
 			eb = (struct ulog_entry_buf *)e;
@@ -542,6 +705,18 @@ ulog_entry_apply(const struct ulog_entry_base *e, int persist,
 			pmemops_memcpy(p_ops, dst, eb->data, eb->size,
 				PMEMOBJ_F_RELAXED | PMEMOBJ_F_MEM_NODRAIN);
 		break;
+		case ULOG_OPERATION_BUF_CAS:
+			eb = (struct ulog_entry_buf *)e;
+			ASSERTeq(eb->size, sizeof(*ec));
+			ec = (struct ulog_entry_cas *)eb->data;
+
+			VALGRIND_ADD_TO_TX(dst, dst_size);
+			if (*dst == ec->expected) {
+				*dst = ec->desired;
+				f(p_ops->base, dst, sizeof(uint64_t),
+					PMEMOBJ_F_RELAXED);
+			}
+		break;
 		default:
 			ASSERT(0);
 	}
@@ -580,55 +755,81 @@ ulog_clobber(struct ulog *dest, struct ulog_next *next,
 }
 
 /*
- * ulog_clobber_data -- zeroes out 'nbytes' of data in the logs
+ * ulog_inc_gen_num -- starts a new generation of the ulog, which makes all
+ *	the entries of the previous one invalid
  */
 void
-ulog_clobber_data(struct ulog *dest,
-	size_t nbytes, size_t ulog_base_nbytes,
-	struct ulog_next *next, ulog_free_fn ulog_free,
-	const struct pmem_ops *p_ops)
+ulog_inc_gen_num(struct ulog *ulog, const struct pmem_ops *p_ops)
 {
-	size_t rcapacity = ulog_base_nbytes;
-	size_t nlog = 0;
-	ASSERTne(dest, NULL);
-
-	for (struct ulog *r = dest; r != NULL; ) {
-		size_t nzero = MIN(nbytes, rcapacity);
-		VALGRIND_ADD_TO_TX(r->data, nzero);
-		pmemops_memset(p_ops, r->data, 0, nzero, PMEMOBJ_F_MEM_WC);
-		VALGRIND_ADD_TO_TX(r->data, nzero);
-		nbytes -= nzero;
-
-		if (nbytes == 0)
-			break;
+	VALGRIND_ADD_TO_TX(&ulog->gen_num, sizeof(ulog->gen_num));
+	ulog->gen_num++;
+	pmemops_persist(p_ops, &ulog->gen_num, sizeof(ulog->gen_num));
+	VALGRIND_REMOVE_FROM_TX(&ulog->gen_num, sizeof(ulog->gen_num));
+}
 
-		r = ulog_by_offset(VEC_ARR(next)[nlog++], p_ops);
-		if (nlog > 1)
-			break;
+/*
+ * ulog_epoch_set -- tags the ulog with the epoch of the relaxed transaction
+ *	that committed it, 0 removes the tag
+ *
+ * The tag is only flushed, it's up to the caller to drain it.
+ */
+void
+ulog_epoch_set(struct ulog *ulog, uint64_t epoch,
+	const struct pmem_ops *p_ops)
+{
+	VALGRIND_ADD_TO_TX(&ulog->epoch, sizeof(ulog->epoch));
+	ulog->epoch = epoch;
+	pmemops_xflush(p_ops, &ulog->epoch, sizeof(ulog->epoch),
+		PMEMOBJ_F_RELAXED);
+	VALGRIND_REMOVE_FROM_TX(&ulog->epoch, sizeof(ulog->epoch));
+}
 
-		ASSERTne(r, NULL);
-		rcapacity = r->capacity;
+/*
+ * ulog_clobber_stale -- zeroes out the data left behind in the ulog and
+ *	its extensions
+ *
+ * Must be called on a ulog without valid entries.
+ */
+void
+ulog_clobber_stale(struct ulog *ulog, const struct pmem_ops *p_ops)
+{
+	for (struct ulog *r = ulog; r != NULL; r = ulog_next(r, p_ops)) {
+		if (util_is_zeroed(r->data, r->capacity))
+			continue;
+
+		VALGRIND_ADD_TO_TX(r->data, r->capacity);
+		pmemops_memset(p_ops, r->data, 0, r->capacity,
+			PMEMOBJ_F_MEM_WC);
+		VALGRIND_REMOVE_FROM_TX(r->data, r->capacity);
 	}
+}
 
+/*
+ * ulog_free_next -- frees all the ulog extensions past the first nkeep ones
+ */
+void
+ulog_free_next(struct ulog *ulog, size_t nkeep, ulog_free_fn ulog_free,
+	const struct pmem_ops *p_ops)
+{
 	/*
-	 * To make sure that transaction logs do not occupy too much of space,
-	 * all of them, expect for the first one, are freed at the end of
-	 * the operation. The reasoning for this is that pmalloc() is
-	 * a relatively cheap operation for transactions where many hundreds of
-	 * kilobytes are being snapshot, and so, allocating and freeing the
-	 * buffer for each transaction is an acceptable overhead for the average
-	 * case.
+	 * The extensions that are kept are reused by the next operations
+	 * without going through the allocator, the remaining ones are freed
+	 * so that the logs do not occupy too much of space. The extensions
+	 * are freed starting from the last one so that the chain is valid at
+	 * all times.
 	 */
-	struct ulog *u = ulog_by_offset(dest->next, p_ops);
+	struct ulog *u = ulog;
+	for (size_t i = 0; i < nkeep && u != NULL; ++i)
+		u = ulog_by_offset(u->next, p_ops);
 	if (u == NULL)
 		return;
 
-	VEC(, uint64_t *) logs_past_first;
-	VEC_INIT(&logs_past_first);
+	VEC(, uint64_t *) logs_past_kept;
+	VEC_INIT(&logs_past_kept);
 
 	size_t next_offset;
 	while (u != NULL && ((next_offset = u->next) != 0)) {
-		if (VEC_PUSH_BACK(&logs_past_first, &u->next) != 0) {
+		if (VEC_PUSH_BACK(&logs_past_kept, &u->next) != 0) {
 			/* this is fine, it will just use more pmem */
 			LOG(1, "unable to free transaction logs memory");
 			goto out;
@@ -637,12 +838,12 @@ ulog_clobber_data(struct ulog *dest,
 	}
 
 	uint64_t *ulog_ptr;
-	VEC_FOREACH_REVERSE(ulog_ptr, &logs_past_first) {
+	VEC_FOREACH_REVERSE(ulog_ptr, &logs_past_kept) {
 		ulog_free(p_ops->base, ulog_ptr);
 	}
 
 out:
-	VEC_DELETE(&logs_past_first);
+	VEC_DELETE(&logs_past_kept);
 }
 
 /*
@@ -662,6 +863,136 @@ ulog_process(struct ulog *ulog, ulog_check_offset_fn check,
 	ulog_foreach_entry(ulog, ulog_process_entry, NULL, p_ops);
 }
 
+/*
+ * ulog_collect_entry -- (internal) gathers the modifications of the value
+ *	entries of the ulog, fails on any other type of entry
+ */
+static int
+ulog_collect_entry(struct ulog_entry_base *e, void *arg,
+	const struct pmem_ops *p_ops)
+{
+	struct ulog_entries *entries = arg;
+
+	struct ulog_val_ref ref;
+	ref.offset = ulog_entry_offset(e);
+	ref.seq = VEC_SIZE(entries);
+
+	struct ulog_entry_vals *evs;
+
+	switch (ulog_entry_type(e)) {
+		case ULOG_OPERATION_AND:
+		case ULOG_OPERATION_OR:
+		case ULOG_OPERATION_SET:
+			ref.type = ulog_entry_type(e);
+			ref.value = &((struct ulog_entry_val *)e)->value;
+			return VEC_PUSH_BACK(entries, ref);
+		case ULOG_OPERATION_SET_RUN:
+			evs = (struct ulog_entry_vals *)e;
+			ref.type = ULOG_OPERATION_SET;
+			for (uint64_t i = 0; i < evs->nvalues; ++i) {
+				ref.value = &evs->values[i];
+				if (VEC_PUSH_BACK(entries, ref) != 0)
+					return -1;
+				ref.offset += sizeof(uint64_t);
+				ref.seq++;
+			}
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+/*
+ * ulog_val_ref_cmp -- (internal) orders modifications by their destination,
+ *	the ones with the same destination stay in the log order
+ */
+static int
+ulog_val_ref_cmp(const void *lhs, const void *rhs)
+{
+	const struct ulog_val_ref *l = lhs;
+	const struct ulog_val_ref *r = rhs;
+
+	if (l->offset != r->offset)
+		return l->offset < r->offset ? -1 : 1;
+
+	if (l->seq != r->seq)
+		return l->seq < r->seq ? -1 : 1;
+
+	return 0;
+}
+
+/*
+ * ulog_process_coalesced -- applies the ulog entries in the order of their
+ *	destination addresses, flushing every modified cacheline only once
+ *
+ * The log is expected to contain only value entries, which is the case for
+ * the redo logs without published buffers. Otherwise, or if there's not
+ * enough memory to sort the entries, the log is processed as is. The changes
+ * are drained before returning, so that the log can be safely discarded
+ * afterwards.
+ *
+ * The entries vector is used as scratch space, it's kept by the caller only
+ * to avoid reallocating it for every operation.
+ */
+void
+ulog_process_coalesced(struct ulog *ulog, struct ulog_entries *entries,
+	ulog_check_offset_fn check, const struct pmem_ops *p_ops)
+{
+	LOG(15, "ulog %p", ulog);
+
+#ifdef DEBUG
+	if (check)
+		ulog_check(ulog, check, p_ops);
+#endif
+
+	VEC_CLEAR(entries);
+	if (ulog_foreach_entry(ulog, ulog_collect_entry, entries,
+	    p_ops) != 0) {
+		ulog_foreach_entry(ulog, ulog_process_entry, NULL, p_ops);
+		pmemops_drain(p_ops);
+		return;
+	}
+
+	qsort(VEC_ARR(entries), VEC_SIZE(entries), sizeof(*VEC_ARR(entries)),
+		ulog_val_ref_cmp);
+
+	/* dirty range of the current cacheline */
+	char *begin = NULL;
+	char *end = NULL;
+
+	struct ulog_val_ref *ref;
+	VEC_FOREACH_BY_PTR(ref, entries) {
+		uint64_t *dst = (uint64_t *)((uintptr_t)p_ops->base +
+			ref->offset);
+
+		if (begin != NULL && ALIGN_DOWN((uintptr_t)dst,
+		    CACHELINE_SIZE) != ALIGN_DOWN((uintptr_t)begin,
+		    CACHELINE_SIZE)) {
+			pmemops_xflush(p_ops, begin, (size_t)(end - begin),
+				PMEMOBJ_F_RELAXED);
+			begin = NULL;
+		}
+
+		VALGRIND_ADD_TO_TX(dst, sizeof(*dst));
+		ulog_entry_val_store(ref->type, *ref->value, dst);
+		VALGRIND_REMOVE_FROM_TX(dst, sizeof(*dst));
+
+		if (begin == NULL) {
+			begin = (char *)dst;
+			end = (char *)(dst + 1);
+		} else {
+			begin = MIN(begin, (char *)dst);
+			end = MAX(end, (char *)(dst + 1));
+		}
+	}
+
+	if (begin != NULL)
+		pmemops_xflush(p_ops, begin, (size_t)(end - begin),
+			PMEMOBJ_F_RELAXED);
+
+	pmemops_drain(p_ops);
+}
+
 /*
  * ulog_base_nbytes -- (internal) counts the actual of number of bytes
  *	occupied by the ulog
@@ -674,7 +1005,7 @@ ulog_base_nbytes(struct ulog *ulog)
 
 	for (offset = 0; offset < ulog->capacity; ) {
 		e = (struct ulog_entry_base *)(ulog->data + offset);
-		if (!ulog_entry_valid(e))
+		if (!ulog_entry_valid(ulog, e, ulog->capacity - offset))
 			break;
 
 		offset += ulog_entry_size(e);
@@ -712,6 +1043,7 @@ ulog_recover(struct ulog *ulog, ulog_check_offset_fn check,
 
 	if (ulog_recovery_needed(ulog, 1)) {
 		ulog_process(ulog, check, p_ops);
+		pmemops_drain(p_ops);
 		ulog_clobber(ulog, NULL, p_ops);
 	}
 }
@@ -55,8 +55,31 @@ struct ulog_entry_val {
 	uint64_t value; /* value to be applied */
 };
 
+/*
+ * ulog_entry_vals -- log entry of values for consecutive 8-byte words
+ */
+struct ulog_entry_vals {
+	struct ulog_entry_base base;
+	uint64_t nvalues; /* number of values that follow */
+	uint64_t values[]; /* values to be applied */
+};
+
+/*
+ * Runs are padded so that all the entries stay 16-byte aligned, which keeps
+ * the single value entries from crossing the end of a ulog.
+ */
+#define ULOG_ENTRY_VALS_SIZE(nvalues)\
+	ALIGN_UP(sizeof(struct ulog_entry_vals) +\
+	(nvalues) * sizeof(uint64_t), sizeof(struct ulog_entry_val))
+
 /*
  * ulog_entry_buf - ulog buffer entry
+ *
+ * A set entry only stores the value the range is filled with, in the first
+ * byte of data, so it always occupies a single cacheline.
+ *
+ * A compare-and-swap entry stores a pair of words, the single word at the
+ * destination is set to the second one only if it still holds the first one.
  */
 struct ulog_entry_buf {
 	struct ulog_entry_base base; /* offset with operation type flag */
@@ -75,7 +98,9 @@ struct ulog_entry_buf {
 	uint64_t checksum; /* checksum of ulog header and its entries */\
 	uint64_t next; /* offset of ulog extension */\
 	uint64_t capacity; /* capacity of this ulog in bytes */\
-	uint64_t unused[5]; /* must be 0 */\
+	uint64_t epoch; /* epoch of a committed relaxed transaction or 0 */\
+	uint64_t gen_num; /* generation of the entries, 0 if not used */\
+	uint64_t unused[3]; /* must be 0 */\
 	uint8_t data[capacity_bytes]; /* N bytes of data */\
 }\
 
@@ -90,11 +115,32 @@ struct ulog ULOG(0);
 
 VEC(ulog_next, uint64_t);
 
+/* the data of a compare-and-swap entry */
+struct ulog_entry_cas {
+	uint64_t expected; /* value the destination has to hold */
+	uint64_t desired; /* value the destination is set to */
+};
+
 typedef uint64_t ulog_operation_type;
 
+/*
+ * ulog_val_ref -- a single 8-byte modification of a ulog, referenced when
+ *	the entries are reordered
+ */
+struct ulog_val_ref {
+	uint64_t offset; /* destination of the modification */
+	ulog_operation_type type;
+	const uint64_t *value;
+	size_t seq; /* position of the entry in the log */
+};
+
+VEC(ulog_entries, struct ulog_val_ref);
+
 #define ULOG_OPERATION_SET		(0b000ULL << 61ULL)
 #define ULOG_OPERATION_AND		(0b001ULL << 61ULL)
 #define ULOG_OPERATION_OR		(0b010ULL << 61ULL)
+#define ULOG_OPERATION_SET_RUN		(0b011ULL << 61ULL)
+#define ULOG_OPERATION_BUF_CAS		(0b100ULL << 61ULL)
 #define ULOG_OPERATION_BUF_SET		(0b101ULL << 61ULL)
 #define ULOG_OPERATION_BUF_CPY		(0b110ULL << 61ULL)
 
@@ -108,8 +154,8 @@ typedef void (*ulog_free_fn)(void *base, uint64_t *next);
 
 struct ulog *ulog_next(struct ulog *ulog, const struct pmem_ops *p_ops);
 
-void ulog_construct(uint64_t offset, size_t capacity, int flush,
-	const struct pmem_ops *p_ops);
+void ulog_construct(uint64_t offset, size_t capacity, uint64_t gen_num,
+	int flush, const struct pmem_ops *p_ops);
 
 size_t ulog_capacity(struct ulog *ulog, size_t ulog_base_bytes,
 	const struct pmem_ops *p_ops);
@@ -130,13 +176,17 @@ void ulog_store(struct ulog *dest,
 
 void ulog_clobber(struct ulog *dest, struct ulog_next *next,
 	const struct pmem_ops *p_ops);
-void ulog_clobber_data(struct ulog *dest,
-	size_t nbytes, size_t ulog_base_nbytes,
-	struct ulog_next *next, ulog_free_fn ulog_free,
+void ulog_inc_gen_num(struct ulog *ulog, const struct pmem_ops *p_ops);
+void ulog_epoch_set(struct ulog *ulog, uint64_t epoch,
+	const struct pmem_ops *p_ops);
+void ulog_clobber_stale(struct ulog *ulog, const struct pmem_ops *p_ops);
+void ulog_free_next(struct ulog *ulog, size_t nkeep, ulog_free_fn ulog_free,
 	const struct pmem_ops *p_ops);
 
 void ulog_process(struct ulog *ulog, ulog_check_offset_fn check,
 	const struct pmem_ops *p_ops);
+void ulog_process_coalesced(struct ulog *ulog, struct ulog_entries *entries,
+	ulog_check_offset_fn check, const struct pmem_ops *p_ops);
 
 size_t ulog_base_nbytes(struct ulog *ulog);
 int ulog_recovery_needed(struct ulog *ulog, int verify_checksum);
@@ -150,8 +200,12 @@ struct ulog_entry_val *ulog_entry_val_create(struct ulog *ulog,
 	ulog_operation_type type,
 	const struct pmem_ops *p_ops);
 
+int ulog_entry_val_append(struct ulog *ulog, size_t offset,
+	uint64_t *dest, uint64_t value, size_t max_size,
+	const struct pmem_ops *p_ops);
+
 struct ulog_entry_buf *
-ulog_entry_buf_create(struct ulog *ulog, size_t offset,
+ulog_entry_buf_create(struct ulog *ulog, size_t offset, uint64_t gen_num,
 	uint64_t *dest, const void *src, uint64_t size,
 	ulog_operation_type type, const struct pmem_ops *p_ops);
 
@@ -65,11 +65,33 @@ fletcher64(void *addr, size_t len)
 	return htole64((uint64_t)hi32 << 32 | lo32);
 }
 
+/*
+ * test_seq -- verify util_checksum_seq() against the gold standard, for
+ * every length of the buffer and with the buffer split in two parts
+ */
+static void
+test_seq(void *addr, size_t size)
+{
+	for (size_t len = 0; len <= size; len += 4) {
+		uint64_t gold_csum = le64toh(fletcher64(addr, len));
+
+		UT_ASSERTeq(util_checksum_seq(addr, len, 0), gold_csum);
+
+		size_t split = (len / 3) & ~(size_t)3;
+		uint64_t csum = util_checksum_seq(addr, split, 0);
+		csum = util_checksum_seq((char *)addr + split,
+			len - split, csum);
+		UT_ASSERTeq(csum, gold_csum);
+	}
+}
+
 int
 main(int argc, char *argv[])
 {
 	START(argc, argv, "checksum");
 
+	util_init();
+
 	if (argc < 2)
 		UT_FATAL("usage: %s files...", argv[0]);
 
@@ -84,6 +106,8 @@ main(int argc, char *argv[])
 			MMAP(NULL, size, PROT_READ|PROT_WRITE,
 					MAP_PRIVATE, fd, 0);
 
+		test_seq(addr, size);
+
 		uint64_t *ptr = addr;
 
 		/*
@@ -165,6 +189,25 @@ main(int argc, char *argv[])
 			UT_ASSERTeq(*csum, gold_csum);
 		}
 
+		/*
+		 * the ignored part which does not start on an 8-byte
+		 * boundary is treated as zeros in pairs of 32-bit words,
+		 * so it effectively extends by 4 bytes past the end
+		 */
+		if (size % 8 == 0) {
+			for (size_t off = size - 4; off > 8; off -= 8) {
+				*csum = 0;
+				uint64_t gold = le64toh(fletcher64(addr, off));
+				uint32_t lo32 = (uint32_t)gold;
+				uint32_t hi32 = (uint32_t)(gold >> 32) +
+					(uint32_t)((size - off) / 4 + 1) * lo32;
+				gold = htole64((uint64_t)hi32 << 32 | lo32);
+
+				util_checksum(addr, size, csum, 1, off);
+				UT_ASSERTeq(*csum, gold);
+			}
+		}
+
 		CLOSE(fd);
 		MUNMAP(addr, size);
 		MUNMAP(addr2, size);
@@ -214,6 +214,126 @@ test_many_sets(PMEMobjpool *pop, size_t n)
 	FREE(act);
 }
 
+#define BUF_SIZE 10000
+#define BUF_NRESV 8
+
+static void
+test_set_buf(PMEMobjpool *pop)
+{
+	struct pobj_action act[BUF_NRESV + 4];
+	PMEMoid resv[BUF_NRESV];
+	PMEMoid oid;
+	int ret = pmemobj_zalloc(pop, &oid, BUF_SIZE + 32, 0);
+	UT_ASSERTeq(ret, 0);
+
+	char *dest = (char *)pmemobj_direct(oid);
+	uint64_t *values = (uint64_t *)dest;
+
+	char *src = (char *)MALLOC(BUF_SIZE);
+	for (size_t i = 0; i < BUF_SIZE; ++i)
+		src[i] = (char)(i % 251 + 1);
+
+	/* the reservations and the buffers are published all at once */
+	size_t n = 0;
+	for (size_t i = 0; i < BUF_NRESV; ++i) {
+		resv[i] = pmemobj_reserve(pop, &act[n++], 128, 0);
+		UT_ASSERT(!OID_IS_NULL(resv[i]));
+	}
+	pmemobj_set_value(pop, &act[n++], values, 1);
+	ret = pmemobj_set_buf(pop, &act[n++], dest + 19, src, BUF_SIZE);
+	UT_ASSERTeq(ret, 0);
+	pmemobj_set_value(pop, &act[n++], values + 1, 2);
+	ret = pmemobj_set_buf(pop, &act[n++], dest + 19 + BUF_SIZE, "abc", 3);
+	UT_ASSERTeq(ret, 0);
+
+	/* the source buffer is copied when the action is created */
+	memset(src, 0, BUF_SIZE);
+
+	UT_ASSERTeq(pmemobj_publish(pop, act, n), 0);
+
+	for (size_t i = 0; i < BUF_SIZE; ++i)
+		UT_ASSERTeq(dest[19 + i], (char)(i % 251 + 1));
+	UT_ASSERTeq(memcmp(dest + 19 + BUF_SIZE, "abc", 3), 0);
+	UT_ASSERTeq(values[0], 1);
+	UT_ASSERTeq(values[1], 2);
+
+	for (size_t i = 0; i < BUF_NRESV; ++i)
+		pmemobj_free(&resv[i]);
+
+	/* a canceled buffer is discarded */
+	ret = pmemobj_set_buf(pop, &act[0], dest, src, BUF_SIZE);
+	UT_ASSERTeq(ret, 0);
+	pmemobj_cancel(pop, act, 1);
+	UT_ASSERTeq(values[0], 1);
+
+	/* and so is one of an aborted transaction */
+	ret = pmemobj_set_buf(pop, &act[0], dest, src, 64);
+	UT_ASSERTeq(ret, 0);
+	TX_BEGIN(pop) {
+		pmemobj_tx_publish(act, 1);
+		pmemobj_tx_abort(EINVAL);
+	} TX_ONCOMMIT {
+		UT_ASSERT(0);
+	} TX_END
+	UT_ASSERTeq(values[0], 1);
+
+	ret = pmemobj_set_buf(pop, &act[0], dest, src, 64);
+	UT_ASSERTeq(ret, 0);
+	TX_BEGIN(pop) {
+		pmemobj_tx_publish(act, 1);
+	} TX_ONABORT {
+		UT_ASSERT(0);
+	} TX_END
+	UT_ASSERTeq(values[0], 0);
+
+	ret = pmemobj_set_buf(pop, &act[0], src, src, BUF_SIZE);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	ret = pmemobj_set_buf(pop, &act[0], dest, src, 0);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	pmemobj_free(&oid);
+	FREE(src);
+}
+
+#define BUF_OOM_SIZE (3 << 20)
+
+/*
+ * test_set_buf_oom -- publishes a buffer that doesn't fit in the log
+ */
+static void
+test_set_buf_oom(PMEMobjpool *pop)
+{
+	struct pobj_action act;
+	PMEMoid oid;
+	int ret = pmemobj_zalloc(pop, &oid, BUF_OOM_SIZE, 0);
+	UT_ASSERTeq(ret, 0);
+
+	char *dest = (char *)pmemobj_direct(oid);
+
+	char *src = (char *)MALLOC(BUF_OOM_SIZE);
+	memset(src, 0xc, BUF_OOM_SIZE);
+
+	/* there's no room left in the pool to extend the log */
+	ret = pmemobj_set_buf(pop, &act, dest, src, BUF_OOM_SIZE);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(pmemobj_publish(pop, &act, 1), -1);
+	pmemobj_cancel(pop, &act, 1);
+
+	for (size_t i = 0; i < BUF_OOM_SIZE; ++i)
+		UT_ASSERTeq(dest[i], 0);
+
+	/* the lane is released after the failure */
+	ret = pmemobj_set_buf(pop, &act, dest, src, 64);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(pmemobj_publish(pop, &act, 1), 0);
+	UT_ASSERTeq(dest[0], 0xc);
+
+	pmemobj_free(&oid);
+	FREE(src);
+}
 
 int
 main(int argc, char *argv[])
@@ -230,6 +350,9 @@ main(int argc, char *argv[])
 	if (pop == NULL)
 		UT_FATAL("!pmemobj_create: %s", path);
 
+	/* needs most of the heap to be free */
+	test_set_buf_oom(pop);
+
 	PMEMoid root = pmemobj_root(pop, sizeof(struct root));
 	struct root *rootp = (struct root *)pmemobj_direct(root);
 
@@ -323,6 +446,8 @@ main(int argc, char *argv[])
 	test_many(pop, POBJ_MAX_ACTIONS * 2);
 	test_many_sets(pop, POBJ_MAX_ACTIONS * 2);
 
+	test_set_buf(pop);
+
 	pmemobj_close(pop);
 
 	DONE(NULL);
@@ -0,0 +1,189 @@
+/*
+ * Copyright 2019, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * obj_ctl_group_commit.c -- tests for the ctl entry points: tx.group_commit
+ */
+
+#include "unittest.h"
+
+#define LAYOUT "obj_ctl_group_commit"
+#define NTHREADS 8
+#define NOPS 200
+
+struct root {
+	uint64_t counters[NTHREADS];
+	PMEMoid objs[NTHREADS];
+};
+
+static PMEMobjpool *pop;
+
+/*
+ * tx_thread -- commits transactions which snapshot and allocate
+ */
+static void *
+tx_thread(void *arg)
+{
+	unsigned idx = *(unsigned *)arg;
+	struct root *rootp = pmemobj_direct(pmemobj_root(pop,
+		sizeof(struct root)));
+
+	for (unsigned i = 0; i < NOPS; ++i) {
+		TX_BEGIN(pop) {
+			pmemobj_tx_add_range_direct(&rootp->objs[idx],
+				sizeof(PMEMoid));
+			if (!OID_IS_NULL(rootp->objs[idx]))
+				pmemobj_tx_free(rootp->objs[idx]);
+			rootp->objs[idx] = pmemobj_tx_alloc(64, 0);
+		} TX_ONABORT {
+			UT_ASSERT(0);
+		} TX_END
+
+		TX_BEGIN(pop) {
+			pmemobj_tx_add_range_direct(&rootp->counters[idx],
+				sizeof(uint64_t));
+			rootp->counters[idx]++;
+			if (i % 2)
+				pmemobj_tx_abort(ECANCELED);
+		} TX_END
+	}
+
+	return NULL;
+}
+
+/*
+ * run_transactions -- runs transactions from multiple threads
+ */
+static void
+run_transactions(void)
+{
+	os_thread_t threads[NTHREADS];
+	unsigned idx[NTHREADS];
+
+	for (unsigned i = 0; i < NTHREADS; ++i) {
+		idx[i] = i;
+		PTHREAD_CREATE(&threads[i], NULL, tx_thread, &idx[i]);
+	}
+
+	for (unsigned i = 0; i < NTHREADS; ++i)
+		PTHREAD_JOIN(&threads[i], NULL);
+}
+
+/*
+ * set_group_commit -- sets the group commit parameters
+ */
+static void
+set_group_commit(int batch, int window)
+{
+	int ret = pmemobj_ctl_set(pop, "tx.group_commit.batch", &batch);
+	UT_ASSERTeq(ret, 0);
+	ret = pmemobj_ctl_set(pop, "tx.group_commit.window", &window);
+	UT_ASSERTeq(ret, 0);
+
+	int val;
+	ret = pmemobj_ctl_get(pop, "tx.group_commit.batch", &val);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(val, batch);
+	ret = pmemobj_ctl_get(pop, "tx.group_commit.window", &val);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(val, window);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "obj_ctl_group_commit");
+
+	if (argc != 2)
+		UT_FATAL("usage: %s file-name", argv[0]);
+
+	const char *path = argv[1];
+
+	if ((pop = pmemobj_create(path, LAYOUT, PMEMOBJ_MIN_POOL,
+		S_IWUSR | S_IRUSR)) == NULL)
+		UT_FATAL("!pmemobj_create: %s", path);
+
+	/* group commit is disabled by default */
+	int val;
+	int ret = pmemobj_ctl_get(pop, "tx.group_commit.batch", &val);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(val, 0);
+
+	val = -1;
+	ret = pmemobj_ctl_set(pop, "tx.group_commit.batch", &val);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	ret = pmemobj_ctl_set(pop, "tx.group_commit.window", &val);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	val = 1000000;
+	ret = pmemobj_ctl_set(pop, "tx.group_commit.window", &val);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	run_transactions();
+
+	/* groups formed only by transactions queued behind the leader */
+	set_group_commit(NTHREADS, 0);
+	run_transactions();
+
+	/* groups filled up within the window */
+	set_group_commit(NTHREADS / 2, 100);
+	run_transactions();
+
+	/* groups which cannot ever fill up */
+	set_group_commit(NTHREADS * 2, 10);
+	run_transactions();
+
+	struct root *rootp = pmemobj_direct(pmemobj_root(pop,
+		sizeof(struct root)));
+	for (unsigned i = 0; i < NTHREADS; ++i)
+		UT_ASSERTeq(rootp->counters[i], 4 * NOPS / 2);
+
+	pmemobj_close(pop);
+
+	ret = pmemobj_check(path, LAYOUT);
+	UT_ASSERTeq(ret, 1);
+
+	pop = pmemobj_open(path, LAYOUT);
+	UT_ASSERTne(pop, NULL);
+
+	rootp = pmemobj_direct(pmemobj_root(pop, sizeof(struct root)));
+	for (unsigned i = 0; i < NTHREADS; ++i)
+		UT_ASSERTeq(rootp->counters[i], 4 * NOPS / 2);
+
+	pmemobj_close(pop);
+
+	DONE(NULL);
+}
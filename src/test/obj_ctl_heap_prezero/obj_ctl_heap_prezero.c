@@ -0,0 +1,214 @@
+/*
+ * Copyright 2018, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * obj_ctl_heap_prezero.c -- tests for the ctl entry point: heap.size.prezero
+ */
+
+#include <inttypes.h>
+
+#include "unittest.h"
+
+#define LAYOUT "obj_ctl_heap_prezero"
+#define POOL_SIZE ((1 << 20) * 64)
+#define PREZERO_SIZE ((1 << 20) * 16)
+#define OBJ_SIZE ((1 << 20) - 64) /* fits exactly in 4 chunks */
+#define MAX_OBJS (POOL_SIZE / OBJ_SIZE)
+#define ZALLOC_OBJS 8
+#define DIRTY_PATTERN 0xAC
+
+/* chunks that are being zeroed are temporarily unavailable */
+#define MAX_OBJS_IN_FLIGHT 4
+
+/* the worker has plenty of time to zero the requested amount of memory */
+#define PREZERO_WAIT_MS 30000
+
+static PMEMoid oids[MAX_OBJS];
+
+/*
+ * alloc_all -- allocates objects until OOM, optionally dirtying them
+ */
+static int
+alloc_all(PMEMobjpool *pop, int dirty)
+{
+	int n = 0;
+	while (n < MAX_OBJS &&
+		pmemobj_alloc(pop, &oids[n], OBJ_SIZE, 0, NULL, NULL) == 0) {
+		if (dirty)
+			pmemobj_memset_persist(pop, pmemobj_direct(oids[n]),
+				DIRTY_PATTERN, OBJ_SIZE);
+		n++;
+	}
+
+	return n;
+}
+
+/*
+ * free_all -- frees the objects allocated by alloc_all
+ */
+static void
+free_all(int n)
+{
+	for (int i = 0; i < n; ++i)
+		pmemobj_free(&oids[i]);
+}
+
+/*
+ * wait_prezeroed -- waits until the requested amount of free memory is zeroed
+ *	in the background
+ */
+static void
+wait_prezeroed(PMEMobjpool *pop)
+{
+	uint64_t zeroed = 0;
+	for (int ms = 0; ms < PREZERO_WAIT_MS; ++ms) {
+		int ret = pmemobj_ctl_get(pop, "heap.size.prezeroed", &zeroed);
+		UT_ASSERTeq(ret, 0);
+		if (zeroed >= PREZERO_SIZE)
+			return;
+
+		usleep(1000);
+	}
+
+	UT_FATAL("only %" PRIu64 " bytes were zeroed in the background",
+		zeroed);
+}
+
+/*
+ * prezero_hits -- returns the number of allocations served from the memory
+ *	zeroed in the background
+ */
+static uint64_t
+prezero_hits(PMEMobjpool *pop)
+{
+	uint64_t hits;
+	int ret = pmemobj_ctl_get(pop, "stats.heap.prezero_hits", &hits);
+	UT_ASSERTeq(ret, 0);
+
+	return hits;
+}
+
+/*
+ * check_zeroed -- verifies that the object contains only zeroes
+ */
+static void
+check_zeroed(PMEMoid oid)
+{
+	char *buf = pmemobj_direct(oid);
+	for (size_t i = 0; i < OBJ_SIZE; ++i)
+		UT_ASSERTeq(buf[i], 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "obj_ctl_heap_prezero");
+
+	if (argc != 2)
+		UT_FATAL("usage: %s file-name", argv[0]);
+
+	const char *path = argv[1];
+
+	PMEMobjpool *pop;
+
+	if ((pop = pmemobj_create(path, LAYOUT, POOL_SIZE,
+		S_IWUSR | S_IRUSR)) == NULL)
+		UT_FATAL("!pmemobj_create: %s", path);
+
+	int enabled = 1;
+	int ret = pmemobj_ctl_set(pop, "stats.enabled", &enabled);
+	UT_ASSERTeq(ret, 0);
+
+	ssize_t size;
+	ret = pmemobj_ctl_get(pop, "heap.size.prezero", &size);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(size, 0);
+
+	size = -1;
+	ret = pmemobj_ctl_set(pop, "heap.size.prezero", &size);
+	UT_ASSERTeq(ret, -1);
+
+	/* leave non-zero garbage in all of the free chunks */
+	int nobjs = alloc_all(pop, 1);
+	UT_ASSERT(nobjs > ZALLOC_OBJS);
+	free_all(nobjs);
+
+	size = PREZERO_SIZE;
+	ret = pmemobj_ctl_set(pop, "heap.size.prezero", &size);
+	UT_ASSERTeq(ret, 0);
+
+	ssize_t curr_size;
+	ret = pmemobj_ctl_get(pop, "heap.size.prezero", &curr_size);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(curr_size, size);
+
+	/*
+	 * Once enough memory is zeroed in the background, the zeroed
+	 * allocations are served from it, and must return zeroed memory even
+	 * though the chunks were dirty before.
+	 */
+	for (int i = 0; i < ZALLOC_OBJS; ++i) {
+		wait_prezeroed(pop);
+		ret = pmemobj_zalloc(pop, &oids[i], OBJ_SIZE, 0);
+		UT_ASSERTeq(ret, 0);
+		UT_ASSERTeq(prezero_hits(pop), (uint64_t)i + 1);
+		check_zeroed(oids[i]);
+		pmemobj_memset_persist(pop, pmemobj_direct(oids[i]),
+			DIRTY_PATTERN, OBJ_SIZE);
+	}
+	free_all(ZALLOC_OBJS);
+
+	wait_prezeroed(pop);
+	TX_BEGIN(pop) {
+		oids[0] = pmemobj_tx_zalloc(OBJ_SIZE, 0);
+		check_zeroed(oids[0]);
+	} TX_ONCOMMIT {
+		UT_ASSERTeq(prezero_hits(pop), ZALLOC_OBJS + 1);
+		check_zeroed(oids[0]);
+	} TX_ONABORT {
+		UT_ASSERT(0);
+	} TX_END
+	free_all(1);
+
+	/* the zeroed chunks must be usable by regular allocations */
+	int nobjs_prezero = alloc_all(pop, 0);
+	UT_ASSERT(nobjs_prezero >= nobjs - MAX_OBJS_IN_FLIGHT);
+	free_all(nobjs_prezero);
+
+	size = 0;
+	ret = pmemobj_ctl_set(pop, "heap.size.prezero", &size);
+	UT_ASSERTeq(ret, 0);
+
+	pmemobj_close(pop);
+
+	DONE(NULL);
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2018, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * obj_ctl_post_commit.c -- tests for the ctl entry points: tx.post_commit
+ */
+
+#include <sched.h>
+
+#include "unittest.h"
+
+#define LAYOUT "obj_ctl_post_commit"
+#define NWORKERS 2
+#define NTHREADS 4
+#define NOPS 500
+#define QUEUE_DEPTH 8
+
+struct root {
+	uint64_t counters[NTHREADS];
+	PMEMoid objs[NTHREADS];
+};
+
+static PMEMobjpool *pop;
+
+/*
+ * worker -- processes the post commit tasks until stopped
+ */
+static void *
+worker(void *arg)
+{
+	int ret = pmemobj_ctl_get(pop, "tx.post_commit.worker", arg);
+	UT_ASSERTeq(ret, 0);
+
+	return NULL;
+}
+
+/*
+ * tx_thread -- commits transactions which snapshot and allocate
+ */
+static void *
+tx_thread(void *arg)
+{
+	unsigned idx = *(unsigned *)arg;
+	struct root *rootp = pmemobj_direct(pmemobj_root(pop,
+		sizeof(struct root)));
+
+	for (unsigned i = 0; i < NOPS; ++i) {
+		TX_BEGIN(pop) {
+			pmemobj_tx_add_range_direct(&rootp->objs[idx],
+				sizeof(PMEMoid));
+			if (!OID_IS_NULL(rootp->objs[idx]))
+				pmemobj_tx_free(rootp->objs[idx]);
+			rootp->objs[idx] = pmemobj_tx_alloc(64, 0);
+		} TX_ONABORT {
+			UT_ASSERT(0);
+		} TX_END
+
+		TX_BEGIN(pop) {
+			pmemobj_tx_add_range_direct(&rootp->counters[idx],
+				sizeof(uint64_t));
+			rootp->counters[idx]++;
+			if (i % 2)
+				pmemobj_tx_abort(ECANCELED);
+		} TX_END
+	}
+
+	return NULL;
+}
+
+/*
+ * run_transactions -- runs transactions from multiple threads
+ */
+static void
+run_transactions(void)
+{
+	os_thread_t threads[NTHREADS];
+	unsigned idx[NTHREADS];
+
+	for (unsigned i = 0; i < NTHREADS; ++i) {
+		idx[i] = i;
+		PTHREAD_CREATE(&threads[i], NULL, tx_thread, &idx[i]);
+	}
+
+	for (unsigned i = 0; i < NTHREADS; ++i)
+		PTHREAD_JOIN(&threads[i], NULL);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "obj_ctl_post_commit");
+
+	if (argc != 2)
+		UT_FATAL("usage: %s file-name", argv[0]);
+
+	const char *path = argv[1];
+
+	if ((pop = pmemobj_create(path, LAYOUT, PMEMOBJ_MIN_POOL,
+		S_IWUSR | S_IRUSR)) == NULL)
+		UT_FATAL("!pmemobj_create: %s", path);
+
+	int depth;
+	int ret = pmemobj_ctl_get(pop, "tx.post_commit.queue_depth", &depth);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(depth, 0);
+
+	/* the queue is disabled by default */
+	ret = pmemobj_ctl_get(pop, "tx.post_commit.worker", &depth);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	depth = -1;
+	ret = pmemobj_ctl_set(pop, "tx.post_commit.queue_depth", &depth);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	depth = QUEUE_DEPTH;
+	ret = pmemobj_ctl_set(pop, "tx.post_commit.queue_depth", &depth);
+	UT_ASSERTeq(ret, 0);
+
+	os_thread_t workers[NWORKERS];
+	for (unsigned i = 0; i < NWORKERS; ++i)
+		PTHREAD_CREATE(&workers[i], NULL, worker, pop);
+
+	/* the depth cannot be changed once the workers are running */
+	while (pmemobj_ctl_set(pop, "tx.post_commit.queue_depth",
+			&depth) == 0)
+		sched_yield();
+	UT_ASSERTeq(errno, EBUSY);
+
+	run_transactions();
+
+	ret = pmemobj_ctl_get(pop, "tx.post_commit.stop", &depth);
+	UT_ASSERTeq(ret, 0);
+
+	for (unsigned i = 0; i < NWORKERS; ++i)
+		PTHREAD_JOIN(&workers[i], NULL);
+
+	/* without the workers the cleanup is done by the committing thread */
+	run_transactions();
+
+	struct root *rootp = pmemobj_direct(pmemobj_root(pop,
+		sizeof(struct root)));
+	for (unsigned i = 0; i < NTHREADS; ++i)
+		UT_ASSERTeq(rootp->counters[i], NOPS);
+
+	pmemobj_close(pop);
+
+	ret = pmemobj_check(path, LAYOUT);
+	UT_ASSERTeq(ret, 1);
+
+	pop = pmemobj_open(path, LAYOUT);
+	UT_ASSERTne(pop, NULL);
+
+	rootp = pmemobj_direct(pmemobj_root(pop, sizeof(struct root)));
+	for (unsigned i = 0; i < NTHREADS; ++i)
+		UT_ASSERTeq(rootp->counters[i], NOPS);
+
+	pmemobj_close(pop);
+
+	DONE(NULL);
+}
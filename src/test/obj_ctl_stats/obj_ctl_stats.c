@@ -36,6 +36,317 @@
 
 #include "unittest.h"
 
+#define TX_OBJ_SIZE (1 << 14)
+#define TX_SMALL_COUNT 100
+
+/*
+ * snapshot_tx -- snapshots the given part of the object in a transaction
+ */
+static void
+snapshot_tx(PMEMobjpool *pop, PMEMoid oid, size_t size)
+{
+	TX_BEGIN(pop) {
+		pmemobj_tx_add_range(oid, 0, size);
+		memset(pmemobj_direct(oid), 0xc, size);
+	} TX_ONABORT {
+		UT_ASSERT(0);
+	} TX_END
+}
+
+/*
+ * test_log_extensions -- verifies that the undo log extensions are kept for
+ *	the following transactions and freed once they are no longer used
+ */
+static void
+test_log_extensions(PMEMobjpool *pop)
+{
+	size_t allocated;
+	int ret = pmemobj_ctl_get(pop, "stats.heap.curr_allocated", &allocated);
+	UT_ASSERTeq(ret, 0);
+
+	PMEMoid oid;
+	ret = pmemobj_alloc(pop, &oid, TX_OBJ_SIZE, 0, NULL, NULL);
+	UT_ASSERTeq(ret, 0);
+	allocated += pmemobj_alloc_usable_size(oid) + 16;
+	pmemobj_memset_persist(pop, pmemobj_direct(oid), 0xc, TX_OBJ_SIZE);
+
+	uint64_t nextensions;
+	ret = pmemobj_ctl_get(pop, "stats.tx.undo_extensions", &nextensions);
+	UT_ASSERTeq(ret, 0);
+
+	size_t extended;
+	snapshot_tx(pop, oid, TX_OBJ_SIZE);
+	ret = pmemobj_ctl_get(pop, "stats.heap.curr_allocated", &extended);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERT(extended > allocated);
+
+	uint64_t value64;
+	ret = pmemobj_ctl_get(pop, "stats.tx.undo_extensions", &value64);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERT(value64 > nextensions);
+	nextensions = value64;
+
+	/* the second transaction reuses the extensions */
+	size_t value;
+	snapshot_tx(pop, oid, TX_OBJ_SIZE);
+	ret = pmemobj_ctl_get(pop, "stats.heap.curr_allocated", &value);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(value, extended);
+	ret = pmemobj_ctl_get(pop, "stats.tx.undo_extensions", &value64);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(value64, nextensions);
+
+	/* and so does a small one */
+	snapshot_tx(pop, oid, 64);
+	ret = pmemobj_ctl_get(pop, "stats.heap.curr_allocated", &value);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(value, extended);
+
+	/* the extensions are freed once they are not used for a while */
+	for (int i = 0; i < TX_SMALL_COUNT; ++i)
+		snapshot_tx(pop, oid, 64);
+
+	ret = pmemobj_ctl_get(pop, "stats.heap.curr_allocated", &value);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(value, allocated);
+
+	pmemobj_free(&oid);
+}
+
+/*
+ * get_stat -- reads a single statistic counter
+ */
+static uint64_t
+get_stat(PMEMobjpool *pop, const char *name)
+{
+	uint64_t value;
+	int ret = pmemobj_ctl_get(pop, name, &value);
+	UT_ASSERTeq(ret, 0);
+
+	return value;
+}
+
+/*
+ * test_tx_stats -- verifies the statistics of the transactions
+ */
+static void
+test_tx_stats(PMEMobjpool *pop)
+{
+	uint64_t committed = get_stat(pop, "stats.tx.committed");
+	uint64_t aborted = get_stat(pop, "stats.tx.aborted");
+	uint64_t ranges = get_stat(pop, "stats.tx.ranges");
+	uint64_t bytes = get_stat(pop, "stats.tx.snapshot_bytes");
+	uint64_t work = get_stat(pop, "stats.tx.time.work");
+	uint64_t drain = get_stat(pop, "stats.tx.time.drain");
+	UT_ASSERTne(committed, 0);
+
+	/* all the transactions so far were committed */
+	struct pobj_tx_latency latency;
+	int ret = pmemobj_ctl_get(pop, "stats.tx.latency", &latency);
+	UT_ASSERTeq(ret, 0);
+	uint64_t nlatency = 0;
+	for (int i = 0; i < POBJ_TX_LATENCY_BUCKETS; ++i)
+		nlatency += latency.count[i];
+	UT_ASSERTeq(nlatency, committed);
+
+	PMEMoid oid;
+	ret = pmemobj_zalloc(pop, &oid, 1024, 0);
+	UT_ASSERTeq(ret, 0);
+
+	TX_BEGIN(pop) {
+		pmemobj_tx_add_range(oid, 0, 256);
+		/* only the part that is not in the transaction yet is logged */
+		pmemobj_tx_add_range(oid, 128, 256);
+		TX_BEGIN(pop) {
+			pmemobj_tx_add_range(oid, 512, 64);
+		} TX_END
+	} TX_ONABORT {
+		UT_ASSERT(0);
+	} TX_END
+
+	UT_ASSERTeq(get_stat(pop, "stats.tx.committed"), committed + 1);
+	UT_ASSERTeq(get_stat(pop, "stats.tx.aborted"), aborted);
+	UT_ASSERTeq(get_stat(pop, "stats.tx.ranges"), ranges + 3);
+	UT_ASSERTeq(get_stat(pop, "stats.tx.snapshot_bytes"), bytes + 448);
+	UT_ASSERT(get_stat(pop, "stats.tx.time.work") > work);
+	UT_ASSERT(get_stat(pop, "stats.tx.time.drain") > drain);
+
+	TX_BEGIN(pop) {
+		pmemobj_tx_add_range(oid, 0, 64);
+		pmemobj_tx_abort(ECANCELED);
+	} TX_ONCOMMIT {
+		UT_ASSERT(0);
+	} TX_END
+
+	UT_ASSERTeq(get_stat(pop, "stats.tx.committed"), committed + 1);
+	UT_ASSERTeq(get_stat(pop, "stats.tx.aborted"), aborted + 1);
+	UT_ASSERTeq(get_stat(pop, "stats.tx.ranges"), ranges + 4);
+	UT_ASSERTeq(get_stat(pop, "stats.tx.snapshot_bytes"), bytes + 512);
+
+	/* nothing is collected while the statistics are disabled */
+	int enabled = 0;
+	ret = pmemobj_ctl_set(pop, "stats.enabled", &enabled);
+	UT_ASSERTeq(ret, 0);
+
+	TX_BEGIN(pop) {
+		pmemobj_tx_add_range(oid, 0, 64);
+	} TX_END
+
+	UT_ASSERTeq(get_stat(pop, "stats.tx.committed"), committed + 1);
+	UT_ASSERTeq(get_stat(pop, "stats.tx.ranges"), ranges + 4);
+
+	enabled = 1;
+	ret = pmemobj_ctl_set(pop, "stats.enabled", &enabled);
+	UT_ASSERTeq(ret, 0);
+
+	pmemobj_free(&oid);
+}
+
+#define MUTEX_NTHREADS 4
+#define MUTEX_NOPS 1000
+
+struct mutex_obj {
+	PMEMmutex mutex;
+	uint64_t counter;
+};
+
+struct mutex_args {
+	PMEMobjpool *pop;
+	struct mutex_obj *obj;
+};
+
+/*
+ * mutex_worker -- increments the counter under the mutex
+ */
+static void *
+mutex_worker(void *arg)
+{
+	struct mutex_args *args = arg;
+	PMEMmutex *mutex = &args->obj->mutex;
+
+	for (int i = 0; i < MUTEX_NOPS; ++i) {
+		UT_ASSERTeq(pmemobj_mutex_lock(args->pop, mutex), 0);
+		args->obj->counter++;
+		UT_ASSERTeq(pmemobj_mutex_unlock(args->pop, mutex), 0);
+	}
+
+	return NULL;
+}
+
+/*
+ * test_mutex_stats -- verifies the queue mutexes and their contention
+ *	statistics
+ */
+static void
+test_mutex_stats(PMEMobjpool *pop)
+{
+	int adaptive;
+	int ret = pmemobj_ctl_get(pop, "sync.mutex.adaptive", &adaptive);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(adaptive, 0);
+
+	adaptive = 1;
+	ret = pmemobj_ctl_set(pop, "sync.mutex.adaptive", &adaptive);
+	UT_ASSERTeq(ret, 0);
+
+	int spin = -1;
+	ret = pmemobj_ctl_set(pop, "sync.mutex.spin", &spin);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	/* the waiters go to sleep right away */
+	spin = 0;
+	ret = pmemobj_ctl_set(pop, "sync.mutex.spin", &spin);
+	UT_ASSERTeq(ret, 0);
+
+	uint64_t contended = get_stat(pop, "stats.mutex.contended");
+	uint64_t parked = get_stat(pop, "stats.mutex.parked");
+
+	PMEMoid oid;
+	ret = pmemobj_zalloc(pop, &oid, sizeof(struct mutex_obj), 0);
+	UT_ASSERTeq(ret, 0);
+
+	struct mutex_args args = {pop, pmemobj_direct(oid)};
+	os_thread_t threads[MUTEX_NTHREADS];
+	for (int i = 0; i < MUTEX_NTHREADS; ++i)
+		PTHREAD_CREATE(&threads[i], NULL, mutex_worker, &args);
+	for (int i = 0; i < MUTEX_NTHREADS; ++i)
+		PTHREAD_JOIN(&threads[i], NULL);
+
+	UT_ASSERTeq(args.obj->counter, MUTEX_NTHREADS * MUTEX_NOPS);
+	UT_ASSERTeq(pmemobj_mutex_trylock(pop, &args.obj->mutex), 0);
+	UT_ASSERTeq(pmemobj_mutex_trylock(pop, &args.obj->mutex), EBUSY);
+	UT_ASSERTeq(pmemobj_mutex_unlock(pop, &args.obj->mutex), 0);
+
+	/* only the contended acquisitions may park */
+	contended = get_stat(pop, "stats.mutex.contended") - contended;
+	parked = get_stat(pop, "stats.mutex.parked") - parked;
+	UT_ASSERT(parked <= contended);
+
+	adaptive = 0;
+	ret = pmemobj_ctl_set(pop, "sync.mutex.adaptive", &adaptive);
+	UT_ASSERTeq(ret, 0);
+
+	pmemobj_free(&oid);
+}
+
+/*
+ * lane_worker -- allocates and frees objects, each operation holds a lane
+ */
+static void *
+lane_worker(void *arg)
+{
+	PMEMobjpool *pop = arg;
+
+	for (int i = 0; i < TX_SMALL_COUNT; ++i) {
+		PMEMoid oid;
+		UT_ASSERTeq(pmemobj_alloc(pop, &oid, 64, 0, NULL, NULL), 0);
+		pmemobj_free(&oid);
+	}
+
+	return NULL;
+}
+
+/*
+ * test_lane_affinity -- verifies the affinity mode of the lanes and its
+ *	statistics
+ */
+static void
+test_lane_affinity(PMEMobjpool *pop)
+{
+	int affinity;
+	int ret = pmemobj_ctl_get(pop, "lane.affinity", &affinity);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(affinity, 0);
+
+	affinity = 1;
+	ret = pmemobj_ctl_set(pop, "lane.affinity", &affinity);
+	UT_ASSERTeq(ret, 0);
+
+	uint64_t busy = get_stat(pop, "stats.lane.busy");
+	uint64_t stolen = get_stat(pop, "stats.lane.stolen");
+
+	/* a single thread always finds a free lane on its CPU */
+	lane_worker(pop);
+	UT_ASSERTeq(get_stat(pop, "stats.lane.busy"), busy);
+	UT_ASSERTeq(get_stat(pop, "stats.lane.stolen"), stolen);
+
+	os_thread_t threads[MUTEX_NTHREADS];
+	for (int i = 0; i < MUTEX_NTHREADS; ++i)
+		PTHREAD_CREATE(&threads[i], NULL, lane_worker, pop);
+	for (int i = 0; i < MUTEX_NTHREADS; ++i)
+		PTHREAD_JOIN(&threads[i], NULL);
+
+	/* only the threads which found their local lanes busy steal */
+	busy = get_stat(pop, "stats.lane.busy") - busy;
+	stolen = get_stat(pop, "stats.lane.stolen") - stolen;
+	UT_ASSERT(stolen <= busy);
+
+	affinity = 0;
+	ret = pmemobj_ctl_set(pop, "lane.affinity", &affinity);
+	UT_ASSERTeq(ret, 0);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -76,6 +387,32 @@ main(int argc, char *argv[])
 	UT_ASSERTeq(ret, 0);
 	UT_ASSERTeq(allocated, oid_size);
 
+	UT_ASSERTeq(pmemobj_pool_by_oid(oid), pop);
+
+	uint64_t hits;
+	uint64_t misses;
+	ret = pmemobj_ctl_get(pop, "stats.pool_cache.hits", &hits);
+	UT_ASSERTeq(ret, 0);
+	ret = pmemobj_ctl_get(pop, "stats.pool_cache.misses", &misses);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTne(hits + misses, 0);
+
+	for (int i = 0; i < 10; ++i)
+		UT_ASSERTeq(pmemobj_pool_by_oid(oid), pop);
+
+	uint64_t value;
+	ret = pmemobj_ctl_get(pop, "stats.pool_cache.hits", &value);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(value, hits + 10);
+	ret = pmemobj_ctl_get(pop, "stats.pool_cache.misses", &value);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(value, misses);
+
+	test_log_extensions(pop);
+	test_tx_stats(pop);
+	test_mutex_stats(pop);
+	test_lane_affinity(pop);
+
 	pmemobj_free(&oid);
 
 	ret = pmemobj_ctl_get(pop, "stats.heap.curr_allocated", &allocated);
@@ -31,7 +31,7 @@
  */
 
 /*
- * obj_direct.c -- unit test for pmemobj_direct()
+ * obj_direct.c -- unit test for pmemobj_direct() and compact handles
  */
 #include "obj.h"
 #include "obj_direct.h"
@@ -77,6 +77,57 @@ test_worker(void *arg)
 	return NULL;
 }
 
+/*
+ * test_compact -- checks translation of compact handles stored in each pool
+ */
+static void
+test_compact(PMEMobjpool **pops, PMEMoid *oids, unsigned npools)
+{
+	PMEMcoid dram = COID_NULL;
+	UT_ASSERTeq(pmemobj_cdirect(&dram), NULL);
+	UT_ASSERTeq(pmemobj_coid_from_oid(&dram, oids[0]), -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	for (unsigned i = 0; i < npools; ++i) {
+		PMEMoid holder;
+		int r = pmemobj_zalloc(pops[i], &holder, sizeof(PMEMcoid), 3);
+		UT_ASSERTeq(r, 0);
+
+		PMEMcoid *coid = obj_direct(holder);
+		UT_ASSERT(COID_IS_NULL(*coid));
+		UT_ASSERTeq(pmemobj_cdirect(coid), NULL);
+		UT_ASSERT(OID_IS_NULL(pmemobj_coid_to_oid(coid)));
+
+		UT_ASSERTeq(pmemobj_coid_from_oid(coid, oids[i]), 0);
+		UT_ASSERTeq(pmemobj_cdirect(coid), obj_direct(oids[i]));
+		UT_ASSERT(OID_EQUALS(pmemobj_coid_to_oid(coid), oids[i]));
+
+		if (npools > 1) {
+			PMEMoid other = oids[(i + 1) % npools];
+			UT_ASSERTeq(pmemobj_coid_from_oid(coid, other), -1);
+			UT_ASSERTeq(errno, EINVAL);
+			UT_ASSERT(OID_EQUALS(pmemobj_coid_to_oid(coid),
+				oids[i]));
+		}
+
+		TX_BEGIN(pops[i]) {
+			pmemobj_tx_coid_set(coid, OID_NULL);
+			UT_ASSERT(COID_IS_NULL(*coid));
+			pmemobj_tx_abort(ECANCELED);
+		} TX_END
+		UT_ASSERTeq(pmemobj_cdirect(coid), obj_direct(oids[i]));
+
+		TX_BEGIN(pops[i]) {
+			pmemobj_tx_coid_set(coid, OID_NULL);
+		} TX_ONABORT {
+			UT_ASSERT(0);
+		} TX_END
+		UT_ASSERT(COID_IS_NULL(*coid));
+
+		pmemobj_free(&holder);
+	}
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -146,6 +197,8 @@ main(int argc, char *argv[])
 		os_cond_wait(&sync_cond1, &lock1);
 	util_mutex_unlock(&lock1);
 
+	test_compact(pops, tmpoids, npools);
+
 	for (unsigned i = 0; i < npools; ++i) {
 		UT_ASSERTne(obj_direct(tmpoids[i]), NULL);
 
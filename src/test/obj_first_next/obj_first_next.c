@@ -31,7 +31,8 @@
  */
 
 /*
- * obj_first_next.c -- unit tests for POBJ_FIRST macro
+ * obj_first_next.c -- unit tests for POBJ_FIRST macro and
+ *	pmemobj_foreach_parallel
  */
 
 #include <stddef.h>
@@ -150,6 +151,18 @@ type_sec_constructor(PMEMobjpool *pop, void *ptr, void *arg)
 	return 0;
 }
 
+/*
+ * type_constructor_silent -- constructor which sets the object's id
+ */
+static int
+type_constructor_silent(PMEMobjpool *pop, void *ptr, void *arg)
+{
+	*(int *)ptr = *(int *)arg;
+	pmemobj_persist(pop, ptr, sizeof(int));
+
+	return 0;
+}
+
 /*
  * do_alloc_type -- allocates new element to type collection
  */
@@ -293,6 +306,94 @@ test_internal_object_mask(PMEMobjpool *pop)
 	}
 }
 
+#define FOREACH_PARALLEL_NSMALL 500
+#define FOREACH_PARALLEL_NHUGE 6
+#define FOREACH_PARALLEL_HUGE_SIZE (200 * 1024)
+
+struct foreach_parallel_arg {
+	uint64_t nobjs;
+	uint64_t idsum;
+	uint64_t stop_at;
+};
+
+/*
+ * foreach_parallel_cb -- counts the visited objects
+ */
+static int
+foreach_parallel_cb(PMEMoid oid, void *arg)
+{
+	struct foreach_parallel_arg *a = arg;
+
+	UT_ASSERT(!OID_IS_NULL(oid));
+	UT_ASSERTeq(pmemobj_pool_by_oid(oid), pop);
+
+	int id = *(int *)pmemobj_direct(oid);
+	util_fetch_and_add64(&a->idsum, (uint64_t)id);
+	uint64_t n = util_fetch_and_add64(&a->nobjs, 1) + 1;
+
+	return n == a->stop_at ? 5 : 0;
+}
+
+/*
+ * check_foreach_parallel -- verifies the parallel iteration against the
+ *	expected number of objects and sum of their ids
+ */
+static void
+check_foreach_parallel(uint64_t type_num, uint64_t nobjs, uint64_t idsum)
+{
+	unsigned nthreads[] = {1, 2, 4, 0};
+
+	for (unsigned i = 0; i < sizeof(nthreads) / sizeof(nthreads[0]); ++i) {
+		struct foreach_parallel_arg a = {0, 0, 0};
+		int ret = pmemobj_foreach_parallel(pop, type_num,
+			foreach_parallel_cb, &a, nthreads[i]);
+		UT_ASSERTeq(ret, 0);
+		UT_ASSERTeq(a.nobjs, nobjs);
+		UT_ASSERTeq(a.idsum, idsum);
+	}
+}
+
+/*
+ * test_foreach_parallel -- verifies that the parallel iteration visits every
+ *	object exactly once, regardless of the number of threads
+ */
+static void
+test_foreach_parallel(void)
+{
+	uint64_t idsum[2] = {0, 0};
+	PMEMoid oid;
+
+	for (int i = 0; i < FOREACH_PARALLEL_NSMALL; ++i) {
+		int ret = pmemobj_alloc(pop, &oid, sizeof(struct type), 0,
+			type_constructor_silent, &i);
+		UT_ASSERTeq(ret, 0);
+		idsum[0] += (uint64_t)i;
+	}
+
+	for (int i = 0; i < FOREACH_PARALLEL_NHUGE; ++i) {
+		int ret = pmemobj_alloc(pop, &oid, FOREACH_PARALLEL_HUGE_SIZE,
+			1, type_constructor_silent, &i);
+		UT_ASSERTeq(ret, 0);
+		idsum[1] += (uint64_t)i;
+	}
+
+	check_foreach_parallel(0, FOREACH_PARALLEL_NSMALL, idsum[0]);
+	check_foreach_parallel(1, FOREACH_PARALLEL_NHUGE, idsum[1]);
+	check_foreach_parallel(POBJ_ANY_TYPE_NUM,
+		FOREACH_PARALLEL_NSMALL + FOREACH_PARALLEL_NHUGE,
+		idsum[0] + idsum[1]);
+	check_foreach_parallel(2, 0, 0);
+
+	/* the first non-zero value returned by the callback stops iteration */
+	struct foreach_parallel_arg a = {0, 0, 1};
+	int ret = pmemobj_foreach_parallel(pop, POBJ_ANY_TYPE_NUM,
+		foreach_parallel_cb, &a, 4);
+	UT_ASSERTeq(ret, 5);
+	UT_ASSERT(a.nobjs <= 4);
+
+	do_cleanup();
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -333,6 +434,8 @@ main(int argc, char *argv[])
 	}
 	do_cleanup();
 
+	test_foreach_parallel();
+
 	test_internal_object_mask(pop);
 
 	pmemobj_close(pop);
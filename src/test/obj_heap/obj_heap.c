@@ -426,6 +426,9 @@ test_recycler(void)
 	struct memory_block mrun5 = {1, 0, 1, 0};
 	memblock_rebuild_state(&pop->heap, &mrun5);
 
+	/* the mirror of a run stays until the run is turned into a chunk */
+	recycler_mirror_remove(r, &mrun5);
+
 	ret = recycler_put(r, &mrun5,
 		recycler_element_new(&pop->heap, &mrun5));
 	UT_ASSERTeq(ret, 0);
@@ -440,6 +443,37 @@ test_recycler(void)
 	ret = recycler_get(r, &mrun5_ret);
 	UT_ASSERTeq(ret, 0);
 
+	/*
+	 * Frees of the runs stored in the recycler are tracked in the
+	 * transient bitmap mirror, the persistent bitmap isn't read again.
+	 */
+	ret = recycler_put(r, &mrun5,
+		recycler_element_new(&pop->heap, &mrun5));
+	UT_ASSERTeq(ret, 0);
+
+	struct memory_block mfree = mrun5;
+	mfree.block_off = 128;
+	mfree.size_idx = 64;
+	recycler_inc_unaccounted(r, &mfree);
+
+	struct empty_runs empty = recycler_recalc(r, 1);
+	UT_ASSERTeq(VEC_SIZE(&empty), 0);
+	VEC_DELETE(&empty);
+
+	mrun5_ret = MEMORY_BLOCK_NONE;
+	mrun5_ret.size_idx = 64;
+	ret = recycler_get(r, &mrun5_ret);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(mrun5_ret.chunk_id, mrun5.chunk_id);
+
+	/* the mirror is kept, and kept up to date, while the run is in use */
+	struct recycler_element before = recycler_element_from_mirror(r,
+		&mrun5);
+	recycler_mark_allocated(r, &mfree);
+	struct recycler_element after = recycler_element_from_mirror(r,
+		&mrun5);
+	UT_ASSERTeq(after.free_space + mfree.size_idx, before.free_space);
+
 	recycler_delete(r);
 
 	stats_delete(pop, s);
@@ -99,6 +99,7 @@ test_lane_boot_cleanup_ok(void)
 {
 	struct mock_pop *pop = MALLOC(sizeof(struct mock_pop));
 	pop->p.nlanes = MAX_MOCK_LANES;
+	pop->p.lanes_ext_offset = 0;
 
 	base_ptr = &pop->p;
 
@@ -115,14 +116,13 @@ test_lane_boot_cleanup_ok(void)
 	UT_ASSERTeq(lane_boot(&pop->p), 0);
 
 	for (int i = 0; i < MAX_MOCK_LANES; ++i) {
-		struct lane *lane = &pop->p.lanes_desc.lane[i];
+		struct lane *lane = lane_get(&pop->p.lanes_desc, (uint64_t)i);
 		UT_ASSERTeq(lane->layout, &pop->l[i]);
 	}
 
 	lane_cleanup(&pop->p);
 
-	UT_ASSERTeq(pop->p.lanes_desc.lane, NULL);
-	UT_ASSERTeq(pop->p.lanes_desc.lane_locks, NULL);
+	UT_ASSERTeq(pop->p.lanes_desc.chunks, NULL);
 
 	FREE(pop);
 }
@@ -150,14 +150,17 @@ test_lane_hold_release(void)
 		.undo = ctx,
 	};
 
+	struct lane_chunk *mock_chunk = ZALLOC(sizeof(struct lane_chunk));
+	mock_chunk->lanes[0] = mock_lane;
+
 	struct mock_pop *pop = MALLOC(sizeof(struct mock_pop));
 
 	pop->p.nlanes = 1;
 	pop->p.lanes_desc.runtime_nlanes = 1,
-	pop->p.lanes_desc.lane = &mock_lane;
+	pop->p.lanes_desc.chunks = &mock_chunk;
 	pop->p.lanes_desc.next_lane_idx = 0;
+	pop->p.lanes_desc.affinity = 0;
 
-	pop->p.lanes_desc.lane_locks = CALLOC(OBJ_NLANES, sizeof(uint64_t));
 	pop->p.lanes_offset = (uint64_t)&pop->l - (uint64_t)&pop->p;
 	pop->p.uuid_lo = 123456;
 	base_ptr = &pop->p;
@@ -187,7 +190,7 @@ test_lane_hold_release(void)
 
 	SIGACTION(SIGABRT, &old, NULL);
 
-	FREE(pop->p.lanes_desc.lane_locks);
+	FREE(mock_chunk);
 	FREE(pop);
 	operation_delete(ctx);
 	FREE(mock_ulog);
@@ -262,6 +265,7 @@ test_lane_cleanup_in_separate_thread(void)
 {
 	struct mock_pop *pop = MALLOC(sizeof(struct mock_pop));
 	pop->p.nlanes = MAX_MOCK_LANES;
+	pop->p.lanes_ext_offset = 0;
 
 	pop->p.p_ops.base = pop;
 	pop->p.p_ops.flush = mock_flush;
@@ -278,7 +282,7 @@ test_lane_cleanup_in_separate_thread(void)
 	UT_ASSERTeq(lane_boot(&pop->p), 0);
 
 	for (int i = 0; i < MAX_MOCK_LANES; ++i) {
-		struct lane *lane = &pop->p.lanes_desc.lane[i];
+		struct lane *lane = lane_get(&pop->p.lanes_desc, (uint64_t)i);
 		UT_ASSERTeq(lane->layout, &pop->l[i]);
 	}
 
@@ -289,8 +293,7 @@ test_lane_cleanup_in_separate_thread(void)
 	os_thread_create(&thread, NULL, test_separate_thread, &data);
 	os_thread_join(&thread, NULL);
 
-	UT_ASSERTeq(pop->p.lanes_desc.lane, NULL);
-	UT_ASSERTeq(pop->p.lanes_desc.lane_locks, NULL);
+	UT_ASSERTeq(pop->p.lanes_desc.chunks, NULL);
 
 	FREE(pop);
 }
@@ -0,0 +1,259 @@
+/*
+ * Copyright 2019, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * obj_lane_ext.c -- unit test for the runtime number of lanes and the
+ *	extensions of the lane area
+ */
+
+#include "unittest.h"
+
+#define LAYOUT "obj_lane_ext"
+#define POOL_SIZE (4 * PMEMOBJ_MIN_POOL)
+#define NLANES 1024 /* number of lanes of a new pool */
+#define EXT1_NLANES 64
+#define EXT2_NLANES 32
+#define TOTAL_NLANES (NLANES + EXT1_NLANES + EXT2_NLANES)
+
+/*
+ * Threads pick their first lanes further and further, the later ones get
+ * the lanes of the extensions.
+ */
+#define NTHREADS 140
+#define CRASH_THREAD 130
+
+struct root {
+	uint64_t counter;
+};
+
+static PMEMobjpool *pop;
+static struct root *rootp;
+
+/*
+ * lane_get -- reads a lane ctl value
+ */
+static int
+lane_get(const char *name)
+{
+	int value;
+	int ret = pmemobj_ctl_get(pop, name, &value);
+	UT_ASSERTeq(ret, 0);
+
+	return value;
+}
+
+/*
+ * increment -- increments the counter in a transaction
+ */
+static void *
+increment(void *arg)
+{
+	TX_BEGIN(pop) {
+		pmemobj_tx_add_range_direct(&rootp->counter,
+			sizeof(rootp->counter));
+		rootp->counter++;
+	} TX_ONABORT {
+		UT_ASSERT(0);
+	} TX_END
+
+	return NULL;
+}
+
+/*
+ * crash -- exits in the middle of a transaction
+ */
+static void *
+crash(void *arg)
+{
+	TX_BEGIN(pop) {
+		pmemobj_tx_add_range_direct(&rootp->counter,
+			sizeof(rootp->counter));
+		rootp->counter = UINT64_MAX;
+
+		DONE(NULL);
+	} TX_END
+
+	return NULL;
+}
+
+/*
+ * run_threads -- runs the threads one after another
+ */
+static void
+run_threads(unsigned nthreads, void *(*func)(void *))
+{
+	for (unsigned i = 0; i < nthreads; ++i) {
+		os_thread_t t;
+		PTHREAD_CREATE(&t, NULL, func, NULL);
+		PTHREAD_JOIN(&t, NULL);
+	}
+}
+
+/*
+ * test_invalid -- verifies that invalid values are rejected
+ */
+static void
+test_invalid(void)
+{
+	int total = lane_get("lane.total");
+
+	int count = 0;
+	int ret = pmemobj_ctl_set(pop, "lane.count", &count);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	count = total + 1;
+	ret = pmemobj_ctl_set(pop, "lane.count", &count);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	int nlanes = 0;
+	ret = pmemobj_ctl_exec(pop, "lane.extend", &nlanes);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	nlanes = INT_MAX;
+	ret = pmemobj_ctl_exec(pop, "lane.extend", &nlanes);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	UT_ASSERTeq(lane_get("lane.total"), total);
+}
+
+/*
+ * test_extend -- adds the lanes to the pool and uses them
+ */
+static void
+test_extend(void)
+{
+	UT_ASSERTeq(lane_get("lane.total"), NLANES);
+	UT_ASSERT(lane_get("lane.count") <= NLANES);
+
+	/* the lanes are not used until the runtime number is raised */
+	int nlanes = EXT1_NLANES;
+	int ret = pmemobj_ctl_exec(pop, "lane.extend", &nlanes);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(lane_get("lane.total"), NLANES + EXT1_NLANES);
+	UT_ASSERT(lane_get("lane.count") <= NLANES);
+
+	nlanes = EXT2_NLANES;
+	ret = pmemobj_ctl_exec(pop, "lane.extend", &nlanes);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(lane_get("lane.total"), TOTAL_NLANES);
+
+	int count = TOTAL_NLANES;
+	ret = pmemobj_ctl_set(pop, "lane.count", &count);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(lane_get("lane.count"), TOTAL_NLANES);
+
+	run_threads(NTHREADS, increment);
+	UT_ASSERTeq(rootp->counter, NTHREADS);
+
+	/* the lanes above the limit are no longer used */
+	count = 1;
+	ret = pmemobj_ctl_set(pop, "lane.count", &count);
+	UT_ASSERTeq(ret, 0);
+
+	run_threads(NTHREADS, increment);
+	UT_ASSERTeq(rootp->counter, 2 * NTHREADS);
+}
+
+/*
+ * test_reopened -- verifies that the extensions are in the pool after it's
+ *	reopened and crashes in the middle of a transaction
+ */
+static void
+test_reopened(void)
+{
+	UT_ASSERTeq(lane_get("lane.total"), TOTAL_NLANES);
+	UT_ASSERTeq(rootp->counter, 2 * NTHREADS);
+
+	int count = TOTAL_NLANES;
+	int ret = pmemobj_ctl_set(pop, "lane.count", &count);
+	UT_ASSERTeq(ret, 0);
+
+	run_threads(CRASH_THREAD, increment);
+	UT_ASSERTeq(rootp->counter, 2 * NTHREADS + CRASH_THREAD);
+
+	run_threads(1, crash);
+}
+
+/*
+ * test_recovered -- verifies that the transaction was rolled back
+ */
+static void
+test_recovered(void)
+{
+	UT_ASSERTeq(lane_get("lane.total"), TOTAL_NLANES);
+	UT_ASSERTeq(rootp->counter, 2 * NTHREADS + CRASH_THREAD);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "obj_lane_ext");
+
+	if (argc != 3 || strchr("cor", argv[2][0]) == NULL)
+		UT_FATAL("usage: %s file-name c|o|r", argv[0]);
+
+	const char *path = argv[1];
+
+	if (argv[2][0] == 'c') {
+		pop = pmemobj_create(path, LAYOUT, POOL_SIZE,
+			S_IWUSR | S_IRUSR);
+		if (pop == NULL)
+			UT_FATAL("!pmemobj_create: %s", path);
+	} else {
+		pop = pmemobj_open(path, LAYOUT);
+		if (pop == NULL)
+			UT_FATAL("!pmemobj_open: %s", path);
+	}
+
+	rootp = pmemobj_direct(pmemobj_root(pop, sizeof(*rootp)));
+
+	switch (argv[2][0]) {
+	case 'c':
+		test_invalid();
+		test_extend();
+		break;
+	case 'o':
+		test_reopened();
+		break;
+	case 'r':
+		test_recovered();
+		break;
+	}
+
+	pmemobj_close(pop);
+
+	DONE(NULL);
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2019, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * obj_lane_recovery.c -- unit test for the parallel recovery of lanes
+ *
+ * Many threads are left in the middle of their transactions when the
+ * process exits, so that the undo logs of all of their lanes have to be
+ * rolled back on the next open.
+ */
+
+#include "unittest.h"
+#include "sys_util.h"
+
+#define LAYOUT "obj_lane_recovery"
+#define NTHREADS 32
+#define OBJ_SIZE 256
+
+struct value {
+	uint64_t value;
+	PMEMoid obj;
+	char padding[40]; /* each thread modifies its own cacheline */
+};
+
+struct root {
+	struct value values[NTHREADS];
+};
+
+static PMEMobjpool *pop;
+static struct root *rootp;
+
+static os_mutex_t lock;
+static os_cond_t cond;
+static unsigned started;
+
+/*
+ * modify -- starts a transaction that modifies the value of the thread and
+ *	never finishes it
+ */
+static void *
+modify(void *arg)
+{
+	struct value *v = &rootp->values[(uintptr_t)arg];
+
+	TX_BEGIN(pop) {
+		pmemobj_tx_add_range_direct(v, sizeof(*v));
+		v->value = (uintptr_t)arg + 1;
+		v->obj = pmemobj_tx_zalloc(OBJ_SIZE, 0);
+
+		util_mutex_lock(&lock);
+		started++;
+		os_cond_broadcast(&cond);
+
+		/* the process exits while the transaction is in progress */
+		while (1)
+			os_cond_wait(&cond, &lock);
+	} TX_END
+
+	return NULL;
+}
+
+/*
+ * test_crash -- exits with all of the transactions in progress
+ */
+static void
+test_crash(void)
+{
+	util_mutex_init(&lock);
+	os_cond_init(&cond);
+
+	os_thread_t threads[NTHREADS];
+	for (uintptr_t i = 0; i < NTHREADS; ++i)
+		PTHREAD_CREATE(&threads[i], NULL, modify, (void *)i);
+
+	util_mutex_lock(&lock);
+	while (started != NTHREADS)
+		os_cond_wait(&cond, &lock);
+
+	DONE(NULL);
+}
+
+/*
+ * test_recovered -- checks that all of the transactions were rolled back
+ */
+static void
+test_recovered(void)
+{
+	for (unsigned i = 0; i < NTHREADS; ++i) {
+		UT_ASSERTeq(rootp->values[i].value, 0);
+		UT_ASSERT(OID_IS_NULL(rootp->values[i].obj));
+	}
+
+	/* the objects allocated by the transactions are gone */
+	UT_ASSERT(OID_IS_NULL(pmemobj_first(pop)));
+
+	uint64_t time;
+	int ret = pmemobj_ctl_get(pop, "stats.recovery.redo", &time);
+	UT_ASSERTeq(ret, 0);
+	ret = pmemobj_ctl_get(pop, "stats.recovery.heap_boot", &time);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTne(time, 0);
+	ret = pmemobj_ctl_get(pop, "stats.recovery.undo", &time);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTne(time, 0);
+}
+
+/*
+ * test_threads -- sets the number of recovery threads
+ */
+static void
+test_threads(int nthreads)
+{
+	int invalid = -1;
+	int ret = pmemobj_ctl_set(NULL, "recovery.threads", &invalid);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	ret = pmemobj_ctl_set(NULL, "recovery.threads", &nthreads);
+	UT_ASSERTeq(ret, 0);
+
+	int value;
+	ret = pmemobj_ctl_get(NULL, "recovery.threads", &value);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(value, nthreads);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "obj_lane_recovery");
+
+	if (argc != 4 || strchr("cr", argv[2][0]) == NULL)
+		UT_FATAL("usage: %s file-name c|r nthreads", argv[0]);
+
+	const char *path = argv[1];
+
+	if (argv[2][0] == 'c') {
+		pop = pmemobj_create(path, LAYOUT, PMEMOBJ_MIN_POOL,
+			S_IWUSR | S_IRUSR);
+		if (pop == NULL)
+			UT_FATAL("!pmemobj_create: %s", path);
+
+		rootp = pmemobj_direct(pmemobj_root(pop, sizeof(*rootp)));
+
+		test_crash();
+	}
+
+	test_threads(atoi(argv[3]));
+
+	pop = pmemobj_open(path, LAYOUT);
+	if (pop == NULL)
+		UT_FATAL("!pmemobj_open: %s", path);
+
+	rootp = pmemobj_direct(pmemobj_root(pop, sizeof(*rootp)));
+
+	test_recovered();
+
+	pmemobj_close(pop);
+
+	DONE(NULL);
+}
@@ -52,6 +52,7 @@ extern "C" {
 #define WRAP_REAL_ULOG
 #define WRAP_REAL_LANE
 #define WRAP_REAL_HEAP
+#define WRAP_REAL_TX
 #define WRAP_REAL_PMEMOBJ
 #endif
 
@@ -83,6 +84,10 @@ extern "C" {
 #define heap_boot __wrap_heap_boot
 #endif
 
+#ifndef WRAP_REAL_TX
+#define tx_epoch_sync_all __wrap_tx_epoch_sync_all
+#endif
+
 #ifndef WRAP_REAL_PMEMOBJ
 #define pmemobj_alloc __wrap_pmemobj_alloc
 #define pmemobj_alloc_usable_size __wrap_pmemobj_alloc_usable_size
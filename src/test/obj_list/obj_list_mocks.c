@@ -74,6 +74,7 @@ obj_flush(void *ctx, const void *addr, size_t len, unsigned flags)
 
 static uintptr_t Pool_addr;
 static size_t Pool_size;
+static struct stats Stats; /* statistics are never enabled */
 
 static void
 obj_msync_nofail(const void *addr, size_t size)
@@ -164,9 +165,15 @@ FUNC_MOCK_RUN_DEFAULT
 		sizeof(Pop->rwlock_head));
 	VALGRIND_REMOVE_PMEM_MAPPING(&Pop->cond_head,
 		sizeof(Pop->cond_head));
+	VALGRIND_REMOVE_PMEM_MAPPING(&Pop->stats, sizeof(Pop->stats));
+	VALGRIND_REMOVE_PMEM_MAPPING(&Pop->sync_params,
+		sizeof(Pop->sync_params));
 	Pop->mutex_head = NULL;
 	Pop->rwlock_head = NULL;
 	Pop->cond_head = NULL;
+	Pop->stats = &Stats;
+	Pop->sync_params = sync_params_new();
+	UT_ASSERTne(Pop->sync_params, NULL);
 
 	if (Pop->is_pmem) {
 		Pop->persist_local = pmem_persist;
@@ -249,6 +256,7 @@ FUNC_MOCK_END
 FUNC_MOCK(pmemobj_close, void, PMEMobjpool *pop)
 	FUNC_MOCK_RUN_DEFAULT {
 		operation_delete(Lane.external);
+		sync_params_delete(Pop->sync_params);
 		UT_ASSERTeq(pmem_unmap(Pop,
 			Pop->heap_size + Pop->heap_offset), 0);
 		Pop = NULL;
@@ -327,6 +335,13 @@ FUNC_MOCK_END
  */
 FUNC_MOCK_RET_ALWAYS_VOID(lane_release, PMEMobjpool *pop);
 
+/*
+ * tx_epoch_sync_all -- tx_epoch_sync_all mock
+ *
+ * There are no relaxed transactions in the mocked pool.
+ */
+FUNC_MOCK_RET_ALWAYS_VOID(tx_epoch_sync_all, PMEMobjpool *pop);
+
 /*
  * lane_recover_and_section_boot -- lane_recover_and_section_boot mock
  */
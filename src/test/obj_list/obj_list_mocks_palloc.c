@@ -104,7 +104,7 @@ FUNC_MOCK_END
  */
 FUNC_MOCK(pmalloc_construct, int, PMEMobjpool *pop, uint64_t *off,
 	size_t size, palloc_constr constructor, void *arg,
-	uint64_t extra_field, uint16_t flags, uint16_t class_id)
+	uint64_t extra_field, uint16_t object_flags, uint64_t flags)
 	FUNC_MOCK_RUN_DEFAULT {
 		struct pmem_ops *p_ops = &Pop->p_ops;
 		size = size + OOB_OFF + sizeof(uint64_t) * 2;
@@ -176,7 +176,7 @@ FUNC_MOCK_END
  */
 FUNC_MOCK(palloc_reserve, int, struct palloc_heap *heap, size_t size,
 	palloc_constr constructor, void *arg,
-	uint64_t extra_field, uint16_t object_flags, uint16_t class_id,
+	uint64_t extra_field, uint16_t object_flags, uint64_t flags,
 	struct pobj_action *act)
 	FUNC_MOCK_RUN_DEFAULT {
 		struct pmem_ops *p_ops = &Pop->p_ops;
@@ -44,6 +44,7 @@
 #define TEST_ENTRIES 256
 
 #define TEST_VALUES 128
+#define TEST_SMALL_OPS 100
 
 enum fail_types {
 	FAIL_NONE,
@@ -71,7 +72,7 @@ redo_log_constructor(void *ctx, void *ptr, size_t usable_size, void *arg)
 	PMEMobjpool *pop = ctx;
 	const struct pmem_ops *p_ops = &pop->p_ops;
 
-	ulog_construct(OBJ_PTR_TO_OFF(ctx, ptr), TEST_ENTRIES, 1, p_ops);
+	ulog_construct(OBJ_PTR_TO_OFF(ctx, ptr), TEST_ENTRIES, 0, 1, p_ops);
 
 	return 0;
 }
@@ -171,6 +172,99 @@ test_same_twice(struct operation_context *ctx, struct test_object *object)
 	UT_ASSERTeq(object->values[0], 10);
 }
 
+static void
+test_unsorted_entries(struct operation_context *ctx,
+	struct test_object *object, size_t nentries)
+{
+	operation_start(ctx);
+
+	/*
+	 * The entries are applied in the order of their destinations, but
+	 * those with the same destination must still follow the log order.
+	 */
+	for (size_t i = nentries; i > 0; --i) {
+		operation_add_typed_entry(ctx,
+			&object->values[i - 1], i,
+			ULOG_OPERATION_SET, LOG_PERSISTENT);
+	}
+
+	for (size_t i = 0; i < nentries; ++i) {
+		operation_add_typed_entry(ctx,
+			&object->values[i], 0x100,
+			ULOG_OPERATION_OR, LOG_PERSISTENT);
+	}
+
+	for (size_t i = nentries; i > 0; --i) {
+		operation_add_typed_entry(ctx,
+			&object->values[i - 1], ~1ULL,
+			ULOG_OPERATION_AND, LOG_PERSISTENT);
+	}
+
+	operation_add_typed_entry(ctx,
+		&object->values[0], 0x200,
+		ULOG_OPERATION_SET, LOG_PERSISTENT);
+
+	operation_reserve(ctx, (3 * nentries + 1) * 16);
+
+	operation_finish(ctx);
+
+	UT_ASSERTeq(object->values[0], 0x200);
+	for (size_t i = 1; i < nentries; ++i)
+		UT_ASSERTeq(object->values[i], ((i + 1) | 0x100) & ~1ULL);
+}
+
+static void
+test_set_runs(struct operation_context *ctx, struct test_object *object,
+	size_t nentries)
+{
+	operation_start(ctx);
+
+	/*
+	 * Sets of consecutive words are logged as runs, the values that
+	 * overlap an earlier run must still take precedence over it.
+	 */
+	for (size_t i = 0; i < nentries; ++i) {
+		operation_add_typed_entry(ctx,
+			&object->values[i], i + 1,
+			ULOG_OPERATION_SET, LOG_PERSISTENT);
+	}
+
+	for (size_t i = 1; i < nentries; i += 4) {
+		operation_add_typed_entry(ctx,
+			&object->values[i], 0x100,
+			ULOG_OPERATION_OR, LOG_PERSISTENT);
+	}
+
+	for (size_t i = 2; i < nentries; i += 4) {
+		operation_add_typed_entry(ctx,
+			&object->values[i], 0x200,
+			ULOG_OPERATION_SET, LOG_PERSISTENT);
+		operation_add_typed_entry(ctx,
+			&object->values[i + 1], 0x300,
+			ULOG_OPERATION_SET, LOG_PERSISTENT);
+	}
+
+	operation_reserve(ctx, 3 * nentries * 16);
+
+	operation_finish(ctx);
+
+	for (size_t i = 0; i < nentries; ++i) {
+		switch (i % 4) {
+			case 1:
+				UT_ASSERTeq(object->values[i], (i + 1) | 0x100);
+				break;
+			case 2:
+				UT_ASSERTeq(object->values[i], 0x200);
+				break;
+			case 3:
+				UT_ASSERTeq(object->values[i], 0x300);
+				break;
+			default:
+				UT_ASSERTeq(object->values[i], i + 1);
+		}
+	}
+}
+
 static void
 test_redo(PMEMobjpool *pop, struct test_object *object)
 {
@@ -192,6 +286,14 @@ test_redo(PMEMobjpool *pop, struct test_object *object)
 	clear_test_values(object);
 	test_set_entries(pop, ctx, object, 10, FAIL_MODIFY_VALUE);
 	clear_test_values(object);
+	test_unsorted_entries(ctx, object, 10);
+	clear_test_values(object);
+	test_unsorted_entries(ctx, object, 50);
+	clear_test_values(object);
+	test_set_runs(ctx, object, 12);
+	clear_test_values(object);
+	test_set_runs(ctx, object, TEST_VALUES - 4);
+	clear_test_values(object);
 	test_same_twice(ctx, object);
 	clear_test_values(object);
 
@@ -272,6 +374,30 @@ test_undo_small_single_set(struct operation_context *ctx,
 	operation_finish(ctx);
 }
 
+static void
+test_undo_large_single_set(struct operation_context *ctx,
+	struct test_object *object)
+{
+	operation_start(ctx);
+
+	for (uint64_t i = 0; i < TEST_VALUES; ++i)
+		object->values[i] = i + 1;
+
+	/* a set entry takes up a single cacheline regardless of its size */
+	uint8_t c = 0xab;
+
+	operation_add_buffer(ctx,
+		&object->values, &c, sizeof(object->values),
+		ULOG_OPERATION_BUF_SET);
+
+	operation_process(ctx);
+
+	for (uint64_t i = 0; i < TEST_VALUES; ++i)
+		UT_ASSERTeq(object->values[i], 0xababababababababULL);
+
+	operation_finish(ctx);
+}
+
 static void
 test_undo_large_single_copy(struct operation_context *ctx,
 	struct test_object *object)
@@ -374,6 +500,50 @@ test_undo_large_copy(PMEMobjpool *pop, struct operation_context *ctx,
 	operation_finish(ctx);
 }
 
+static void
+test_undo_stale_entries(PMEMobjpool *pop, struct operation_context *ctx,
+	struct test_object *object, struct ulog *log)
+{
+	operation_start(ctx);
+
+	for (uint64_t i = 0; i < TEST_VALUES; ++i)
+		object->values[i] = i + 1;
+
+	operation_add_buffer(ctx,
+		&object->values, &object->values, sizeof(object->values),
+		ULOG_OPERATION_BUF_CPY);
+
+	uint64_t gen_num = log->gen_num;
+	operation_finish(ctx);
+
+	/* the log is invalidated by a new generation, not by zeroing it */
+	UT_ASSERTeq(log->gen_num, gen_num + 1);
+	UT_ASSERTeq(ulog_base_nbytes(log), 0);
+	UT_ASSERT(!util_is_zeroed(log->data, TEST_ENTRIES));
+
+	operation_start(ctx);
+
+	operation_add_buffer(ctx,
+		&object->values, &object->values, sizeof(*object->values) * 2,
+		ULOG_OPERATION_BUF_CPY);
+
+	for (uint64_t i = 0; i < TEST_VALUES; ++i)
+		object->values[i] = i + 2;
+
+	pmemobj_persist(pop, &object->values, sizeof(object->values));
+
+	operation_process(ctx);
+
+	/* only the entries of the current generation are applied */
+	for (uint64_t i = 0; i < 2; ++i)
+		UT_ASSERTeq(object->values[i], i + 1);
+
+	for (uint64_t i = 2; i < TEST_VALUES; ++i)
+		UT_ASSERTeq(object->values[i], i + 2);
+
+	operation_finish(ctx);
+}
+
 static void
 test_undo(PMEMobjpool *pop, struct test_object *object)
 {
@@ -384,17 +554,28 @@ test_undo(PMEMobjpool *pop, struct test_object *object)
 
 	test_undo_small_single_copy(ctx, object);
 	test_undo_small_single_set(ctx, object);
+	test_undo_large_single_set(ctx, object);
 	test_undo_large_single_copy(ctx, object);
 	test_undo_large_copy(pop, ctx, object);
 	test_undo_checksum_mismatch(pop, ctx, object,
 		(struct ulog *)&object->undo);
+	test_undo_stale_entries(pop, ctx, object,
+		(struct ulog *)&object->undo);
 
-	/* undo logs are clobbered at the end, which shrinks their size */
+	/* the recently used extensions are kept for the next operations */
 	size_t capacity = ulog_capacity((struct ulog *)&object->undo,
 		TEST_ENTRIES, &pop->p_ops);
+	UT_ASSERT(capacity > TEST_ENTRIES);
+
+	/* ... and freed once they are not needed for a while */
+	for (int i = 0; i < TEST_SMALL_OPS; ++i)
+		test_undo_small_single_copy(ctx, object);
+
+	capacity = ulog_capacity((struct ulog *)&object->undo,
+		TEST_ENTRIES, &pop->p_ops);
 
-	/* builtin log + one next */
-	UT_ASSERTeq(capacity, TEST_ENTRIES * 2);
+	/* builtin log only */
+	UT_ASSERTeq(capacity, TEST_ENTRIES);
 
 	operation_delete(ctx);
 }
@@ -419,7 +600,7 @@ main(int argc, char *argv[])
 		pmemobj_direct(pmemobj_root(pop, sizeof(struct test_object)));
 	UT_ASSERTne(object, NULL);
 	ulog_construct(OBJ_PTR_TO_OFF(pop, &object->undo),
-		TEST_ENTRIES, 1, &pop->p_ops);
+		TEST_ENTRIES, 1, 1, &pop->p_ops);
 
 	test_redo(pop, object);
 	test_undo(pop, object);
@@ -0,0 +1,299 @@
+/*
+ * Copyright 2019, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * obj_mwcas.c -- unit test for the multi-word compare-and-swap
+ */
+
+#include "unittest.h"
+#include "lane.h"
+#include "memops.h"
+#include "obj.h"
+
+#define LAYOUT "obj_mwcas"
+#define NTHREADS 4
+#define NOPS 1000
+
+struct root {
+	uint64_t words[POBJ_MWCAS_MAX_WORDS];
+	uint64_t counters[NTHREADS];
+	uint64_t crashed[2];
+};
+
+static PMEMobjpool *pop;
+static struct root *rootp;
+
+/*
+ * test_swap -- swaps the words only if all of them have the expected values
+ */
+static void
+test_swap(void)
+{
+	struct pobj_mwcas words[POBJ_MWCAS_MAX_WORDS];
+
+	/* the words do not have to be sorted */
+	for (int i = 0; i < POBJ_MWCAS_MAX_WORDS; ++i) {
+		words[i].ptr = &rootp->words[POBJ_MWCAS_MAX_WORDS - i - 1];
+		words[i].old_value = 0;
+		words[i].new_value = (uint64_t)i + 1;
+	}
+
+	int ret = pmemobj_mwcas(pop, words, POBJ_MWCAS_MAX_WORDS);
+	UT_ASSERTeq(ret, 0);
+
+	for (int i = 0; i < POBJ_MWCAS_MAX_WORDS; ++i) {
+		UT_ASSERTeq(rootp->words[i],
+			(uint64_t)(POBJ_MWCAS_MAX_WORDS - i));
+		UT_ASSERTeq(pmemobj_mwcas_read(pop, &rootp->words[i]),
+			rootp->words[i]);
+	}
+
+	/* the last word does not match */
+	for (int i = 0; i < POBJ_MWCAS_MAX_WORDS; ++i) {
+		words[i].old_value = words[i].new_value;
+		words[i].new_value = 0;
+	}
+	words[POBJ_MWCAS_MAX_WORDS - 1].old_value = 0;
+
+	ret = pmemobj_mwcas(pop, words, POBJ_MWCAS_MAX_WORDS);
+	UT_ASSERTeq(ret, 1);
+
+	for (int i = 0; i < POBJ_MWCAS_MAX_WORDS; ++i)
+		UT_ASSERTeq(rootp->words[i],
+			(uint64_t)(POBJ_MWCAS_MAX_WORDS - i));
+}
+
+/*
+ * test_invalid -- checks that invalid operations are rejected
+ */
+static void
+test_invalid(void)
+{
+	uint64_t word = 0;
+	struct pobj_mwcas words[POBJ_MWCAS_MAX_WORDS + 1];
+	for (int i = 0; i <= POBJ_MWCAS_MAX_WORDS; ++i) {
+		words[i].ptr = &rootp->counters[i % NTHREADS];
+		words[i].old_value = 0;
+		words[i].new_value = 1;
+	}
+
+	errno = 0;
+	UT_ASSERTeq(pmemobj_mwcas(pop, words, 0), -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	errno = 0;
+	UT_ASSERTeq(pmemobj_mwcas(pop, words, POBJ_MWCAS_MAX_WORDS + 1), -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	/* duplicated word */
+	words[1].ptr = words[0].ptr;
+	errno = 0;
+	UT_ASSERTeq(pmemobj_mwcas(pop, words, 2), -1);
+	UT_ASSERTeq(errno, EINVAL);
+	words[1].ptr = &rootp->counters[1];
+
+	/* reserved bit */
+	words[1].new_value = POBJ_MWCAS_RESERVED_BIT;
+	errno = 0;
+	UT_ASSERTeq(pmemobj_mwcas(pop, words, 2), -1);
+	UT_ASSERTeq(errno, EINVAL);
+	words[1].new_value = 1;
+
+	/* word outside of pool */
+	words[1].ptr = &word;
+	errno = 0;
+	UT_ASSERTeq(pmemobj_mwcas(pop, words, 2), -1);
+	UT_ASSERTeq(errno, EINVAL);
+	words[1].ptr = &rootp->counters[1];
+
+	/* inside of a transaction */
+	TX_BEGIN(pop) {
+		errno = 0;
+		UT_ASSERTeq(pmemobj_mwcas(pop, words, 2), -1);
+		UT_ASSERTeq(errno, EINVAL);
+	} TX_ONABORT {
+		UT_ASSERT(0);
+	} TX_END
+
+	for (int i = 0; i < NTHREADS; ++i)
+		UT_ASSERTeq(rootp->counters[i], 0);
+}
+
+/*
+ * increment_worker -- increments two neighbouring counters at once
+ */
+static void *
+increment_worker(void *arg)
+{
+	size_t idx = (size_t)arg;
+
+	struct pobj_mwcas words[2];
+	words[0].ptr = &rootp->counters[idx];
+	words[1].ptr = &rootp->counters[(idx + 1) % NTHREADS];
+
+	for (int i = 0; i < NOPS; ++i) {
+		int ret;
+		do {
+			for (int w = 0; w < 2; ++w) {
+				words[w].old_value =
+					pmemobj_mwcas_read(pop, words[w].ptr);
+				words[w].new_value = words[w].old_value + 1;
+			}
+			ret = pmemobj_mwcas(pop, words, 2);
+			UT_ASSERTne(ret, -1);
+		} while (ret != 0);
+	}
+
+	return NULL;
+}
+
+/*
+ * test_concurrent -- runs operations that overlap with each other
+ */
+static void
+test_concurrent(void)
+{
+	os_thread_t threads[NTHREADS];
+	for (size_t i = 0; i < NTHREADS; ++i)
+		PTHREAD_CREATE(&threads[i], NULL, increment_worker, (void *)i);
+
+	for (size_t i = 0; i < NTHREADS; ++i)
+		PTHREAD_JOIN(&threads[i], NULL);
+
+	/* each counter is incremented by two threads */
+	for (size_t i = 0; i < NTHREADS; ++i)
+		UT_ASSERTeq(rootp->counters[i], 2 * NOPS);
+}
+
+/*
+ * test_crash -- exits in the middle of an operation that owns only one of
+ *	its words, mimicking the steps of pmemobj_mwcas
+ */
+static void
+test_crash(void)
+{
+	struct pobj_mwcas words[2];
+	for (int i = 0; i < 2; ++i) {
+		words[i].ptr = &rootp->crashed[i];
+		words[i].old_value = 1;
+		words[i].new_value = 2;
+		*words[i].ptr = words[i].old_value;
+	}
+	pmemobj_persist(pop, rootp->crashed, sizeof(rootp->crashed));
+
+	/* the marker refers to a descriptor that won't exist after restart */
+	uint64_t marker = POBJ_MWCAS_RESERVED_BIT | 1;
+
+	struct lane *lane;
+	lane_hold(pop, &lane);
+	operation_start(lane->undo);
+	for (int i = 0; i < 2; ++i) {
+		struct ulog_entry_cas restore = {marker, words[i].old_value};
+		int ret = operation_add_buffer(lane->undo, words[i].ptr,
+			&restore, sizeof(restore), ULOG_OPERATION_BUF_CAS);
+		UT_ASSERTeq(ret, 0);
+	}
+
+	rootp->crashed[0] = marker;
+	pmemobj_persist(pop, &rootp->crashed[0], sizeof(uint64_t));
+
+	/* the second word is modified before the operation takes it */
+	rootp->crashed[1] = 3;
+	pmemobj_persist(pop, &rootp->crashed[1], sizeof(uint64_t));
+
+	DONE(NULL);
+}
+
+/*
+ * test_recovered -- checks that the interrupted operation was rolled back
+ *	without touching the word it didn't own
+ */
+static void
+test_recovered(void)
+{
+	UT_ASSERTeq(rootp->crashed[0], 1);
+	UT_ASSERTeq(rootp->crashed[1], 3);
+
+	struct pobj_mwcas words[2];
+	for (int i = 0; i < 2; ++i) {
+		words[i].ptr = &rootp->crashed[i];
+		words[i].old_value = rootp->crashed[i];
+		words[i].new_value = 2;
+	}
+
+	int ret = pmemobj_mwcas(pop, words, 2);
+	UT_ASSERTeq(ret, 0);
+
+	for (int i = 0; i < 2; ++i)
+		UT_ASSERTeq(rootp->crashed[i], 2);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "obj_mwcas");
+
+	if (argc != 3 || strchr("co", argv[2][0]) == NULL)
+		UT_FATAL("usage: %s file-name c|o", argv[0]);
+
+	const char *path = argv[1];
+
+	if (argv[2][0] == 'c') {
+		pop = pmemobj_create(path, LAYOUT, PMEMOBJ_MIN_POOL,
+			S_IWUSR | S_IRUSR);
+		if (pop == NULL)
+			UT_FATAL("!pmemobj_create: %s", path);
+
+		rootp = pmemobj_direct(pmemobj_root(pop, sizeof(*rootp)));
+
+		test_swap();
+		test_invalid();
+		test_concurrent();
+		test_crash();
+	} else {
+		pop = pmemobj_open(path, LAYOUT);
+		if (pop == NULL)
+			UT_FATAL("!pmemobj_open: %s", path);
+
+		rootp = pmemobj_direct(pmemobj_root(pop, sizeof(*rootp)));
+
+		test_recovered();
+
+		pmemobj_close(pop);
+
+		int ret = pmemobj_check(path, LAYOUT);
+		UT_ASSERTeq(ret, 1);
+	}
+
+	DONE(NULL);
+}
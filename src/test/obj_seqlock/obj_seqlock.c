@@ -0,0 +1,275 @@
+/*
+ * Copyright 2019, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * obj_seqlock.c -- unit test for the pmem resident seqlocks
+ */
+
+#include "unittest.h"
+
+#define LAYOUT "obj_seqlock"
+#define NREADERS 4
+#define NWRITERS 2
+#define NOPS 1000
+
+struct data {
+	uint64_t a;
+	uint64_t b;
+};
+
+struct root {
+	PMEMseqlock lock;
+	struct data data;
+	PMEMseqlock held;
+};
+
+static PMEMobjpool *pop;
+static struct root *rootp;
+
+/*
+ * reader -- verifies that the data is never seen in an inconsistent state
+ */
+static void *
+reader(void *arg)
+{
+	uint64_t last = 0;
+	for (int i = 0; i < NOPS; ++i) {
+		struct data d;
+
+		POBJ_SEQLOCK_READ_BEGIN(pop, &rootp->lock) {
+			d = rootp->data;
+		} POBJ_SEQLOCK_READ_END(pop, &rootp->lock)
+
+		UT_ASSERTeq(d.a, d.b);
+		UT_ASSERT(d.a >= last);
+		last = d.a;
+	}
+
+	return NULL;
+}
+
+/*
+ * writer -- modifies the data with the seqlock held
+ */
+static void *
+writer(void *arg)
+{
+	int tx = *(int *)arg;
+
+	for (int i = 0; i < NOPS; ++i) {
+		if (tx) {
+			TX_BEGIN_PARAM(pop, TX_PARAM_SEQLOCK, &rootp->lock,
+					TX_PARAM_NONE) {
+				pmemobj_tx_add_range_direct(&rootp->data,
+					sizeof(rootp->data));
+				rootp->data.a++;
+				rootp->data.b++;
+			} TX_ONABORT {
+				UT_ASSERT(0);
+			} TX_END
+		} else {
+			int ret = pmemobj_seqlock_wrlock(pop, &rootp->lock);
+			UT_ASSERTeq(ret, 0);
+			rootp->data.a++;
+			rootp->data.b++;
+			pmemobj_persist(pop, &rootp->data, sizeof(rootp->data));
+			ret = pmemobj_seqlock_unlock(pop, &rootp->lock);
+			UT_ASSERTeq(ret, 0);
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * test_concurrent -- runs the readers and the writers concurrently
+ */
+static void
+test_concurrent(void)
+{
+	os_thread_t readers[NREADERS];
+	os_thread_t writers[NWRITERS];
+	int tx[NWRITERS];
+
+	for (int i = 0; i < NWRITERS; ++i) {
+		tx[i] = i % 2;
+		PTHREAD_CREATE(&writers[i], NULL, writer, &tx[i]);
+	}
+
+	for (int i = 0; i < NREADERS; ++i)
+		PTHREAD_CREATE(&readers[i], NULL, reader, NULL);
+
+	for (int i = 0; i < NREADERS; ++i)
+		PTHREAD_JOIN(&readers[i], NULL);
+
+	for (int i = 0; i < NWRITERS; ++i)
+		PTHREAD_JOIN(&writers[i], NULL);
+
+	UT_ASSERTeq(rootp->data.a, NWRITERS * NOPS);
+	UT_ASSERTeq(rootp->data.b, NWRITERS * NOPS);
+}
+
+/*
+ * test_abort -- verifies that the data restored by an aborted transaction
+ *	is consistent for the readers
+ */
+static void
+test_abort(void)
+{
+	uint64_t a = rootp->data.a;
+	uint64_t seq = pmemobj_seqlock_read_begin(pop, &rootp->lock);
+
+	TX_BEGIN(pop) {
+		pmemobj_tx_lock(TX_PARAM_SEQLOCK, &rootp->lock);
+		/* the held seqlock is not restored on abort */
+		pmemobj_tx_add_range_direct(&rootp->lock,
+			sizeof(rootp->lock) + sizeof(rootp->data));
+		rootp->data.a++;
+
+		pmemobj_tx_abort(ECANCELED);
+	} TX_ONCOMMIT {
+		UT_ASSERT(0);
+	} TX_END
+
+	/* the read that overlapped with the transaction is not valid */
+	UT_ASSERTne(pmemobj_seqlock_read_retry(pop, &rootp->lock, seq), 0);
+
+	struct data d;
+	POBJ_SEQLOCK_READ_BEGIN(pop, &rootp->lock) {
+		d = rootp->data;
+	} POBJ_SEQLOCK_READ_END(pop, &rootp->lock)
+
+	UT_ASSERTeq(d.a, a);
+	UT_ASSERTeq(d.b, a);
+}
+
+/*
+ * test_validation -- verifies that a read overlapping with a writer is
+ *	not validated
+ */
+static void
+test_validation(void)
+{
+	uint64_t seq = pmemobj_seqlock_read_begin(pop, &rootp->lock);
+	UT_ASSERTeq(pmemobj_seqlock_read_retry(pop, &rootp->lock, seq), 0);
+
+	int ret = pmemobj_seqlock_wrlock(pop, &rootp->lock);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTne(pmemobj_seqlock_read_retry(pop, &rootp->lock, seq), 0);
+	ret = pmemobj_seqlock_unlock(pop, &rootp->lock);
+	UT_ASSERTeq(ret, 0);
+
+	UT_ASSERTne(pmemobj_seqlock_read_retry(pop, &rootp->lock, seq), 0);
+
+	seq = pmemobj_seqlock_read_begin(pop, &rootp->lock);
+	UT_ASSERTeq(pmemobj_seqlock_read_retry(pop, &rootp->lock, seq), 0);
+}
+
+/*
+ * test_held -- leaves a seqlock locked for writing when the pool is closed
+ */
+static void
+test_held(void)
+{
+	int ret = pmemobj_seqlock_wrlock(pop, &rootp->held);
+	UT_ASSERTeq(ret, 0);
+
+	/* the readers of the other seqlocks are not affected */
+	struct data d;
+	POBJ_SEQLOCK_READ_BEGIN(pop, &rootp->lock) {
+		d = rootp->data;
+	} POBJ_SEQLOCK_READ_END(pop, &rootp->lock)
+
+	UT_ASSERTeq(d.a, d.b);
+}
+
+/*
+ * test_reopened -- verifies that the seqlocks are reinitialized after the
+ *	pool is reopened
+ */
+static void
+test_reopened(void)
+{
+	/* the readers neither block nor initialize the seqlock */
+	uint64_t seq = pmemobj_seqlock_read_begin(pop, &rootp->held);
+	UT_ASSERTeq(seq, 0);
+	UT_ASSERTeq(pmemobj_seqlock_read_retry(pop, &rootp->held, seq), 0);
+
+	int ret = pmemobj_seqlock_wrlock(pop, &rootp->held);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTne(pmemobj_seqlock_read_retry(pop, &rootp->held, seq), 0);
+	ret = pmemobj_seqlock_unlock(pop, &rootp->held);
+	UT_ASSERTeq(ret, 0);
+
+	seq = pmemobj_seqlock_read_begin(pop, &rootp->held);
+	UT_ASSERTeq(seq, 2);
+
+	UT_ASSERTeq(rootp->data.a, NWRITERS * NOPS);
+	UT_ASSERTeq(rootp->data.b, NWRITERS * NOPS);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "obj_seqlock");
+
+	if (argc != 3 || strchr("co", argv[2][0]) == NULL)
+		UT_FATAL("usage: %s file-name c|o", argv[0]);
+
+	const char *path = argv[1];
+
+	if (argv[2][0] == 'c') {
+		pop = pmemobj_create(path, LAYOUT, PMEMOBJ_MIN_POOL,
+			S_IWUSR | S_IRUSR);
+		if (pop == NULL)
+			UT_FATAL("!pmemobj_create: %s", path);
+
+		rootp = pmemobj_direct(pmemobj_root(pop, sizeof(*rootp)));
+
+		test_concurrent();
+		test_abort();
+		test_validation();
+		test_held();
+	} else {
+		pop = pmemobj_open(path, LAYOUT);
+		if (pop == NULL)
+			UT_FATAL("!pmemobj_open: %s", path);
+
+		rootp = pmemobj_direct(pmemobj_root(pop, sizeof(*rootp)));
+
+		test_reopened();
+	}
+
+	pmemobj_close(pop);
+
+	DONE(NULL);
+}
@@ -44,7 +44,8 @@ FUNC_MOCK(pthread_mutex_init, int,
 		pthread_mutex_t *__restrict mutex,
 		const pthread_mutexattr_t *__restrict attr)
 	FUNC_MOCK_RUN_RET_DEFAULT_REAL(pthread_mutex_init, mutex, attr)
-	FUNC_MOCK_RUN(1) {
+	/* call 0 initializes the pool-wide sync parameters */
+	FUNC_MOCK_RUN(2) {
 		return -1;
 	}
 FUNC_MOCK_END
@@ -62,7 +63,8 @@ FUNC_MOCK(pthread_cond_init, int,
 		pthread_cond_t *__restrict cond,
 		const pthread_condattr_t *__restrict attr)
 	FUNC_MOCK_RUN_RET_DEFAULT_REAL(pthread_cond_init, cond, attr)
-	FUNC_MOCK_RUN(1) {
+	/* call 0 initializes the pool-wide sync parameters */
+	FUNC_MOCK_RUN(2) {
 		return -1;
 	}
 FUNC_MOCK_END
@@ -41,7 +41,8 @@ FUNC_MOCK(os_mutex_init, int,
 	os_mutex_t *__restrict mutex)
 
 	FUNC_MOCK_RUN_RET_DEFAULT_REAL(os_mutex_init, mutex)
-	FUNC_MOCK_RUN(1) {
+	/* call 0 initializes the pool-wide sync parameters */
+	FUNC_MOCK_RUN(2) {
 		return -1;
 	}
 FUNC_MOCK_END
@@ -59,7 +60,8 @@ FUNC_MOCK(os_cond_init, int,
 	os_cond_t *__restrict cond)
 
 	FUNC_MOCK_RUN_RET_DEFAULT_REAL(os_cond_init, cond)
-	FUNC_MOCK_RUN(1) {
+	/* call 0 initializes the pool-wide sync parameters */
+	FUNC_MOCK_RUN(2) {
 		return -1;
 	}
 FUNC_MOCK_END
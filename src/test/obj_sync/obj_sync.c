@@ -49,13 +49,20 @@
 #define WORKER_RUNS 10
 #define MAX_OPENS 5
 
-#define FATAL_USAGE() UT_FATAL("usage: obj_sync [mrc] <num_threads> <runs>\n")
+#define FATAL_USAGE() UT_FATAL("usage: obj_sync [mrct] <num_threads> <runs> "\
+	"[a]\n")
 
 /* posix thread worker typedef */
 typedef void *(*worker)(void *);
 
 /* the mock pmemobj pool */
 static PMEMobjpool Mock_pop;
+static struct stats_transient Mock_stats_transient;
+static struct stats Mock_stats = {
+	.enabled = 1,
+	.transient = &Mock_stats_transient,
+	.persistent = NULL,
+};
 
 /* the tested object containing persistent synchronization primitives */
 static struct mock_obj {
@@ -275,6 +282,20 @@ timed_check_worker(void *arg)
 	return NULL;
 }
 
+/*
+ * mutex_destroy -- (internal) destroys a mutex, unless it's a queue lock
+ */
+static void
+mutex_destroy(PMEMmutex *mutexp)
+{
+	PMEMmutex_internal *mutexip = (PMEMmutex_internal *)mutexp;
+
+	if (mutexip->pmemmutex.adaptive)
+		UT_ASSERTeq(mutexip->PMEMmutex_tail, 0);
+	else
+		os_mutex_destroy(&mutexip->PMEMmutex_lock);
+}
+
 /*
  * cleanup -- (internal) clean up after each run
  */
@@ -283,24 +304,20 @@ cleanup(char test_type)
 {
 	switch (test_type) {
 		case 'm':
-			os_mutex_destroy(&((PMEMmutex_internal *)
-				&(Test_obj->mutex))->PMEMmutex_lock);
+			mutex_destroy(&Test_obj->mutex);
 			break;
 		case 'r':
 			os_rwlock_destroy(&((PMEMrwlock_internal *)
 				&(Test_obj->rwlock))->PMEMrwlock_lock);
 			break;
 		case 'c':
-			os_mutex_destroy(&((PMEMmutex_internal *)
-				&(Test_obj->mutex))->PMEMmutex_lock);
+			mutex_destroy(&Test_obj->mutex);
 			os_cond_destroy(&((PMEMcond_internal *)
 				&(Test_obj->cond))->PMEMcond_cond);
 			break;
 		case 't':
-			os_mutex_destroy(&((PMEMmutex_internal *)
-				&(Test_obj->mutex))->PMEMmutex_lock);
-			os_mutex_destroy(&((PMEMmutex_internal *)
-				&(Test_obj->mutex_locked))->PMEMmutex_lock);
+			mutex_destroy(&Test_obj->mutex);
+			mutex_destroy(&Test_obj->mutex_locked);
 			break;
 		default:
 			FATAL_USAGE();
@@ -358,6 +375,9 @@ main(int argc, char *argv[])
 	if (opens > MAX_OPENS)
 		UT_FATAL("Do not use more than %d runs.\n", MAX_OPENS);
 
+	/* the mutexes alternate between queue locks and os mutexes */
+	int adaptive = argc > 4 && argv[4][0] == 'a';
+
 	os_thread_t *write_threads
 		= (os_thread_t *)MALLOC(num_threads * sizeof(os_thread_t));
 	os_thread_t *check_threads
@@ -367,6 +387,9 @@ main(int argc, char *argv[])
 	mock_open_pool(&Mock_pop);
 	Mock_pop.p_ops.persist = obj_sync_persist;
 	Mock_pop.p_ops.base = &Mock_pop;
+	Mock_pop.stats = &Mock_stats;
+	Mock_pop.sync_params = sync_params_new();
+	UT_ASSERTne(Mock_pop.sync_params, NULL);
 	Test_obj = (struct mock_obj *)MALLOC(sizeof(struct mock_obj));
 	/* zero-initialize the test object */
 	pmemobj_mutex_zero(&Mock_pop, &Test_obj->mutex);
@@ -377,6 +400,10 @@ main(int argc, char *argv[])
 	memset(&Test_obj->data, 0, DATA_SIZE);
 
 	for (unsigned long run = 0; run < opens; run++) {
+		Mock_pop.sync_params->adaptive = adaptive && run % 2 == 0;
+		/* makes the contended queue locks sleep right away */
+		Mock_pop.sync_params->spin = run % 4 == 0 ? 0 : 100;
+
 		if (test_type == 't') {
 			pmemobj_mutex_lock(&Mock_pop,
 					&Test_obj->mutex_locked);
@@ -397,11 +424,20 @@ main(int argc, char *argv[])
 			pmemobj_mutex_unlock(&Mock_pop,
 					&Test_obj->mutex_locked);
 		}
+		if (test_type != 'r') {
+			PMEMmutex_internal *mutexip =
+				(PMEMmutex_internal *)&Test_obj->mutex;
+			UT_ASSERTeq(mutexip->pmemmutex.adaptive,
+				(uint64_t)Mock_pop.sync_params->adaptive);
+		}
+
 		/* up the run_id counter and cleanup */
 		mock_open_pool(&Mock_pop);
 		cleanup(test_type);
 	}
 
+	sync_params_delete(Mock_pop.sync_params);
+
 	FREE(check_threads);
 	FREE(write_threads);
 	FREE(Test_obj);
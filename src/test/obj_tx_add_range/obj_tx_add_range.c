@@ -53,6 +53,7 @@
 enum type_number {
 	TYPE_OBJ,
 	TYPE_OBJ_ABORT,
+	TYPE_OBJ_REDO,
 };
 
 TOID_DECLARE(struct object, 0);
@@ -399,6 +400,40 @@ do_tx_add_huge_range_abort(PMEMobjpool *pop)
 	UT_ASSERT(util_is_zeroed(pmemobj_direct(obj), snapshot_s));
 }
 
+/*
+ * do_tx_add_range_zeroed_abort -- call pmemobj_tx_add_range on a mostly
+ * zeroed object and abort the tx
+ */
+static void
+do_tx_add_range_zeroed_abort(PMEMobjpool *pop)
+{
+	int ret;
+	TOID(struct object) obj;
+	TOID_ASSIGN(obj, do_tx_zalloc(pop, TYPE_OBJ_ABORT));
+
+	D_RW(obj)->value = TEST_VALUE_1;
+	D_RW(obj)->data[DATA_SIZE / 2] = TEST_VALUE_2;
+	D_RW(obj)->data[DATA_SIZE - 1] = TEST_VALUE_2;
+	pmemobj_persist(pop, D_RW(obj), sizeof(struct object));
+
+	TX_BEGIN(pop) {
+		ret = pmemobj_tx_add_range(obj.oid, 0, OBJ_SIZE);
+		UT_ASSERTeq(ret, 0);
+		memset(D_RW(obj), 0xc, OBJ_SIZE);
+		pmemobj_tx_abort(-1);
+	} TX_ONCOMMIT {
+		UT_ASSERT(0);
+	} TX_END
+
+	UT_ASSERTeq(D_RO(obj)->value, TEST_VALUE_1);
+	for (size_t i = 0; i < DATA_SIZE; ++i) {
+		if (i == DATA_SIZE / 2 || i == DATA_SIZE - 1)
+			UT_ASSERTeq(D_RO(obj)->data[i], TEST_VALUE_2);
+		else
+			UT_ASSERTeq(D_RO(obj)->data[i], 0);
+	}
+}
+
 /*
  * do_tx_add_range_commit -- call pmemobj_tx_add_range and commit the tx
  */
@@ -445,6 +480,68 @@ do_tx_xadd_range_commit(PMEMobjpool *pop)
 	UT_ASSERTeq(D_RO(obj)->value, TEST_VALUE_1);
 }
 
+/*
+ * do_tx_xadd_range_no_snapshot_commit -- call pmemobj_tx_xadd_range with
+ *	POBJ_XADD_NO_SNAPSHOT flag and commit the tx
+ */
+static void
+do_tx_xadd_range_no_snapshot_commit(PMEMobjpool *pop)
+{
+	int ret;
+	TOID(struct object) obj;
+	TOID_ASSIGN(obj, do_tx_zalloc(pop, TYPE_OBJ));
+
+	TX_BEGIN(pop) {
+		ret = pmemobj_tx_xadd_range(obj.oid, DATA_OFF, DATA_SIZE,
+				POBJ_XADD_NO_SNAPSHOT);
+		UT_ASSERTeq(ret, 0);
+
+		ret = pmemobj_tx_xadd_range(obj.oid, VALUE_OFF, VALUE_SIZE,
+				POBJ_XADD_ASSUME_INITIALIZED);
+		UT_ASSERTeq(ret, 0);
+
+		memset(D_RW(obj)->data, TEST_VALUE_2, DATA_SIZE);
+		D_RW(obj)->value = TEST_VALUE_1;
+	} TX_ONABORT {
+		UT_ASSERT(0);
+	} TX_END
+
+	UT_ASSERTeq(D_RO(obj)->value, TEST_VALUE_1);
+	for (size_t i = 0; i < DATA_SIZE; ++i)
+		UT_ASSERTeq(D_RO(obj)->data[i], TEST_VALUE_2);
+}
+
+/*
+ * do_tx_xadd_range_no_snapshot_abort -- call pmemobj_tx_xadd_range with
+ *	POBJ_XADD_NO_SNAPSHOT flag and abort the tx
+ */
+static void
+do_tx_xadd_range_no_snapshot_abort(PMEMobjpool *pop)
+{
+	int ret;
+	TOID(struct object) obj;
+	TOID_ASSIGN(obj, do_tx_zalloc(pop, TYPE_OBJ));
+
+	TX_BEGIN(pop) {
+		ret = pmemobj_tx_xadd_range(obj.oid, DATA_OFF, DATA_SIZE,
+				POBJ_XADD_NO_SNAPSHOT);
+		UT_ASSERTeq(ret, 0);
+
+		ret = pmemobj_tx_add_range(obj.oid, VALUE_OFF, VALUE_SIZE);
+		UT_ASSERTeq(ret, 0);
+
+		memset(D_RW(obj)->data, TEST_VALUE_2, DATA_SIZE);
+		D_RW(obj)->value = TEST_VALUE_1;
+
+		pmemobj_tx_abort(-1);
+	} TX_ONCOMMIT {
+		UT_ASSERT(0);
+	} TX_END
+
+	/* only the snapshotted range is rolled back */
+	UT_ASSERTeq(D_RO(obj)->value, 0);
+}
+
 /*
  * do_tx_add_range_overlapping -- call pmemobj_tx_add_range with overlapping
  */
@@ -604,6 +701,206 @@ do_tx_add_range_reopen(char *path)
 	}
 }
 
+/*
+ * do_tx_add_range_redo_commit -- modify ranges in a redo-only transaction
+ *	and commit it
+ */
+static void
+do_tx_add_range_redo_commit(PMEMobjpool *pop)
+{
+	int ret;
+	TOID(struct object) obj;
+	TOID_ASSIGN(obj, do_tx_zalloc(pop, TYPE_OBJ));
+
+	TX_BEGIN_PARAM(pop, TX_PARAM_REDO) {
+		ret = pmemobj_tx_add_range(obj.oid, VALUE_OFF, VALUE_SIZE);
+		UT_ASSERTeq(ret, 0);
+
+		size_t *value = pmemobj_tx_access(&D_RW(obj)->value,
+			VALUE_SIZE);
+		UT_ASSERTne(value, &D_RW(obj)->value);
+		*value = TEST_VALUE_1;
+
+		/* the object is not modified until commit */
+		UT_ASSERTeq(D_RO(obj)->value, 0);
+
+		/* unaligned ranges are merged with the existing ones */
+		ret = pmemobj_tx_add_range(obj.oid, DATA_OFF + 1, 3);
+		UT_ASSERTeq(ret, 0);
+		ret = pmemobj_tx_add_range(obj.oid, DATA_OFF + 6, 20);
+		UT_ASSERTeq(ret, 0);
+
+		char *data = pmemobj_tx_access(D_RW(obj)->data, 26);
+		UT_ASSERTne(data, D_RW(obj)->data);
+		memset(data, TEST_VALUE_2, 26);
+
+		/* merging invalidates the previously returned pointers */
+		value = pmemobj_tx_access(&D_RW(obj)->value, VALUE_SIZE);
+		UT_ASSERTeq(*value, TEST_VALUE_1);
+		UT_ASSERTeq((char *)value + DATA_OFF, data);
+
+		/* range not added to the transaction */
+		char *tail = pmemobj_tx_access(&D_RW(obj)->data[100], 1);
+		UT_ASSERTeq(tail, &D_RW(obj)->data[100]);
+
+		TX_BEGIN(pop) {
+			ret = pmemobj_tx_add_range(obj.oid, DATA_OFF + 200,
+				VALUE_SIZE);
+			UT_ASSERTeq(ret, 0);
+
+			data = pmemobj_tx_access(&D_RW(obj)->data[200],
+				VALUE_SIZE);
+			UT_ASSERTne(data, &D_RW(obj)->data[200]);
+			*data = TEST_VALUE_1;
+		} TX_ONABORT {
+			UT_ASSERT(0);
+		} TX_END
+
+		UT_ASSERTeq(D_RO(obj)->data[200], 0);
+	} TX_ONABORT {
+		UT_ASSERT(0);
+	} TX_END
+
+	UT_ASSERTeq(D_RO(obj)->value, TEST_VALUE_1);
+	for (int i = 0; i < 26; ++i)
+		UT_ASSERTeq(D_RO(obj)->data[i], TEST_VALUE_2);
+	UT_ASSERTeq(D_RO(obj)->data[26], 0);
+	UT_ASSERTeq(D_RO(obj)->data[200], TEST_VALUE_1);
+
+	/* outside of a transaction the pointer is returned unchanged */
+	UT_ASSERTeq(pmemobj_tx_access(&D_RW(obj)->value, VALUE_SIZE),
+		&D_RW(obj)->value);
+}
+
+/*
+ * do_tx_add_range_redo_abort -- modify ranges in a redo-only transaction
+ *	and abort it
+ */
+static void
+do_tx_add_range_redo_abort(PMEMobjpool *pop)
+{
+	int ret;
+	TOID(struct object) obj;
+	TOID(struct object) nobj;
+	TOID_ASSIGN(obj, do_tx_zalloc(pop, TYPE_OBJ));
+
+	TX_BEGIN_PARAM(pop, TX_PARAM_REDO) {
+		ret = pmemobj_tx_add_range(obj.oid, 0, sizeof(struct object));
+		UT_ASSERTeq(ret, 0);
+
+		struct object *o = pmemobj_tx_access(D_RW(obj),
+			sizeof(struct object));
+		o->value = TEST_VALUE_1;
+
+		TOID_ASSIGN(nobj, pmemobj_tx_zalloc(sizeof(struct object),
+			TYPE_OBJ_REDO));
+
+		/* newly allocated objects are modified directly */
+		UT_ASSERTeq(pmemobj_tx_access(D_RW(nobj),
+			sizeof(struct object)), D_RW(nobj));
+		D_RW(nobj)->value = TEST_VALUE_2;
+
+		pmemobj_tx_abort(-1);
+	} TX_ONCOMMIT {
+		UT_ASSERT(0);
+	} TX_END
+
+	UT_ASSERTeq(D_RO(obj)->value, 0);
+	TOID_ASSIGN(nobj, POBJ_FIRST_TYPE_NUM(pop, TYPE_OBJ_REDO));
+	UT_ASSERT(TOID_IS_NULL(nobj));
+}
+
+/*
+ * do_tx_add_range_redo_free -- free an object allocated and added to
+ *	a redo-only transaction
+ */
+static void
+do_tx_add_range_redo_free(PMEMobjpool *pop)
+{
+	int ret;
+	TOID(struct object) obj;
+	TOID(struct object) nobj;
+	TOID_ASSIGN(obj, do_tx_zalloc(pop, TYPE_OBJ));
+
+	TX_BEGIN_PARAM(pop, TX_PARAM_REDO) {
+		TOID_ASSIGN(nobj, pmemobj_tx_zalloc(sizeof(struct object),
+			TYPE_OBJ_REDO));
+
+		ret = pmemobj_tx_add_range(obj.oid, 0, sizeof(struct object));
+		UT_ASSERTeq(ret, 0);
+		ret = pmemobj_tx_add_range(nobj.oid, 0, sizeof(struct object));
+		UT_ASSERTeq(ret, 0);
+
+		struct object *o = pmemobj_tx_access(D_RW(obj),
+			sizeof(struct object));
+		o->value = TEST_VALUE_1;
+
+		ret = pmemobj_tx_free(nobj.oid);
+		UT_ASSERTeq(ret, 0);
+
+		/* the write set of the other object is left intact */
+		UT_ASSERTeq(pmemobj_tx_access(D_RW(obj),
+			sizeof(struct object)), o);
+	} TX_ONABORT {
+		UT_ASSERT(0);
+	} TX_END
+
+	UT_ASSERTeq(D_RO(obj)->value, TEST_VALUE_1);
+	TOID_ASSIGN(nobj, POBJ_FIRST_TYPE_NUM(pop, TYPE_OBJ_REDO));
+	UT_ASSERT(TOID_IS_NULL(nobj));
+}
+
+/*
+ * do_tx_add_range_redo_large -- modify a range that doesn't fit in the
+ *	base redo log in a redo-only transaction
+ */
+static void
+do_tx_add_range_redo_large(PMEMobjpool *pop)
+{
+	TOID(struct root) root = POBJ_ROOT(pop, struct root);
+
+	TX_BEGIN_PARAM(pop, TX_PARAM_REDO) {
+		TX_ADD_FIELD(root, tab);
+
+		int *tab = pmemobj_tx_access(D_RW(root)->tab,
+			sizeof(D_RO(root)->tab));
+		for (size_t i = 0; i < ROOT_TAB_SIZE; ++i)
+			tab[i] = (int)i;
+	} TX_ONABORT {
+		UT_ASSERT(0);
+	} TX_END
+
+	for (size_t i = 0; i < ROOT_TAB_SIZE; ++i)
+		UT_ASSERTeq(D_RO(root)->tab[i], (int)i);
+}
+
+/*
+ * do_tx_add_range_redo_nested -- begin a redo-only transaction nested in
+ *	an undo one
+ */
+static void
+do_tx_add_range_redo_nested(PMEMobjpool *pop)
+{
+	TOID(struct object) obj;
+	TOID_ASSIGN(obj, do_tx_zalloc(pop, TYPE_OBJ));
+
+	TX_BEGIN(pop) {
+		TX_ADD(obj);
+		D_RW(obj)->value = TEST_VALUE_1;
+
+		TX_BEGIN_PARAM(pop, TX_PARAM_REDO) {
+			UT_ASSERT(0);
+		} TX_ONCOMMIT {
+			UT_ASSERT(0);
+		} TX_END
+	} TX_ONCOMMIT {
+		UT_ASSERT(0);
+	} TX_END
+
+	UT_ASSERTeq(errno, EINVAL);
+	UT_ASSERTeq(D_RO(obj)->value, 0);
+}
+
 static void
 do_tx_add_range_too_large(PMEMobjpool *pop)
 {
@@ -679,9 +976,25 @@ main(int argc, char *argv[])
 		VALGRIND_WRITE_STATS;
 		do_tx_add_huge_range_abort(pop);
 		VALGRIND_WRITE_STATS;
+		do_tx_add_range_zeroed_abort(pop);
+		VALGRIND_WRITE_STATS;
 		do_tx_add_range_zero(pop);
 		VALGRIND_WRITE_STATS;
 		do_tx_xadd_range_commit(pop);
+		VALGRIND_WRITE_STATS;
+		do_tx_xadd_range_no_snapshot_commit(pop);
+		VALGRIND_WRITE_STATS;
+		do_tx_xadd_range_no_snapshot_abort(pop);
+		VALGRIND_WRITE_STATS;
+		do_tx_add_range_redo_commit(pop);
+		VALGRIND_WRITE_STATS;
+		do_tx_add_range_redo_abort(pop);
+		VALGRIND_WRITE_STATS;
+		do_tx_add_range_redo_free(pop);
+		VALGRIND_WRITE_STATS;
+		do_tx_add_range_redo_large(pop);
+		VALGRIND_WRITE_STATS;
+		do_tx_add_range_redo_nested(pop);
 		pmemobj_close(pop);
 	}
 
@@ -0,0 +1,253 @@
+/*
+ * Copyright 2019, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * obj_tx_ranges.c -- unit test for the set of transaction ranges
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tx_ranges.h"
+#include "util.h"
+#include "unittest.h"
+
+#define SPACE_SIZE (1 << 16)
+#define NOPS 20000
+
+/* model of the set, flags of each byte, 0 if not in the set */
+static uint64_t Model[SPACE_SIZE];
+
+/*
+ * add_cb -- checks that the range was not yet in the set and adds it to
+ *	the model
+ */
+static int
+add_cb(const struct tx_range_def *def, void *arg)
+{
+	unsigned *nbytes = arg;
+
+	UT_ASSERT(def->size != 0);
+	UT_ASSERT(def->offset + def->size <= SPACE_SIZE);
+	for (uint64_t i = def->offset; i < def->offset + def->size; ++i) {
+		UT_ASSERTeq(Model[i], 0);
+		Model[i] = def->flags;
+	}
+
+	*nbytes += (unsigned)def->size;
+
+	return 0;
+}
+
+/*
+ * check_set -- verifies that the set is sorted, its ranges are disjoint,
+ *	not mergeable and equal to the model
+ */
+static void
+check_set(struct tx_ranges *r)
+{
+	UT_ASSERT(r->nleaves >= 1);
+	UT_ASSERTeq(r->leaves[0], &r->first);
+
+	uint64_t covered = 0;
+	const struct tx_range_def *prev = NULL;
+	for (size_t i = 0; i < r->nleaves; ++i) {
+		struct tx_ranges_leaf *l = r->leaves[i];
+		UT_ASSERT(l->nranges != 0 || r->nleaves == 1);
+
+		for (unsigned j = 0; j < l->nranges; ++j) {
+			const struct tx_range_def *d = &l->ranges[j];
+			UT_ASSERT(d->size != 0);
+
+			if (prev != NULL) {
+				uint64_t pend = prev->offset + prev->size;
+				UT_ASSERT(pend <= d->offset);
+				UT_ASSERT(pend != d->offset ||
+					prev->flags != d->flags ||
+					(prev->flags & TX_RANGE_NO_MERGE));
+			}
+
+			for (uint64_t b = d->offset;
+					b < d->offset + d->size; ++b)
+				UT_ASSERTeq(Model[b], d->flags);
+
+			covered += d->size;
+			prev = d;
+		}
+	}
+
+	uint64_t model_covered = 0;
+	for (size_t i = 0; i < SPACE_SIZE; ++i)
+		model_covered += Model[i] != 0;
+
+	UT_ASSERTeq(covered, model_covered);
+}
+
+/*
+ * clear_cb -- checks that the ranges are visited in an ascending order
+ */
+static void
+clear_cb(const struct tx_range_def *def, void *arg)
+{
+	uint64_t *last_end = arg;
+
+	UT_ASSERT(*last_end <= def->offset);
+	*last_end = def->offset + def->size;
+}
+
+/*
+ * test_basic -- merging of adjacent and overlapping ranges
+ */
+static void
+test_basic(void)
+{
+	struct tx_ranges r;
+	tx_ranges_init(&r);
+	memset(Model, 0, sizeof(Model));
+
+	unsigned nbytes = 0;
+	struct tx_range_def d = {100, 10, 1};
+	tx_ranges_add(&r, &d, add_cb, &nbytes);
+	UT_ASSERTeq(nbytes, 10);
+
+	/* already covered */
+	d.offset = 102;
+	d.size = 5;
+	tx_ranges_add(&r, &d, add_cb, &nbytes);
+	UT_ASSERTeq(nbytes, 10);
+
+	/* adjacent on both sides */
+	d.offset = 120;
+	d.size = 10;
+	tx_ranges_add(&r, &d, add_cb, &nbytes);
+	d.offset = 110;
+	tx_ranges_add(&r, &d, add_cb, &nbytes);
+	UT_ASSERTeq(nbytes, 30);
+	UT_ASSERTeq(r.first.nranges, 1);
+	UT_ASSERTeq(r.first.ranges[0].offset, 100);
+	UT_ASSERTeq(r.first.ranges[0].size, 30);
+
+	/* overlapping on both sides, different flags */
+	d.offset = 90;
+	d.size = 50;
+	d.flags = 2;
+	tx_ranges_add(&r, &d, add_cb, &nbytes);
+	UT_ASSERTeq(nbytes, 50);
+	UT_ASSERTeq(r.first.nranges, 3);
+	check_set(&r);
+
+	/* ranges that are never merged */
+	d.offset = 200;
+	d.size = 16;
+	d.flags = TX_RANGE_NO_MERGE;
+	tx_ranges_add(&r, &d, add_cb, &nbytes);
+	d.offset = 216;
+	tx_ranges_add(&r, &d, add_cb, &nbytes);
+	UT_ASSERTeq(r.first.nranges, 5);
+	check_set(&r);
+
+	UT_ASSERTne(tx_ranges_get(&r, 216), NULL);
+	UT_ASSERTeq(tx_ranges_get(&r, 217), NULL);
+	tx_ranges_remove(&r, 216);
+	memset(&Model[216], 0, 16 * sizeof(Model[0]));
+	UT_ASSERTeq(tx_ranges_get(&r, 216), NULL);
+	check_set(&r);
+
+	uint64_t last_end = 0;
+	tx_ranges_clear(&r, clear_cb, &last_end);
+	UT_ASSERTeq(last_end, 216);
+	UT_ASSERTeq(r.first.nranges, 0);
+}
+
+/*
+ * test_stress -- random operations compared against a model
+ */
+static void
+test_stress(unsigned seed, int ascending)
+{
+	struct tx_ranges r;
+	tx_ranges_init(&r);
+	memset(Model, 0, sizeof(Model));
+	srand(seed);
+
+	uint64_t next = 0;
+	for (int i = 0; i < NOPS; ++i) {
+		struct tx_range_def d;
+		d.size = (uint64_t)(rand() % 32 + 1);
+		if (ascending) {
+			d.offset = next % (SPACE_SIZE - 32);
+			next += d.size + (uint64_t)(rand() % 4);
+		} else {
+			d.offset = (uint64_t)rand() % (SPACE_SIZE - 32);
+		}
+
+		int op = rand() % 16;
+		if (op == 0) {
+			/* remove the range that starts at the offset, if any */
+			struct tx_range_def *f = tx_ranges_get(&r, d.offset);
+			if (f != NULL) {
+				memset(&Model[f->offset], 0,
+					f->size * sizeof(Model[0]));
+				tx_ranges_remove(&r, d.offset);
+			}
+		} else {
+			d.flags = op == 1 ? TX_RANGE_NO_MERGE :
+				(uint64_t)(op % 2 + 1);
+
+			unsigned nbytes = 0;
+			UT_ASSERTeq(tx_ranges_add(&r, &d, add_cb, &nbytes), 0);
+		}
+
+		if (i % 1000 == 0)
+			check_set(&r);
+	}
+
+	check_set(&r);
+	UT_ASSERT(r.nleaves > 1);
+
+	uint64_t last_end = 0;
+	tx_ranges_clear(&r, clear_cb, &last_end);
+	UT_ASSERTeq(r.nleaves, 1);
+	UT_ASSERTeq(r.first.nranges, 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "obj_tx_ranges");
+
+	test_basic();
+	test_stress(1, 0);
+	test_stress(2, 1);
+
+	DONE(NULL);
+}
@@ -42,6 +42,7 @@
 #define LAYOUT_NAME "tx_realloc"
 
 #define TEST_VALUE_1	1
+#define TEST_VALUE_2	2
 #define OBJ_SIZE	1024
 
 enum type_number {
@@ -59,6 +60,8 @@ enum type_number {
 	TYPE_ABORT_ZERO_HUGE,
 	TYPE_ABORT_ZERO_HUGE_MACRO,
 	TYPE_FREE,
+	TYPE_COW_COMMIT,
+	TYPE_COW_ABORT,
 };
 
 struct object {
@@ -75,6 +78,10 @@ struct object_macro {
 
 TOID_DECLARE(struct object_macro, TYPE_COMMIT_ZERO_MACRO);
 
+struct root {
+	TOID(struct object) handles[2];
+};
+
 /*
  * do_tx_alloc -- do tx allocation with specified type number
  */
@@ -478,6 +485,100 @@ do_tx_realloc_free(PMEMobjpool *pop)
 	UT_ASSERT(TOID_IS_NULL(obj));
 }
 
+/*
+ * do_tx_cow_init -- (internal) points both handles in the root object to
+ *	a new object
+ */
+static struct root *
+do_tx_cow_init(PMEMobjpool *pop, unsigned type_num)
+{
+	struct root *root = pmemobj_direct(pmemobj_root(pop,
+		sizeof(struct root)));
+	UT_ASSERTne(root, NULL);
+
+	TOID_ASSIGN(root->handles[0], do_tx_alloc(pop, type_num,
+		TEST_VALUE_1));
+	root->handles[1] = root->handles[0];
+	pmemobj_persist(pop, root->handles, sizeof(root->handles));
+
+	return root;
+}
+
+/*
+ * do_tx_cow_commit -- modify a copy of an object and commit the transaction
+ */
+static void
+do_tx_cow_commit(PMEMobjpool *pop)
+{
+	struct root *root = do_tx_cow_init(pop, TYPE_COW_COMMIT);
+	TOID(struct object) old = root->handles[0];
+	TOID(struct object) obj;
+
+	TX_BEGIN(pop) {
+		obj = TX_COW(root->handles[0]);
+		UT_ASSERT(!TOID_IS_NULL(obj));
+		UT_ASSERT(!TOID_EQUALS(obj, old));
+		UT_ASSERTeq(pmemobj_type_num(obj.oid), TYPE_COW_COMMIT);
+		UT_ASSERTeq(D_RO(obj)->value, TEST_VALUE_1);
+
+		/* the other handle is pointed to the same copy */
+		PMEMoid copy = pmemobj_tx_cow(&root->handles[1].oid);
+		UT_ASSERT(OID_EQUALS(copy, obj.oid));
+
+		D_RW(obj)->value = TEST_VALUE_2;
+
+		/* the handles are switched on commit */
+		UT_ASSERT(TOID_EQUALS(root->handles[0], old));
+		UT_ASSERTeq(D_RO(old)->value, TEST_VALUE_1);
+	} TX_ONABORT {
+		UT_ASSERT(0);
+	} TX_END
+
+	UT_ASSERT(TOID_EQUALS(root->handles[0], obj));
+	UT_ASSERT(TOID_EQUALS(root->handles[1], obj));
+	UT_ASSERTeq(D_RO(obj)->value, TEST_VALUE_2);
+
+	/* the original object is freed */
+	TOID_ASSIGN(obj, POBJ_FIRST_TYPE_NUM(pop, TYPE_COW_COMMIT));
+	UT_ASSERT(TOID_EQUALS(root->handles[0], obj));
+
+	TOID_ASSIGN(obj, POBJ_NEXT_TYPE_NUM(obj.oid));
+	UT_ASSERT(TOID_IS_NULL(obj));
+}
+
+/*
+ * do_tx_cow_abort -- modify a copy of an object and abort the transaction
+ */
+static void
+do_tx_cow_abort(PMEMobjpool *pop)
+{
+	struct root *root = do_tx_cow_init(pop, TYPE_COW_ABORT);
+	TOID(struct object) old = root->handles[0];
+
+	TX_BEGIN(pop) {
+		TOID(struct object) obj = TX_COW(root->handles[0]);
+		UT_ASSERT(!TOID_IS_NULL(obj));
+
+		D_RW(obj)->value = TEST_VALUE_2;
+
+		pmemobj_tx_abort(-1);
+	} TX_ONCOMMIT {
+		UT_ASSERT(0);
+	} TX_END
+
+	UT_ASSERT(TOID_EQUALS(root->handles[0], old));
+	UT_ASSERT(TOID_EQUALS(root->handles[1], old));
+	UT_ASSERTeq(D_RO(old)->value, TEST_VALUE_1);
+
+	/* the copy is freed */
+	TOID(struct object) obj;
+	TOID_ASSIGN(obj, POBJ_FIRST_TYPE_NUM(pop, TYPE_COW_ABORT));
+	UT_ASSERT(TOID_EQUALS(obj, old));
+
+	TOID_ASSIGN(obj, POBJ_NEXT_TYPE_NUM(obj.oid));
+	UT_ASSERT(TOID_IS_NULL(obj));
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -504,6 +605,8 @@ main(int argc, char *argv[])
 	do_tx_realloc_alloc_commit(pop);
 	do_tx_realloc_alloc_abort(pop);
 	do_tx_realloc_free(pop);
+	do_tx_cow_commit(pop);
+	do_tx_cow_abort(pop);
 
 	pmemobj_close(pop);
 
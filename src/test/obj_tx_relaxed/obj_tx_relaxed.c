@@ -0,0 +1,396 @@
+/*
+ * Copyright 2019, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * obj_tx_relaxed.c -- unit test for relaxed durability transactions
+ */
+
+#include "unittest.h"
+
+#define LAYOUT "obj_tx_relaxed"
+#define NTHREADS 4
+#define NOPS 1000
+#define OBJ_TYPE 1
+#define OBJ_SIZE 64
+
+struct root {
+	uint64_t a;
+	uint64_t b;
+	uint64_t c;
+	uint64_t counters[NTHREADS];
+	PMEMoid ptr;
+};
+
+static PMEMobjpool *pop;
+static struct root *rootp;
+
+/*
+ * epoch_get -- returns the value of the given epoch counter
+ */
+static uint64_t
+epoch_get(const char *name)
+{
+	uint64_t epoch;
+	int ret = pmemobj_ctl_get(pop, name, &epoch);
+	UT_ASSERTeq(ret, 0);
+
+	return epoch;
+}
+
+/*
+ * set_relaxed -- sets the fields of the root object in a relaxed transaction
+ */
+static void
+set_relaxed(uint64_t *field, uint64_t value, uint64_t *other, uint64_t ovalue)
+{
+	TX_BEGIN_PARAM(pop, TX_PARAM_RELAXED_DURABILITY, TX_PARAM_NONE) {
+		pmemobj_tx_add_range_direct(field, sizeof(*field));
+		*field = value;
+		if (other != NULL) {
+			pmemobj_tx_add_range_direct(other, sizeof(*other));
+			*other = ovalue;
+		}
+	} TX_ONABORT {
+		UT_ASSERT(0);
+	} TX_END
+}
+
+/*
+ * test_nested -- a relaxed transaction cannot be nested in a durable one
+ */
+static void
+test_nested(void)
+{
+	int aborted = 0;
+	TX_BEGIN(pop) {
+		TX_BEGIN_PARAM(pop, TX_PARAM_RELAXED_DURABILITY,
+				TX_PARAM_NONE) {
+			UT_ASSERT(0);
+		} TX_END
+	} TX_ONABORT {
+		UT_ASSERTeq(errno, EINVAL);
+		aborted = 1;
+	} TX_END
+
+	UT_ASSERT(aborted);
+
+	/* but a durable transaction can be nested in a relaxed one */
+	TX_BEGIN_PARAM(pop, TX_PARAM_RELAXED_DURABILITY, TX_PARAM_NONE) {
+		TX_BEGIN(pop) {
+			pmemobj_tx_add_range_direct(&rootp->a,
+				sizeof(rootp->a));
+			rootp->a = 0;
+		} TX_ONABORT {
+			UT_ASSERT(0);
+		} TX_END
+	} TX_ONABORT {
+		UT_ASSERT(0);
+	} TX_END
+}
+
+/*
+ * test_crash -- exits with committed but not durable relaxed transactions
+ *	and a durable one in progress, all modifying the same data
+ */
+static void
+test_crash(void)
+{
+	set_relaxed(&rootp->a, 1, NULL, 0);
+	int ret = pmemobj_ctl_exec(pop, "tx.epoch.sync", NULL);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(epoch_get("tx.epoch.durable"), 2);
+	UT_ASSERTeq(epoch_get("tx.epoch.last"), 2);
+
+	set_relaxed(&rootp->a, 2, &rootp->b, 1);
+	set_relaxed(&rootp->a, 3, &rootp->c, 1);
+	UT_ASSERTeq(epoch_get("tx.epoch.durable"), 2);
+	UT_ASSERTeq(epoch_get("tx.epoch.last"), 4);
+
+	UT_ASSERTeq(rootp->a, 3);
+	UT_ASSERTeq(rootp->b, 1);
+	UT_ASSERTeq(rootp->c, 1);
+
+	TX_BEGIN(pop) {
+		pmemobj_tx_add_range_direct(rootp, sizeof(*rootp));
+		rootp->a = 4;
+		rootp->b = 2;
+		rootp->c = 2;
+
+		DONE(NULL);
+	} TX_END
+}
+
+/*
+ * test_recovered -- checks that only the durable relaxed transactions
+ *	survived the crash
+ */
+static void
+test_recovered(void)
+{
+	UT_ASSERTeq(epoch_get("tx.epoch.durable"), 2);
+	UT_ASSERTeq(epoch_get("tx.epoch.last"), 2);
+
+	UT_ASSERTeq(rootp->a, 1);
+	UT_ASSERTeq(rootp->b, 0);
+	UT_ASSERTeq(rootp->c, 0);
+}
+
+/*
+ * test_durable_commit -- a durable commit makes the preceding relaxed
+ *	transactions durable
+ */
+static void
+test_durable_commit(void)
+{
+	set_relaxed(&rootp->a, 5, NULL, 0);
+	UT_ASSERTeq(epoch_get("tx.epoch.durable"), 2);
+
+	TX_BEGIN(pop) {
+		pmemobj_tx_add_range_direct(&rootp->b, sizeof(rootp->b));
+		rootp->b = 5;
+	} TX_ONABORT {
+		UT_ASSERT(0);
+	} TX_END
+
+	UT_ASSERTeq(epoch_get("tx.epoch.durable"), 3);
+
+	/* and so does a relaxed one which allocates */
+	TX_BEGIN_PARAM(pop, TX_PARAM_RELAXED_DURABILITY, TX_PARAM_NONE) {
+		pmemobj_tx_add_range_direct(&rootp->c, sizeof(rootp->c));
+		rootp->c = 5;
+		pmemobj_tx_alloc(64, 0);
+	} TX_ONABORT {
+		UT_ASSERT(0);
+	} TX_END
+
+	UT_ASSERTeq(epoch_get("tx.epoch.durable"), 3);
+	UT_ASSERTeq(epoch_get("tx.epoch.last"), 3);
+}
+
+/*
+ * test_alloc_crash -- exits after a relaxed transaction modified the
+ *	destination of an atomic allocation, which must not be rolled back
+ */
+static void
+test_alloc_crash(void)
+{
+	TX_BEGIN_PARAM(pop, TX_PARAM_RELAXED_DURABILITY, TX_PARAM_NONE) {
+		pmemobj_tx_add_range_direct(&rootp->ptr, sizeof(rootp->ptr));
+		rootp->ptr.pool_uuid_lo = 1;
+		rootp->ptr.off = 1;
+	} TX_ONABORT {
+		UT_ASSERT(0);
+	} TX_END
+
+	UT_ASSERTeq(epoch_get("tx.epoch.durable"), 0);
+	UT_ASSERTeq(epoch_get("tx.epoch.last"), 1);
+
+	int ret = pmemobj_alloc(pop, &rootp->ptr, OBJ_SIZE, OBJ_TYPE,
+		NULL, NULL);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(epoch_get("tx.epoch.durable"), 1);
+
+	/* this one is not durable and gets rolled back */
+	set_relaxed(&rootp->a, 1, NULL, 0);
+	UT_ASSERTeq(epoch_get("tx.epoch.durable"), 1);
+	UT_ASSERTeq(epoch_get("tx.epoch.last"), 2);
+
+	DONE(NULL);
+}
+
+/*
+ * test_alloc_recovered -- checks that the allocated object is still
+ *	reachable after the crash
+ */
+static void
+test_alloc_recovered(void)
+{
+	UT_ASSERTeq(epoch_get("tx.epoch.durable"), 1);
+	UT_ASSERTeq(rootp->a, 0);
+
+	UT_ASSERT(!OID_IS_NULL(rootp->ptr));
+	UT_ASSERTeq(rootp->ptr.pool_uuid_lo, pmemobj_oid(rootp).pool_uuid_lo);
+	UT_ASSERTeq(pmemobj_type_num(rootp->ptr), OBJ_TYPE);
+
+	PMEMoid oid = POBJ_FIRST_TYPE_NUM(pop, OBJ_TYPE);
+	UT_ASSERT(OID_EQUALS(oid, rootp->ptr));
+}
+
+/*
+ * worker -- makes the committed relaxed transactions durable until stopped
+ */
+static void *
+worker(void *arg)
+{
+	int ret = pmemobj_ctl_exec(pop, "tx.epoch.worker", NULL);
+	UT_ASSERTeq(ret, 0);
+
+	return NULL;
+}
+
+/*
+ * tx_thread -- commits relaxed transactions
+ */
+static void *
+tx_thread(void *arg)
+{
+	unsigned idx = *(unsigned *)arg;
+
+	for (unsigned i = 0; i < NOPS; ++i)
+		set_relaxed(&rootp->counters[idx], i + 1, NULL, 0);
+
+	return NULL;
+}
+
+/*
+ * run_transactions -- commits relaxed transactions from multiple threads
+ */
+static void
+run_transactions(void)
+{
+	os_thread_t threads[NTHREADS];
+	unsigned idx[NTHREADS];
+
+	for (unsigned i = 0; i < NTHREADS; ++i) {
+		idx[i] = i;
+		PTHREAD_CREATE(&threads[i], NULL, tx_thread, &idx[i]);
+	}
+
+	for (unsigned i = 0; i < NTHREADS; ++i)
+		PTHREAD_JOIN(&threads[i], NULL);
+}
+
+/*
+ * test_worker -- commits relaxed transactions with and without the worker
+ */
+static void
+test_worker(void)
+{
+	int interval;
+	int ret = pmemobj_ctl_get(pop, "tx.epoch.interval", &interval);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(interval, 10);
+
+	interval = 0;
+	ret = pmemobj_ctl_set(pop, "tx.epoch.interval", &interval);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	interval = 1;
+	ret = pmemobj_ctl_set(pop, "tx.epoch.interval", &interval);
+	UT_ASSERTeq(ret, 0);
+
+	os_thread_t w;
+	PTHREAD_CREATE(&w, NULL, worker, NULL);
+
+	run_transactions();
+
+	ret = pmemobj_ctl_exec(pop, "tx.epoch.stop", NULL);
+	UT_ASSERTeq(ret, 0);
+	PTHREAD_JOIN(&w, NULL);
+
+	UT_ASSERTeq(epoch_get("tx.epoch.durable"),
+		epoch_get("tx.epoch.last"));
+
+	/* without the worker the lanes are reclaimed by the committers */
+	run_transactions();
+
+	for (unsigned i = 0; i < NTHREADS; ++i)
+		UT_ASSERTeq(rootp->counters[i], NOPS);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "obj_tx_relaxed");
+
+	if (argc != 3 || strchr("coar", argv[2][0]) == NULL)
+		UT_FATAL("usage: %s file-name c|o|a|r", argv[0]);
+
+	const char *path = argv[1];
+
+	if (argv[2][0] == 'a') {
+		pop = pmemobj_create(path, LAYOUT, PMEMOBJ_MIN_POOL,
+			S_IWUSR | S_IRUSR);
+		if (pop == NULL)
+			UT_FATAL("!pmemobj_create: %s", path);
+
+		rootp = pmemobj_direct(pmemobj_root(pop, sizeof(*rootp)));
+
+		test_alloc_crash();
+	} else if (argv[2][0] == 'r') {
+		pop = pmemobj_open(path, LAYOUT);
+		if (pop == NULL)
+			UT_FATAL("!pmemobj_open: %s", path);
+
+		rootp = pmemobj_direct(pmemobj_root(pop, sizeof(*rootp)));
+
+		test_alloc_recovered();
+
+		pmemobj_close(pop);
+
+		int ret = pmemobj_check(path, LAYOUT);
+		UT_ASSERTeq(ret, 1);
+	} else if (argv[2][0] == 'c') {
+		pop = pmemobj_create(path, LAYOUT, PMEMOBJ_MIN_POOL,
+			S_IWUSR | S_IRUSR);
+		if (pop == NULL)
+			UT_FATAL("!pmemobj_create: %s", path);
+
+		rootp = pmemobj_direct(pmemobj_root(pop, sizeof(*rootp)));
+
+		UT_ASSERTeq(epoch_get("tx.epoch.durable"), 0);
+		UT_ASSERTeq(epoch_get("tx.epoch.last"), 0);
+
+		test_nested();
+		UT_ASSERTeq(epoch_get("tx.epoch.last"), 1);
+		test_crash();
+	} else {
+		pop = pmemobj_open(path, LAYOUT);
+		if (pop == NULL)
+			UT_FATAL("!pmemobj_open: %s", path);
+
+		rootp = pmemobj_direct(pmemobj_root(pop, sizeof(*rootp)));
+
+		test_recovered();
+		test_durable_commit();
+		test_worker();
+
+		pmemobj_close(pop);
+
+		int ret = pmemobj_check(path, LAYOUT);
+		UT_ASSERTeq(ret, 1);
+	}
+
+	DONE(NULL);
+}
@@ -135,6 +135,7 @@ info_obj_redo_entry(struct ulog_entry_base *e, void *arg,
 {
 	struct info_obj_redo_args *a = arg;
 	struct ulog_entry_val *ev;
+	struct ulog_entry_vals *evs;
 	struct ulog_entry_buf *eb;
 
 	switch (ulog_entry_type(e)) {
@@ -150,8 +151,22 @@ info_obj_redo_entry(struct ulog_entry_base *e, void *arg,
 				ulog_entry_offset(e),
 				ev->value);
 			break;
+		case ULOG_OPERATION_SET_RUN:
+			evs = (struct ulog_entry_vals *)e;
+
+			for (uint64_t i = 0; i < evs->nvalues; ++i) {
+				outv(a->v, "%010zu: "
+					"Offset: 0x%016jx "
+					"Value: 0x%016jx ",
+					a->i++,
+					ulog_entry_offset(e) +
+						i * sizeof(uint64_t),
+					evs->values[i]);
+			}
+			break;
 		case ULOG_OPERATION_BUF_CPY:
 		case ULOG_OPERATION_BUF_SET:
+		case ULOG_OPERATION_BUF_CAS:
 			eb = (struct ulog_entry_buf *)e;
 
 			outv(a->v, "%010zu: "